@@ -0,0 +1,24 @@
+#version 140
+
+// Passed from the vertex shader
+in vec2 uv0;
+
+// Passed from outside
+uniform sampler2D accumulation_map;
+uniform sampler2D revealage_map;
+
+void main() 
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float revealage = texelFetch(revealage_map, texel, 0).r;
+	// Nothing transparent covers this pixel
+	if (revealage == 1.0) {
+		discard;
+	}
+
+	vec4 accumulation = texelFetch(accumulation_map, texel, 0);
+	// Weighted average of the colors; the blending keeps 'revealage' of
+	// the opaque scene behind them
+	vec3 average = accumulation.rgb / clamp(accumulation.a, 1e-4, 5e4);
+	gl_FragColor = vec4(average, revealage);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// Attributes passed from the vertex shader
+in vec2 uv_interp;
+flat in float layer_interp;
+
+// Uniform (global) buffer
+uniform sampler2DArray texture_map; // One layer per member of the family
+
+
+void main()
+{
+    // Same alpha test as the family material, so that the main pass
+    // finds the depth of every fragment it keeps
+    if (texture(texture_map, vec3(uv_interp, layer_interp)).a < 0.1) {
+        discard;
+    }
+}
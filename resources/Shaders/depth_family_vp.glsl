@@ -0,0 +1,46 @@
+#version 330 core
+
+// Depth pre-pass of instanced families: positions, and the texture
+// coordinates for the alpha test of the leaves
+
+// Vertex buffer
+in vec3 vertex;
+in vec2 uv;
+in vec4 instancePosition; // xyz position, w scale
+in vec4 instanceRotation; // Quaternion
+in float instanceLayer;
+
+// Uniform (global) buffer
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+// Attributes forwarded to the fragment shader
+out vec2 uv_interp;
+flat out float layer_interp;
+
+
+// Computed as by the materials of the main pass, so that the depths match exactly
+invariant gl_Position;
+
+
+// Same instance transform as lit_textured_material_family_vp
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec3 instanceTransform(vec4 q, vec3 v)
+{
+    return rotate(q, v * instancePosition.w) + instancePosition.xyz;
+}
+
+
+void main()
+{
+    vec4 q = normalize(instanceRotation);
+    gl_Position = projection_mat * view_mat * vec4(instanceTransform(q, vertex), 1.0);
+
+    uv_interp = uv;
+
+    layer_interp = instanceLayer;
+}
@@ -0,0 +1,8 @@
+#version 140
+
+// Only the depth is written
+
+
+void main()
+{
+}
@@ -0,0 +1,21 @@
+#version 140
+
+// Depth pre-pass of meshes: positions only
+
+// Vertex buffer
+in vec3 vertex;
+
+// Uniform (global) buffer
+uniform mat4 world_mat;
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+
+// Computed as by the materials of the main pass, so that the depths match exactly
+invariant gl_Position;
+
+
+void main()
+{
+    gl_Position = projection_mat * view_mat * vec4(vec3(world_mat * vec4(vertex, 1.0)), 1.0);
+}
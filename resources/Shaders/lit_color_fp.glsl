@@ -1,4 +1,4 @@
-#version 130
+#version 140
 
 // Attributes passed from the vertex shader
 in vec3 position_interp;
@@ -6,11 +6,16 @@ in vec3 normal_interp;
 in vec4 color_interp;
 in vec2 uv_interp;
 
+// Parameters of the material
+layout(std140) uniform MaterialBlock {
+	vec4 object_color;
+	vec4 light_color;
+	vec4 ambient_light_color;
+	float specular_power;
+};
+
 // Uniform (global) buffer
-uniform vec4 object_color;
 uniform vec3 light_position;
-uniform vec4 light_color;
-uniform float specular_power;
 uniform vec3 camera_position;
 
 void main() 
@@ -0,0 +1,47 @@
+#version 140
+#extension GL_ARB_shader_draw_parameters : enable
+
+// Vertex buffer
+in vec3 vertex;
+in vec3 normal;
+in vec3 color;
+in vec2 uv;
+
+// Uniform (global) buffer
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+// World matrix then normal matrix of each draw of the batch, 8 texels per draw
+uniform samplerBuffer draw_data;
+
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_INDEX gl_DrawIDARB
+#else
+uniform int draw_index; // Set before each draw without the extension
+#define DRAW_INDEX draw_index
+#endif
+
+// Attributes forwarded to the fragment shader
+out vec3 normal_interp;
+out vec4 color_interp;
+out vec2 uv_interp;
+out vec3 fragPos;
+
+
+void main()
+{
+    int base = DRAW_INDEX * 8;
+    mat4 world_mat = mat4(texelFetch(draw_data, base), texelFetch(draw_data, base + 1),
+                          texelFetch(draw_data, base + 2), texelFetch(draw_data, base + 3));
+    mat3 normal_mat = mat3(texelFetch(draw_data, base + 4).xyz, texelFetch(draw_data, base + 5).xyz,
+                           texelFetch(draw_data, base + 6).xyz);
+
+    fragPos = vec3(world_mat * vec4(vertex, 1.0));
+    gl_Position = projection_mat * view_mat * vec4(fragPos, 1.0);
+    
+    normal_interp = normal_mat * normal;
+
+    color_interp = vec4(color, 1.0);
+
+    uv_interp = uv;
+}
@@ -0,0 +1,58 @@
+#version 330 core
+
+// Vertex buffer
+in vec3 vertex;
+in vec3 normal;
+in vec3 color;
+in vec2 uv;
+in vec4 instancePosition; // xyz position, w scale
+in vec4 instanceRotation; // Quaternion
+in float instanceLayer;
+in vec4 instanceTint;
+
+// Uniform (global) buffer
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+// Attributes forwarded to the fragment shader
+out vec3 normal_interp;
+out vec4 color_interp;
+out vec2 uv_interp;
+out vec3 fragPos;
+flat out float layer_interp;
+flat out vec4 tint_interp;
+
+
+// Computed as by the depth pre-pass, so that the depths match exactly
+invariant gl_Position;
+
+
+// Instance transform: uniform scale, then the rotation, then the position.
+// Cheaper than a matrix per instance and, as the scale is uniform, the
+// rotation alone turns the normals
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec3 instanceTransform(vec4 q, vec3 v)
+{
+    return rotate(q, v * instancePosition.w) + instancePosition.xyz;
+}
+
+
+void main()
+{
+    vec4 q = normalize(instanceRotation);
+    fragPos = instanceTransform(q, vertex);
+    gl_Position = projection_mat * view_mat * vec4(fragPos, 1.0);
+    
+    normal_interp = rotate(q, normal);
+
+    color_interp = vec4(color, 1.0);
+
+    uv_interp = uv;
+
+    layer_interp = instanceLayer;
+    tint_interp = instanceTint;
+}
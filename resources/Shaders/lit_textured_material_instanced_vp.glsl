@@ -5,7 +5,8 @@ in vec3 vertex;
 in vec3 normal;
 in vec3 color;
 in vec2 uv;
-in mat4 instanceMatrix;
+in vec4 instancePosition; // xyz position, w scale
+in vec4 instanceRotation; // Quaternion
 
 // Uniform (global) buffer
 uniform mat4 view_mat;
@@ -18,12 +19,29 @@ out vec2 uv_interp;
 out vec3 fragPos;
 
 
+// Computed as by the depth pre-pass, so that the depths match exactly
+invariant gl_Position;
+
+
+// Uniform scale, rotation, then translation of the instance
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec3 instanceTransform(vec4 q, vec3 v)
+{
+    return rotate(q, v * instancePosition.w) + instancePosition.xyz;
+}
+
+
 void main()
 {
-    fragPos = vec3(instanceMatrix * vec4(vertex, 1.0));
+    vec4 q = normalize(instanceRotation);
+    fragPos = instanceTransform(q, vertex);
     gl_Position = projection_mat * view_mat * vec4(fragPos, 1.0);
     
-    normal_interp = mat3(transpose(inverse(instanceMatrix))) * normal;
+    normal_interp = rotate(q, normal);
 
     color_interp = vec4(color, 1.0);
 
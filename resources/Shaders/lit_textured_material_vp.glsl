@@ -18,6 +18,10 @@ out vec2 uv_interp;
 out vec3 fragPos;
 
 
+// Computed as by the depth pre-pass, so that the depths match exactly
+invariant gl_Position;
+
+
 void main()
 {
     fragPos = vec3(world_mat * vec4(vertex, 1.0));
@@ -15,9 +15,13 @@ uniform mat4 projection_mat;
 out vec4 color_interp;
 
 
+// Computed as by the depth pre-pass, so that the depths match exactly
+invariant gl_Position;
+
+
 void main()
 {
-    gl_Position = projection_mat * view_mat * world_mat * vec4(vertex, 1.0);
+    gl_Position = projection_mat * view_mat * vec4(vec3(world_mat * vec4(vertex, 1.0)), 1.0);
 
     color_interp = vec4(color, 1.0);
 }
@@ -0,0 +1,97 @@
+#version 400
+
+// Particle state, read from one buffer and captured into the other
+in vec4 particlePosition; // w: age
+in vec4 particleVelocity; // w: lifetime
+in uint particleEmitter;
+
+// Captured outputs
+out vec4 out_position;
+out vec4 out_velocity;
+
+// Emitters, as laid out by ParticleSystem
+struct Emitter {
+    vec4 position; // w: attraction
+    vec4 velocity; // w: spread
+    vec4 acceleration; // w: lifetime
+    vec4 color;
+    vec4 size; // x: size, y: 1 while the emitter exists
+    uvec4 spawn; // First particle, particles, spawn counter before and after this update
+};
+
+layout(std140) uniform Emitters {
+    Emitter emitters[64];
+};
+
+uniform float delta_time;
+uniform uint seed;
+
+const float two_pi = 6.2831853072;
+
+
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+
+float random(inout uint state)
+{
+    state = hash(state);
+    return float(state) / 4294967295.0;
+}
+
+
+void main()
+{
+    Emitter emitter = emitters[particleEmitter];
+    vec3 position = particlePosition.xyz;
+    float age = particlePosition.w;
+    vec3 velocity = particleVelocity.xyz;
+    float lifetime = particleVelocity.w;
+
+    // Particles left by a removed emitter, or outside the range of the
+    // emitter they point to, die at once
+    uint index = uint(gl_VertexID) - emitter.spawn.x;
+    if (emitter.size.y == 0.0 || index >= emitter.spawn.y) {
+        out_position = vec4(position, 0.0);
+        out_velocity = vec4(velocity, 0.0);
+        return;
+    }
+
+    if (age < lifetime) {
+        // Move under the acceleration and the pull of the emitter
+        vec3 acceleration = emitter.acceleration.xyz + (emitter.position.xyz - position) * emitter.position.w;
+        velocity += acceleration * delta_time;
+        position += velocity * delta_time;
+        age += delta_time;
+    }
+    else {
+        // The emitter spawns the particles due this update into its range
+        // in turn; a particle whose turn comes while it is dead respawns
+        uint turn = (index + emitter.spawn.y - emitter.spawn.z % emitter.spawn.y) % emitter.spawn.y;
+        if (turn < emitter.spawn.w - emitter.spawn.z) {
+            uint state = hash(uint(gl_VertexID) ^ hash(seed));
+
+            // Random direction, with a speed spread over the ball
+            float z = 2.0 * random(state) - 1.0;
+            float angle = two_pi * random(state);
+            float radius = sqrt(1.0 - z * z);
+            vec3 direction = vec3(radius * cos(angle), radius * sin(angle), z);
+            float speed = emitter.velocity.w * pow(random(state), 1.0 / 3.0);
+
+            position = emitter.position.xyz;
+            velocity = emitter.velocity.xyz + direction * speed;
+            age = 0.0;
+            lifetime = emitter.acceleration.w * (0.75 + 0.5 * random(state));
+        }
+    }
+
+    out_position = vec4(position, age);
+    out_velocity = vec4(velocity, lifetime);
+}
@@ -0,0 +1,23 @@
+#version 400
+
+// Attributes passed from the vertex shader
+in vec4 frag_color;
+in vec2 tex_coord;
+
+// Weighted sums of the transparency pass
+layout(location = 0) out vec4 accumulation;
+layout(location = 1) out float revealage;
+
+// Uniform (global) buffer
+uniform sampler2D tex_samp;
+
+
+void main (void)
+{
+    // Tint the texture with the color of the emitter
+    vec4 color = texture(tex_samp, tex_coord) * frag_color;
+    // Nearer fragments weigh more, so the blend favours the front ones
+    float weight = color.a * max(0.01, 3000.0 * pow(1.0 - gl_FragCoord.z, 3.0));
+    accumulation = vec4(color.rgb * color.a, color.a) * weight;
+    revealage = color.a;
+}
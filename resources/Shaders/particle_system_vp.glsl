@@ -0,0 +1,56 @@
+#version 400
+
+// Particle state, one particle per instance; the four vertices of an
+// instance are the corners of its quad
+in vec4 particlePosition; // w: age
+in vec4 particleVelocity; // w: lifetime
+in uint particleEmitter;
+
+// Emitters, as laid out by ParticleSystem
+struct Emitter {
+    vec4 position;
+    vec4 velocity;
+    vec4 acceleration;
+    vec4 color;
+    vec4 size; // x: size, y: 1 while the emitter exists
+    uvec4 spawn;
+};
+
+layout(std140) uniform Emitters {
+    Emitter emitters[64];
+};
+
+// Uniform (global) buffer
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+// Attributes forwarded to the fragment shader
+out vec4 frag_color;
+out vec2 tex_coord;
+
+
+void main()
+{
+    Emitter emitter = emitters[particleEmitter];
+    float age = particlePosition.w;
+    float lifetime = particleVelocity.w;
+
+    // Corner of the quad: (0, 0), (1, 0), (0, 1), (1, 1) as a triangle strip
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    tex_coord = corner;
+
+    // Dead particles collapse outside of the view
+    if (age >= lifetime) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        frag_color = vec4(0.0);
+        return;
+    }
+
+    // Quad facing the camera, around the particle in view space
+    vec4 position = view_mat * vec4(particlePosition.xyz, 1.0);
+    gl_Position = projection_mat * vec4(position.xy + (corner - 0.5) * emitter.size.x, position.z, 1.0);
+
+    // Fade in and out over the life of the particle
+    float life = clamp(age / max(lifetime, 0.0001), 0.0, 1.0);
+    frag_color = vec4(emitter.color.rgb, emitter.color.a * sin(3.1415926536 * life));
+}
@@ -7,11 +7,16 @@ in vec3 normal_interp;
 in vec4 color_interp;
 in vec2 uv_interp;
 
+// Parameters of the material
+layout(std140) uniform MaterialBlock {
+	vec4 object_color;
+	vec4 light_color;
+	vec4 ambient_light_color;
+	float specular_power;
+};
+
 // Uniform (global) buffer
 uniform sampler2D texture_map;
-uniform vec4 light_color;
-uniform vec4 ambient_light_color;
-uniform float specular_power;
 uniform vec3 camera_position;
 uniform vec3 flashlight_pos;
 uniform vec3 flashlight_dir;
@@ -19,6 +24,44 @@ uniform float cutoff;
 uniform float falloffRate;
 uniform float distanceFactor;
 
+// Point lights, listed per cluster of the view: screen tiles split along the depth
+uniform samplerBuffer light_data; // Position and radius, then color and intensity, per light
+uniform usamplerBuffer light_clusters; // First index and count, per cluster
+uniform usamplerBuffer light_indices;
+uniform ivec3 cluster_count;
+uniform vec2 cluster_tile_size; // In pixels
+uniform vec2 cluster_depth; // Slice = log(depth) * x - y
+
+// Light of the point lights of the cluster of the fragment
+vec3 pointLights(vec3 N, vec3 V, vec3 position)
+{
+	float depth = 1.0 / gl_FragCoord.w;
+	ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / cluster_tile_size), int(floor(log(depth) * cluster_depth.x - cluster_depth.y)));
+	cluster = clamp(cluster, ivec3(0), cluster_count - 1);
+	uvec2 range = texelFetch(light_clusters, (cluster.z * cluster_count.y + cluster.y) * cluster_count.x + cluster.x).xy;
+
+	vec3 light = vec3(0.0);
+	for (uint i = 0u; i < range.y; i++) {
+		int index = int(texelFetch(light_indices, int(range.x + i)).r);
+		vec4 position_radius = texelFetch(light_data, 2 * index);
+		vec4 color = texelFetch(light_data, 2 * index + 1);
+
+		vec3 L = position_radius.xyz - position;
+		float distance = length(L);
+		L /= max(distance, 0.0001);
+		vec3 H = normalize(L + V);
+
+		// Smooth falloff, down to zero at the radius
+		float falloff = clamp(1.0 - (distance * distance) / (position_radius.w * position_radius.w), 0.0, 1.0);
+		falloff *= falloff;
+
+		float diffuse = max(0.0, dot(N, L));
+		float specular = pow(max(0.0, dot(N, H)), specular_power);
+		light += (diffuse + specular) * falloff * color.rgb * color.a;
+	}
+	return light;
+}
+
 void main() 
 {
     // Retrieve texture value
@@ -62,5 +105,6 @@ void main()
     gl_FragColor = 
 	 	diffuse * pixel * light_color            // Diffuse Component
 	 	+ specular * pixel * light_color		// Specular Component
-		+ amb * pixel * ambient_light_color;             // Ambient Component
+		+ amb * pixel * ambient_light_color             // Ambient Component
+		+ vec4(pointLights(N, V, fragPos) * pixel.rgb, 0.0); // Point lights of the cluster
 }
@@ -0,0 +1,18 @@
+#version 330 core
+
+// Copies a texture into the bound render target, resampling it to the
+// size of the target
+
+// Attributes passed from the vertex shader
+in vec2 uv_interp;
+
+// Uniform (global) buffer
+uniform sampler2D texture_map;
+
+out vec4 frag_color;
+
+
+void main()
+{
+    frag_color = texture(texture_map, uv_interp);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+// Full screen triangle generated from the vertex index, so no vertex
+// buffer is needed
+
+// Attributes forwarded to the fragment shader
+out vec2 uv_interp;
+
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    uv_interp = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
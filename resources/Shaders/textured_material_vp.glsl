@@ -24,9 +24,13 @@ out vec3 fragPos;
 uniform vec3 light_position = vec3(-0.5, -0.5, 1.5);
 
 
+// Computed as by the depth pre-pass, so that the depths match exactly
+invariant gl_Position;
+
+
 void main()
 {
-    gl_Position = projection_mat * view_mat * world_mat * vec4(vertex, 1.0);
+    gl_Position = projection_mat * view_mat * vec4(vec3(world_mat * vec4(vertex, 1.0)), 1.0);
 
     position_interp = vec3(view_mat * world_mat * vec4(vertex, 1.0));
     
@@ -1,9 +1,13 @@
 #version 400
 
-// Attributes passed from the geometry shader
+// Attributes passed from the vertex shader
 in vec4 frag_color;
 in vec2 tex_coord;
 
+// Weighted sums of the transparency pass
+layout(location = 0) out vec4 accumulation;
+layout(location = 1) out float revealage;
+
 // Uniform (global) buffer
 uniform sampler2D tex_samp;
 
@@ -17,6 +21,8 @@ void main (void)
     vec4 outval = texture(tex_samp, tex_coord);
     // Adjust specified object color according to the grayscale texture value
     //outval = vec4(outval.r*object_color.r, outval.g*object_color.g, outval.b*object_color.b, sqrt(sqrt(outval.r))*frag_color.a);
-    // Set output fragment color
-    gl_FragColor = outval;
+    // Nearer fragments weigh more, so the blend favours the front ones
+    float weight = outval.a * max(0.01, 3000.0 * pow(1.0 - gl_FragCoord.z, 3.0));
+    accumulation = vec4(outval.rgb * outval.a, outval.a) * weight;
+    revealage = outval.a;
 }
@@ -1,6 +1,7 @@
 #version 400
 
-// Vertex buffer
+// Particle, one per instance; the four vertices of an instance are the
+// corners of its quad
 in vec3 vertex;
 in vec3 normal;
 in vec3 color;
@@ -8,17 +9,19 @@ in vec3 color;
 // Uniform (global) buffer
 uniform mat4 world_mat;
 uniform mat4 view_mat;
+uniform mat4 projection_mat;
 uniform mat4 normal_mat;
 uniform float timer;
 
-// Attributes forwarded to the geometry shader
-out vec4 particle_color;
-out float particle_id;
+// Attributes forwarded to the fragment shader
+out vec4 frag_color;
+out vec2 tex_coord;
 
 // Simulation parameters (constants)
 uniform vec3 up_vec = vec3(0.0, 1.0, 0.0); // Up direction
 float accel = 1; // An acceleration applied to the particles coming from some attraction force
 float speed = 0.5; // Control the speed of the motion
+float particle_size = 2;
 
 // Define some useful constants
 const float pi = 3.1415926536;
@@ -29,7 +32,7 @@ const float two_pi = 2.0*pi;
 void main()
 {
     // Define particle id
-    particle_id = color.r; // Derived from the particle color. We use the id to keep track of particles
+    float particle_id = color.r; // Derived from the particle color. We use the id to keep track of particles
 
     // Define time in a cyclic manner
     float phase = two_pi*particle_id; // Start the sin wave later depending on the particle_id
@@ -44,10 +47,15 @@ void main()
     vec3 position = vertex;
     position += up_vec*speed*t; // Particle moves up
     
-    // Define output position but do not apply the projection matrix yet
-    gl_Position = view_mat * world_mat * vec4(position, 1.0);
-    
+    // Position in view space, where the quad faces the camera
+    vec4 view_position = view_mat * world_mat * vec4(position, 1.0);
+
+    // Corner of the quad: (0, 0), (1, 0), (0, 1), (1, 1) as a triangle strip
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = projection_mat * vec4(view_position.xy + (corner - 0.5) * particle_size, view_position.z, 1.0);
+    tex_coord = corner;
+
     // Define amount of blending depending on the cyclic time
     float alpha = 1.0 - circtime*circtime;
-    particle_color = vec4(1.0, 1.0, 1.0, alpha);
+    frag_color = vec4(vec3(0.0), alpha);
 }
@@ -0,0 +1,164 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "benchmark.h"
+#include "vertex_format.h"
+
+namespace game {
+
+double BenchmarkTime(void){
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void PrintResult(const std::string& name, double value, const std::string& unit){
+
+    printf("  %-40s %10.3f %s\n", (name + ":").c_str(), value, unit.c_str());
+}
+
+
+static GLFWwindow* window_g = NULL;
+
+
+bool CreateBenchmarkContext(void){
+
+    if (!glfwInit()){
+        fprintf(stderr, "Could not initialize the GLFW library\n");
+        return false;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window_g = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (!window_g){
+        fprintf(stderr, "Could not create window\n");
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(window_g);
+    glfwSwapInterval(0);
+
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if (err != GLEW_OK){
+        fprintf(stderr, "Could not initialize the GLEW library: %s\n", (const char*)glewGetErrorString(err));
+        DestroyBenchmarkContext();
+        return false;
+    }
+
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+    return true;
+}
+
+
+void DestroyBenchmarkContext(void){
+
+    if (window_g){
+        glfwDestroyWindow(window_g);
+        window_g = NULL;
+    }
+    glfwTerminate();
+}
+
+
+static GLuint CompileShader(GLenum type, const std::string& filename){
+
+    std::ifstream f(filename.c_str());
+    std::stringstream source;
+    source << f.rdbuf();
+    std::string text = source.str();
+    const char* text_ptr = text.c_str();
+
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &text_ptr, NULL);
+    glCompileShader(shader);
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE){
+        char buffer[512];
+        glGetShaderInfoLog(shader, 512, NULL, buffer);
+        fprintf(stderr, "Error compiling %s: %s\n", filename.c_str(), buffer);
+    }
+    return shader;
+}
+
+
+GLuint LoadBenchmarkProgram(const std::string& vp, const std::string& gp, const std::string& fp){
+
+    GLuint program = glCreateProgram();
+    std::vector<GLuint> shaders;
+    shaders.push_back(CompileShader(GL_VERTEX_SHADER, vp));
+    if (!gp.empty()){
+        shaders.push_back(CompileShader(GL_GEOMETRY_SHADER, gp));
+    }
+    shaders.push_back(CompileShader(GL_FRAGMENT_SHADER, fp));
+    for (size_t i = 0; i < shaders.size(); i++){
+        glAttachShader(program, shaders[i]);
+    }
+    BindVertexAttributeLocations(program);
+    glLinkProgram(program);
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE){
+        char buffer[512];
+        glGetProgramInfoLog(program, 512, NULL, buffer);
+        fprintf(stderr, "Error linking %s: %s\n", vp.c_str(), buffer);
+    }
+    for (size_t i = 0; i < shaders.size(); i++){
+        glDeleteShader(shaders[i]);
+    }
+    return program;
+}
+
+
+StepTimer::StepTimer(void){
+
+    glGenQueries(1, &query_);
+    start_ = gpu_ = wall_ = 0.0;
+}
+
+
+StepTimer::~StepTimer(){
+
+    glDeleteQueries(1, &query_);
+}
+
+
+void StepTimer::Begin(void){
+
+    glFinish();
+    start_ = BenchmarkTime();
+    glBeginQuery(GL_TIME_ELAPSED, query_);
+}
+
+
+void StepTimer::End(void){
+
+    glEndQuery(GL_TIME_ELAPSED);
+    glFinish();
+    wall_ += (BenchmarkTime() - start_) * 1000.0;
+
+    GLuint64 nanoseconds;
+    glGetQueryObjectui64v(query_, GL_QUERY_RESULT, &nanoseconds);
+    gpu_ += nanoseconds / 1.0e6;
+}
+
+
+double StepTimer::GetGpu(void) const{
+
+    return gpu_;
+}
+
+
+double StepTimer::GetWall(void) const{
+
+    return wall_;
+}
+
+} // namespace game
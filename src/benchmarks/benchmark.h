@@ -0,0 +1,50 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <string>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    // Seconds on a steady clock
+    double BenchmarkTime(void);
+
+    // Print one measurement as "name: value unit", aligned with the others
+    void PrintResult(const std::string& name, double value, const std::string& unit);
+
+    // Make the OpenGL context of a hidden window current and load GLEW,
+    // as Game does; false, with the reason printed, if it fails
+    bool CreateBenchmarkContext(void);
+    void DestroyBenchmarkContext(void);
+
+    // Program from a vertex, an optional geometry and a fragment shader
+    // file, with the attribute locations of the game; errors are printed
+    GLuint LoadBenchmarkProgram(const std::string& vp, const std::string& gp, const std::string& fp);
+
+    // Milliseconds spent on the commands issued between Begin and End,
+    // summed over the steps: as a timer query sees them on the GPU, and
+    // until glFinish returns
+    class StepTimer {
+
+        public:
+            StepTimer(void);
+            ~StepTimer();
+
+            void Begin(void);
+            void End(void);
+
+            double GetGpu(void) const;
+            double GetWall(void) const;
+
+        private:
+            GLuint query_;
+            double start_;
+            double gpu_;
+            double wall_;
+
+    }; // class StepTimer
+
+} // namespace game
+
+#endif // BENCHMARK_H_
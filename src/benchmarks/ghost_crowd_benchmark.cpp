@@ -0,0 +1,127 @@
+// Frame time of the ghost crowd against the 60 Hz budget: the flow
+// field, the batched update and the upload of the instances, with the
+// GPU waited for, as Game::MainLoop runs them. Drawing, one instanced
+// call, is left out. Usage: ghost_crowd_benchmark [count ...], 1000,
+// 10000 and 100000 ghosts by default, on the shipped world grid
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "benchmark.h"
+#include "flow_field.h"
+#include "ghost_crowd.h"
+#include "path_config.h"
+#include "world_grid.h"
+#include "world_grid_file.h"
+
+using namespace game;
+
+int main(int argc, char* argv[]) {
+
+    std::vector<int> counts;
+    for (int i = 1; i < argc; i++) {
+        counts.push_back(atoi(argv[i]));
+    }
+    if (counts.empty()) {
+        counts.push_back(1000);
+        counts.push_back(10000);
+        counts.push_back(100000);
+    }
+
+    if (!CreateBenchmarkContext()) {
+        return 1;
+    }
+
+    // The world grid, set up as Game does
+    const char* heightfield = MATERIAL_DIRECTORY "/terrain.heightfield";
+    const char* passability = MATERIAL_DIRECTORY "/impassable.csv";
+    uint64_t stamp = WorldGridFile::StampFiles({ heightfield, passability });
+    std::string cache_path = WorldGridFile::GetCachePath(stamp);
+    WorldGridFile grid_file;
+    if (!grid_file.Open(cache_path, stamp)) {
+        WorldGridFile::Bake(heightfield, passability, cache_path, stamp, 0.1f);
+        grid_file.Open(cache_path, stamp);
+    }
+    std::vector<float> heights(grid_file.GetHeights(), grid_file.GetHeights() + grid_file.GetWidth() * grid_file.GetHeight());
+    WorldGrid grid;
+    grid.SetHeights(grid_file.GetWidth(), grid_file.GetHeight(), grid_file.GetOriginX(), grid_file.GetOriginZ(), grid_file.GetCellSize(), heights);
+    grid.SetPassability(grid_file);
+    int terrain_offset = 100;
+    grid.SetTransform(glm::vec3(terrain_offset * 2, 0, terrain_offset * 2), glm::vec3(100.0f + terrain_offset, 25.0f, 100.0f + terrain_offset));
+
+    // A cube stands in for the ghost mesh, which is not drawn
+    GLfloat vertices[8 * 11] = { 0 };
+    GLuint indices[36] = { 0 };
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    GLuint program = glCreateProgram();
+    GLuint texture;
+    glGenTextures(1, &texture);
+    Resource geometry(Mesh, "Ghost", buffers[0], buffers[1], 36);
+    Resource material(Material, "LitTextureInstancedShader", program, 0);
+    Resource cloth(Texture, "ClothTexture", texture, 0);
+
+    const int frames = 300;
+    const double budget = 1000.0 / 60.0;
+    const glm::vec3 target(700.0f, 0.0f, 700.0f);
+
+    for (int count : counts) {
+        FlowField flow_field;
+        flow_field.Start();
+        GhostCrowd crowd("Ghosts", &geometry, &material, &cloth);
+        crowd.SetScale(0.3f);
+        crowd.SetFlowField(&flow_field);
+
+        // Spread over the playable area, inside the rock wall
+        srand(1);
+        for (int i = 0; i < count; i++) {
+            crowd.Spawn(glm::vec3(-245.0f + rand() % 1890, 35.0f, -245.0f + rand() % 1890));
+        }
+
+        std::vector<double> times;
+        size_t contacts = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            double start = BenchmarkTime();
+            flow_field.Update(target, grid);
+            crowd.Update(target, 1.0f / 60.0f, grid);
+            glFinish();
+            times.push_back((BenchmarkTime() - start) * 1000.0);
+
+            // Send the ghosts that got there back to the far corner
+            const std::vector<uint32_t>& reached = crowd.GetContacts();
+            contacts += reached.size();
+            for (size_t i = 0; i < reached.size(); i++) {
+                crowd.Respawn(reached[i], glm::vec3(1600.0f, 35.0f, 1570.0f));
+            }
+            crowd.ClearContacts();
+        }
+        flow_field.Stop();
+
+        std::sort(times.begin(), times.end());
+        double total = 0.0;
+        for (double time : times) {
+            total += time;
+        }
+        double average = total / frames;
+        printf("%d ghosts, %d frames (%zu contacts)\n", count, frames, contacts);
+        PrintResult("average frame", average, "ms");
+        PrintResult("95th percentile frame", times[frames * 95 / 100], "ms");
+        PrintResult("worst frame", times.back(), "ms");
+        PrintResult("share of the 60 Hz budget", average / budget * 100.0, "%");
+    }
+
+    glDeleteTextures(1, &texture);
+    glDeleteProgram(program);
+    glDeleteBuffers(2, buffers);
+    DestroyBenchmarkContext();
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Load time of the world grid: the text parse the game used to run on
+// every launch against the one time bake and the mapping of the baked
+// file. Usage: grid_load_benchmark [size ...], square grids of 'size'
+// vertices, 100 (the shipped files) and 4096 by default. The synthetic
+// files are written to the temporary directory and removed afterwards
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "world_grid_file.h"
+
+using namespace game;
+
+// The text parse as ResourceManager did it before the binary grid
+static std::vector<std::string> StringSplit(const std::string& str, char separator) {
+    int startIndex = 0, endIndex = 0;
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] == separator) {
+            endIndex = i;
+            std::string token = "";
+            token.append(str, startIndex, endIndex - startIndex);
+            if (!token.empty())
+                tokens.push_back(token);
+            startIndex = endIndex + 1;
+        }
+    }
+    std::string token = "";
+    token.append(str, startIndex, str.size() - startIndex);
+    if (!token.empty())
+        tokens.push_back(token);
+
+    return tokens;
+}
+
+
+static std::string LoadTextFile(const std::string& filename) {
+
+    std::ifstream f(filename);
+    std::string content;
+    std::string line;
+    while (std::getline(f, line)) {
+        content += line + "\n";
+    }
+    return content;
+}
+
+
+// Sum of everything parsed, so that nothing is optimized away
+static double ParseText(const std::string& heightfield, const std::string& passability) {
+
+    double sum = 0.0;
+    std::vector<std::string> lines = StringSplit(LoadTextFile(heightfield), '\n');
+    for (const std::string& line : lines) {
+        for (const std::string& vertex : StringSplit(line, ' ')) {
+            std::vector<std::string> numbers = StringSplit(vertex, ',');
+            if (numbers.size() == 3) {
+                sum += atof(numbers[0].c_str()) + atof(numbers[1].c_str()) + atof(numbers[2].c_str());
+            }
+        }
+    }
+
+    lines = StringSplit(LoadTextFile(passability), '\n');
+    for (const std::string& line : lines) {
+        for (const std::string& cell : StringSplit(line, ',')) {
+            sum += cell == "1";
+        }
+    }
+    return sum;
+}
+
+
+static double TouchGrid(const WorldGridFile& grid) {
+
+    double sum = 0.0;
+    size_t count = static_cast<size_t>(grid.GetWidth()) * grid.GetHeight();
+    const float* heights = grid.GetHeights();
+    const float* uvs = grid.GetUVs();
+    for (size_t i = 0; i < count; i++) {
+        sum += heights[i] + uvs[2 * i] + uvs[2 * i + 1];
+    }
+    for (uint32_t row = 0; row < grid.GetPassabilityHeight(); row++) {
+        for (uint32_t column = 0; column < grid.GetPassabilityWidth(); column++) {
+            sum += grid.IsImpassable(row, column);
+        }
+    }
+    return sum;
+}
+
+
+// Random heights in the format of terrain.heightfield and impassable.csv
+static void WriteGrid(const std::string& heightfield, const std::string& passability, int size) {
+
+    FILE* f = fopen(heightfield.c_str(), "w");
+    for (int row = 0; row < size; row++) {
+        for (int column = 0; column < size; column++) {
+            fprintf(f, "%.16f,%d,%d ", rand() / (double)RAND_MAX, column & 1, row & 1);
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+
+    f = fopen(passability.c_str(), "w");
+    for (int row = 0; row < size - 1; row++) {
+        for (int column = 0; column < size - 1; column++) {
+            fprintf(f, column ? ",%d" : "%d", rand() % 7 == 0);
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes.push_back(100);
+        sizes.push_back(4096);
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string heightfield = (directory / "grid_load_benchmark.heightfield").string();
+    std::string passability = (directory / "grid_load_benchmark.csv").string();
+
+    for (int size : sizes) {
+        srand(1);
+        WriteGrid(heightfield, passability, size);
+        printf("%dx%d grid\n", size, size);
+
+        double start = BenchmarkTime();
+        double checksum = ParseText(heightfield, passability);
+        PrintResult("text parse", (BenchmarkTime() - start) * 1000.0, "ms");
+
+        uint64_t stamp = WorldGridFile::StampFiles({ heightfield, passability });
+        std::string cache_path = WorldGridFile::GetCachePath(stamp);
+        start = BenchmarkTime();
+        WorldGridFile::Bake(heightfield.c_str(), passability.c_str(), cache_path, stamp, 0.1f);
+        PrintResult("bake (first launch)", (BenchmarkTime() - start) * 1000.0, "ms");
+
+        // What a later launch does: stamp the sources and map the file
+        {
+            start = BenchmarkTime();
+            stamp = WorldGridFile::StampFiles({ heightfield, passability });
+            WorldGridFile grid;
+            if (!grid.Open(cache_path, stamp)) {
+                fprintf(stderr, "Could not open the baked grid %s\n", cache_path.c_str());
+                return 1;
+            }
+            PrintResult("open mapped grid", (BenchmarkTime() - start) * 1000.0, "ms");
+            checksum += TouchGrid(grid);
+            PrintResult("open and read every value", (BenchmarkTime() - start) * 1000.0, "ms");
+        }
+        printf("  (checksum %g)\n", checksum);
+
+        std::filesystem::remove(cache_path);
+    }
+
+    std::filesystem::remove(heightfield);
+    std::filesystem::remove(passability);
+    return 0;
+}
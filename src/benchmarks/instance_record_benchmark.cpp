@@ -0,0 +1,179 @@
+// Vertex stage cost of the two instance layouts the game has used, on
+// the tree1 model: a 64 byte world matrix per instance whose normal matrix
+// the vertex shader inverts (the shader from before the change, kept in
+// shaders/), and the 32 byte InstanceRecord the vertex shader rotates by
+// a quaternion (lit_textured_material_instanced). Each is timed with the
+// rasterizer discarded, where only the vertex stage runs, and drawn into
+// a 1280x720 target; an image checksum tells that both place the trees
+// alike. Usage: instance_record_benchmark [count ...], 100 and 400 (a
+// streamed forest) instances by default
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "benchmark.h"
+#include "path_config.h"
+#include "resource_manager.h"
+#include "vertex_format.h"
+
+using namespace game;
+
+int main(int argc, char* argv[]) {
+
+    std::vector<int> counts;
+    for (int i = 1; i < argc; i++) {
+        counts.push_back(atoi(argv[i]));
+    }
+    if (counts.empty()) {
+        counts.push_back(100);
+        counts.push_back(400);
+    }
+
+    if (!CreateBenchmarkContext()) {
+        return 1;
+    }
+
+    // The tree as Game loads it: optimized and in the format chosen for it
+    ResourceManager resman;
+    std::string filename = std::string(MATERIAL_DIRECTORY) + std::string("/tree1.obj");
+    resman.LoadResource(Mesh, "Tree1", filename.c_str());
+    Resource* tree = resman.GetResource("Tree1");
+
+    std::string old_shaders = std::string(CMAKE_SOURCE_DIRECTORY) + "/benchmarks/shaders/";
+    std::string fp = old_shaders + "instance_normal_fp.glsl";
+    GLuint programs[2] = {
+        LoadBenchmarkProgram(old_shaders + "matrix_instance_vp.glsl", "", fp),
+        LoadBenchmarkProgram(std::string(SHADERS_DIRECTORY) + "/lit_textured_material_instanced_vp.glsl", "", fp)
+    };
+    const char* labels[2] = { "world matrix (64 B)", "instance record (32 B)" };
+
+    const GLsizei width = 1280, height = 720;
+    GLuint frame_buffer, color, depth;
+    glGenFramebuffers(1, &frame_buffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Could not set up the frame buffer\n");
+        return 1;
+    }
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 40.0f), glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), width / (float)height, 0.1f, 1000.0f);
+
+    // Best of the runs after the first two, which warm the caches up
+    const int runs = 5;
+
+    for (int count : counts) {
+        // Trees turned about the vertical and scaled, over a square that
+        // grows with the count, the same in both layouts
+        srand(5);
+        std::vector<glm::mat4> matrices(count);
+        std::vector<InstanceRecord> records(count);
+        float extent = 8.0f * std::sqrt((float)count);
+        for (int i = 0; i < count; i++) {
+            glm::vec3 position((rand() / (float)RAND_MAX - 0.5f) * extent, 0.0f, -(rand() / (float)RAND_MAX) * extent);
+            float scale = 0.5f + rand() / (float)RAND_MAX;
+            glm::quat rotation = glm::angleAxis(rand() / (float)RAND_MAX * 6.2832f, glm::vec3(0.0f, 1.0f, 0.0f));
+            matrices[i] = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+            records[i] = InstanceRecord::Pack(position, scale, rotation);
+        }
+
+        GLuint instance_buffers[2], vertex_arrays[2];
+        glGenBuffers(2, instance_buffers);
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4), matrices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffers[1]);
+        glBufferData(GL_ARRAY_BUFFER, records.size() * sizeof(InstanceRecord), records.data(), GL_STATIC_DRAW);
+
+        glGenVertexArrays(2, vertex_arrays);
+        for (int path = 0; path < 2; path++) {
+            glBindVertexArray(vertex_arrays[path]);
+            glBindBuffer(GL_ARRAY_BUFFER, tree->GetArrayBuffer());
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tree->GetElementArrayBuffer());
+            SetupVertexFormat(tree->GetVertexFormat());
+            glBindBuffer(GL_ARRAY_BUFFER, instance_buffers[path]);
+            if (path == 0) {
+                // A matrix attribute takes four locations, one per column
+                for (GLuint column = 0; column < 4; column++) {
+                    GLuint location = InstancePositionLocation + column;
+                    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+                    glEnableVertexAttribArray(location);
+                    glVertexAttribDivisor(location, 1);
+                }
+            }
+            else {
+                SetupInstanceAttributes();
+            }
+        }
+        glBindVertexArray(0);
+
+        printf("%d trees, %d triangles each\n", count, tree->GetSize() / 3);
+        for (int path = 0; path < 2; path++) {
+            glUseProgram(programs[path]);
+            glUniformMatrix4fv(glGetUniformLocation(programs[path], "view_mat"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(programs[path], "projection_mat"), 1, GL_FALSE, glm::value_ptr(projection));
+            glBindVertexArray(vertex_arrays[path]);
+
+            double vertex_stage = 1.0e9, draw = 1.0e9;
+            for (int discard = 1; discard >= 0; discard--) {
+                for (int run = 0; run < runs; run++) {
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    if (discard) {
+                        glEnable(GL_RASTERIZER_DISCARD);
+                    }
+                    StepTimer timer;
+                    timer.Begin();
+                    glDrawElementsInstanced(GL_TRIANGLES, tree->GetSize(), GL_UNSIGNED_INT, 0, count);
+                    timer.End();
+                    glDisable(GL_RASTERIZER_DISCARD);
+                    double& best = discard ? vertex_stage : draw;
+                    if (run > 1) {
+                        best = std::min(best, timer.GetWall());
+                    }
+                }
+            }
+
+            std::vector<GLubyte> pixels(width * height * 4);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            double checksum = 0.0;
+            for (size_t i = 0; i < pixels.size(); i++) {
+                checksum += pixels[i];
+            }
+
+            std::string label = labels[path];
+            PrintResult(label + ", vertex stage", vertex_stage, "ms");
+            PrintResult(label + ", draw 1280x720", draw, "ms");
+            printf("  %s image checksum %.6g\n", label.c_str(), checksum);
+        }
+
+        glDeleteVertexArrays(2, vertex_arrays);
+        glDeleteBuffers(2, instance_buffers);
+    }
+
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteFramebuffers(1, &frame_buffer);
+    glDeleteProgram(programs[0]);
+    glDeleteProgram(programs[1]);
+    DestroyBenchmarkContext();
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Per frame upload of instance records: the whole array sent again with
+// glBufferData, as the ghost crowd and the families did, against
+// InstanceBuffer, which sends the records that changed through the upload
+// ring, or the whole array when they span half of it. Each frame changes a share of the records, scattered or in one
+// block, and the GPU then reads the buffer (a copy out of it stands in
+// for the draw). Timed on the CPU for the upload calls alone and up to
+// glFinish. The buffer is read back at the end to check it holds the
+// records. Usage: instance_upload_benchmark [count ...], 10000 (the ghost
+// crowd) and 100000 records by default
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "benchmark.h"
+#include "instance_buffer.h"
+#include "vertex_format.h"
+
+using namespace game;
+
+// Record i of frame 'frame'
+static InstanceRecord MakeRecord(size_t i, int frame) {
+
+    return InstanceRecord::Pack(glm::vec3(i * 0.5f, frame * 0.25f, 1.0f), 1.0f,
+        glm::angleAxis(frame * 0.01f + i * 0.001f, glm::vec3(0.0f, 1.0f, 0.0f)));
+}
+
+
+int main(int argc, char* argv[]) {
+
+    std::vector<int> counts;
+    for (int i = 1; i < argc; i++) {
+        counts.push_back(atoi(argv[i]));
+    }
+    if (counts.empty()) {
+        counts.push_back(10000);
+        counts.push_back(100000);
+    }
+
+    if (!CreateBenchmarkContext()) {
+        return 1;
+    }
+    UploadRing probe(64);
+    printf("upload ring %s\n", probe.IsMapped() ? "persistently mapped" : "through glBufferSubData");
+
+    const int frames = 60;
+    // Percent of the records changed per frame, scattered over the array
+    // or as one block at its end
+    const int shares[] = { 0, 1, 10, 100 };
+    const int share_count = sizeof(shares) / sizeof(shares[0]);
+
+    for (int count : counts) {
+        GLuint full_buffer, scratch;
+        glGenBuffers(1, &full_buffer);
+        glGenBuffers(1, &scratch);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+        glBufferData(GL_COPY_WRITE_BUFFER, count * sizeof(InstanceRecord), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        for (int s = 0; s < share_count; s++) {
+            for (int block = 0; block < 2; block++) {
+                if (shares[s] == 0 && block) {
+                    continue;
+                }
+                size_t changed = static_cast<size_t>(count) * shares[s] / 100;
+                std::vector<InstanceRecord> records(count);
+                for (size_t i = 0; i < records.size(); i++) {
+                    records[i] = MakeRecord(i, 0);
+                }
+                InstanceBuffer instances;
+                instances.Resize(count);
+                instances.Set(0, records.data(), records.size());
+                instances.Upload();
+                glFinish();
+
+                double full_calls = 0.0, full_wall = 0.0, ring_calls = 0.0, ring_wall = 0.0;
+                size_t ring_bytes = 0;
+                for (int frame = 1; frame <= frames; frame++) {
+                    // Change every (100 / share)th record, or the last block
+                    if (changed > 0) {
+                        size_t stride = block ? 1 : records.size() / changed;
+                        size_t first = block ? records.size() - changed : 0;
+                        for (size_t k = 0; k < changed; k++) {
+                            size_t i = first + k * stride;
+                            records[i] = MakeRecord(i, frame);
+                        }
+                    }
+
+                    // The whole array, as before
+                    double start = BenchmarkTime();
+                    glBindBuffer(GL_ARRAY_BUFFER, full_buffer);
+                    glBufferData(GL_ARRAY_BUFFER, records.size() * sizeof(InstanceRecord), records.data(), GL_STREAM_DRAW);
+                    glBindBuffer(GL_ARRAY_BUFFER, 0);
+                    full_calls += BenchmarkTime() - start;
+                    glBindBuffer(GL_COPY_READ_BUFFER, full_buffer);
+                    glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, records.size() * sizeof(InstanceRecord));
+                    glFinish();
+                    full_wall += BenchmarkTime() - start;
+
+                    // Set every record, as GhostCrowd does, and upload what
+                    // changed
+                    start = BenchmarkTime();
+                    instances.Set(0, records.data(), records.size());
+                    ring_bytes += instances.Upload();
+                    ring_calls += BenchmarkTime() - start;
+                    glBindBuffer(GL_COPY_READ_BUFFER, instances.GetBuffer());
+                    glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, records.size() * sizeof(InstanceRecord));
+                    glFinish();
+                    ring_wall += BenchmarkTime() - start;
+                }
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+                // What the GPU holds against what was set
+                std::vector<InstanceRecord> uploaded(count);
+                glBindBuffer(GL_ARRAY_BUFFER, instances.GetBuffer());
+                glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceRecord), uploaded.data());
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                bool match = memcmp(uploaded.data(), records.data(), count * sizeof(InstanceRecord)) == 0;
+
+                printf("%d records, %d%% changed%s, %d frames%s\n", count, shares[s],
+                    shares[s] == 0 || shares[s] == 100 ? "" : (block ? " in one block" : " scattered"), frames,
+                    match ? "" : " (MISMATCH)");
+                PrintResult("full re-upload, calls", full_calls * 1000.0 / frames, "ms");
+                PrintResult("full re-upload, to glFinish", full_wall * 1000.0 / frames, "ms");
+                PrintResult("instance buffer, set and upload", ring_calls * 1000.0 / frames, "ms");
+                PrintResult("instance buffer, to glFinish", ring_wall * 1000.0 / frames, "ms");
+                PrintResult("instance buffer, bytes sent", (double)ring_bytes / frames / 1024.0, "KiB");
+                if (shares[s] == 100) {
+                    break;
+                }
+            }
+        }
+
+        glDeleteBuffers(1, &scratch);
+        glDeleteBuffers(1, &full_buffer);
+    }
+
+    DestroyBenchmarkContext();
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Time of the particle system against its 2 ms budget: the transform
+// feedback simulation and the draw into a 1280x720 target, once every
+// particle of the pool is alive. Each step is measured with a timer query
+// and as wall time up to glFinish; software drivers do not count vertex
+// only work in timer queries. Usage: particle_benchmark [capacity ...],
+// 65536 (the game) and 1048576 by default. The pool is split over 16
+// emitters
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+
+#include "benchmark.h"
+#include "camera.h"
+#include "gl_state.h"
+#include "particle_system.h"
+#include "path_config.h"
+#include "resource_manager.h"
+
+using namespace game;
+
+int main(int argc, char* argv[]) {
+
+    std::vector<int> capacities;
+    for (int i = 1; i < argc; i++) {
+        capacities.push_back(atoi(argv[i]));
+    }
+    if (capacities.empty()) {
+        capacities.push_back(1 << 16);
+        capacities.push_back(1 << 20);
+    }
+
+    if (!CreateBenchmarkContext()) {
+        return 1;
+    }
+
+    // The programs Game loads for the particle system
+    ResourceManager resman;
+    std::string filename = std::string(SHADERS_DIRECTORY) + std::string("/particle_system");
+    resman.LoadResource(Material, "ParticleSystemMaterial", filename.c_str());
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/particle_simulation");
+    std::vector<std::string> particle_state;
+    particle_state.push_back("out_position");
+    particle_state.push_back("out_velocity");
+    resman.LoadFeedbackProgram("ParticleSimulation", filename.c_str(), particle_state);
+
+    // White sprite in place of the sparkle texture
+    GLuint texture;
+    GLubyte white[4 * 4 * 4];
+    for (size_t i = 0; i < sizeof(white); i++) {
+        white[i] = 255;
+    }
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    Resource sparkle(Texture, "SparkleTexture", texture, 0);
+
+    // Target of the size the scene is drawn at, blended additively like
+    // the accumulation of the transparency pass
+    const GLsizei width = 1280, height = 720;
+    GLuint frame_buffer, color, depth;
+    glGenFramebuffers(1, &frame_buffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Could not set up the frame buffer\n");
+        return 1;
+    }
+    glViewport(0, 0, width, height);
+
+    Camera camera;
+    camera.SetView(glm::vec3(0.0f, 20.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    camera.SetProjection(60.0f, 0.01f, 1000.0f, static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+
+    const int emitter_count = 16;
+    const int frames = 30;
+    const float delta_time = 1.0f / 60.0f;
+    const double budget = 2.0;
+
+    for (int capacity : capacities) {
+        ParticleSystem particles("Particles", capacity, resman.GetResource("ParticleSimulation"),
+            resman.GetResource("ParticleSystemMaterial"), &sparkle);
+
+        // Each emitter respawns its whole range once per lifetime, so the
+        // pool stays full
+        ParticleEmitter emitter;
+        emitter.velocity = glm::vec3(0.0f, 4.0f, 0.0f);
+        emitter.spread = 6.0f;
+        emitter.acceleration = glm::vec3(0.0f, -2.0f, 0.0f);
+        emitter.attraction = 0.4f;
+        emitter.lifetime = 2.0f;
+        emitter.rate = (capacity / emitter_count) / emitter.lifetime;
+        emitter.color = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+        emitter.size = 0.5f;
+        for (int i = 0; i < emitter_count; i++) {
+            emitter.position = glm::vec3((i % 4) * 30.0f - 45.0f, 0.0f, (i / 4) * 30.0f - 45.0f);
+            particles.AddEmitter(emitter, capacity / emitter_count);
+        }
+
+        // Fill the pool
+        for (int frame = 0; frame < static_cast<int>(emitter.lifetime / delta_time) + 1; frame++) {
+            particles.Simulate(delta_time);
+        }
+        glFinish();
+
+        StepTimer simulation, draw;
+        for (int frame = 0; frame < frames; frame++) {
+            simulation.Begin();
+            particles.Simulate(delta_time);
+            simulation.End();
+
+            // The simulation binds objects directly, as updates do in Game
+            GLState::BeginFrame();
+            GLState::DepthMask(GL_TRUE);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            GLState::Enable(GL_DEPTH_TEST);
+            GLState::Enable(GL_BLEND);
+            GLState::BlendFunc(GL_ONE, GL_ONE);
+            draw.Begin();
+            particles.Draw(&camera);
+            draw.End();
+            GLState::Disable(GL_BLEND);
+        }
+
+        printf("%d particles, %d frames\n", particles.GetReserved(), frames);
+        PrintResult("simulation, timer query", simulation.GetGpu() / frames, "ms");
+        PrintResult("simulation, wall", simulation.GetWall() / frames, "ms");
+        PrintResult("draw 1280x720, timer query", draw.GetGpu() / frames, "ms");
+        PrintResult("draw 1280x720, wall", draw.GetWall() / frames, "ms");
+        double slowest = std::max(simulation.GetGpu(), simulation.GetWall()) / frames;
+        PrintResult("simulation share of the 2 ms budget", slowest / budget * 100.0, "%");
+    }
+
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteTextures(1, &color);
+    glDeleteFramebuffers(1, &frame_buffer);
+    glDeleteTextures(1, &texture);
+    DestroyBenchmarkContext();
+    return 0;
+}
@@ -0,0 +1,237 @@
+// Particle point sets drawn the two ways the game has used: points
+// expanded into quads by a geometry shader (the shaders from before the
+// change, kept in shaders/) and instanced four-vertex strips placed by
+// the vertex shader (textured_particle). Both draw the sphere particles
+// into a 1280x720 target with the blending of the transparency pass,
+// seen up close, where filling the quads dominates, and from afar, where
+// the vertex work does. Besides the time, the pipeline statistics tell
+// how many times each stage ran, and an image checksum that both paths
+// draw the same.
+// Usage: particle_draw_benchmark [count ...], 10000, 100000 and 1000000
+// by default
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "benchmark.h"
+#include "path_config.h"
+#include "resource_manager.h"
+#include "vertex_format.h"
+
+using namespace game;
+
+// Shader stage invocations of the draws between Begin and End
+class StageCounter {
+
+    public:
+        static const int stage_count = 3;
+
+        StageCounter(void) {
+            glGenQueries(stage_count, queries_);
+        }
+        ~StageCounter() {
+            glDeleteQueries(stage_count, queries_);
+        }
+
+        void Begin(void) {
+            for (int i = 0; i < stage_count; i++) {
+                glBeginQuery(targets[i], queries_[i]);
+            }
+        }
+        void End(void) {
+            for (int i = 0; i < stage_count; i++) {
+                glEndQuery(targets[i]);
+                glGetQueryObjectui64v(queries_[i], GL_QUERY_RESULT, &counts_[i]);
+            }
+        }
+
+        GLuint64 GetVertexInvocations(void) const { return counts_[0]; }
+        GLuint64 GetGeometryInvocations(void) const { return counts_[1]; }
+        GLuint64 GetFragmentInvocations(void) const { return counts_[2]; }
+
+    private:
+        static const GLenum targets[stage_count];
+        GLuint queries_[stage_count];
+        GLuint64 counts_[stage_count];
+};
+
+const GLenum StageCounter::targets[StageCounter::stage_count] = {
+    GL_VERTEX_SHADER_INVOCATIONS_ARB, GL_GEOMETRY_SHADER_INVOCATIONS, GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+};
+
+
+int main(int argc, char* argv[]) {
+
+    std::vector<int> counts;
+    for (int i = 1; i < argc; i++) {
+        counts.push_back(atoi(argv[i]));
+    }
+    if (counts.empty()) {
+        counts.push_back(10000);
+        counts.push_back(100000);
+        counts.push_back(1000000);
+    }
+
+    if (!CreateBenchmarkContext()) {
+        return 1;
+    }
+    bool statistics = GLEW_ARB_pipeline_statistics_query;
+
+    std::string shaders = std::string(SHADERS_DIRECTORY) + "/textured_particle";
+    std::string old_shaders = std::string(CMAKE_SOURCE_DIRECTORY) + "/benchmarks/shaders/geometry_shader_particle";
+    GLuint geometry_program = LoadBenchmarkProgram(old_shaders + "_vp.glsl", old_shaders + "_gp.glsl", shaders + "_fp.glsl");
+    GLuint instanced_program = LoadBenchmarkProgram(shaders + "_vp.glsl", "", shaders + "_fp.glsl");
+
+    // White sprite in place of the sparkle texture
+    GLuint texture;
+    std::vector<GLubyte> white(16 * 16 * 4, 255);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 16, 16, 0, GL_RGBA, GL_UNSIGNED_BYTE, white.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    // The targets of the transparency pass
+    const GLsizei width = 1280, height = 720;
+    GLuint frame_buffer, targets[2], depth;
+    glGenFramebuffers(1, &frame_buffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+    glGenTextures(2, targets);
+    glBindTexture(GL_TEXTURE_2D, targets[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targets[0], 0);
+    glBindTexture(GL_TEXTURE_2D, targets[1]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, targets[1], 0);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    GLenum draw_buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, draw_buffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Could not set up the frame buffer\n");
+        return 1;
+    }
+    glViewport(0, 0, width, height);
+
+    // A sparkle node as when an item is held, and across the map
+    glm::mat4 world = glm::scale(glm::mat4(1.0f), glm::vec3(30.0f));
+    const int view_count = 2;
+    const char* view_names[view_count] = { "near", "far" };
+    glm::mat4 views[view_count] = {
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 900.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+    };
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), width / (float)height, 0.01f, 1000.0f);
+    glm::mat4 normal = glm::transpose(glm::inverse(world));
+
+    const int frames = 10;
+    ResourceManager resman;
+
+    for (int count : counts) {
+        srand(1);
+        std::string name = "SphereParticles" + std::to_string(count);
+        resman.CreateSphereParticles(name, count);
+        GLuint array_buffer = resman.GetResource(name)->GetArrayBuffer();
+
+        // Points for the geometry shader, one instance per point otherwise
+        GLuint vertex_arrays[2];
+        glGenVertexArrays(2, vertex_arrays);
+        for (int i = 0; i < 2; i++) {
+            glBindVertexArray(vertex_arrays[i]);
+            glBindBuffer(GL_ARRAY_BUFFER, array_buffer);
+            SetupVertexFormat(StandardFormat);
+            if (i == 1) {
+                glVertexAttribDivisor(VertexLocation, 1);
+                glVertexAttribDivisor(NormalLocation, 1);
+                glVertexAttribDivisor(ColorLocation, 1);
+                glVertexAttribDivisor(UVLocation, 1);
+            }
+        }
+        glBindVertexArray(0);
+
+        for (int v = 0; v < view_count; v++) {
+            printf("%d particles, %s, %d frames\n", count, view_names[v], frames);
+            for (int path = 0; path < 2; path++) {
+                GLuint program = path == 0 ? geometry_program : instanced_program;
+                glUseProgram(program);
+                glUniformMatrix4fv(glGetUniformLocation(program, "world_mat"), 1, GL_FALSE, glm::value_ptr(world));
+                glUniformMatrix4fv(glGetUniformLocation(program, "view_mat"), 1, GL_FALSE, glm::value_ptr(views[v]));
+                glUniformMatrix4fv(glGetUniformLocation(program, "projection_mat"), 1, GL_FALSE, glm::value_ptr(projection));
+                glUniformMatrix4fv(glGetUniformLocation(program, "normal_mat"), 1, GL_FALSE, glm::value_ptr(normal));
+                glUniform1f(glGetUniformLocation(program, "timer"), 3.0f);
+                glUniform1i(glGetUniformLocation(program, "tex_samp"), 0);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glBindVertexArray(vertex_arrays[path]);
+
+                StepTimer timer;
+                StageCounter stages;
+                for (int frame = 0; frame < frames; frame++) {
+                    glDepthMask(GL_TRUE);
+                    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    glEnable(GL_DEPTH_TEST);
+                    glDepthMask(GL_FALSE);
+                    glEnable(GL_BLEND);
+                    glBlendFunci(0, GL_ONE, GL_ONE);
+                    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+                    if (statistics && frame == 0) {
+                        stages.Begin();
+                    }
+                    timer.Begin();
+                    if (path == 0) {
+                        glDrawArrays(GL_POINTS, 0, count);
+                    }
+                    else {
+                        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+                    }
+                    timer.End();
+                    if (statistics && frame == 0) {
+                        stages.End();
+                    }
+                    glDisable(GL_BLEND);
+                }
+
+                // Sum of the accumulation target, to compare the two paths
+                std::vector<GLfloat> pixels(width * height * 4);
+                glReadBuffer(GL_COLOR_ATTACHMENT0);
+                glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, pixels.data());
+                double checksum = 0.0;
+                for (size_t i = 0; i < pixels.size(); i++) {
+                    checksum += pixels[i];
+                }
+
+                std::string label = path == 0 ? "geometry shader" : "instanced";
+                PrintResult(label + ", timer query", timer.GetGpu() / frames, "ms");
+                PrintResult(label + ", wall", timer.GetWall() / frames, "ms");
+                if (statistics) {
+                    PrintResult(label + ", vertex invocations", (double)stages.GetVertexInvocations(), "");
+                    PrintResult(label + ", geometry invocations", (double)stages.GetGeometryInvocations(), "");
+                    PrintResult(label + ", fragment invocations", (double)stages.GetFragmentInvocations(), "");
+                }
+                printf("  %s image checksum %.6g\n", label.c_str(), checksum);
+            }
+        }
+
+        glDeleteVertexArrays(2, vertex_arrays);
+    }
+
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteTextures(2, targets);
+    glDeleteFramebuffers(1, &frame_buffer);
+    glDeleteTextures(1, &texture);
+    glDeleteProgram(geometry_program);
+    glDeleteProgram(instanced_program);
+    DestroyBenchmarkContext();
+    return 0;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+// Attributes passed from the vertex shader
+in vec3 fragPos;
+in vec3 normal_interp;
+in vec4 color_interp;
+in vec2 uv_interp;
+
+out vec4 fragColor;
+
+
+// The normal as a color, so that the two instance layouts can be compared
+// pixel for pixel without textures or lights
+void main()
+{
+    fragColor = vec4(normalize(normal_interp) * 0.5 + 0.5, 1.0);
+}
@@ -51,32 +51,28 @@ namespace game {
         orientation_ = orientation;
     }
 
-    void Camera::SetTerrainGrid(std::vector<std::vector<float>> grid) {
-        terrain_grid_ = grid;
+    void Camera::SetWorldGrid(WorldGrid* grid) {
+        world_grid_ = grid;
     }
 
-    void Camera::SetImpassableCells(std::vector<std::vector<bool>> grid) {
-        impassable_cells_ = grid;
+    void Camera::SetBounds(float min_x, float min_z, float max_x, float max_z) {
+        min_x_ = min_x;
+        min_z_ = min_z;
+        max_x_ = max_x;
+        max_z_ = max_z;
     }
 
     void Camera::Translate(glm::vec3 trans) {
-        constexpr float sizeOfQuad = 0.1f;
-        const int coord_offset = 300; // This is to avoid negative indices, seems to be the right value
-
         float xpos = position_.x + trans.x;
         float zpos = position_.z + trans.z;
         
-        xpos = std::max(std::min(xpos, 1645.0f), -245.0f);
-        zpos = std::max(std::min(zpos, 1645.0f), -245.0f);
+        xpos = std::max(std::min(xpos, max_x_), min_x_);
+        zpos = std::max(std::min(zpos, max_z_), min_z_);
 
         trans.x = xpos - position_.x;
         trans.z = zpos - position_.z;
 
-        // Get the lower x and z value of the cell for the terrain grid (corresponds to the coordinates of the cell in the impassable cell grid)
-        int x1 = static_cast<int>(glm::floor((position_.x + trans.x + coord_offset) * sizeOfQuad));
-        int z1 = static_cast<int>(glm::floor((position_.z + trans.z + coord_offset) * sizeOfQuad));
-
-        if (impassable_cells_[x1/2][z1/2]) {
+        if (!world_grid_->IsPassable(position_.x + trans.x, position_.z + trans.z)) {
             return;
         }
 
@@ -85,60 +81,15 @@ namespace game {
     }
 
     glm::vec3 Camera::clampToGround(glm::vec3 pos, float offset) const {
-        constexpr float sizeOfQuad = 0.1f;
-        constexpr int coord_offset = 300; // This is to avoid negative indices, seems to be the right value
-        constexpr float height_scalar = 25.0f;
-
-        // Get indices in the grid for all 4 points
-        int x1 = static_cast<int>(glm::floor((pos.x + coord_offset) * sizeOfQuad));
-        int x2 = static_cast<int>(glm::ceil((pos.x + coord_offset) * sizeOfQuad));
-        int z1 = static_cast<int>(glm::floor((pos.z + coord_offset) * sizeOfQuad));
-        int z2 = static_cast<int>(glm::ceil((pos.z + coord_offset) * sizeOfQuad));
-
-        if (terrain_grid_.size() <= std::max(z1, z2) / 2 || terrain_grid_[0].size() <= std::max(x1, x2) / 2)
-            return pos;
-
-        glm::vec3 p1 = glm::vec3(x1, terrain_grid_[z1 / 2][x1 / 2], z1);
-        glm::vec3 p2 = glm::vec3(x1, terrain_grid_[z1 / 2][x2 / 2], z2);
-        glm::vec3 p3 = glm::vec3(x2, terrain_grid_[z2 / 2][x1 / 2], z1);
-        glm::vec3 p4 = glm::vec3(x2, terrain_grid_[z2 / 2][x2 / 2], z2);
-
-        // Interpolate the y position
-
-        float s = (pos.x + coord_offset) * sizeOfQuad - x1;
-        float t = (pos.z + coord_offset) * sizeOfQuad - z1;
-
-        pos.y = ((1 - t) * ((1 - s) * p1 + s * p2) + t * ((1 - s) * p3 + s * p4)).y * height_scalar + offset;
+        pos.y = world_grid_->GetHeight(pos.x, pos.z) + offset;
 
         return pos;
     }
 
     void Camera::UpdateYPos() {
-        constexpr float sizeOfQuad = 0.1f;
-        const int coord_offset = 300; // This is to avoid negative indices, seems to be the right value
         const float player_height = 20.0f;
-        const float height_scalar = 25.0f;
-
-        // Get indices in the grid for all 4 points
-        int x1 = static_cast<int>(glm::floor((position_.x + coord_offset) * sizeOfQuad));
-        int x2 = static_cast<int>(glm::ceil((position_.x + coord_offset) * sizeOfQuad));
-        int z1 = static_cast<int>(glm::floor((position_.z + coord_offset) * sizeOfQuad));
-        int z2 = static_cast<int>(glm::ceil((position_.z + coord_offset) * sizeOfQuad));
-
-        if (terrain_grid_.size() <= std::max(z1, z2) / 2 || terrain_grid_[0].size() <= std::max(x1, x2) / 2)
-            return;
-
-        glm::vec3 p1 = glm::vec3(x1, terrain_grid_[z1 / 2][x1 / 2], z1);
-        glm::vec3 p2 = glm::vec3(x1, terrain_grid_[z1 / 2][x2 / 2], z2);
-        glm::vec3 p3 = glm::vec3(x2, terrain_grid_[z2 / 2][x1 / 2], z1);
-        glm::vec3 p4 = glm::vec3(x2, terrain_grid_[z2 / 2][x2 / 2], z2);
-
-        // Interpolate the y position
-
-        float s = (position_.x + coord_offset) * sizeOfQuad - x1;
-        float t = (position_.z + coord_offset) * sizeOfQuad - z1;
 
-        position_.y = ((1 - t) * ((1 - s) * p1 + s * p2) + t * ((1 - s) * p3 + s * p4)).y * height_scalar + player_height;
+        position_.y = world_grid_->GetHeight(position_.x, position_.z) + player_height;
     }
 
     void Camera::MoveForward(float amount) {
@@ -270,6 +221,23 @@ namespace game {
         glm::vec3 camera_pos = GetPosition();
         GLint camera_position = glGetUniformLocation(program, "camera_position");
         glUniform3f(camera_position, camera_pos.x, camera_pos.y, camera_pos.z);
+
+        if (lights_) {
+            lights_->SetupShader(program);
+        }
+    }
+
+    void Camera::SetLights(const ClusteredLights* lights) {
+        lights_ = lights;
+    }
+
+    glm::mat4 Camera::GetViewMatrix(void) {
+        SetupViewMatrix();
+        return view_matrix_;
+    }
+
+    glm::mat4 Camera::GetProjectionMatrix(void) const {
+        return projection_matrix_;
     }
 
     void Camera::SetupShaderSkybox(GLuint program) {
@@ -330,7 +298,7 @@ namespace game {
         boundingBox.max = position_ + glm::vec3(1.0f, 10.0f, 1.0f);
     }
 
-    BoundingBox Camera::getBBox() {
+    const BoundingBox& Camera::getBBox() const {
         return boundingBox;
     }
 
@@ -341,7 +309,6 @@ namespace game {
         // 3: Return the real x position, which is where the log will be placed
 
         constexpr float sizeOfQuad = 0.1f;
-        constexpr int coord_offset = 300;
 
         const int z1 = 20;
         const int z2 = 26;
@@ -349,28 +316,28 @@ namespace game {
         const float y_pos = 0.7;
 
         // Convert x-coord to index
-        int x1 = static_cast<int>(glm::floor((position_.x + coord_offset) * sizeOfQuad));
+        int x1 = world_grid_->GetColumn(position_.x);
         
         // Create a path in the impassable cells
-        impassable_cells_[x1 / 2][z1] = 0;
-        impassable_cells_[x1 / 2][z2] = 0;
+        world_grid_->SetCellImpassable(x1, z1, false);
+        world_grid_->SetCellImpassable(x1, z2, false);
 
-        impassable_cells_[(x1 / 2) + 1][z1] = 0;
-        impassable_cells_[(x1 / 2) + 1][z2] = 0;
+        world_grid_->SetCellImpassable(x1 + 1, z1, false);
+        world_grid_->SetCellImpassable(x1 + 1, z2, false);
 
-        impassable_cells_[(x1 / 2) - 1][z1] = 0;
-        impassable_cells_[(x1 / 2) - 1][z2] = 0;
+        world_grid_->SetCellImpassable(x1 - 1, z1, false);
+        world_grid_->SetCellImpassable(x1 - 1, z2, false);
 
         for (int i = z1 + 1; i <= z2; ++i) {
 
             // Create barrier along the path
-            impassable_cells_[(x1 / 2) + 1][i] = 1;
-            impassable_cells_[(x1 / 2) - 1][i] = 1;
+            world_grid_->SetCellImpassable(x1 + 1, i, true);
+            world_grid_->SetCellImpassable(x1 - 1, i, true);
 
             // Elevate y-pos
-            terrain_grid_[i][(x1 / 2)] = y_pos;
-            terrain_grid_[i][(x1 / 2) + 1] = y_pos;
-            terrain_grid_[i][(x1 / 2) - 1] = y_pos;
+            world_grid_->SetCellHeight(i, x1, y_pos);
+            world_grid_->SetCellHeight(i, x1 + 1, y_pos);
+            world_grid_->SetCellHeight(i, x1 - 1, y_pos);
         }
 
         // Return real x-coord (doesn't seem to be quite right)
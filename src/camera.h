@@ -8,6 +8,9 @@
 #include <vector>
 #include <glm/gtc/quaternion.hpp>
 
+#include "clustered_lights.h"
+#include "world_grid.h"
+
 namespace game {
 
     struct BoundingBox {
@@ -31,11 +34,11 @@ namespace game {
         void SetPosition(glm::vec3 position);
         void SetOrientation(glm::quat orientation);
 
-        // Set terrain grid
-        void SetTerrainGrid(std::vector<std::vector<float>>);
-
-        // Set passable cells
-        void SetImpassableCells(std::vector<std::vector<bool>>);
+        // Set the heights and passability of the terrain; the grid is
+        // shared, not copied
+        void SetWorldGrid(WorldGrid* grid);
+        // Set the area the camera may walk in
+        void SetBounds(float min_x, float min_z, float max_x, float max_z);
 
         // Updates y position
         void UpdateYPos();
@@ -64,15 +67,21 @@ namespace game {
         // Set projection from frustum parameters: field-of-view,
         // near and far planes, and width and height of viewport
         void SetProjection(GLfloat fov, GLfloat near, GLfloat far, GLfloat w, GLfloat h);
+        // Set the point lights given to the shaders with the flashlight;
+        // the lights are shared, not copied
+        void SetLights(const ClusteredLights* lights);
         // Set all camera-related variables in shader program
         void SetupShader(GLuint program);
         void SetupShaderSkybox(GLuint program);
 
+        glm::mat4 GetViewMatrix(void);
+        glm::mat4 GetProjectionMatrix(void) const;
+
         //bounding box
         void updateBoundingBox();
-        BoundingBox getBBox();
+        const BoundingBox& getBBox() const;
 
-        // Creates a path in the terrain_grid_ and impasssable_cells_ that the player can move through over the river
+        // Creates a path in the heights and passability of the world grid that the player can move through over the river
         int CreateRiverPath();
 
     private:
@@ -82,8 +91,11 @@ namespace game {
         glm::vec3 side_; // Initial side vector
         glm::mat4 view_matrix_; // View matrix
         glm::mat4 projection_matrix_; // Projection matrix
-        std::vector<std::vector<float>> terrain_grid_; // 2D vector of y positions
-        std::vector<std::vector<bool>> impassable_cells_;
+        WorldGrid* world_grid_ = nullptr; // Heights and passability of the terrain
+        const ClusteredLights* lights_ = nullptr; // Point lights of the scene
+        // Area the camera may walk in
+        float min_x_ = -245.0f, min_z_ = -245.0f;
+        float max_x_ = 1645.0f, max_z_ = 1645.0f;
 
         // Create view matrix from current camera parameters
         void SetupViewMatrix(void);
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <thread>
+
+#include "clustered_lights.h"
+
+namespace game {
+
+    ClusteredLights::ClusteredLights(void) {
+
+        near_ = 1.0f;
+        far_ = 1000.0f;
+        depth_scale_ = 1.0f;
+        depth_bias_ = 0.0f;
+        tile_size_ = glm::vec2(1.0f);
+        light_buffer_ = light_texture_ = 0;
+        cluster_buffer_ = cluster_texture_ = 0;
+        index_buffer_ = index_texture_ = 0;
+    }
+
+
+    ClusteredLights::~ClusteredLights() {
+
+        if (light_buffer_) {
+            glDeleteTextures(1, &light_texture_);
+            glDeleteTextures(1, &cluster_texture_);
+            glDeleteTextures(1, &index_texture_);
+            glDeleteBuffers(1, &light_buffer_);
+            glDeleteBuffers(1, &cluster_buffer_);
+            glDeleteBuffers(1, &index_buffer_);
+        }
+    }
+
+
+    void ClusteredLights::Init(void) {
+
+        glGenBuffers(1, &light_buffer_);
+        glGenBuffers(1, &cluster_buffer_);
+        glGenBuffers(1, &index_buffer_);
+        glGenTextures(1, &light_texture_);
+        glGenTextures(1, &cluster_texture_);
+        glGenTextures(1, &index_texture_);
+
+        // Position and radius, then color and intensity, per light
+        glBindBuffer(GL_TEXTURE_BUFFER, light_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, max_lights * 2 * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, light_texture_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, light_buffer_);
+
+        // First index and count, per cluster
+        glBindBuffer(GL_TEXTURE_BUFFER, cluster_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, clusters_x * clusters_y * clusters_z * 2 * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, cluster_texture_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, cluster_buffer_);
+
+        // Lights of each cluster, one after the other
+        glBindBuffer(GL_TEXTURE_BUFFER, index_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(GLuint), NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, index_texture_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, index_buffer_);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        ranges_.assign(clusters_x * clusters_y * clusters_z * 2, 0);
+    }
+
+
+    void ClusteredLights::Clear(void) {
+
+        lights_.clear();
+    }
+
+
+    bool ClusteredLights::Add(const PointLight& light) {
+
+        if (lights_.size() >= max_lights) {
+            return false;
+        }
+        lights_.push_back(light);
+        return true;
+    }
+
+
+    size_t ClusteredLights::GetCount(void) const {
+
+        return lights_.size();
+    }
+
+
+    void ClusteredLights::Update(const glm::mat4& view, const glm::mat4& projection, int width, int height) {
+
+        // Depth range of the perspective projection. Slices grow with the
+        // depth; the first one reaches from the near plane to at least one
+        // unit, so that the slices are not spent right in front of the eye
+        float near_plane = projection[3][2] / (projection[2][2] - 1.0f);
+        far_ = projection[3][2] / (projection[2][2] + 1.0f);
+        near_ = std::max(near_plane, 1.0f);
+        depth_scale_ = clusters_z / std::log(far_ / near_);
+        depth_bias_ = std::log(near_) * depth_scale_;
+        tile_size_ = glm::vec2(static_cast<float>(width) / clusters_x, static_cast<float>(height) / clusters_y);
+
+        bounds_.resize(lights_.size());
+        for (size_t i = 0; i < lights_.size(); i++) {
+            bounds_[i] = getBounds(lights_[i], view, projection);
+        }
+
+        // One range of slices per core
+        int jobs = std::min(static_cast<int>(clusters_z), static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+        if (lights_.size() < 256) {
+            jobs = 1;
+        }
+        int slices = (clusters_z + jobs - 1) / jobs;
+        std::vector<Lists> lists(jobs);
+        std::vector<std::future<void> > workers;
+        for (int i = 1; i < jobs; i++) {
+            int first = std::min(i * slices, static_cast<int>(clusters_z));
+            int last = std::min(first + slices, static_cast<int>(clusters_z));
+            workers.push_back(std::async(std::launch::async, &ClusteredLights::assign, this, first, last, std::ref(lists[i])));
+        }
+        assign(0, std::min(slices, static_cast<int>(clusters_z)), lists[0]);
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].get();
+        }
+
+        // Join the lists of the jobs, in slice order
+        indices_.clear();
+        size_t cluster = 0;
+        for (int i = 0; i < jobs; i++) {
+            GLuint base = static_cast<GLuint>(indices_.size());
+            for (size_t k = 0; k < lists[i].ranges.size(); k += 2) {
+                ranges_[2 * cluster] = base + lists[i].ranges[k];
+                ranges_[2 * cluster + 1] = lists[i].ranges[k + 1];
+                cluster++;
+            }
+            indices_.insert(indices_.end(), lists[i].indices.begin(), lists[i].indices.end());
+        }
+
+        light_data_.resize(lights_.size() * 2);
+        for (size_t i = 0; i < lights_.size(); i++) {
+            light_data_[2 * i] = glm::vec4(lights_[i].position, lights_[i].radius);
+            light_data_[2 * i + 1] = glm::vec4(lights_[i].color, lights_[i].intensity);
+        }
+
+        // Orphan the stores of the last frame instead of waiting on them
+        glBindBuffer(GL_TEXTURE_BUFFER, light_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, max_lights * 2 * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        if (!light_data_.empty()) {
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, light_data_.size() * sizeof(glm::vec4), light_data_.data());
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, cluster_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, ranges_.size() * sizeof(GLuint), ranges_.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, index_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(indices_.size(), 1) * sizeof(GLuint),
+            indices_.empty() ? NULL : indices_.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        // The units are left to the lights, so bind them once per frame
+        glActiveTexture(GL_TEXTURE0 + light_unit);
+        glBindTexture(GL_TEXTURE_BUFFER, light_texture_);
+        glActiveTexture(GL_TEXTURE0 + light_unit + 1);
+        glBindTexture(GL_TEXTURE_BUFFER, cluster_texture_);
+        glActiveTexture(GL_TEXTURE0 + light_unit + 2);
+        glBindTexture(GL_TEXTURE_BUFFER, index_texture_);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+
+    void ClusteredLights::SetupShader(GLuint program) const {
+
+        GLint light_data = glGetUniformLocation(program, "light_data");
+        if (light_data < 0) {
+            return; // Not a lit material
+        }
+        glUniform1i(light_data, light_unit);
+        glUniform1i(glGetUniformLocation(program, "light_clusters"), light_unit + 1);
+        glUniform1i(glGetUniformLocation(program, "light_indices"), light_unit + 2);
+
+        glUniform3i(glGetUniformLocation(program, "cluster_count"), clusters_x, clusters_y, clusters_z);
+        glUniform2f(glGetUniformLocation(program, "cluster_tile_size"), tile_size_.x, tile_size_.y);
+        glUniform2f(glGetUniformLocation(program, "cluster_depth"), depth_scale_, depth_bias_);
+    }
+
+
+    ClusteredLights::Bounds ClusteredLights::getBounds(const PointLight& light, const glm::mat4& view, const glm::mat4& projection) const {
+
+        Bounds bounds = { 0, -1, 0, -1, 0, -1 };
+
+        // The view looks down -z
+        glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        float depth = -center.z;
+        float r = light.radius;
+        if (depth + r < near_ || depth - r > far_) {
+            return bounds;
+        }
+        float min_depth = std::max(depth - r, near_);
+        float max_depth = std::min(depth + r, far_);
+
+        // Extent on the screen of the box around the sphere, over its depth
+        // range: x / depth is smallest at the near side when x is negative
+        // and at the far side when it is positive, and the other way round
+        // for the largest
+        float x0 = center.x - r, x1 = center.x + r;
+        float y0 = center.y - r, y1 = center.y + r;
+        float left = projection[0][0] * (x0 < 0.0f ? x0 / min_depth : x0 / max_depth);
+        float right = projection[0][0] * (x1 > 0.0f ? x1 / min_depth : x1 / max_depth);
+        float bottom = projection[1][1] * (y0 < 0.0f ? y0 / min_depth : y0 / max_depth);
+        float top = projection[1][1] * (y1 > 0.0f ? y1 / min_depth : y1 / max_depth);
+        if (right < -1.0f || left > 1.0f || top < -1.0f || bottom > 1.0f) {
+            return bounds;
+        }
+
+        // Tiles count from the bottom left, as gl_FragCoord
+        bounds.min_x = std::max(0, static_cast<int>(std::floor((left * 0.5f + 0.5f) * clusters_x)));
+        bounds.max_x = std::min(clusters_x - 1, static_cast<int>(std::floor((right * 0.5f + 0.5f) * clusters_x)));
+        bounds.min_y = std::max(0, static_cast<int>(std::floor((bottom * 0.5f + 0.5f) * clusters_y)));
+        bounds.max_y = std::min(clusters_y - 1, static_cast<int>(std::floor((top * 0.5f + 0.5f) * clusters_y)));
+        bounds.min_z = getSlice(min_depth);
+        bounds.max_z = getSlice(max_depth);
+        return bounds;
+    }
+
+
+    int ClusteredLights::getSlice(float depth) const {
+
+        // Same as the shaders, which clamp the slice as well
+        int slice = static_cast<int>(std::floor(std::log(depth) * depth_scale_ - depth_bias_));
+        return std::min(std::max(slice, 0), clusters_z - 1);
+    }
+
+
+    void ClusteredLights::assign(int first, int last, Lists& lists) const {
+
+        const int slice_clusters = clusters_x * clusters_y;
+        lists.ranges.assign((last - first) * slice_clusters * 2, 0);
+        lists.indices.clear();
+        if (first >= last) {
+            return;
+        }
+
+        // Count the lights of each cluster, then place each cluster's list
+        // after the previous one and fill them
+        for (size_t i = 0; i < bounds_.size(); i++) {
+            const Bounds& b = bounds_[i];
+            for (int z = std::max(b.min_z, first); z <= std::min(b.max_z, last - 1); z++) {
+                for (int y = b.min_y; y <= b.max_y; y++) {
+                    for (int x = b.min_x; x <= b.max_x; x++) {
+                        lists.ranges[2 * (((z - first) * clusters_y + y) * clusters_x + x) + 1]++;
+                    }
+                }
+            }
+        }
+
+        GLuint total = 0;
+        for (size_t k = 0; k < lists.ranges.size(); k += 2) {
+            lists.ranges[k] = total;
+            total += lists.ranges[k + 1];
+            lists.ranges[k + 1] = 0;
+        }
+        lists.indices.resize(total);
+
+        for (size_t i = 0; i < bounds_.size(); i++) {
+            const Bounds& b = bounds_[i];
+            for (int z = std::max(b.min_z, first); z <= std::min(b.max_z, last - 1); z++) {
+                for (int y = b.min_y; y <= b.max_y; y++) {
+                    for (int x = b.min_x; x <= b.max_x; x++) {
+                        GLuint* range = &lists.ranges[2 * (((z - first) * clusters_y + y) * clusters_x + x)];
+                        lists.indices[range[0] + range[1]++] = static_cast<GLuint>(i);
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace game
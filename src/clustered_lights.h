@@ -0,0 +1,97 @@
+#ifndef CLUSTERED_LIGHTS_H_
+#define CLUSTERED_LIGHTS_H_
+
+#include <cstddef>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace game {
+
+    // Point light in world space
+    struct PointLight {
+        glm::vec3 position;
+        float radius; // No light reaches beyond it
+        glm::vec3 color;
+        float intensity;
+    };
+
+    // Point lights for forward shading, listed anew every frame. The view
+    // frustum is cut into clusters, tiles of the screen split again along
+    // the depth, and each cluster lists the lights that reach into it.
+    // Shaders find the cluster of a fragment and loop over its lights
+    // only, so the cost of a fragment follows the lights around it rather
+    // than all the lights of the scene. The lists are built on the CPU,
+    // split over worker threads by depth slice, and sent as buffer
+    // textures
+    class ClusteredLights {
+
+        public:
+            // Clusters across the screen, up it and along the depth
+            static const int clusters_x = 16;
+            static const int clusters_y = 9;
+            static const int clusters_z = 24;
+            // Lights kept per frame; the ones added past it are dropped
+            static const size_t max_lights = 4096;
+            // Texture units of the light buffers, after those of the materials
+            static const int light_unit = 4;
+
+            ClusteredLights(void);
+            ~ClusteredLights();
+
+            // Create the buffers; needs the GL context
+            void Init(void);
+
+            // Start the list of a new frame
+            void Clear(void);
+            // False when the list is full
+            bool Add(const PointLight& light);
+            size_t GetCount(void) const;
+
+            // Assign the lights to the clusters of the view and upload the
+            // lists; 'width' and 'height' are those of the viewport drawn to
+            void Update(const glm::mat4& view, const glm::mat4& projection, int width, int height);
+
+            // Set the lights and the layout of the clusters in a shader program
+            void SetupShader(GLuint program) const;
+
+        private:
+            // Clusters a light reaches, inclusive; empty when out of view
+            struct Bounds {
+                int min_x, max_x;
+                int min_y, max_y;
+                int min_z, max_z;
+            };
+
+            // Lists of the clusters of some depth slices
+            struct Lists {
+                std::vector<GLuint> ranges; // First index and count, per cluster
+                std::vector<GLuint> indices;
+            };
+
+            Bounds getBounds(const PointLight& light, const glm::mat4& view, const glm::mat4& projection) const;
+            int getSlice(float depth) const;
+            // Fill the lists of the slices in [first, last)
+            void assign(int first, int last, Lists& lists) const;
+
+            std::vector<PointLight> lights_;
+            std::vector<Bounds> bounds_;
+            std::vector<GLuint> ranges_;
+            std::vector<GLuint> indices_;
+            std::vector<glm::vec4> light_data_;
+
+            // Slice of a view depth: log(depth) * depth_scale_ - depth_bias_
+            float near_, far_;
+            float depth_scale_, depth_bias_;
+            glm::vec2 tile_size_; // In pixels
+
+            GLuint light_buffer_, light_texture_;
+            GLuint cluster_buffer_, cluster_texture_;
+            GLuint index_buffer_, index_texture_;
+
+    }; // class ClusteredLights
+
+} // namespace game
+
+#endif // CLUSTERED_LIGHTS_H_
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cmath>
+
+#include "collision_world.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_WORLD_SSE2
+#endif
+
+namespace game {
+
+namespace {
+
+    // A handle is a slot index with the generation of the slot on top
+    const int slot_bits = 20;
+    const uint32_t slot_mask = (1u << slot_bits) - 1;
+    const uint32_t generation_mask = (1u << (32 - slot_bits)) - 1;
+    const uint32_t no_box = 0xffffffff;
+
+} // namespace
+
+
+CollisionWorld::CollisionWorld(float min_x, float min_z, float max_x, float max_z, float cell_size){
+
+    min_x_extent_ = min_x;
+    min_z_extent_ = min_z;
+    inv_cell_size_ = 1.0f / cell_size;
+    columns_ = std::max(1, static_cast<int>(std::ceil((max_x - min_x) * inv_cell_size_)));
+    rows_ = std::max(1, static_cast<int>(std::ceil((max_z - min_z) * inv_cell_size_)));
+    cells_.resize(columns_ * rows_);
+    stamp_ = 0;
+}
+
+
+void CollisionWorld::getCellRange(const glm::vec3& min, const glm::vec3& max, int& x0, int& z0, int& x1, int& z1) const {
+
+    x0 = std::min(std::max(static_cast<int>(std::floor((min.x - min_x_extent_) * inv_cell_size_)), 0), columns_ - 1);
+    z0 = std::min(std::max(static_cast<int>(std::floor((min.z - min_z_extent_) * inv_cell_size_)), 0), rows_ - 1);
+    x1 = std::min(std::max(static_cast<int>(std::floor((max.x - min_x_extent_) * inv_cell_size_)), 0), columns_ - 1);
+    z1 = std::min(std::max(static_cast<int>(std::floor((max.z - min_z_extent_) * inv_cell_size_)), 0), rows_ - 1);
+}
+
+
+CollisionWorld::Handle CollisionWorld::Add(const BoundingBox& box){
+
+    glm::vec3 min = glm::min(box.min, box.max);
+    glm::vec3 max = glm::max(box.min, box.max);
+
+    uint32_t slot;
+    if (!free_slots_.empty()){
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slot_dense_.size());
+        slot_dense_.push_back(no_box);
+        slot_generation_.push_back(0);
+        slot_stamp_.push_back(0);
+    }
+
+    uint32_t dense = static_cast<uint32_t>(min_x_.size());
+    min_x_.push_back(min.x);
+    min_y_.push_back(min.y);
+    min_z_.push_back(min.z);
+    max_x_.push_back(max.x);
+    max_y_.push_back(max.y);
+    max_z_.push_back(max.z);
+    dense_slot_.push_back(slot);
+    slot_dense_[slot] = dense;
+
+    int x0, z0, x1, z1;
+    getCellRange(min, max, x0, z0, x1, z1);
+    for (int z = z0; z <= z1; z++){
+        for (int x = x0; x <= x1; x++){
+            cells_[z * columns_ + x].push_back(slot);
+        }
+    }
+
+    return (slot_generation_[slot] << slot_bits) | slot;
+}
+
+
+bool CollisionWorld::IsValid(Handle handle) const {
+
+    uint32_t slot = handle & slot_mask;
+    return handle != invalid_handle && slot < slot_dense_.size() &&
+        slot_dense_[slot] != no_box && slot_generation_[slot] == (handle >> slot_bits);
+}
+
+
+void CollisionWorld::Remove(Handle handle){
+
+    if (!IsValid(handle)){
+        return;
+    }
+    uint32_t slot = handle & slot_mask;
+    uint32_t dense = slot_dense_[slot];
+
+    // Take the slot out of the cells the box covers
+    int x0, z0, x1, z1;
+    getCellRange(glm::vec3(min_x_[dense], min_y_[dense], min_z_[dense]), glm::vec3(max_x_[dense], max_y_[dense], max_z_[dense]), x0, z0, x1, z1);
+    for (int z = z0; z <= z1; z++){
+        for (int x = x0; x <= x1; x++){
+            std::vector<uint32_t>& cell = cells_[z * columns_ + x];
+            std::vector<uint32_t>::iterator it = std::find(cell.begin(), cell.end(), slot);
+            if (it != cell.end()){
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+
+    // Move the last box into the hole
+    uint32_t last = static_cast<uint32_t>(min_x_.size()) - 1;
+    min_x_[dense] = min_x_[last];
+    min_y_[dense] = min_y_[last];
+    min_z_[dense] = min_z_[last];
+    max_x_[dense] = max_x_[last];
+    max_y_[dense] = max_y_[last];
+    max_z_[dense] = max_z_[last];
+    dense_slot_[dense] = dense_slot_[last];
+    slot_dense_[dense_slot_[dense]] = dense;
+
+    min_x_.pop_back();
+    min_y_.pop_back();
+    min_z_.pop_back();
+    max_x_.pop_back();
+    max_y_.pop_back();
+    max_z_.pop_back();
+    dense_slot_.pop_back();
+
+    slot_dense_[slot] = no_box;
+    slot_generation_[slot] = (slot_generation_[slot] + 1) & generation_mask;
+    free_slots_.push_back(slot);
+}
+
+
+size_t CollisionWorld::GetCount(void) const {
+
+    return min_x_.size();
+}
+
+
+bool CollisionWorld::Overlaps(const BoundingBox& box) const {
+
+    return query(box, NULL);
+}
+
+
+void CollisionWorld::Query(const BoundingBox& box, std::vector<Handle>& hits) const {
+
+    hits.clear();
+    query(box, &hits);
+}
+
+
+bool CollisionWorld::query(const BoundingBox& box, std::vector<Handle>* hits) const {
+
+    glm::vec3 min = glm::min(box.min, box.max);
+    glm::vec3 max = glm::max(box.min, box.max);
+
+    // Gather each box of the covered cells once
+    if (++stamp_ == 0){
+        std::fill(slot_stamp_.begin(), slot_stamp_.end(), 0);
+        stamp_ = 1;
+    }
+    candidates_.clear();
+    int x0, z0, x1, z1;
+    getCellRange(min, max, x0, z0, x1, z1);
+    for (int z = z0; z <= z1; z++){
+        for (int x = x0; x <= x1; x++){
+            const std::vector<uint32_t>& cell = cells_[z * columns_ + x];
+            for (size_t i = 0; i < cell.size(); i++){
+                if (slot_stamp_[cell[i]] != stamp_){
+                    slot_stamp_[cell[i]] = stamp_;
+                    candidates_.push_back(slot_dense_[cell[i]]);
+                }
+            }
+        }
+    }
+
+    // Boxes overlap, touching included, unless they are apart on an axis
+    bool found = false;
+    size_t i = 0;
+#ifdef COLLISION_WORLD_SSE2
+    const __m128 qmin_x = _mm_set1_ps(min.x), qmin_y = _mm_set1_ps(min.y), qmin_z = _mm_set1_ps(min.z);
+    const __m128 qmax_x = _mm_set1_ps(max.x), qmax_y = _mm_set1_ps(max.y), qmax_z = _mm_set1_ps(max.z);
+    const uint32_t* c = candidates_.data();
+    for (; i + 4 <= candidates_.size(); i += 4){
+        __m128 bmin_x = _mm_set_ps(min_x_[c[i + 3]], min_x_[c[i + 2]], min_x_[c[i + 1]], min_x_[c[i]]);
+        __m128 bmin_y = _mm_set_ps(min_y_[c[i + 3]], min_y_[c[i + 2]], min_y_[c[i + 1]], min_y_[c[i]]);
+        __m128 bmin_z = _mm_set_ps(min_z_[c[i + 3]], min_z_[c[i + 2]], min_z_[c[i + 1]], min_z_[c[i]]);
+        __m128 bmax_x = _mm_set_ps(max_x_[c[i + 3]], max_x_[c[i + 2]], max_x_[c[i + 1]], max_x_[c[i]]);
+        __m128 bmax_y = _mm_set_ps(max_y_[c[i + 3]], max_y_[c[i + 2]], max_y_[c[i + 1]], max_y_[c[i]]);
+        __m128 bmax_z = _mm_set_ps(max_z_[c[i + 3]], max_z_[c[i + 2]], max_z_[c[i + 1]], max_z_[c[i]]);
+
+        __m128 overlap = _mm_and_ps(_mm_cmple_ps(bmin_x, qmax_x), _mm_cmpge_ps(bmax_x, qmin_x));
+        overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(bmin_y, qmax_y), _mm_cmpge_ps(bmax_y, qmin_y)));
+        overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(bmin_z, qmax_z), _mm_cmpge_ps(bmax_z, qmin_z)));
+
+        int mask = _mm_movemask_ps(overlap);
+        if (mask){
+            if (!hits){
+                return true;
+            }
+            found = true;
+            for (int k = 0; k < 4; k++){
+                if ((mask >> k) & 1){
+                    uint32_t slot = dense_slot_[c[i + k]];
+                    hits->push_back((slot_generation_[slot] << slot_bits) | slot);
+                }
+            }
+        }
+    }
+#endif
+    for (; i < candidates_.size(); i++){
+        uint32_t d = candidates_[i];
+        if (min_x_[d] <= max.x && max_x_[d] >= min.x &&
+            min_y_[d] <= max.y && max_y_[d] >= min.y &&
+            min_z_[d] <= max.z && max_z_[d] >= min.z){
+            if (!hits){
+                return true;
+            }
+            found = true;
+            uint32_t slot = dense_slot_[d];
+            hits->push_back((slot_generation_[slot] << slot_bits) | slot);
+        }
+    }
+
+    return found;
+}
+
+} // namespace game
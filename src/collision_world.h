@@ -0,0 +1,75 @@
+#ifndef COLLISION_WORLD_H_
+#define COLLISION_WORLD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+namespace game {
+
+    // Static axis aligned boxes that the player and other movers collide
+    // with. The boxes are kept as structure of arrays and indexed by a
+    // uniform grid over the map, so a query only tests the boxes in the
+    // cells it overlaps
+    class CollisionWorld {
+
+        public:
+            // Stable reference to a box; stays valid until the box is
+            // removed, whatever else is added or removed
+            typedef uint32_t Handle;
+            static const Handle invalid_handle = 0xffffffff;
+
+            // Grid of square cells over [min_x, max_x] x [min_z, max_z].
+            // Boxes outside the extents are kept in the border cells
+            CollisionWorld(float min_x, float min_z, float max_x, float max_z, float cell_size);
+
+            // Add a box; its corners may be given in any order
+            Handle Add(const BoundingBox& box);
+            // Remove a box in constant time; invalid handles are ignored
+            void Remove(Handle handle);
+            bool IsValid(Handle handle) const;
+            size_t GetCount(void) const;
+
+            // Whether any box overlaps the given one
+            bool Overlaps(const BoundingBox& box) const;
+            // Handles of all boxes overlapping the given one
+            void Query(const BoundingBox& box, std::vector<Handle>& hits) const;
+
+        private:
+            // Cell range covered by a box, clamped to the grid
+            void getCellRange(const glm::vec3& min, const glm::vec3& max, int& x0, int& z0, int& x1, int& z1) const;
+            // Collect the dense indices of the boxes in the cells a box
+            // covers, each once, then test them against the box. Stops at
+            // the first hit if 'hits' is null
+            bool query(const BoundingBox& box, std::vector<Handle>* hits) const;
+
+            // Boxes, densely packed
+            std::vector<float> min_x_, min_y_, min_z_;
+            std::vector<float> max_x_, max_y_, max_z_;
+            std::vector<uint32_t> dense_slot_; // Slot of each box
+
+            // Slots give handles a fixed place: the dense index of the box
+            // and a generation that is bumped on removal
+            std::vector<uint32_t> slot_dense_;
+            std::vector<uint32_t> slot_generation_;
+            std::vector<uint32_t> free_slots_;
+
+            // Slots of the boxes overlapping each cell
+            std::vector<std::vector<uint32_t> > cells_;
+            float min_x_extent_, min_z_extent_;
+            float inv_cell_size_;
+            int columns_, rows_;
+
+            // Scratch space of the queries
+            mutable std::vector<uint32_t> candidates_;
+            mutable std::vector<uint32_t> slot_stamp_;
+            mutable uint32_t stamp_;
+
+    }; // class CollisionWorld
+
+} // namespace game
+
+#endif // COLLISION_WORLD_H_
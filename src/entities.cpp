@@ -53,6 +53,10 @@ namespace game {
         return position_;
     }
 
+    const BoundingBox& Entity::getBBox() const {
+        return boundingBox;
+    }
+
 
     void Entity::Update(void) {
         //update bounding box
@@ -35,6 +35,7 @@ namespace game {
         void setPos(const glm::vec3& pos);
 
         glm::vec3 getPos();
+        const BoundingBox& getBBox() const;
 
         // Update geometry configuration
         void Update(void);
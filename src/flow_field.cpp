@@ -0,0 +1,269 @@
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "flow_field.h"
+
+namespace game {
+
+namespace {
+
+    // Cells popped between two checks for a newer request
+    const int check_interval = 1024;
+
+    const int neighbour_x[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+    const int neighbour_z[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+    const float neighbour_cost[8] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f };
+
+} // namespace
+
+
+FlowField::FlowField(void){
+
+    origin_x_ = 0.0f;
+    origin_z_ = 0.0f;
+    inv_cell_size_x_ = 1.0f;
+    inv_cell_size_z_ = 1.0f;
+    field_.rows = 0;
+    field_.columns = 0;
+    has_request_ = false;
+    target_x_ = 0;
+    target_z_ = 0;
+    revision_ = 0;
+    stop_ = false;
+    pending_ = false;
+    finished_ = false;
+    newer_request_ = false;
+}
+
+
+FlowField::~FlowField(){
+
+    Stop();
+}
+
+
+void FlowField::Start(void){
+
+    Stop();
+
+    stop_ = false;
+    worker_ = std::thread(&FlowField::workerLoop, this);
+}
+
+
+void FlowField::Stop(void){
+
+    if (worker_.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            newer_request_ = true;
+        }
+        work_condition_.notify_all();
+        worker_.join();
+    }
+
+    pending_ = false;
+    finished_ = false;
+    has_request_ = false;
+}
+
+
+void FlowField::Update(const glm::vec3& target, const WorldGrid& grid){
+
+    origin_x_ = grid.GetWorldX(0);
+    origin_z_ = grid.GetWorldZ(0);
+    inv_cell_size_x_ = 1.0f / (grid.GetWorldX(1) - origin_x_);
+    inv_cell_size_z_ = 1.0f / (grid.GetWorldZ(1) - origin_z_);
+
+    // Ask for a new field when the target changed cell or the grid changed
+    int target_x = grid.GetColumn(target.x);
+    int target_z = grid.GetRow(target.z);
+    uint32_t revision = grid.GetPassabilityRevision();
+    if (!has_request_ || target_x != target_x_ || target_z != target_z_ || revision != revision_){
+        has_request_ = true;
+        target_x_ = target_x;
+        target_z_ = target_z;
+        revision_ = revision;
+
+        Request request;
+        request.rows = grid.GetPassabilityRows();
+        request.columns = grid.GetPassabilityColumns();
+        request.target_x = target_x;
+        request.target_z = target_z;
+        request.impassable = grid.GetImpassableBits();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            request_ = std::move(request);
+            pending_ = true;
+            newer_request_ = true;
+        }
+        work_condition_.notify_all();
+    }
+
+    // Take the field built last, if any
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_){
+        std::swap(field_, built_);
+        finished_ = false;
+    }
+}
+
+
+glm::vec2 FlowField::GetDirection(float x, float z) const {
+
+    float gx = (x - origin_x_) * inv_cell_size_x_;
+    float gz = (z - origin_z_) * inv_cell_size_z_;
+    if (!(gx >= 0.0f && gx < field_.rows && gz >= 0.0f && gz < field_.columns)){
+        return glm::vec2(0.0f);
+    }
+
+    size_t cell = static_cast<size_t>(gx) * field_.columns + static_cast<size_t>(gz);
+    return glm::vec2(field_.direction_x[cell], field_.direction_z[cell]);
+}
+
+
+void FlowField::GetDirections(const float* x, const float* z, float* direction_x, float* direction_z, size_t count) const {
+
+    for (size_t i = 0; i < count; i++){
+        glm::vec2 direction = GetDirection(x[i], z[i]);
+        direction_x[i] = direction.x;
+        direction_z[i] = direction.y;
+    }
+}
+
+
+void FlowField::workerLoop(void){
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true){
+        work_condition_.wait(lock, [this]{ return stop_ || pending_; });
+        if (stop_){
+            return;
+        }
+
+        Request request = std::move(request_);
+        pending_ = false;
+        newer_request_ = false;
+
+        lock.unlock();
+        Field field;
+        bool complete = build(request, field);
+        lock.lock();
+
+        if (complete){
+            built_ = std::move(field);
+            finished_ = true;
+        }
+    }
+}
+
+
+bool FlowField::build(const Request& request, Field& field){
+
+    int rows = request.rows;
+    int columns = request.columns;
+    size_t cells = static_cast<size_t>(rows) * columns;
+    field.rows = rows;
+    field.columns = columns;
+    field.direction_x.assign(cells, 0.0f);
+    field.direction_z.assign(cells, 0.0f);
+
+    if (request.target_x < 0 || request.target_x >= rows || request.target_z < 0 || request.target_z >= columns){
+        return true;
+    }
+
+    std::vector<uint8_t> blocked(cells);
+    for (size_t i = 0; i < cells; i++){
+        blocked[i] = (request.impassable[i >> 6] >> (i & 63)) & 1;
+    }
+
+    // Walking distance to the target from every cell. The target cell
+    // counts as passable, so that the field still leads to a player
+    // standing on a cell that is not
+    const float unreached = std::numeric_limits<float>::max();
+    std::vector<float> distance(cells, unreached);
+    typedef std::pair<float, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+    int target = request.target_x * columns + request.target_z;
+    distance[target] = 0.0f;
+    open.push(Entry(0.0f, target));
+
+    int popped = 0;
+    while (!open.empty()){
+        Entry entry = open.top();
+        open.pop();
+        int cell = entry.second;
+        if (entry.first > distance[cell]){
+            continue;
+        }
+        if (++popped % check_interval == 0 && newer_request_){
+            return false;
+        }
+
+        int x = cell / columns;
+        int z = cell % columns;
+        for (int k = 0; k < 8; k++){
+            int nx = x + neighbour_x[k];
+            int nz = z + neighbour_z[k];
+            if (nx < 0 || nx >= rows || nz < 0 || nz >= columns){
+                continue;
+            }
+            int next = nx * columns + nz;
+            if (blocked[next]){
+                continue;
+            }
+            // Diagonal steps may not cut the corner of a blocked cell
+            if (k >= 4 && (blocked[nx * columns + z] || blocked[x * columns + nz])){
+                continue;
+            }
+            float cost = entry.first + neighbour_cost[k];
+            if (cost < distance[next]){
+                distance[next] = cost;
+                open.push(Entry(cost, next));
+            }
+        }
+    }
+
+    // Each reached cell points to the neighbour nearest to the target; the
+    // steps are the same as above, so the neighbour is one the search
+    // could walk to
+    for (int x = 0; x < rows; x++){
+        for (int z = 0; z < columns; z++){
+            int cell = x * columns + z;
+            if (cell == target || distance[cell] == unreached){
+                continue;
+            }
+            float best = distance[cell];
+            int best_k = -1;
+            for (int k = 0; k < 8; k++){
+                int nx = x + neighbour_x[k];
+                int nz = z + neighbour_z[k];
+                if (nx < 0 || nx >= rows || nz < 0 || nz >= columns){
+                    continue;
+                }
+                if (k >= 4 && (blocked[nx * columns + z] || blocked[x * columns + nz])){
+                    continue;
+                }
+                float d = distance[nx * columns + nz];
+                if (d < best){
+                    best = d;
+                    best_k = k;
+                }
+            }
+            if (best_k >= 0){
+                float length = (best_k >= 4) ? 1.41421356f : 1.0f;
+                field.direction_x[cell] = neighbour_x[best_k] / length;
+                field.direction_z[cell] = neighbour_z[best_k] / length;
+            }
+        }
+    }
+
+    return true;
+}
+
+} // namespace game
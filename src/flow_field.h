@@ -0,0 +1,87 @@
+#ifndef FLOW_FIELD_H_
+#define FLOW_FIELD_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "world_grid.h"
+
+namespace game {
+
+    // Directions toward a target over the passability grid of the world,
+    // shared by every agent chasing it. A worker thread integrates the
+    // walking distance to the target from every passable cell (Dijkstra,
+    // eight neighbours, no cutting corners) and stores in each cell the
+    // way to its best neighbour. The field is rebuilt only when the
+    // target changes cell or cells change passability; the main thread
+    // then copies the grid and swaps in the result, and never waits
+    class FlowField {
+
+        public:
+            FlowField(void);
+            ~FlowField();
+
+            void Start(void);
+            void Stop(void);
+
+            // Follow the target: request a new field if needed and take the
+            // one built last. Call once per frame, before sampling
+            void Update(const glm::vec3& target, const WorldGrid& grid);
+
+            // Unit direction to walk at a world position, or zero where
+            // there is none: in the cell of the target, on impassable or
+            // unreachable cells, outside the grid and before the first field
+            glm::vec2 GetDirection(float x, float z) const;
+            // Directions at 'count' positions given as separate x and z arrays
+            void GetDirections(const float* x, const float* z, float* direction_x, float* direction_z, size_t count) const;
+
+        private:
+            // Copy of the passability grid with the cell to reach
+            struct Request {
+                int rows, columns;
+                std::vector<uint64_t> impassable; // As kept by the world grid
+                int target_x, target_z;
+            };
+
+            struct Field {
+                int rows, columns;
+                std::vector<float> direction_x; // Row by row, as the passability grid
+                std::vector<float> direction_z;
+            };
+
+            void workerLoop(void);
+            // Returns false when a newer request arrived before the end
+            bool build(const Request& request, Field& field);
+
+            // Placement of the cells, from the grid of the last update
+            float origin_x_, origin_z_;
+            float inv_cell_size_x_, inv_cell_size_z_;
+
+            // Main thread only
+            Field field_;
+            bool has_request_;
+            int target_x_, target_z_;
+            uint32_t revision_;
+
+            // Shared with the worker
+            std::thread worker_;
+            std::mutex mutex_;
+            std::condition_variable work_condition_;
+            bool stop_;
+            bool pending_; // 'request_' not picked up yet
+            Request request_;
+            bool finished_; // 'built_' not taken yet
+            Field built_;
+            std::atomic<bool> newer_request_;
+
+    }; // class FlowField
+
+} // namespace game
+
+#endif // FLOW_FIELD_H_
@@ -5,11 +5,14 @@
 #include <algorithm>
 #define _USE_MATH_DEFINES
 #include <math.h>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
 
 #include "game.h"
 #include "skybox.h"
 #include "path_config.h"
-#include "instanced_object.h"
+#include "world_streamer.h"
+#include "gl_state.h"
 
 #define GAMEPLAY_MUSIC_VOLUME 0.2f
 #define INITIAL_MENU_MUSIC_VOLUME 0.3f
@@ -131,12 +134,8 @@ void Game::SetupResources(void){
     //----------------------------------- Meshes ------------------------------------
     resman_.LoadCustomResource(Mesh, "SignPost", signVerticesFilepath.c_str(), signFacesFilepath.c_str());
 
-    // Load material to be applied to insect particles
-    std::string filename = std::string(MATERIAL_DIRECTORY) + std::string("/Shaders/particle_insect");
-    resman_.LoadResource(Material, "ParticleInsectMaterial", filename.c_str());
-
     //Car Mesh
-    filename = std::string(MATERIAL_DIRECTORY) + std::string("/car.obj");
+    std::string filename = std::string(MATERIAL_DIRECTORY) + std::string("/car.obj");
     resman_.LoadResource(Mesh, "Car", filename.c_str());
 
     //Cabin Mesh
@@ -322,9 +321,6 @@ void Game::SetupResources(void){
     filename = std::string(MATERIAL_DIRECTORY) + std::string("/road_tex.png");
     resman_.LoadResource(Texture, "RoadText", filename.c_str());
 
-    // Create particles for insects
-    resman_.CreateInsectParticles("InsectParticles", 10);
-
     //-------------------------------Materials-----------------------------
     filename = std::string(SHADERS_DIRECTORY) + std::string("/material");
     resman_.LoadResource(Material, "ObjectMaterial", filename.c_str());
@@ -336,7 +332,16 @@ void Game::SetupResources(void){
     resman_.LoadResource(Material, "LitTextureShader", filename.c_str());
 
     filename = std::string(SHADERS_DIRECTORY) + std::string("/lit_textured_material_instanced");
-    resman_.LoadResource(Material, "LitTextureInstanceShader", filename.c_str());
+    resman_.LoadResource(Material, "LitTextureInstancedShader", filename.c_str());
+
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/lit_textured_material_family");
+    resman_.LoadResource(Material, "LitTextureFamilyShader", filename.c_str());
+
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/lit_textured_material_batch");
+    resman_.LoadResource(Material, "LitTextureBatchShader", filename.c_str());
+
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/texture_layer");
+    resman_.LoadResource(Material, "TextureLayerMaterial", filename.c_str());
 
     filename = std::string(SHADERS_DIRECTORY) + std::string("/lit_color");
     resman_.LoadResource(Material, "LitColorShader", filename.c_str());
@@ -344,9 +349,34 @@ void Game::SetupResources(void){
     filename = std::string(SHADERS_DIRECTORY) + std::string("/textured_particle");
     resman_.LoadResource(Material, "Particle", filename.c_str());
 
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/particle_system");
+    resman_.LoadResource(Material, "ParticleSystemMaterial", filename.c_str());
+
+    // Moves the particles of the particle system
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/particle_simulation");
+    std::vector<std::string> particle_state;
+    particle_state.push_back("out_position");
+    particle_state.push_back("out_velocity");
+    resman_.LoadFeedbackProgram("ParticleSimulation", filename.c_str(), particle_state);
+
     filename = std::string(SHADERS_DIRECTORY) + std::string("/terrain");
     resman_.LoadResource(Material, "TerrainShader", filename.c_str());
 
+    // Depth pre-pass of meshes and of instanced families
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/depth");
+    resman_.LoadResource(Material, "DepthMaterial", filename.c_str());
+
+    filename = std::string(SHADERS_DIRECTORY) + std::string("/depth_family");
+    resman_.LoadResource(Material, "DepthFamilyMaterial", filename.c_str());
+
+    //-------------------------------Texture Arrays-----------------------
+    // One layer per member of each instanced family, in the same order as
+    // the layers of the streamed groups
+    resman_.CreateTextureArray("VegetationTextures", { "TreeTexture1", "TreeTexture2" });
+    resman_.CreateTextureArray("PropTextures", { "Rock_1Texture", "Rock_2Texture", "Rock_3Texture", "GravestoneTexture" });
+
+    resman_.PrintTextureStats();
+
     //-------------------------------Screen Space Material------------------
     filename = std::string(SCREEN_SPACE_SHADERS_DIRECTORY) + std::string("/blank");
     resman_.LoadResource(SS_Material, "BlankShader", filename.c_str());
@@ -369,6 +399,10 @@ void Game::SetupResources(void){
     filename = std::string(SCREEN_SPACE_SHADERS_DIRECTORY) + std::string("/bloody");
     resman_.LoadResource(SS_Material, "BloodyShader", filename.c_str());
 
+    // Blends the transparent nodes over the scene
+    filename = std::string(SCREEN_SPACE_SHADERS_DIRECTORY) + std::string("/transparency_composite");
+    resman_.LoadResource(SS_Material, "TransparencyComposite", filename.c_str());
+
     // Skybox
     filename = std::string(MATERIAL_DIRECTORY) + std::string("/skybox/");
     resman_.LoadResource(SkyboxTexture, "SkyboxText", filename.c_str());
@@ -378,13 +412,17 @@ void Game::SetupResources(void){
 
     resman_.AddResource(Mesh, "SkyboxMesh", resman_.GetSkyboxVBO(), 36);
 
+    resman_.PrintShaderStats();
+
     resman_.GenerateSkybox();
     // ---
 
-    std::vector<std::vector<float>> terrain = resman_.LoadTerrainResource(Type::Mesh, "TerrainMesh", MATERIAL_DIRECTORY "/terrain.heightfield");
-    terrain_grid_ = terrain;
-    camera_.SetTerrainGrid(terrain);
-    camera_.SetImpassableCells(resman_.GetImpassableCells(MATERIAL_DIRECTORY "/impassable.csv", terrain));
+    resman_.LoadWorldGrid(world_grid_file_, MATERIAL_DIRECTORY "/terrain.heightfield", MATERIAL_DIRECTORY "/impassable.csv");
+    resman_.LoadTerrainHeights(world_grid_file_, world_grid_);
+    world_grid_.SetPassability(world_grid_file_);
+    camera_.SetWorldGrid(&world_grid_);
+    // Inside the rock wall border
+    camera_.SetBounds(-245.0f, -245.0f, 1645.0f, 1645.0f);
 
 #ifdef USE_SOUND
     const char* filepath = AUDIO_DIRECTORY "/oof.wav";
@@ -421,19 +459,14 @@ void Game::SetupScene(void){
     //camera_.Translate(camera_.GetUp() * 20.0f);
     
     
-    Resource* geom = resman_.GetResource("TerrainMesh");
-    Resource* mat  = resman_.GetResource("TerrainShader");
-    Resource* text;
-    Resource* mtext = resman_.GetResource("GrassTexture");
-    
-    SceneNode* terrain = scene_.CreateNode("Terrain", geom, mat, mtext);
-    constexpr int bumpyNess = 2; // at 1 the terrain will vary between 1 and -1 in the y. Increasing this causes more jagged terrain
+    // The terrain is streamed in chunks placed like this, see below
     int terrain_offset = 100;
-    terrain->SetScale(glm::vec3(100.0f + terrain_offset, 25.0f, 100.0f + terrain_offset));
-    terrain->SetPosition(glm::vec3(terrain_offset * 2, 0, terrain_offset * 2));
+    world_grid_.SetTransform(glm::vec3(terrain_offset * 2, 0, terrain_offset * 2), glm::vec3(100.0f + terrain_offset, 25.0f, 100.0f + terrain_offset));
 
     // Road
-    geom = resman_.GetResource("Wall");
+    Resource* geom = resman_.GetResource("Wall");
+    Resource* mat;
+    Resource* text;
     mat = resman_.GetResource("LitTextureShader");
     text = resman_.GetResource("RoadText");
     SceneNode* road = scene_.CreateNode("Road", geom, mat, text);
@@ -456,8 +489,18 @@ void Game::SetupScene(void){
     mat = resman_.GetResource("ObjectMaterial");
     SceneNode* cam_vertex = scene_.CreateNode("CameraVertex", geom, mat);
 
+    // Point lights, given to the lit materials with the flashlight
+    lights_.Init();
+    camera_.SetLights(&lights_);
+
     // Setup drawing to texture
     scene_.SetupDrawToTexture();
+    scene_.SetupTransparency(resman_.GetResource("TransparencyComposite")->GetResource());
+
+    // The forest stacks many layers of terrain and trees; lay their depth
+    // down first so that only the front one runs the lighting
+    scene_.SetDepthPrepass(TerrainLayer, resman_.GetResource("DepthMaterial")->GetResource());
+    scene_.SetDepthPrepass(FamilyLayer, resman_.GetResource("DepthFamilyMaterial")->GetResource());
     use_screen_space_effects_ = false;
 
     // -- Camera --
@@ -479,57 +522,74 @@ void Game::SetupScene(void){
     SummonUI("WinScreen", "WinText");
 
     // -- Ghost --
-    SummonGhost("Ghost1", glm::vec3(1600, 35, 1570));
+    SummonGhost("Ghosts", glm::vec3(1600, 35, 1570));
+    flow_field_.Start();
+    ghosts_->SetFlowField(&flow_field_);
 
     // -- Car -- 
-    SummonCar("Car", glm::vec3(-200, 100, -150));
+    SummonCar(glm::vec3(-200, 100, -150));
 
     // -- Border --
     // Border Rock Wall
-    SummonPlane("TreeBorder1", "RockTexture", glm::vec3(690, 0, -250), glm::vec3(970, 1, 40), 0);
-    SummonPlane("TreeBorder2", "RockTexture", glm::vec3(-250, 0, 690), glm::vec3(970, 1, 40), 90);
-    SummonPlane("TreeBorder3", "RockTexture", glm::vec3(690, 0, 1650), glm::vec3(970, 1, 40), 180);
-    SummonPlane("TreeBorder4", "RockTexture", glm::vec3(1650, 0, 690), glm::vec3(970, 1, 40), 270);
-
-    // -- Instanced Objects --
-    const std::vector<boundingArea> posesToIgnore{
+    SummonPlane("RockTexture", glm::vec3(690, 0, -250), glm::vec3(970, 1, 40), 0);
+    SummonPlane("RockTexture", glm::vec3(-250, 0, 690), glm::vec3(970, 1, 40), 90);
+    SummonPlane("RockTexture", glm::vec3(690, 0, 1650), glm::vec3(970, 1, 40), 180);
+    SummonPlane("RockTexture", glm::vec3(1650, 0, 690), glm::vec3(970, 1, 40), 270);
+
+    // -- Streamed World --
+    // Terrain, instanced objects and their collision boxes are loaded in
+    // chunks around the player
+    const std::vector<PlacementArea> posesToIgnore{
         // road
-        boundingArea{-300, 1700, -200, -100},
+        PlacementArea{-300, 1700, -200, -100},
         // river
-        boundingArea{-300, 1700, 90, 250},
+        PlacementArea{-300, 1700, 90, 250},
     };
 
-    std::vector<glm::vec3> filledPositions;
-    filledPositions.reserve(444 * 6);
-
-    glm::vec3 tree1Scale(5.0f, 50.0f, 3.5f);
-    glm::vec3 tree2Scale(6.5f, 50.0f, 3.5f);
-    SummonInstancedObjects("TreeInstance1", "Tree1", "TreeTexture1", 444, glm::vec3(3, 3, 3), tree1Scale, posesToIgnore, 100, filledPositions);
-    SummonInstancedObjects("TreeInstance2", "Tree2", "TreeTexture2", 444, glm::vec3(9, 9, 9), tree2Scale, posesToIgnore, 107, filledPositions);
-
-    const std::vector<boundingArea> rockPosesToIgnore{
+    const std::vector<PlacementArea> rockPosesToIgnore{
         // top right of map
-        boundingArea{-300, 800, -200, 1700},
+        PlacementArea{-300, 800, -200, 1700},
         // top of map
-        boundingArea{-300, 1700, 100, 1700},
+        PlacementArea{-300, 1700, 100, 1700},
     };
 
-    glm::vec3 rock1Scale(10.0f, 50.0f, 7.5f);
-    glm::vec3 rock2Scale(10.0f, 50.0f, 7.5f);
-    glm::vec3 rock3Scale(8.0f, 50.0f, 7.5f);
-    SummonInstancedObjects("RockInstance1", "Rock_1", "Rock_1Texture", 444, glm::vec3(0.2f, 0.2f, 0.2f), rock1Scale, rockPosesToIgnore, 101, filledPositions);
-    SummonInstancedObjects("RockInstance2", "Rock_2", "Rock_2Texture", 444, glm::vec3(5, 5, 5), rock2Scale, rockPosesToIgnore, 102, filledPositions);
-    SummonInstancedObjects("RockInstance3", "Rock_3", "Rock_3Texture", 444, glm::vec3(2, 2, 2), rock3Scale, rockPosesToIgnore, 103, filledPositions);
-
     // Only summon on top right of map
-    const std::vector<boundingArea> gravestonePosesToIgnore{
+    const std::vector<PlacementArea> gravestonePosesToIgnore{
         // left of map
-        boundingArea{400, 1700, -300, 1700},
+        PlacementArea{400, 1700, -300, 1700},
         // bottom of map
-        boundingArea{-300, 1700, -300, 250},
+        PlacementArea{-300, 1700, -300, 250},
     };
+
+    glm::vec3 tree1Scale(5.0f, 50.0f, 3.5f);
+    glm::vec3 tree2Scale(6.5f, 50.0f, 3.5f);
+    StreamedGroup vegetation{"VegetationInstances", resman_.GetResource("LitTextureFamilyShader"), resman_.GetResource("VegetationTextures"), {
+        StreamedMember{resman_.GetResource("Tree1"), 0, 3.0f, tree1Scale, PlacementFamily{444, 100, posesToIgnore}},
+        StreamedMember{resman_.GetResource("Tree2"), 1, 9.0f, tree2Scale, PlacementFamily{444, 107, posesToIgnore}},
+    }};
+
+    glm::vec3 rock1Scale(10.0f, 50.0f, 7.5f);
+    glm::vec3 rock2Scale(10.0f, 50.0f, 7.5f);
+    glm::vec3 rock3Scale(8.0f, 50.0f, 7.5f);
     glm::vec3 graveStoneScale(8.0f, 50.0f, 7.5f);
-    SummonInstancedObjects("GraveInstance1", "Gravestone", "GravestoneTexture", 444, glm::vec3(30, 30, 30), graveStoneScale, gravestonePosesToIgnore, 104, filledPositions);
+    StreamedGroup props{"PropInstances", resman_.GetResource("LitTextureFamilyShader"), resman_.GetResource("PropTextures"), {
+        StreamedMember{resman_.GetResource("Rock_1"), 0, 0.2f, rock1Scale, PlacementFamily{444, 101, rockPosesToIgnore}},
+        StreamedMember{resman_.GetResource("Rock_2"), 1, 5.0f, rock2Scale, PlacementFamily{444, 102, rockPosesToIgnore}},
+        StreamedMember{resman_.GetResource("Rock_3"), 2, 2.0f, rock3Scale, PlacementFamily{444, 103, rockPosesToIgnore}},
+        StreamedMember{resman_.GetResource("Gravestone"), 3, 30.0f, graveStoneScale, PlacementFamily{444, 104, gravestonePosesToIgnore}},
+    }};
+
+    WorldStreamerSettings streaming;
+    streaming.chunk_cells = 16; // 320 units
+    streaming.load_radius = 3; // Past the far clipping plane
+    streaming.unload_radius = 4;
+    streaming.upload_budget = 256 * 1024;
+    streaming.terrain_material = resman_.GetResource("TerrainShader");
+    streaming.terrain_texture = resman_.GetResource("GrassTexture");
+    streaming.placement_area = PlacementArea{-225, 1625, -215, 1591};
+    streaming.min_distance = 20.0f;
+    streaming.groups = {vegetation, props};
+    world_streamer_.Start(world_grid_, world_grid_file_, streaming);
 
     // -- Animated Trees --
     SummonTree("Tree1", glm::vec3(-50, 0, -50));
@@ -537,33 +597,36 @@ void Game::SetupScene(void){
     SummonTree("Tree3", glm::vec3(50, 0, -100));
 
     // -- Cabin --
-    SummonCabin("Cabin", glm::vec3(1424, 0, 1063));
+    SummonCabin(glm::vec3(1424, 0, 1063));
 
     // -- Key --
     SummonKey("Key", glm::vec3(1490, 30, 1160));
     //SummonKey("Key", glm::vec3(-200, 30, -120));
 
     // -- Signs --
-    SummonSign("Sign1", glm::vec3(-150, 0, -80), 210);
+    SummonSign(glm::vec3(-150, 0, -80), 210);
 
     // -- Fences --
     // Fences right of car
     for (int i = 0; i < 2; ++i) {
-        SummonFence("Fence" + std::to_string(i + 3), glm::vec3(-240 - 20 * i, 0, -120));
+        SummonFence(glm::vec3(-240 - 20 * i, 0, -120));
     }
 
     // Fences left of car
     for (int i = 0; i < 40; ++i) {
-		SummonFence("Fence" + std::to_string(i+3), glm::vec3(-160 + 20*i, 0, -120));
+		SummonFence(glm::vec3(-160 + 20*i, 0, -120));
 	}
 
     // -- Ruins --
     SummonRuins("Ruins", glm::vec3(954, 0, -20));
 
     // -- Insects --
-    SummonInsects("Insect1", glm::vec3(0, 30, 0));
-    SummonInsects("Insect2", glm::vec3(600, 30, -100));
-    SummonInsects("Insect3", glm::vec3(1200, 30, 100));
+    particles_ = new ParticleSystem("Particles", 1 << 16, resman_.GetResource("ParticleSimulation"),
+        resman_.GetResource("ParticleSystemMaterial"), resman_.GetResource("SparkleTexture"));
+    scene_.AddNode(particles_);
+    SummonInsects(glm::vec3(0, 30, 0));
+    SummonInsects(glm::vec3(600, 30, -100));
+    SummonInsects(glm::vec3(1200, 30, 100));
 
     //log summon version and interactable node version
     SummonLog("RegularLog", glm::vec3(0, 1000, 0), 2); // Summon far away, teleport to position later
@@ -574,7 +637,7 @@ void Game::SetupScene(void){
     InteractableNode* log2 = scene_.CreateInteractableNode("InteractableLog", geom, mat, text);
     log2->Scale(glm::vec3(0.05, 0.05, 0.05));
     log2->Translate(glm::vec3(1381, 0, 50));
-    log2->UpdateYPos(terrain_grid_, 5);
+    log2->UpdateYPos(world_grid_, 5);
 
     glm::vec3 log_held_pos = glm::vec3(-8, 0, 8);
     glm::vec3 log_held_scale = glm::vec3(0.05, 0.05, 0.05);
@@ -602,28 +665,38 @@ void Game::SetupScene(void){
     end_particles->SetBlending(true);
     end_node->SetParticles(end_particles);
     end_node->SetPosition(glm::vec3(0, 1000, 0));
+
+    // Have the chunks around the player in place before the first frame
+    world_streamer_.Flush(camera_.GetPosition());
 }
 
 void Game::SummonRuins(std::string name, glm::vec3 position) {
     SummonDoor(name + "Door", position + glm::vec3(0, 0, 50), 0);
-    SummonRuinWall(name + "Wall1", position + glm::vec3(25, 0, 50), 0);
-    SummonRuinWall(name + "Wall2", position + glm::vec3(-25, 0, 50), 0);
-    SummonRuinWall(name + "Wall3", position + glm::vec3(-40, 0, 10), 90);
-    SummonRuinWall(name + "Wall4", position + glm::vec3(40, 0, 10),270);
-    SummonRuinWall(name + "Wall5", position + glm::vec3(-40, 0, 30), 90);
-    SummonRuinWall(name + "Wall6", position + glm::vec3(40, 0, 30), 270);
-    SummonRuinWall(name + "Wall7", position + glm::vec3(0, 0, 0), 180);
-    SummonRuinWall(name + "Wall8", position + glm::vec3(-22, 0, 0), 180);
-    SummonRuinWall(name + "Wall9", position + glm::vec3(22, 0, 0), 180);
+    SummonRuinWall(position + glm::vec3(25, 0, 50), 0);
+    SummonRuinWall(position + glm::vec3(-25, 0, 50), 0);
+    SummonRuinWall(position + glm::vec3(-40, 0, 10), 90);
+    SummonRuinWall(position + glm::vec3(40, 0, 10),270);
+    SummonRuinWall(position + glm::vec3(-40, 0, 30), 90);
+    SummonRuinWall(position + glm::vec3(40, 0, 30), 270);
+    SummonRuinWall(position + glm::vec3(0, 0, 0), 180);
+    SummonRuinWall(position + glm::vec3(-22, 0, 0), 180);
+    SummonRuinWall(position + glm::vec3(22, 0, 0), 180);
     SummonGasCan(name + "GasCan", position + glm::vec3(0, 0, 20), 0);
 }
 
-void Game::SummonInsects(std::string name, glm::vec3 position) {
-    Resource* geom = resman_.GetResource("SphereParticles");
-    Resource* mat = resman_.GetResource("ParticleInsectMaterial");
-    Resource* text = resman_.GetResource("SparkleTexture");
-    SceneNode* node = scene_.CreateNode(name, geom, mat, text);
-    node->SetPosition(position);
+void Game::SummonInsects(glm::vec3 position) {
+    // A swarm held together by the pull of its emitter
+    ParticleEmitter insects;
+    insects.position = position;
+    insects.velocity = glm::vec3(0, 0, 0);
+    insects.spread = 6.0f;
+    insects.acceleration = glm::vec3(0, 0, 0);
+    insects.attraction = 0.4f;
+    insects.rate = 4.0f;
+    insects.lifetime = 5.0f;
+    insects.color = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+    insects.size = 1.0f;
+    insect_emitters_.push_back(particles_->AddEmitter(insects, 32));
 }
 
 void Game::SummonDoor(std::string name, glm::vec3 position, float rotation) {
@@ -634,10 +707,10 @@ void Game::SummonDoor(std::string name, glm::vec3 position, float rotation) {
     door_->Scale(glm::vec3(0.1, 0.1, 0.1));
     door_->Translate(glm::vec3(position));
     door_->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    door_->UpdateYPos(terrain_grid_, 0);
+    door_->UpdateYPos(world_grid_, 0);
 
     Entity entity(rotation == 90 || rotation == 270 ? 5.0f : 22.0f, 25.0f, rotation == 90 || rotation == 270 ? 22.0f : 5.0f, camera_.clampToGround(glm::vec3(position.x, 50, position.z), -3));
-    entities.push_back(entity);
+    door_collision_ = collision_world_.Add(entity.getBBox());
 }
 
 void Game::SummonKey(std::string name, glm::vec3 position) {
@@ -675,7 +748,7 @@ void Game::SummonGasCan(std::string name, glm::vec3 position, float rotation) {
     node->Translate(glm::vec3(position));
     node->SetOrientation(glm::angleAxis(glm::radians(90.0f), glm::vec3(0, 0, 1)));
     node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    node->UpdateYPos(terrain_grid_, 1);
+    node->UpdateYPos(world_grid_, 1);
 
     glm::vec3 gas_held_pos = glm::vec3(-3, -5, 12);
     glm::vec3 gas_held_scale = glm::vec3(4, 4, 4);
@@ -696,46 +769,46 @@ void Game::SummonGasCan(std::string name, glm::vec3 position, float rotation) {
     node->SetParticles(particles);
 }
 
-void Game::SummonRuinWall(std::string name, glm::vec3 position, float rotation) {
+void Game::SummonRuinWall(glm::vec3 position, float rotation) {
     Resource* geom = resman_.GetResource("StoneWall");
-	Resource* mat = resman_.GetResource("LitTextureShader");
-	Resource* text = resman_.GetResource("RuinTex");
-    SceneNode* node = scene_.CreateNode(name, geom, mat, text);
-    node->Scale(glm::vec3(0.05, 0.05, 0.05));
-    node->Translate(glm::vec3(position));
-    node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    node->UpdateYPos(terrain_grid_, 1);
+    glm::vec3 placed(position.x, world_grid_.GetHeight(position.x, position.z) + 1, position.z);
+    GetStaticBatch("RuinTex")->Add(geom, PropTransform(placed, glm::vec3(0.05, 0.05, 0.05), glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0))));
 
     Entity entity(rotation == 90 || rotation == 270 ? 5.0f : 22.0f, 25.0f, rotation == 90 || rotation == 270 ? 22.0f : 5.0f, camera_.clampToGround(glm::vec3(position.x, 50, position.z), -3));
-    entities.push_back(entity);
+    collision_world_.Add(entity.getBBox());
 }
 
-void Game::SummonFence(std::string name, glm::vec3 position, float rotation) {
+void Game::SummonFence(glm::vec3 position, float rotation) {
     Resource* geom = resman_.GetResource("Fence");
-    Resource* mat = resman_.GetResource("LitTextureShader");
-    Resource* text = resman_.GetResource("FenceTexture");
-    SceneNode* node = scene_.CreateNode(name, geom, mat, text);
-    node->Scale(glm::vec3(30, 30, 30));
-    node->Translate(position);
-    node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    node->UpdateYPos(terrain_grid_, 1);
+    glm::vec3 placed(position.x, world_grid_.GetHeight(position.x, position.z) + 1, position.z);
+    GetStaticBatch("FenceTexture")->Add(geom, PropTransform(placed, glm::vec3(30, 30, 30), glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0))));
 
     Entity entity(20.0f, 25.0f, 5.0f, camera_.clampToGround(glm::vec3(position.x, 50, position.z + 15), -3));
-    entities.push_back(entity);
+    collision_world_.Add(entity.getBBox());
 }
 
-void Game::SummonCar(std::string name, glm::vec3 position, float rotation) {
+void Game::SummonCar(glm::vec3 position, float rotation) {
     Resource* geom = resman_.GetResource("Car");
-    Resource* mat = resman_.GetResource("LitTextureShader");
-    Resource* text = resman_.GetResource("CarTexture");
-    SceneNode* node = scene_.CreateNode(name, geom, mat, text);
-    node->Scale(glm::vec3(5, 5, 5));
-    node->Translate(position);
-    node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    node->UpdateYPos(terrain_grid_, 8);
+    glm::vec3 placed(position.x, world_grid_.GetHeight(position.x, position.z) + 8, position.z);
+    GetStaticBatch("CarTexture")->Add(geom, PropTransform(placed, glm::vec3(5, 5, 5), glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0))));
 
     Entity entity(30.0f, 25.0f, 18.0f, camera_.clampToGround(glm::vec3(position.x, 50, position.z), -3));
-    entities.push_back(entity);
+    collision_world_.Add(entity.getBBox());
+}
+
+StaticBatch* Game::GetStaticBatch(const std::string& texture) {
+    StaticBatch*& batch = static_batches_[texture];
+    if (!batch) {
+        Resource* mat = resman_.GetResource("LitTextureBatchShader");
+        Resource* text = resman_.GetResource(texture);
+        batch = new StaticBatch("StaticProps_" + texture, resman_.GetGeometryArena(), mat, text);
+        scene_.AddNode(batch);
+    }
+    return batch;
+}
+
+glm::mat4 Game::PropTransform(const glm::vec3& position, const glm::vec3& scale, const glm::quat& orientation) {
+    return glm::translate(glm::mat4(1.0), position) * glm::mat4_cast(orientation) * glm::scale(glm::mat4(1.0), scale);
 }
 
 void Game::SummonUI(std::string name, std::string texture) {
@@ -752,83 +825,15 @@ void Game::SummonUI(std::string name, std::string texture) {
 
 void Game::SummonGhost(std::string name, glm::vec3 position) {
     Resource* geom = resman_.GetResource("Ghost");
-    Resource* mat = resman_.GetResource("LitTextureShader");
+    Resource* mat = resman_.GetResource("LitTextureInstancedShader");
     Resource* text = resman_.GetResource("ClothTexture");
 
-    ghost = new Ghost(name, geom, mat, text);
-    ghost->Scale(glm::vec3(0.3, 0.3, 0.3));
-    ghost->Translate(position);
-    scene_.AddNode(ghost);
-}
-
-void Game::SummonInstancedObjects(std::string name, std::string geometry, std::string texture, int amount, glm::vec3 scale, 
-                                  const glm::vec3& boundingBox, std::vector<boundingArea> posesToIgnore, int seed, std::vector<glm::vec3>& filledPosses) {
-    constexpr float minDistanceBetweenObjects = 20.0f;
-    
-    Resource* geom = resman_.GetResource(geometry);
-    Resource* mat = resman_.GetResource("LitTextureInstanceShader");
-    Resource* text = resman_.GetResource(texture);
-
-    srand(seed);
-
-    std::vector<glm::vec3> positions;
-    positions.reserve(amount);
-
-    std::vector<glm::quat> orientations;
-    orientations.reserve(amount);
-
-    std::vector<glm::vec3> scales;
-    scales.reserve(amount);
-
-    int j = 0;
-    for (int i = 0; i < amount; ++i) {
-        if ((120 * i) % 1800 >= 1800 - 120) {
-            j++;
-        }
-
-        bool ignore = false;
-
-        float randomX = (rand() % (261)) - 130;
-        float randomZ = (rand() % (261)) - 130;
-        float xpos = std::min(std::max(-150 + ((120 * i) % 1800) + randomX, -225.0f), 1625.0f);
-        float zpos = std::min(std::max(-170 + (60 * j) + randomZ, -215.0f), 1591.0f);
-
-        if (!posesToIgnore.empty()) {
-            for (const auto& box : posesToIgnore) {
-                if (xpos < box.maxx && xpos > box.minx && zpos > box.minz && zpos < box.maxz) {
-                    ignore = true;
-                    break;
-                }
-            }
-            if (ignore)
-                continue;
-		}
-
-        glm::vec3 newPos(xpos, 50, zpos);
-        for (const auto& pos : filledPosses) {
-            if (glm::length(newPos - pos) <= minDistanceBetweenObjects) {
-                ignore = true;
-                break;
-            }
-        }
-        if (ignore)
-            continue;
-
-        orientations.push_back(glm::angleAxis(glm::radians(0.0f), glm::vec3(0, 1, 0)));
-        scales.push_back(glm::vec3(scale));
-        positions.push_back(camera_.clampToGround(glm::vec3(xpos, 50, zpos), -3));
-
-        Entity entity(boundingBox.x, boundingBox.y, boundingBox.z, camera_.clampToGround(glm::vec3(xpos, 50, zpos), -3));
-        entity.setOrientation(glm::angleAxis(glm::radians(0.0f), glm::vec3(0, 1, 0)));
-        entities.push_back(entity);
-
-        filledPosses.push_back(glm::vec3(xpos, 50, zpos));
+    if (!ghosts_) {
+        ghosts_ = new GhostCrowd(name, geom, mat, text);
+        ghosts_->SetScale(0.3f);
+        scene_.AddNode(ghosts_);
     }
-
-    InstancedObject* objects = new InstancedObject(name, geom, mat, positions, scales, orientations, text);
-    scene_.AddNode(objects);
-
-    srand(time(NULL));
+    ghosts_->Spawn(position);
 }
 
 void Game::SummonTree(std::string name, glm::vec3 position, float rotation) {
@@ -836,51 +841,37 @@ void Game::SummonTree(std::string name, glm::vec3 position, float rotation) {
     SceneNode* node = scene_.GetNode(name + "_branch0");
     node->Translate(position);
     node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    node->UpdateYPos(terrain_grid_, 8);
+    node->UpdateYPos(world_grid_, 8);
 }
 
-void Game::SummonCabin(std::string name, glm::vec3 position, float rotation) {
+void Game::SummonCabin(glm::vec3 position, float rotation) {
     Resource* geom = resman_.GetResource("Cabin");
-    Resource* mat = resman_.GetResource("LitTextureShader");
-    Resource* text = resman_.GetResource("CabinTexture");
-    SceneNode* node = scene_.CreateNode(name, geom, mat, text);
-    node->Scale(glm::vec3(30, 30, 30));
-    node->Translate(position);
-    node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    node->UpdateYPos(terrain_grid_, 0);
+    glm::vec3 placed(position.x, world_grid_.GetHeight(position.x, position.z), position.z);
+    GetStaticBatch("CabinTexture")->Add(geom, PropTransform(placed, glm::vec3(30, 30, 30), glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0))));
 
     Entity entity(32.0f, 50.0f, 45.0f, camera_.clampToGround(glm::vec3(position.x+44, 50, position.z+28), -3));
-    entities.push_back(entity);
+    collision_world_.Add(entity.getBBox());
     Entity entity2(15.0, 50.0f, 17.0f, camera_.clampToGround(glm::vec3(position.x-5, 50, position.z+29), -3));
-    entities.push_back(entity2);
+    collision_world_.Add(entity2.getBBox());
 }
 
-void Game::SummonSign(std::string name, glm::vec3 position, float rotation) {
+void Game::SummonSign(glm::vec3 position, float rotation) {
     Resource* geom = resman_.GetResource("SignPost");
-    Resource* mat = resman_.GetResource("LitTextureShader");
-    Resource* text = resman_.GetResource("SignTexture");
-    SceneNode* node = scene_.CreateNode(name, geom, mat, text);
-    node->Scale(glm::vec3(8, 8, 8));
-    node->Translate(position);
-    node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    node->UpdateYPos(terrain_grid_, 8);
+    glm::vec3 placed(position.x, world_grid_.GetHeight(position.x, position.z) + 8, position.z);
+    GetStaticBatch("SignTexture")->Add(geom, PropTransform(placed, glm::vec3(8, 8, 8), glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0))));
 
     Entity entity(10.0f, 50.0f, 0.05f, camera_.clampToGround(glm::vec3(position.x, 50, position.z), -3));
     entity.setOrientation(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    entities.push_back(entity);
+    collision_world_.Add(entity.getBBox());
 }
 
-void Game::SummonPlane(std::string name, std::string texture, glm::vec3 position, glm::vec3 scale, float rotation) {
+void Game::SummonPlane(std::string texture, glm::vec3 position, glm::vec3 scale, float rotation) {
     Resource* geom = resman_.GetResource("Wall");
-    Resource* mat = resman_.GetResource("LitTextureShader");
-    Resource* text = resman_.GetResource(texture);
-    SceneNode* node = scene_.CreateNode(name, geom, mat, text);
-    node->SetScale(scale);
-    node->SetPosition(position);
-    node->SetOrientation(glm::angleAxis(glm::radians(90.0f), glm::vec3(1, 0, 0)));
-    node->Rotate(glm::angleAxis(glm::radians(180.0f), glm::vec3(1, 0, 0)));
-    node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 0, 1)));
-    node->UpdateYPos(terrain_grid_, -6);
+    glm::quat orientation = glm::angleAxis(glm::radians(90.0f), glm::vec3(1, 0, 0)) *
+        glm::angleAxis(glm::radians(180.0f), glm::vec3(1, 0, 0)) *
+        glm::angleAxis(glm::radians(rotation), glm::vec3(0, 0, 1));
+    glm::vec3 placed(position.x, world_grid_.GetHeight(position.x, position.z) - 6, position.z);
+    GetStaticBatch(texture)->Add(geom, PropTransform(placed, scale, orientation));
 }
 
 void Game::SummonLog(std::string name, glm::vec3 position, float rotation) {
@@ -891,24 +882,16 @@ void Game::SummonLog(std::string name, glm::vec3 position, float rotation) {
     node->Scale(glm::vec3(0.05, 0.05, 0.06));
     node->Translate(position);
     node->Rotate(glm::angleAxis(glm::radians(rotation), glm::vec3(0, 1, 0)));
-    //node->UpdateYPos(terrain_grid_, 5);
+    //node->UpdateYPos(world_grid_, 5);
 
     //Entity entity(10.0f, 25.0f, 10.0f, camera_.clampToGround(glm::vec3(position.x - 10, 50, position.y), -3));
-    //entities.push_back(entity);
+    //collision_world_.Add(entity.getBBox());
 }
 
 
 
 void Game::MainLoop(void){
     glfwSwapInterval(0);
-    const char* ssShaders[] = {"BlankShader",
-                               "NightVisionShader",
-                               "WaveringShader",
-                               "PixelatedShader",
-                               "DrunkShader",
-                               "BlurShader",
-                               "BloodyShader"
-                               };
 
 #ifdef USE_SOUND
     const char* filepath = AUDIO_DIRECTORY "/Agoraphobia.mp3";
@@ -961,7 +944,14 @@ void Game::MainLoop(void){
         if (gamePhase_ == GamePhase::gameplay) {
             checkKeys(deltaTime);
 
-            scene_.Update(&camera_, deltaTime, gamePhase_);
+            world_streamer_.Update(camera_.GetPosition());
+
+            scene_.Update(gamePhase_);
+
+            flow_field_.Update(camera_.GetPosition(), world_grid_);
+            ghosts_->Update(camera_.GetPosition(), static_cast<float>(deltaTime), world_grid_);
+
+            updateLights();
         }
 
         if (gamePhase_ == GamePhase::gameWon) {
@@ -1003,33 +993,18 @@ void Game::MainLoop(void){
         checkEntityCollision();
 
         // Draw the scene
+        // Loading and updates bind objects directly, so start with no
+        // cached GL state
+        GLState::BeginFrame();
         // Enable writing to depth buffer
-        glDepthMask(GL_TRUE);
-        glDisable(GL_BLEND);
-        glDepthFunc(GL_LESS);
+        GLState::DepthMask(GL_TRUE);
+        GLState::Disable(GL_BLEND);
+        GLState::DepthFunc(GL_LESS);
         if (!use_screen_space_effects_ || gamePhase_ != gameplay) {
             scene_.Draw(&camera_, gamePhase_);
         }
         else {
-            // enable these if using the drunk filter
-            if (screen_space_effect_index_ == 4) {
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            }
-            
-            scene_.DrawToTexture(&camera_, gamePhase_);
-            if (glm::length(ghost->GetPosition() - camera_.GetPosition()) <= 600.0f) {
-                adjustBlurFactor();
-                scene_.ApplySSE(resman_.GetResource(ssShaders[5])->GetResource());
-            }
-            
-
-            scene_.DisplayTexture(resman_.GetResource(ssShaders[screen_space_effect_index_])->GetResource());
-
-            if (screen_space_effect_index_ == 4) {
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            }
+            drawScreenSpace();
         }
 
         // Push buffer drawn in the background onto the display
@@ -1085,6 +1060,32 @@ void Game::KeyCallback(GLFWwindow* window, int key, int scancode, int action, in
         // Quit game early
         glfwSetWindowShouldClose(window, true);
     }
+
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        // Toggle the depth pre-pass of every layer, to compare the timings
+        bool prepass = !game->scene_.HasDepthPrepass(TerrainLayer);
+        GLuint depth = prepass ? game->resman_.GetResource("DepthMaterial")->GetResource() : 0;
+        GLuint family_depth = prepass ? game->resman_.GetResource("DepthFamilyMaterial")->GetResource() : 0;
+        game->scene_.SetDepthPrepass(TerrainLayer, depth);
+        game->scene_.SetDepthPrepass(FamilyLayer, family_depth);
+        game->scene_.SetDepthPrepass(ObjectLayer, depth);
+        std::cout << "Depth pre-pass " << (prepass ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        game->scene_.PrintPassTimes();
+        game->world_streamer_.PrintStats();
+    }
+
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        // The passes of the last frame, as compiled
+        game->render_graph_.Dump(std::cout);
+    }
+
+    if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        // What the mesh optimizer did to each model, cached or not
+        game->resman_.PrintMeshStats();
+    }
 }
 
 void Game::MouseCallback(GLFWwindow* window, double xpos, double ypos) {
@@ -1213,13 +1214,8 @@ void Game::OnInteract() {
 
                 if (glm::length((door->GetPosition() - camera_.GetPosition())) <= MAX_DIST_FROM_DOOR) {
 
-                    for (int i = 0; i < entities.size(); ++i) {
-                        // Most reliable way to find the collision entity that represents the door
-                        if ((entities[i].getPos().x == door->GetPosition().x) && (entities[i].getPos().z == door->GetPosition().z)) {
-                            entities.erase(entities.begin() + i);
-                            break;
-                        }
-                    }
+                    collision_world_.Remove(door_collision_);
+                    door_collision_ = CollisionWorld::invalid_handle;
      
                     held_item_->SetParent(NULL);
                     held_item_->SetPosition(glm::vec3(0, 1000, 0));
@@ -1258,7 +1254,7 @@ void Game::OnInteract() {
             held_item_->SetPosition(camera_.GetPosition() + 10.0f*camera_.GetForward() - glm::vec3(0, 6, 0));
             held_item_->SetOrientation(held_item_->GetWorldOrientation());
             held_item_->SetScale(held_item_->GetWorldScale());
-            held_item_->UpdateYPos(terrain_grid_,2);
+            held_item_->UpdateYPos(world_grid_,2);
 
             held_item_ = NULL;
         }
@@ -1322,6 +1318,8 @@ void Game::ResizeCallback(GLFWwindow* window, int width, int height){
 
 Game::~Game(){
     
+    world_streamer_.Stop();
+    flow_field_.Stop();
     glfwTerminate();
 }
 
@@ -1439,8 +1437,9 @@ bool Game::ghostContact() {
 
     
 
-    //player contacted
-    if (ghost->getContacted() == true) {
+    //player contacted; touches in the same frame cost a single hit
+    const std::vector<uint32_t>& contacts = ghosts_->GetContacts();
+    if (!contacts.empty()) {
         hp -= 1;
 
 #ifdef USE_SOUND
@@ -1468,11 +1467,11 @@ bool Game::ghostContact() {
 
         glm::vec3 ghostSpawnPoint(possibleSpawns[positionIndex].first, 35, possibleSpawns[positionIndex].second);
 
-        //warp ghost to random position
-        ghost->SetPosition(ghostSpawnPoint);
-
-        //set contact to false
-        ghost->setContacted(false);
+        //warp the ghosts to the spawn point, back in pursuit
+        for (size_t i = 0; i < contacts.size(); ++i) {
+            ghosts_->Respawn(contacts[i], ghostSpawnPoint);
+        }
+        ghosts_->ClearContacts();
 
         return true;
     }
@@ -1484,24 +1483,71 @@ void Game::checkEntityCollision() {
 
     camera_.updateBoundingBox();
 
-    //loop through entities
-    for(const auto& entity : entities) {
-        bool collision = entity.checkPlayerCollision(&camera_);
-        
-        //if colliding with an entity
-        if (collision) {
-            camera_.SetPosition(originalPos);
-            camera_.updateBoundingBox();
-        }
+    //if colliding with an entity near the player
+    if (collision_world_.Overlaps(camera_.getBBox())) {
+        camera_.SetPosition(originalPos);
+        camera_.updateBoundingBox();
     }
 
     originalPos = camera_.GetPosition();
 
 }
 
+void Game::drawScreenSpace() {
+    const char* ssShaders[] = {"BlankShader",
+                               "NightVisionShader",
+                               "WaveringShader",
+                               "PixelatedShader",
+                               "DrunkShader",
+                               "BlurShader",
+                               "BloodyShader"
+                               };
+
+    render_graph_.Reset();
+    GraphTarget scene = render_graph_.Import("Scene", scene_.GetTexture(), scene_.GetFrameBuffer(), FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
+    GraphTarget blurred = render_graph_.CreateTarget("Blurred", FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
+
+    render_graph_.AddPass("Scene", {}, scene, [this](const RenderGraph&) {
+        scene_.DrawToTexture(&camera_, gamePhase_);
+    });
+
+    // Blur the view as a ghost gets close; a single sample is a copy
+    glm::vec3 ghostpos = ghosts_->GetPosition(ghosts_->GetNearest(camera_.GetPosition()));
+    bool blur = false;
+    if (glm::length(ghostpos - camera_.GetPosition()) <= 600.0f) {
+        adjustBlurFactor();
+        blur = scene_.blurrSamples > 1;
+    }
+    GLuint blur_program = resman_.GetResource(ssShaders[5])->GetResource();
+    render_graph_.AddPass("Blur", {scene}, blurred, [this, scene, blur_program](const RenderGraph& graph) {
+        scene_.DisplayTexture(blur_program, graph.GetTexture(scene));
+    }, !blur);
+
+    // The selected effect, straight to the screen; the blank shader is a copy
+    int effect = screen_space_effect_index_;
+    GLuint effect_program = resman_.GetResource(ssShaders[effect])->GetResource();
+    render_graph_.AddPass("Effect", {blurred}, render_graph_.GetScreen(), [this, blurred, effect, effect_program](const RenderGraph& graph) {
+        GLuint texture = graph.GetTexture(blurred);
+        // The drunk filter samples past the edges
+        if (effect == 4) {
+            GLState::BindTexture(0, GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        scene_.DisplayTexture(effect_program, texture);
+        if (effect == 4) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        }
+    }, effect == 0);
+
+    render_graph_.Compile();
+    render_graph_.Execute();
+}
+
 void Game::adjustBlurFactor() {
     constexpr int maxBlurSamples = 100;
-    glm::vec3 ghostpos = ghost->GetPosition();
+    glm::vec3 ghostpos = ghosts_->GetPosition(ghosts_->GetNearest(camera_.GetPosition()));
     ghostpos.y += 25.0f;
     float distanceToGhost = glm::length(camera_.GetPosition() - ghostpos);
     float angleToGhost = acos(glm::dot(camera_.GetForward(), glm::normalize(ghostpos - camera_.GetPosition())));
@@ -1514,4 +1560,47 @@ void Game::adjustBlurFactor() {
     scene_.blurrSamples = std::max(std::min(blurSamples, maxBlurSamples), 1);
 }
 
+void Game::updateLights() {
+    lights_.Clear();
+
+    // Swarms glow in the color of their insects
+    for (size_t i = 0; i < insect_emitters_.size(); i++) {
+        const ParticleEmitter& insects = particles_->GetEmitter(insect_emitters_[i]);
+        PointLight light;
+        light.position = insects.position;
+        light.radius = 40.0f;
+        light.color = glm::vec3(insects.color);
+        light.intensity = 0.8f;
+        lights_.Add(light);
+    }
+
+    // Sparkles over the items, wherever they are carried
+    float current_time = static_cast<float>(glfwGetTime());
+    for (std::vector<Renderable*>::const_iterator it = scene_.begin(); it != scene_.end(); ++it) {
+        SceneNode* sparkles = dynamic_cast<SceneNode*>(*it);
+        if (sparkles && sparkles->IsBlended()) {
+            PointLight light;
+            light.position = glm::vec3(sparkles->CalculateTransform(current_time)[3]);
+            light.radius = 30.0f;
+            light.color = glm::vec3(1.0f, 0.9f, 0.6f);
+            light.intensity = 0.6f;
+            lights_.Add(light);
+        }
+    }
+
+    // Aura around each ghost, at its hover height
+    for (size_t i = 0; i < ghosts_->GetCount(); i++) {
+        PointLight light;
+        light.position = ghosts_->GetPosition(i) + glm::vec3(0, 25, 0);
+        light.radius = 60.0f;
+        light.color = glm::vec3(0.5f, 0.7f, 1.0f);
+        light.intensity = 0.7f;
+        if (!lights_.Add(light)) {
+            break;
+        }
+    }
+
+    lights_.Update(camera_.GetViewMatrix(), camera_.GetProjectionMatrix(), FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
+}
+
 } // namespace game
@@ -2,6 +2,7 @@
 #define GAME_H_
 
 #include <exception>
+#include <map>
 #include <string>
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -15,8 +16,16 @@
 #include "camera.h"
 #include "scene_graph.h"
 
-#include "ghost.h"
+#include "flow_field.h"
+#include "ghost_crowd.h"
+#include "particle_system.h"
+#include "clustered_lights.h"
 #include "entities.h"
+#include "collision_world.h"
+#include "instanced_family.h"
+#include "static_batch.h"
+#include "render_graph.h"
+#include "world_streamer.h"
 
 // Interaction related constants
 #define INTERACT_COOLDOWN 2
@@ -67,7 +76,8 @@ namespace game {
             SceneNode* rock2_;
             SceneNode* rock3_;
             SceneNode* gravestone_;
-            Ghost* ghost;
+            GhostCrowd* ghosts_ = nullptr;
+            ParticleSystem* particles_ = nullptr; // Emitters of the insects
             SceneNode* gasCan_;
             SceneNode* door_;
             SceneNode* sWall_;
@@ -75,8 +85,9 @@ namespace game {
             SceneNode* log;
             //InteractableNode* log2;
 
-            //entities vector
-            std::vector<Entity> entities;
+            // Collision boxes of the entities, over the extents of the world grid
+            CollisionWorld collision_world_{-300.0f, -300.0f, 1700.0f, 1700.0f, 40.0f};
+            CollisionWorld::Handle door_collision_ = CollisionWorld::invalid_handle;
             glm::vec3 originalPos;
 
             // Held interactable item
@@ -98,6 +109,11 @@ namespace game {
             bool use_screen_space_effects_ = false;
             int screen_space_effect_index_ = 0;
 
+            // Passes from the scene texture to the screen, declared again
+            // every frame
+            RenderGraph render_graph_;
+            void drawScreenSpace(void);
+
             // Methods to initialize the game
             void InitWindow(void);
             void InitView(void);
@@ -123,8 +139,17 @@ namespace game {
             // Mouse position
             glm::vec2 lastMousePos_;
 
-            // Terrain Grid
-            std::vector<std::vector<float>> terrain_grid_;
+            // Heights and passability of the terrain, shared with the camera
+            WorldGrid world_grid_;
+            // Baked world grid, kept mapped for the streamer
+            WorldGridFile world_grid_file_;
+            // Terrain, instances and their collision boxes around the player
+            WorldStreamer world_streamer_{scene_, collision_world_};
+            // Way to the player around impassable cells, for the ghosts
+            FlowField flow_field_;
+            // Point lights of the insects, sparkles and ghosts, listed every frame
+            ClusteredLights lights_;
+            std::vector<ParticleSystem::EmitterHandle> insect_emitters_;
 
             // Game Phase
             GamePhase gamePhase_ = title;
@@ -137,24 +162,31 @@ namespace game {
 
             void adjustBlurFactor();
 
-            typedef struct { float minx; float maxx; float minz; float maxz; } boundingArea;
+            // List the lights of this frame and assign them to the view
+            void updateLights();
+
+            // Props that never move, drawn together; one batch per texture
+            std::map<std::string, StaticBatch*> static_batches_;
+            StaticBatch* GetStaticBatch(const std::string& texture);
+            // World matrix of a prop, as its scene node would have computed it
+            static glm::mat4 PropTransform(const glm::vec3& position, const glm::vec3& scale, const glm::quat& orientation);
 
             // Summon Objects
-            void SummonFence(std::string name, glm::vec3 position, float rotation = 0);
-            void SummonCar(std::string name, glm::vec3 position, float rotation = 0);
+            void SummonFence(glm::vec3 position, float rotation = 0);
+            void SummonCar(glm::vec3 position, float rotation = 0);
             void SummonUI(std::string name, std::string texture);
+            // Add a ghost to the crowd; the crowd is named after the first one summoned
             void SummonGhost(std::string name, glm::vec3 position);
             void SummonTree(std::string name, glm::vec3 position, float rotation = 0);
-            void SummonCabin(std::string name, glm::vec3 position, float rotation = 0);
-            void SummonSign(std::string name, glm::vec3 position, float rotation = 0);
-            void SummonPlane(std::string name, std::string texture, glm::vec3 position, glm::vec3 scale, float rotation = 0);
-            void SummonInstancedObjects(std::string name, std::string geometry, std::string texture, int amount, glm::vec3 scale, const glm::vec3& boundingBox, std::vector<boundingArea>, int seed, std::vector<glm::vec3>& filledPosses);
+            void SummonCabin(glm::vec3 position, float rotation = 0);
+            void SummonSign(glm::vec3 position, float rotation = 0);
+            void SummonPlane(std::string texture, glm::vec3 position, glm::vec3 scale, float rotation = 0);
             void SummonRuins(std::string name, glm::vec3 position);
             void SummonDoor(std::string name, glm::vec3 position, float rotation = 0);
             void SummonGasCan(std::string name, glm::vec3 position, float rotation = 0);
-            void SummonRuinWall(std::string name, glm::vec3 position, float rotation = 0);
+            void SummonRuinWall(glm::vec3 position, float rotation = 0);
             void SummonKey(std::string name, glm::vec3 position);
-            void SummonInsects(std::string name, glm::vec3 position);
+            void SummonInsects(glm::vec3 position);
             void SummonLog(std::string name, glm::vec3 position, float rotation = 0);
 
     }; // class Game
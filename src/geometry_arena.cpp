@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "geometry_arena.h"
+
+namespace game {
+
+    GeometryArena::GeometryArena(GLsizeiptr vertex_bytes, GLsizeiptr index_bytes) {
+
+        initial_vertex_bytes_ = vertex_bytes;
+        initial_index_bytes_ = index_bytes;
+    }
+
+
+    GeometryArena::~GeometryArena() {
+
+        for (std::map<VertexFormat, Pool>::iterator it = pools_.begin(); it != pools_.end(); ++it) {
+            glDeleteVertexArrays(1, &it->second.vertex_array);
+            glDeleteBuffers(1, &it->second.array_buffer);
+            glDeleteBuffers(1, &it->second.element_array_buffer);
+        }
+    }
+
+
+    const GeometryRange& GeometryArena::Add(const Resource* geometry, VertexFormat format) {
+
+        std::pair<const Resource*, VertexFormat> key(geometry, format);
+        std::map<std::pair<const Resource*, VertexFormat>, GeometryRange>::iterator found = ranges_.find(key);
+        if (found != ranges_.end()) {
+            return found->second;
+        }
+        if (geometry->GetType() != Mesh) {
+            throw(std::invalid_argument(std::string("Invalid type of geometry")));
+        }
+
+        GLsizeiptr vertex_size = GetVertexSize(format);
+
+        GLint buffer_size;
+        glBindBuffer(GL_COPY_READ_BUFFER, geometry->GetArrayBuffer());
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &buffer_size);
+        GLsizeiptr vertex_bytes = buffer_size / GetVertexSize(geometry->GetVertexFormat()) * vertex_size;
+        GLsizeiptr index_bytes = geometry->GetSize() * sizeof(GLuint);
+
+        // First mesh of its format: make the buffers and their vertex array
+        std::map<VertexFormat, Pool>::iterator it = pools_.find(format);
+        if (it == pools_.end()) {
+            Pool pool;
+            pool.array_buffer = 0;
+            pool.element_array_buffer = 0;
+            pool.vertex_capacity = pool.vertex_used = 0;
+            pool.index_capacity = pool.index_used = 0;
+            glGenVertexArrays(1, &pool.vertex_array);
+            it = pools_.insert(std::make_pair(format, pool)).first;
+        }
+        Pool& pool = it->second;
+        reserve(format, pool, vertex_bytes, index_bytes);
+
+        GeometryRange range;
+        range.format = format;
+        range.base_vertex = static_cast<GLint>(pool.vertex_used / vertex_size);
+        range.first_index = static_cast<GLuint>(pool.index_used / sizeof(GLuint));
+        range.count = geometry->GetSize();
+
+        // Copy on the GPU, or through memory when the vertices have to be
+        // converted; the mesh keeps its own buffers for the nodes that
+        // draw it on its own
+        if (geometry->GetVertexFormat() == format) {
+            glBindBuffer(GL_COPY_READ_BUFFER, geometry->GetArrayBuffer());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pool.array_buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, pool.vertex_used, vertex_bytes);
+        }
+        else {
+            std::vector<GLubyte> vertices = ReadVertices(geometry->GetArrayBuffer(), geometry->GetVertexFormat(), format);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pool.array_buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, pool.vertex_used, vertex_bytes, vertices.data());
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, geometry->GetElementArrayBuffer());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.element_array_buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, pool.index_used, index_bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        pool.vertex_used += vertex_bytes;
+        pool.index_used += index_bytes;
+        return ranges_[key] = range;
+    }
+
+
+    GLuint GeometryArena::GetVertexArray(VertexFormat format) const {
+
+        std::map<VertexFormat, Pool>::const_iterator it = pools_.find(format);
+        return it == pools_.end() ? 0 : it->second.vertex_array;
+    }
+
+
+    GLsizeiptr GeometryArena::GetVertexBytes(void) const {
+
+        GLsizeiptr bytes = 0;
+        for (std::map<VertexFormat, Pool>::const_iterator it = pools_.begin(); it != pools_.end(); ++it) {
+            bytes += it->second.vertex_used;
+        }
+        return bytes;
+    }
+
+
+    GLsizeiptr GeometryArena::GetIndexBytes(void) const {
+
+        GLsizeiptr bytes = 0;
+        for (std::map<VertexFormat, Pool>::const_iterator it = pools_.begin(); it != pools_.end(); ++it) {
+            bytes += it->second.index_used;
+        }
+        return bytes;
+    }
+
+
+    // Move the used part of 'buffer' to a new buffer of 'capacity' bytes
+    static void growBuffer(GLuint& buffer, GLsizeiptr used, GLsizeiptr capacity) {
+
+        GLuint grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+        if (buffer) {
+            if (used > 0) {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer = grown;
+    }
+
+
+    void GeometryArena::reserve(VertexFormat format, Pool& pool, GLsizeiptr vertex_bytes, GLsizeiptr index_bytes) {
+
+        bool grown = false;
+        if (pool.vertex_used + vertex_bytes > pool.vertex_capacity) {
+            GLsizeiptr capacity = std::max(std::max(pool.vertex_capacity * 2, initial_vertex_bytes_), pool.vertex_used + vertex_bytes);
+            growBuffer(pool.array_buffer, pool.vertex_used, capacity);
+            pool.vertex_capacity = capacity;
+            grown = true;
+        }
+        if (pool.index_used + index_bytes > pool.index_capacity) {
+            GLsizeiptr capacity = std::max(std::max(pool.index_capacity * 2, initial_index_bytes_), pool.index_used + index_bytes);
+            growBuffer(pool.element_array_buffer, pool.index_used, capacity);
+            pool.index_capacity = capacity;
+            grown = true;
+        }
+
+        // Point the vertex array at the new buffers
+        if (grown) {
+            glBindVertexArray(pool.vertex_array);
+            glBindBuffer(GL_ARRAY_BUFFER, pool.array_buffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.element_array_buffer);
+            SetupVertexFormat(format);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+
+} // namespace game
@@ -0,0 +1,78 @@
+#ifndef GEOMETRY_ARENA_H_
+#define GEOMETRY_ARENA_H_
+
+#include <map>
+#include <utility>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "resource.h"
+
+namespace game {
+
+    // Where a mesh lives in the arena of its vertex format
+    struct GeometryRange {
+        VertexFormat format;
+        GLint base_vertex;
+        GLuint first_index;
+        GLsizei count; // Number of indices
+    };
+
+    // Draw of a mesh, laid out as glMultiDrawElementsIndirect expects
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint base_vertex;
+        GLuint base_instance;
+    };
+
+    // One large vertex buffer and one index buffer per vertex format, with
+    // a vertex array over them. Meshes are copied in on the GPU and then
+    // addressed by base vertex and first index, so that everything drawn
+    // from the arena shares a single vertex array. Indices stay local to
+    // their mesh. The buffers double when they run out of room
+    class GeometryArena {
+
+        public:
+            // Room for 'vertex_bytes' and 'index_bytes' in each vertex
+            // format before the first growth; nothing is allocated until a
+            // mesh of that format is added
+            GeometryArena(GLsizeiptr vertex_bytes = 8 << 20, GLsizeiptr index_bytes = 2 << 20);
+            ~GeometryArena();
+
+            // Copy a triangle mesh into the arena of 'format', converting
+            // its vertices if the mesh is in another format; each mesh is
+            // copied once per format and later calls return the same range
+            const GeometryRange& Add(const Resource* geometry, VertexFormat format);
+
+            // Vertex array over the buffers of 'format', with every
+            // attribute of the format; 0 while the format has no mesh
+            GLuint GetVertexArray(VertexFormat format) const;
+
+            // Bytes used by the meshes, all formats together
+            GLsizeiptr GetVertexBytes(void) const;
+            GLsizeiptr GetIndexBytes(void) const;
+
+        private:
+            struct Pool {
+                GLuint array_buffer;
+                GLuint element_array_buffer;
+                GLuint vertex_array;
+                GLsizeiptr vertex_capacity, vertex_used;
+                GLsizeiptr index_capacity, index_used;
+            };
+
+            // Make room for 'vertex_bytes' and 'index_bytes' more
+            void reserve(VertexFormat format, Pool& pool, GLsizeiptr vertex_bytes, GLsizeiptr index_bytes);
+
+            GLsizeiptr initial_vertex_bytes_;
+            GLsizeiptr initial_index_bytes_;
+            std::map<VertexFormat, Pool> pools_;
+            std::map<std::pair<const Resource*, VertexFormat>, GeometryRange> ranges_;
+
+    }; // class GeometryArena
+
+} // namespace game
+
+#endif // GEOMETRY_ARENA_H_
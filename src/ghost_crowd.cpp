@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#include "ghost_crowd.h"
+#include "gl_state.h"
+#include "material_instance.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GHOST_CROWD_SSE2
+#endif
+
+
+namespace game {
+
+    namespace {
+
+        // Half size of the square around the player in which a ghost touches it
+        const float contact_distance = 17.0f;
+        // Height of a ghost above the ground
+        const float hover_height = 25.0f;
+
+    } // namespace
+
+
+    GhostCrowd::GhostCrowd(const std::string name, const Resource* geometry, const Resource* material, const Resource* texture)
+        : Renderable(name) {
+
+        if (geometry->GetType() != Mesh) {
+            throw(std::invalid_argument(std::string("Invalid type of geometry")));
+        }
+        if (material->GetType() != Material) {
+            throw(std::invalid_argument(std::string("Invalid type of material")));
+        }
+
+        array_buffer_ = geometry->GetArrayBuffer();
+        element_array_buffer_ = geometry->GetElementArrayBuffer();
+        size_ = geometry->GetSize();
+        vertex_format_ = geometry->GetVertexFormat();
+        material_ = material->GetResource();
+        texture_ = texture ? texture->GetResource() : 0;
+        material_instance_ = MaterialInstance::GetShared(material, texture);
+        blending_ = false;
+
+        speed_ = 55.0f;
+        scale_ = 1.0f;
+
+        glGenVertexArrays(1, &VAO);
+        setupVertexAttributes();
+    }
+
+
+    GhostCrowd::~GhostCrowd() {
+
+        glDeleteVertexArrays(1, &VAO);
+    }
+
+
+    size_t GhostCrowd::Spawn(const glm::vec3& position) {
+
+        x_.push_back(position.x);
+        y_.push_back(position.y);
+        z_.push_back(position.z);
+        velocity_x_.push_back(0.0f);
+        velocity_z_.push_back(0.0f);
+        heading_x_.push_back(0.0f);
+        heading_z_.push_back(-1.0f);
+        state_.push_back(Pursuing);
+
+        return x_.size() - 1;
+    }
+
+
+    void GhostCrowd::Respawn(size_t index, const glm::vec3& position) {
+
+        x_[index] = position.x;
+        y_[index] = position.y;
+        z_[index] = position.z;
+        velocity_x_[index] = 0.0f;
+        velocity_z_[index] = 0.0f;
+        state_[index] = Pursuing;
+    }
+
+
+    size_t GhostCrowd::GetCount(void) const {
+
+        return x_.size();
+    }
+
+
+    glm::vec3 GhostCrowd::GetPosition(size_t index) const {
+
+        return glm::vec3(x_[index], y_[index], z_[index]);
+    }
+
+
+    size_t GhostCrowd::GetNearest(const glm::vec3& position) const {
+
+        size_t nearest = 0;
+        float nearest_distance = 0.0f;
+        for (size_t i = 0; i < x_.size(); i++) {
+            float dx = x_[i] - position.x;
+            float dy = y_[i] - position.y;
+            float dz = z_[i] - position.z;
+            float distance = dx * dx + dy * dy + dz * dz;
+            if (i == 0 || distance < nearest_distance) {
+                nearest = i;
+                nearest_distance = distance;
+            }
+        }
+        return nearest;
+    }
+
+
+    void GhostCrowd::SetFlowField(const FlowField* flow_field) {
+
+        flow_field_ = flow_field;
+    }
+
+
+    void GhostCrowd::SetSpeed(float speed) {
+
+        speed_ = speed;
+    }
+
+
+    void GhostCrowd::SetScale(float scale) {
+
+        scale_ = scale;
+    }
+
+
+    const std::vector<uint32_t>& GhostCrowd::GetContacts(void) const {
+
+        return contacts_;
+    }
+
+
+    void GhostCrowd::ClearContacts(void) {
+
+        contacts_.clear();
+    }
+
+
+    void GhostCrowd::Update(const glm::vec3& target, float delta_time, const WorldGrid& grid) {
+
+        size_t count = x_.size();
+        records_.resize(count);
+        flow_x_.resize(count);
+        flow_z_.resize(count);
+
+        // Split large crowds in one range per core, each a whole number of batches
+        size_t batches = (count + batch_size - 1) / batch_size;
+        size_t jobs = std::min<size_t>(batches, std::max(1u, std::thread::hardware_concurrency()));
+        if (jobs <= 1) {
+            updateRange(0, count, target, delta_time, grid, contacts_);
+        } else {
+            size_t range = (batches + jobs - 1) / jobs * batch_size;
+            std::vector<std::vector<uint32_t> > found(jobs);
+            std::vector<std::future<void> > workers;
+            for (size_t i = 1; i < jobs; i++) {
+                size_t begin = std::min(i * range, count);
+                size_t end = std::min(begin + range, count);
+                workers.push_back(std::async(std::launch::async, &GhostCrowd::updateRange, this, begin, end,
+                    std::cref(target), delta_time, std::cref(grid), std::ref(found[i])));
+            }
+            updateRange(0, std::min(range, count), target, delta_time, grid, found[0]);
+            for (size_t i = 0; i < workers.size(); i++) {
+                workers[i].get();
+            }
+            for (size_t i = 0; i < jobs; i++) {
+                contacts_.insert(contacts_.end(), found[i].begin(), found[i].end());
+            }
+        }
+
+        // Ghosts that stood still, such as those at the target, are not
+        // sent again
+        instance_buffer_.Resize(count);
+        if (count > 0) {
+            instance_buffer_.Set(0, records_.data(), count);
+        }
+        instance_buffer_.Upload();
+    }
+
+
+    void GhostCrowd::updateRange(size_t begin, size_t end, const glm::vec3& target, float delta_time, const WorldGrid& grid, std::vector<uint32_t>& contacts) {
+
+        // Follow the flow field around obstacles, or head straight for the
+        // target where it has no direction
+        if (flow_field_) {
+            flow_field_->GetDirections(&x_[begin], &z_[begin], &flow_x_[begin], &flow_z_[begin], end - begin);
+        } else {
+            std::fill(flow_x_.begin() + begin, flow_x_.begin() + end, 0.0f);
+            std::fill(flow_z_.begin() + begin, flow_z_.begin() + end, 0.0f);
+        }
+
+        size_t i = begin;
+    #ifdef GHOST_CROWD_SSE2
+        const __m128 target_x = _mm_set1_ps(target.x);
+        const __m128 target_z = _mm_set1_ps(target.z);
+        const __m128 speed = _mm_set1_ps(speed_);
+        const __m128 step = _mm_set1_ps(speed_ * delta_time);
+        const __m128 reach = _mm_set1_ps(contact_distance);
+        const __m128 epsilon = _mm_set1_ps(1e-12f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        for (; i + 4 <= end; i += 4) {
+            __m128 x = _mm_loadu_ps(&x_[i]);
+            __m128 z = _mm_loadu_ps(&z_[i]);
+            __m128 dx = _mm_sub_ps(target_x, x);
+            __m128 dz = _mm_sub_ps(target_z, z);
+
+            // Ghosts on top of the target keep their heading and stay put
+            __m128 length2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz));
+            __m128 moving = _mm_cmpgt_ps(length2, epsilon);
+            __m128 inv_length = _mm_and_ps(_mm_div_ps(one, _mm_sqrt_ps(length2)), moving);
+            __m128 fx = _mm_loadu_ps(&flow_x_[i]);
+            __m128 fz = _mm_loadu_ps(&flow_z_[i]);
+            __m128 flowing = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fz, fz)), epsilon);
+            __m128 hx = _mm_or_ps(_mm_and_ps(flowing, fx), _mm_andnot_ps(flowing, _mm_mul_ps(dx, inv_length)));
+            __m128 hz = _mm_or_ps(_mm_and_ps(flowing, fz), _mm_andnot_ps(flowing, _mm_mul_ps(dz, inv_length)));
+            moving = _mm_or_ps(moving, flowing);
+
+            _mm_storeu_ps(&velocity_x_[i], _mm_mul_ps(hx, speed));
+            _mm_storeu_ps(&velocity_z_[i], _mm_mul_ps(hz, speed));
+            __m128 old_hx = _mm_loadu_ps(&heading_x_[i]);
+            __m128 old_hz = _mm_loadu_ps(&heading_z_[i]);
+            _mm_storeu_ps(&heading_x_[i], _mm_or_ps(_mm_and_ps(moving, hx), _mm_andnot_ps(moving, old_hx)));
+            _mm_storeu_ps(&heading_z_[i], _mm_or_ps(_mm_and_ps(moving, hz), _mm_andnot_ps(moving, old_hz)));
+            _mm_storeu_ps(&x_[i], _mm_add_ps(x, _mm_mul_ps(hx, step)));
+            _mm_storeu_ps(&z_[i], _mm_add_ps(z, _mm_mul_ps(hz, step)));
+
+            __m128 near_x = _mm_cmple_ps(_mm_and_ps(dx, abs_mask), reach);
+            __m128 near_z = _mm_cmple_ps(_mm_and_ps(dz, abs_mask), reach);
+            int touching = _mm_movemask_ps(_mm_and_ps(near_x, near_z));
+            for (int k = 0; touching; k++, touching >>= 1) {
+                if ((touching & 1) && state_[i + k] != Contact) {
+                    state_[i + k] = Contact;
+                    contacts.push_back(static_cast<uint32_t>(i + k));
+                }
+            }
+        }
+    #endif
+        for (; i < end; i++) {
+            float dx = target.x - x_[i];
+            float dz = target.z - z_[i];
+            float length2 = dx * dx + dz * dz;
+            if (flow_x_[i] != 0.0f || flow_z_[i] != 0.0f) {
+                heading_x_[i] = flow_x_[i];
+                heading_z_[i] = flow_z_[i];
+                velocity_x_[i] = heading_x_[i] * speed_;
+                velocity_z_[i] = heading_z_[i] * speed_;
+            } else if (length2 > 1e-12f) {
+                float inv_length = 1.0f / std::sqrt(length2);
+                heading_x_[i] = dx * inv_length;
+                heading_z_[i] = dz * inv_length;
+                velocity_x_[i] = heading_x_[i] * speed_;
+                velocity_z_[i] = heading_z_[i] * speed_;
+            } else {
+                velocity_x_[i] = 0.0f;
+                velocity_z_[i] = 0.0f;
+            }
+            x_[i] += velocity_x_[i] * delta_time;
+            z_[i] += velocity_z_[i] * delta_time;
+
+            if (std::fabs(dx) <= contact_distance && std::fabs(dz) <= contact_distance && state_[i] != Contact) {
+                state_[i] = Contact;
+                contacts.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        // Hover over the ground
+        grid.GetHeights(&x_[begin], &z_[begin], &y_[begin], end - begin);
+
+        // Turn about y so that the -z axis of the mesh faces the heading, as
+        // the single ghost used to with a look-at matrix; the half-angle
+        // quaternion comes from the cosine without any trigonometry
+        for (i = begin; i < end; i++) {
+            y_[i] += hover_height;
+            float sine = -heading_x_[i];
+            float cosine = -heading_z_[i];
+            float half_sine = std::copysign(std::sqrt(std::max(0.0f, 0.5f * (1.0f - cosine))), sine);
+            float half_cosine = std::sqrt(std::max(0.0f, 0.5f * (1.0f + cosine)));
+            records_[i] = InstanceRecord::Pack(glm::vec3(x_[i], y_[i], z_[i]), scale_,
+                glm::quat(half_cosine, 0.0f, half_sine, 0.0f));
+        }
+    }
+
+
+    void GhostCrowd::Update(void) {
+        // Moved by Update(target, delta_time, grid)
+    }
+
+
+    void GhostCrowd::Draw(Camera* camera) {
+
+        if (x_.empty()) {
+            return;
+        }
+
+        // Enable z-buffer
+        setupOpaqueDepth();
+        GLState::Disable(GL_BLEND);
+
+        // Select proper material: program, texture and parameters
+        material_instance_->Bind();
+        GLuint program = material_instance_->GetProgram();
+
+        // Set globals for camera
+        camera->SetupShader(program);
+
+        // Set other shader input variables
+        SetupShader(program);
+
+        // Whole crowd in one call
+        GLState::BindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, size_, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(x_.size()));
+    }
+
+
+    void GhostCrowd::setupVertexAttributes(void) {
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+
+        // Set attributes for shaders (common elements)
+        SetupVertexFormat(vertex_format_);
+
+        // One compact record per ghost
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_.GetBuffer());
+        SetupInstanceAttributes();
+
+        glBindVertexArray(0);
+    }
+
+
+    void GhostCrowd::SetupShader(GLuint program) {
+
+        // Timer
+        GLint timer_var = glGetUniformLocation(program, "timer");
+        float current_time = static_cast<float>(glfwGetTime());
+        glUniform1f(timer_var, (float)current_time);
+    }
+
+} // namespace game
@@ -0,0 +1,97 @@
+#ifndef GHOST_CROWD_H_
+#define GHOST_CROWD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "flow_field.h"
+#include "instance_buffer.h"
+#include "renderable.h"
+#include "resource.h"
+#include "world_grid.h"
+
+namespace game {
+
+    // Ghosts pursuing the player. Positions, velocities, headings and
+    // states are kept as structure of arrays and updated in SIMD batches,
+    // split over worker threads for large crowds; all ghosts are drawn
+    // with one instanced call
+    class GhostCrowd : public Renderable {
+
+        public:
+            enum State { Pursuing = 0, Contact = 1 };
+
+            // Ghosts per batch given to a worker thread
+            static const size_t batch_size = 2048;
+
+            GhostCrowd(const std::string name, const Resource* geometry, const Resource* material, const Resource* texture);
+            ~GhostCrowd();
+
+            // Add a ghost; returns its index
+            size_t Spawn(const glm::vec3& position);
+            // Put a ghost back in pursuit at a new position
+            void Respawn(size_t index, const glm::vec3& position);
+            size_t GetCount(void) const;
+            glm::vec3 GetPosition(size_t index) const;
+            // Index of the ghost nearest to a position; the crowd must not be empty
+            size_t GetNearest(const glm::vec3& position) const;
+
+            // Follow 'flow_field' where it has a direction, instead of going
+            // straight for the target; null to go straight everywhere
+            void SetFlowField(const FlowField* flow_field);
+            void SetSpeed(float speed);
+            // Uniform scale of the mesh
+            void SetScale(float scale);
+
+            // Move every ghost toward the target on the ground of 'grid'
+            // and collect those that reached it
+            void Update(const glm::vec3& target, float delta_time, const WorldGrid& grid);
+            // Ghosts that reached the target since the contacts were cleared
+            const std::vector<uint32_t>& GetContacts(void) const;
+            void ClearContacts(void);
+
+            virtual void Update(void) override;
+
+            virtual void Draw(Camera* camera) override;
+
+        private:
+            // Move, ground and orient the ghosts in [begin, end); contacts
+            // are added to 'contacts'
+            void updateRange(size_t begin, size_t end, const glm::vec3& target, float delta_time, const WorldGrid& grid, std::vector<uint32_t>& contacts);
+
+            void setupVertexAttributes(void);
+            virtual void SetupShader(GLuint program) override;
+
+            // Ghosts, one entry per ghost in each array
+            std::vector<float> x_, y_, z_;
+            std::vector<float> velocity_x_, velocity_z_;
+            std::vector<float> heading_x_, heading_z_; // Unit vector the ghost faces
+            std::vector<uint8_t> state_;
+            std::vector<InstanceRecord> records_; // Instance data, rebuilt every update
+            std::vector<float> flow_x_, flow_z_; // Directions of the flow field, zero where there is none
+
+            std::vector<uint32_t> contacts_;
+            const FlowField* flow_field_ = nullptr;
+            float speed_;
+            float scale_;
+
+            GLuint array_buffer_; // Geometry
+            GLuint element_array_buffer_;
+            VertexFormat vertex_format_;
+            GLsizei size_;
+            InstanceBuffer instance_buffer_; // Only the ghosts that moved are sent
+            GLuint VAO = 0;
+            GLuint material_;
+            GLuint texture_;
+
+    }; // class GhostCrowd
+
+} // namespace game
+
+#endif // GHOST_CROWD_H_
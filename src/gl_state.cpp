@@ -0,0 +1,341 @@
+#include "gl_state.h"
+
+namespace game {
+
+    static const GLuint unknown = ~0u;
+
+    GLuint GLState::program_ = unknown;
+    GLuint GLState::vertex_array_ = unknown;
+    GLuint GLState::buffers_[GLState::buffer_targets];
+    GLState::UniformBinding GLState::uniform_bindings_[GLState::max_uniform_bindings];
+    GLuint GLState::active_unit_ = unknown;
+    GLuint GLState::textures_[GLState::max_texture_units][GLState::texture_targets];
+    GLint GLState::capabilities_[GLState::capabilities];
+    GLint GLState::depth_mask_ = -1;
+    GLenum GLState::depth_func_ = unknown;
+    GLint GLState::color_mask_ = -1;
+    GLenum GLState::blend_func_[4];
+    GLenum GLState::blend_equation_[2];
+    size_t GLState::issued_ = 0;
+    size_t GLState::filtered_ = 0;
+    size_t GLState::last_issued_ = 0;
+    size_t GLState::last_filtered_ = 0;
+
+    // Nothing is known before the first frame either
+    static const bool shadow_reset = (GLState::Reset(), true);
+
+
+    void GLState::BeginFrame(void) {
+
+        last_issued_ = issued_;
+        last_filtered_ = filtered_;
+        issued_ = 0;
+        filtered_ = 0;
+        Reset();
+    }
+
+
+    void GLState::Reset(void) {
+
+        program_ = unknown;
+        vertex_array_ = unknown;
+        for (int i = 0; i < buffer_targets; i++) {
+            buffers_[i] = unknown;
+        }
+        for (int i = 0; i < max_uniform_bindings; i++) {
+            uniform_bindings_[i].buffer = unknown;
+        }
+        active_unit_ = unknown;
+        for (int i = 0; i < max_texture_units; i++) {
+            for (int j = 0; j < texture_targets; j++) {
+                textures_[i][j] = unknown;
+            }
+        }
+        for (int i = 0; i < capabilities; i++) {
+            capabilities_[i] = -1;
+        }
+        depth_mask_ = -1;
+        depth_func_ = unknown;
+        color_mask_ = -1;
+        for (int i = 0; i < 4; i++) {
+            blend_func_[i] = unknown;
+        }
+        blend_equation_[0] = blend_equation_[1] = unknown;
+    }
+
+
+    bool GLState::issue(bool changed) {
+
+        if (changed) {
+            issued_++;
+        }
+        else {
+            filtered_++;
+        }
+        return changed;
+    }
+
+
+    void GLState::UseProgram(GLuint program) {
+
+        if (issue(program != program_)) {
+            glUseProgram(program);
+            program_ = program;
+        }
+    }
+
+
+    void GLState::BindVertexArray(GLuint vertex_array) {
+
+        if (issue(vertex_array != vertex_array_)) {
+            glBindVertexArray(vertex_array);
+            vertex_array_ = vertex_array;
+            // The element array buffer is part of the vertex array
+            buffers_[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+        }
+    }
+
+
+    int GLState::bufferIndex(GLenum target) {
+
+        switch (target) {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        case GL_DRAW_INDIRECT_BUFFER: return 4;
+        case GL_SHADER_STORAGE_BUFFER: return 5;
+        default: return -1;
+        }
+    }
+
+
+    void GLState::BindBuffer(GLenum target, GLuint buffer) {
+
+        int index = bufferIndex(target);
+        if (index < 0) {
+            issue(true);
+            glBindBuffer(target, buffer);
+        }
+        else if (issue(buffer != buffers_[index])) {
+            glBindBuffer(target, buffer);
+            buffers_[index] = buffer;
+        }
+    }
+
+
+    void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+
+        // Binding a range also binds the buffer to the generic target
+        int generic = bufferIndex(target);
+        if (target != GL_UNIFORM_BUFFER || index >= static_cast<GLuint>(max_uniform_bindings)) {
+            issue(true);
+            glBindBufferBase(target, index, buffer);
+            if (generic >= 0) {
+                buffers_[generic] = buffer;
+            }
+        }
+        else {
+            UniformBinding& binding = uniform_bindings_[index];
+            if (issue(buffer != binding.buffer || binding.size != -1)) {
+                glBindBufferBase(target, index, buffer);
+                binding.buffer = buffer;
+                binding.offset = 0;
+                binding.size = -1;
+                buffers_[generic] = buffer;
+            }
+        }
+    }
+
+
+    void GLState::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+
+        int generic = bufferIndex(target);
+        if (target != GL_UNIFORM_BUFFER || index >= static_cast<GLuint>(max_uniform_bindings)) {
+            issue(true);
+            glBindBufferRange(target, index, buffer, offset, size);
+            if (generic >= 0) {
+                buffers_[generic] = buffer;
+            }
+        }
+        else {
+            UniformBinding& binding = uniform_bindings_[index];
+            if (issue(buffer != binding.buffer || offset != binding.offset || size != binding.size)) {
+                glBindBufferRange(target, index, buffer, offset, size);
+                binding.buffer = buffer;
+                binding.offset = offset;
+                binding.size = size;
+                buffers_[generic] = buffer;
+            }
+        }
+    }
+
+
+    int GLState::textureIndex(GLenum target) {
+
+        switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        case GL_TEXTURE_3D: return 4;
+        default: return -1;
+        }
+    }
+
+
+    void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+
+        int index = textureIndex(target);
+        bool tracked = index >= 0 && unit < static_cast<GLuint>(max_texture_units);
+        if (tracked && !issue(texture != textures_[unit][index])) {
+            return;
+        }
+        if (!tracked) {
+            issue(true);
+        }
+
+        if (issue(unit != active_unit_)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            active_unit_ = unit;
+        }
+        glBindTexture(target, texture);
+        if (tracked) {
+            textures_[unit][index] = texture;
+        }
+    }
+
+
+    int GLState::capabilityIndex(GLenum capability) {
+
+        switch (capability) {
+        case GL_DEPTH_TEST: return 0;
+        case GL_BLEND: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_RASTERIZER_DISCARD: return 3;
+        default: return -1;
+        }
+    }
+
+
+    void GLState::setCapability(GLenum capability, bool enabled) {
+
+        int index = capabilityIndex(capability);
+        if (index >= 0 && !issue(capabilities_[index] != static_cast<GLint>(enabled))) {
+            return;
+        }
+        if (index < 0) {
+            issue(true);
+        }
+        else {
+            capabilities_[index] = enabled;
+        }
+
+        if (enabled) {
+            glEnable(capability);
+        }
+        else {
+            glDisable(capability);
+        }
+    }
+
+
+    void GLState::Enable(GLenum capability) {
+
+        setCapability(capability, true);
+    }
+
+
+    void GLState::Disable(GLenum capability) {
+
+        setCapability(capability, false);
+    }
+
+
+    void GLState::DepthMask(GLboolean mask) {
+
+        GLint value = mask ? 1 : 0;
+        if (issue(value != depth_mask_)) {
+            glDepthMask(mask);
+            depth_mask_ = value;
+        }
+    }
+
+
+    void GLState::DepthFunc(GLenum func) {
+
+        if (issue(func != depth_func_)) {
+            glDepthFunc(func);
+            depth_func_ = func;
+        }
+    }
+
+
+    void GLState::ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+
+        GLint value = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) | (alpha ? 8 : 0);
+        if (issue(value != color_mask_)) {
+            glColorMask(red, green, blue, alpha);
+            color_mask_ = value;
+        }
+    }
+
+
+    void GLState::BlendFunc(GLenum source, GLenum destination) {
+
+        BlendFuncSeparate(source, destination, source, destination);
+    }
+
+
+    void GLState::BlendFuncSeparate(GLenum source_rgb, GLenum destination_rgb, GLenum source_alpha, GLenum destination_alpha) {
+
+        bool changed = source_rgb != blend_func_[0] || destination_rgb != blend_func_[1] ||
+            source_alpha != blend_func_[2] || destination_alpha != blend_func_[3];
+        if (issue(changed)) {
+            glBlendFuncSeparate(source_rgb, destination_rgb, source_alpha, destination_alpha);
+            blend_func_[0] = source_rgb;
+            blend_func_[1] = destination_rgb;
+            blend_func_[2] = source_alpha;
+            blend_func_[3] = destination_alpha;
+        }
+    }
+
+
+    void GLState::BlendFunci(GLuint buffer, GLenum source, GLenum destination) {
+
+        issue(true);
+        glBlendFunci(buffer, source, destination);
+        for (int i = 0; i < 4; i++) {
+            blend_func_[i] = unknown;
+        }
+    }
+
+
+    void GLState::BlendEquation(GLenum mode) {
+
+        BlendEquationSeparate(mode, mode);
+    }
+
+
+    void GLState::BlendEquationSeparate(GLenum mode_rgb, GLenum mode_alpha) {
+
+        if (issue(mode_rgb != blend_equation_[0] || mode_alpha != blend_equation_[1])) {
+            glBlendEquationSeparate(mode_rgb, mode_alpha);
+            blend_equation_[0] = mode_rgb;
+            blend_equation_[1] = mode_alpha;
+        }
+    }
+
+
+    size_t GLState::GetIssuedCalls(void) {
+
+        return last_issued_;
+    }
+
+
+    size_t GLState::GetFilteredCalls(void) {
+
+        return last_filtered_;
+    }
+
+} // namespace game
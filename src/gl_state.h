@@ -0,0 +1,102 @@
+#ifndef GL_STATE_H_
+#define GL_STATE_H_
+
+#include <cstddef>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    // Shadow of the GL state set by the draw paths. Each call is compared
+    // with the state last set through this class and only forwarded to GL
+    // when it changes it, so that nodes drawn one after the other with the
+    // same program, textures and depth state do not set them again.
+    // Code outside the draw paths (loading, streaming, simulation) binds
+    // objects directly; BeginFrame forgets the shadow so that the first
+    // call of each kind in a frame always reaches GL
+    class GLState {
+
+        public:
+            // Texture units and uniform buffer bindings that are tracked;
+            // calls beyond them are always forwarded
+            static const int max_texture_units = 16;
+            static const int max_uniform_bindings = 16;
+
+            // Start a frame: keep the counts of the last one and forget
+            // the shadow
+            static void BeginFrame(void);
+            // Forget the shadow, after binding objects directly in the
+            // middle of a frame
+            static void Reset(void);
+
+            static void UseProgram(GLuint program);
+            // Binding a vertex array also changes the element array buffer
+            static void BindVertexArray(GLuint vertex_array);
+            static void BindBuffer(GLenum target, GLuint buffer);
+            static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+            static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+            // Bind 'texture' to 'unit', a number from 0 rather than
+            // GL_TEXTURE0; the active unit only changes when needed
+            static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+            static void Enable(GLenum capability);
+            static void Disable(GLenum capability);
+            static void DepthMask(GLboolean mask);
+            static void DepthFunc(GLenum func);
+            static void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+            static void BlendFunc(GLenum source, GLenum destination);
+            static void BlendFuncSeparate(GLenum source_rgb, GLenum destination_rgb, GLenum source_alpha, GLenum destination_alpha);
+            // Per draw buffer; always forwarded, and the shared blend
+            // function is unknown afterwards
+            static void BlendFunci(GLuint buffer, GLenum source, GLenum destination);
+            static void BlendEquation(GLenum mode);
+            static void BlendEquationSeparate(GLenum mode_rgb, GLenum mode_alpha);
+
+            // Calls forwarded to GL and calls filtered out, in the last
+            // complete frame
+            static size_t GetIssuedCalls(void);
+            static size_t GetFilteredCalls(void);
+
+        private:
+            // Index of a tracked binding or capability, -1 if untracked
+            static int bufferIndex(GLenum target);
+            static int textureIndex(GLenum target);
+            static int capabilityIndex(GLenum capability);
+            static void setCapability(GLenum capability, bool enabled);
+            // Count a call; true if it has to reach GL
+            static bool issue(bool changed);
+
+            static const int buffer_targets = 6;
+            static const int texture_targets = 5;
+            static const int capabilities = 4;
+
+            // Buffer bound to an indexed uniform binding; a size of -1
+            // stands for the whole buffer
+            struct UniformBinding {
+                GLuint buffer;
+                GLintptr offset;
+                GLsizeiptr size;
+            };
+
+            // ~0 stands for an unknown binding or value
+            static GLuint program_;
+            static GLuint vertex_array_;
+            static GLuint buffers_[buffer_targets];
+            static UniformBinding uniform_bindings_[max_uniform_bindings];
+            static GLuint active_unit_;
+            static GLuint textures_[max_texture_units][texture_targets];
+            static GLint capabilities_[capabilities]; // -1 unknown
+            static GLint depth_mask_;
+            static GLenum depth_func_;
+            static GLint color_mask_; // One bit per channel
+            static GLenum blend_func_[4];
+            static GLenum blend_equation_[2];
+
+            static size_t issued_, filtered_;
+            static size_t last_issued_, last_filtered_;
+
+    }; // class GLState
+
+} // namespace game
+
+#endif // GL_STATE_H_
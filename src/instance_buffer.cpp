@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "instance_buffer.h"
+
+namespace game {
+
+    InstanceBuffer::InstanceBuffer(void) {
+
+        capacity_ = 0;
+        ring_ = NULL;
+        dirty_begin_ = dirty_end_ = 0;
+        glGenBuffers(1, &buffer_);
+    }
+
+
+    InstanceBuffer::~InstanceBuffer() {
+
+        delete ring_;
+        glDeleteBuffers(1, &buffer_);
+    }
+
+
+    GLuint InstanceBuffer::GetBuffer(void) const {
+
+        return buffer_;
+    }
+
+
+    size_t InstanceBuffer::GetCount(void) const {
+
+        return records_.size();
+    }
+
+
+    void InstanceBuffer::Resize(size_t count) {
+
+        size_t old_count = records_.size();
+        reserve(count);
+
+        InstanceRecord zero;
+        memset(&zero, 0, sizeof(zero));
+        records_.resize(count, zero);
+        dirty_.resize(count, 1);
+        if (count > old_count) {
+            markDirty(old_count, count);
+        }
+        dirty_end_ = std::min(dirty_end_, count);
+        if (dirty_begin_ >= dirty_end_) {
+            dirty_begin_ = dirty_end_ = 0;
+        }
+    }
+
+
+    void InstanceBuffer::Set(size_t index, const InstanceRecord& record) {
+
+        Set(index, &record, 1);
+    }
+
+
+    void InstanceBuffer::Set(size_t first, const InstanceRecord* records, size_t count) {
+
+        if (first + count > records_.size()) {
+            throw(std::invalid_argument(std::string("Invalid instance")));
+        }
+
+        // Bounds of the records that changed, widened once at the end
+        size_t begin = first + count, end = first;
+        for (size_t i = 0; i < count; i++) {
+            InstanceRecord& record = records_[first + i];
+            if (memcmp(&record, &records[i], sizeof(InstanceRecord)) != 0) {
+                record = records[i];
+                dirty_[first + i] = 1;
+                begin = std::min(begin, first + i);
+                end = first + i + 1;
+            }
+        }
+        if (begin < end) {
+            markDirty(begin, end);
+        }
+    }
+
+
+    const InstanceRecord& InstanceBuffer::Get(size_t index) const {
+
+        return records_[index];
+    }
+
+
+    size_t InstanceBuffer::Upload(void) {
+
+        if (dirty_begin_ >= dirty_end_) {
+            return 0;
+        }
+
+        // When the dirty records span half of the array or more, as when
+        // the whole crowd moves, replace the storage with the array in one
+        // call: about half the cost of staging it through the ring and
+        // copying it on the GPU, and never more than sending it all as
+        // before. The buffer then holds exactly the records, so growing
+        // reallocates
+        size_t bytes = 0;
+        if ((dirty_end_ - dirty_begin_) * 2 >= records_.size()) {
+            bytes = records_.size() * sizeof(InstanceRecord);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+            glBufferData(GL_COPY_WRITE_BUFFER, bytes, records_.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            capacity_ = records_.size();
+
+            std::fill(dirty_.begin() + dirty_begin_, dirty_.begin() + dirty_end_, 0);
+            dirty_begin_ = dirty_end_ = 0;
+            return bytes;
+        }
+
+        // One copy per run of dirty records; short clean gaps are sent
+        // along rather than paying for another copy
+        runs_.clear();
+        size_t index = dirty_begin_;
+        while (index < dirty_end_ && runs_.size() <= max_copies) {
+            if (!dirty_[index]) {
+                index++;
+                continue;
+            }
+            size_t begin = index;
+            size_t end = index + 1;
+            size_t next = end;
+            while (next < dirty_end_ && next - end < merge_gap) {
+                if (dirty_[next]) {
+                    end = next + 1;
+                }
+                next++;
+            }
+            runs_.push_back(std::make_pair(begin, end));
+            index = end;
+        }
+        // Scattered changes are cheaper as one copy of the whole span
+        if (runs_.size() > max_copies) {
+            runs_.assign(1, std::make_pair(dirty_begin_, dirty_end_));
+        }
+
+        // The ring holds a whole buffer per region, so every write fits
+        ring_->Begin();
+        for (size_t i = 0; i < runs_.size(); i++) {
+            size_t begin = runs_[i].first;
+            size_t count = runs_[i].second - begin;
+            ring_->Write(buffer_, begin * sizeof(InstanceRecord), &records_[begin], count * sizeof(InstanceRecord));
+            bytes += count * sizeof(InstanceRecord);
+        }
+        ring_->End();
+
+        std::fill(dirty_.begin() + dirty_begin_, dirty_.begin() + dirty_end_, 0);
+        dirty_begin_ = dirty_end_ = 0;
+        return bytes;
+    }
+
+
+    void InstanceBuffer::reserve(size_t count) {
+
+        if (count <= capacity_ && ring_) {
+            return;
+        }
+
+        // Double, so that adding one instance at a time does not
+        // reallocate every time
+        size_t capacity = std::max(std::max(count, capacity_ * 2), size_t(64));
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(InstanceRecord), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        // The new storage is empty, so every record is sent again, through
+        // regions sized for the new capacity
+        if (!records_.empty()) {
+            std::fill(dirty_.begin(), dirty_.end(), 1);
+            markDirty(0, records_.size());
+        }
+        delete ring_;
+        ring_ = new UploadRing(capacity * sizeof(InstanceRecord));
+        capacity_ = capacity;
+    }
+
+
+    void InstanceBuffer::markDirty(size_t begin, size_t end) {
+
+        if (dirty_begin_ >= dirty_end_) {
+            dirty_begin_ = begin;
+            dirty_end_ = end;
+        }
+        else {
+            dirty_begin_ = std::min(dirty_begin_, begin);
+            dirty_end_ = std::max(dirty_end_, end);
+        }
+    }
+
+} // namespace game
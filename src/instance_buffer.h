@@ -0,0 +1,66 @@
+#ifndef INSTANCE_BUFFER_H_
+#define INSTANCE_BUFFER_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "upload_ring.h"
+#include "vertex_format.h"
+
+namespace game {
+
+    // Instance records drawn from a GL buffer, with a copy kept on the
+    // CPU. Setting a record that differs from the copy marks it dirty;
+    // Upload sends the dirty runs through an upload ring, so records that
+    // did not change are never sent again. When the changes span half of
+    // the array or more, it is sent whole instead. The buffer grows by doubling
+    class InstanceBuffer {
+
+        public:
+            InstanceBuffer(void);
+            ~InstanceBuffer();
+
+            // Buffer to point the instance attributes at; its name does
+            // not change when it grows
+            GLuint GetBuffer(void) const;
+            size_t GetCount(void) const;
+
+            // Keep the first 'count' records; new records are zero and dirty
+            void Resize(size_t count);
+            void Set(size_t index, const InstanceRecord& record);
+            // Set the 'count' records from 'first' to 'records'
+            void Set(size_t first, const InstanceRecord* records, size_t count);
+            const InstanceRecord& Get(size_t index) const;
+
+            // Copy the dirty runs to the buffer, or the whole array when they
+            // span half of it or more. Returns the number of bytes uploaded
+            size_t Upload(void);
+
+        private:
+            // Make room in the buffer for 'count' records
+            void reserve(size_t count);
+            // Widen the dirty bounds to the records [begin, end)
+            void markDirty(size_t begin, size_t end);
+
+            GLuint buffer_;
+            size_t capacity_; // Records the buffer has room for
+            UploadRing* ring_; // Holds a whole buffer per region
+
+            std::vector<InstanceRecord> records_;
+            std::vector<unsigned char> dirty_; // Records changed since the last upload
+            size_t dirty_begin_, dirty_end_; // Bounds of the dirty records
+            std::vector<std::pair<size_t, size_t> > runs_; // Records [first, second) to upload
+
+            // Dirty runs closer than this many records are uploaded as one
+            static const size_t merge_gap = 8;
+            // More runs than this are uploaded as a single span
+            static const size_t max_copies = 32;
+
+    }; // class InstanceBuffer
+
+} // namespace game
+
+#endif // INSTANCE_BUFFER_H_
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <stdexcept>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "instanced_family.h"
+#include "gl_state.h"
+#include "material_instance.h"
+
+namespace game {
+
+    InstancedFamily::InstancedFamily(const std::string name, const std::vector<InstancedFamilyMember>& members, const Resource* material, const Resource* texture_array)
+        : Renderable(name) {
+
+        if (members.empty()) {
+            throw(std::invalid_argument(std::string("Instanced family needs at least one member")));
+        }
+
+        // Set material (shader program) and texture
+        if (material->GetType() != Material) {
+            throw(std::invalid_argument(std::string("Invalid type of material")));
+        }
+        if (texture_array->GetType() != TextureArray) {
+            throw(std::invalid_argument(std::string("Invalid type of texture array")));
+        }
+        material_ = material->GetResource();
+        texture_ = texture_array->GetResource();
+        material_instance_ = MaterialInstance::GetShared(material, texture_array);
+        blending_ = false;
+        layer_ = FamilyLayer;
+
+        // The family is drawn in the compact format only if all its
+        // members are compact; otherwise the compact ones are widened
+        vertex_format_ = CompactFormat;
+        for (size_t i = 0; i < members.size(); i++) {
+            if (members[i].geometry->GetType() != Mesh) {
+                throw(std::invalid_argument(std::string("Invalid type of geometry")));
+            }
+            if (members[i].geometry->GetVertexFormat() != CompactFormat) {
+                vertex_format_ = StandardFormat;
+            }
+        }
+
+        // Measure the members and lay out their draws
+        GLsizeiptr vertex_size = GetVertexSize(vertex_format_);
+        std::vector<GLsizeiptr> vertex_bytes(members.size());
+        GLsizeiptr total_vertex_bytes = 0;
+        GLsizeiptr total_indices = 0;
+
+        for (size_t i = 0; i < members.size(); i++) {
+            const Resource* geometry = members[i].geometry;
+
+            GLint buffer_size;
+            glBindBuffer(GL_ARRAY_BUFFER, geometry->GetArrayBuffer());
+            glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &buffer_size);
+            vertex_bytes[i] = buffer_size / GetVertexSize(geometry->GetVertexFormat()) * vertex_size;
+
+            DrawCommand command;
+            command.count = geometry->GetSize();
+            command.instance_count = 0;
+            command.first_index = static_cast<GLuint>(total_indices);
+            command.base_vertex = static_cast<GLint>(total_vertex_bytes / vertex_size);
+            command.base_instance = 0;
+            commands_.push_back(command);
+
+            total_vertex_bytes += vertex_bytes[i];
+            total_indices += command.count;
+        }
+
+        // Merge the geometry of all members on the GPU; indices stay local
+        // to their mesh and are offset by the base vertex of each draw
+        glGenBuffers(1, &array_buffer_);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, array_buffer_);
+        glBufferData(GL_COPY_WRITE_BUFFER, total_vertex_bytes, NULL, GL_STATIC_DRAW);
+        GLintptr offset = 0;
+        for (size_t i = 0; i < members.size(); i++) {
+            const Resource* geometry = members[i].geometry;
+            if (geometry->GetVertexFormat() == vertex_format_) {
+                glBindBuffer(GL_COPY_READ_BUFFER, geometry->GetArrayBuffer());
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, vertex_bytes[i]);
+            }
+            else {
+                std::vector<GLubyte> vertices = ReadVertices(geometry->GetArrayBuffer(), geometry->GetVertexFormat(), vertex_format_);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, array_buffer_);
+                glBufferSubData(GL_COPY_WRITE_BUFFER, offset, vertex_bytes[i], vertices.data());
+            }
+            offset += vertex_bytes[i];
+        }
+
+        glGenBuffers(1, &element_array_buffer_);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, element_array_buffer_);
+        glBufferData(GL_COPY_WRITE_BUFFER, total_indices * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+        for (size_t i = 0; i < members.size(); i++) {
+            glBindBuffer(GL_COPY_READ_BUFFER, members[i].geometry->GetElementArrayBuffer());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, commands_[i].first_index * sizeof(GLuint), commands_[i].count * sizeof(GLuint));
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        member_capacities_.assign(members.size(), 0);
+        if (GLEW_ARB_multi_draw_indirect) {
+            glGenBuffers(1, &indirect_buffer_);
+        }
+        uploadInstances(members);
+
+        glGenVertexArrays(1, &VAO);
+        glGenVertexArrays(1, &depth_VAO);
+        setupVertexAttributes();
+    }
+
+
+    InstancedFamily::~InstancedFamily() {
+
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteVertexArrays(1, &depth_VAO);
+        glDeleteBuffers(1, &array_buffer_);
+        glDeleteBuffers(1, &element_array_buffer_);
+        if (indirect_buffer_) {
+            glDeleteBuffers(1, &indirect_buffer_);
+        }
+    }
+
+
+    size_t InstancedFamily::SetInstances(const std::vector<InstancedFamilyMember>& members) {
+
+        if (members.size() != commands_.size()) {
+            throw(std::invalid_argument(std::string("Instanced family members cannot change")));
+        }
+        return uploadInstances(members);
+    }
+
+
+    void InstancedFamily::Update(void) {
+        // do nothing
+    }
+
+
+    void InstancedFamily::Draw(Camera* camera) {
+
+        // Enable z-buffer, or match the depth of the pre-pass
+        setupOpaqueDepth();
+        GLState::Disable(GL_BLEND);
+
+        // Select proper material: program, texture array and parameters
+        material_instance_->Bind();
+        GLuint program = material_instance_->GetProgram();
+
+        // Set globals for camera
+        camera->SetupShader(program);
+
+        // Set other shader input variables
+        SetupShader(program);
+
+        GLState::BindVertexArray(VAO);
+        drawMembers();
+    }
+
+
+    bool InstancedFamily::DrawDepth(Camera* camera, GLuint program) {
+
+        GLState::UseProgram(program);
+        camera->SetupShader(program);
+
+        // The texture array, for the alpha test
+        GLint tex = glGetUniformLocation(program, "texture_map");
+        glUniform1i(tex, 0);
+        GLState::BindTexture(0, GL_TEXTURE_2D_ARRAY, texture_);
+
+        GLState::BindVertexArray(depth_VAO);
+        drawMembers();
+        return true;
+    }
+
+
+    void InstancedFamily::drawMembers(void) {
+
+        if (indirect_buffer_) {
+            // Whole family in one call
+            GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(commands_.size()), 0);
+        }
+        else {
+            // Without base instances, point the instance attributes at
+            // each member in turn
+            for (size_t i = 0; i < commands_.size(); i++) {
+                const DrawCommand& command = commands_[i];
+                setupInstanceAttributes(command.base_instance);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                    (void*)(command.first_index * sizeof(GLuint)), command.instance_count, command.base_vertex);
+            }
+            setupInstanceAttributes(0);
+        }
+    }
+
+
+    size_t InstancedFamily::uploadInstances(const std::vector<InstancedFamilyMember>& members) {
+
+        // Lay out the ranges of the members, in member order
+        size_t total = 0;
+        for (size_t i = 0; i < members.size(); i++) {
+            const InstancedFamilyMember& member = members[i];
+            if (member.scales.size() != member.positions.size() || member.orientations.size() != member.positions.size()) {
+                throw(std::invalid_argument(std::string("Instance attributes of a family member differ in size")));
+            }
+            size_t count = member.positions.size();
+            if (count > member_capacities_[i]) {
+                member_capacities_[i] = std::max(std::max(count, member_capacities_[i] * 2), size_t(64));
+            }
+            commands_[i].instance_count = static_cast<GLuint>(count);
+            commands_[i].base_instance = static_cast<GLuint>(total);
+            total += member_capacities_[i];
+        }
+
+        // Records past the count of a member are left as they are; they
+        // are not drawn
+        instance_buffer_.Resize(total);
+        for (size_t i = 0; i < members.size(); i++) {
+            const InstancedFamilyMember& member = members[i];
+            for (size_t j = 0; j < member.positions.size(); j++) {
+                instance_buffer_.Set(commands_[i].base_instance + j,
+                    InstanceRecord::Pack(member.positions[j], member.scales[j], member.orientations[j], member.layer));
+            }
+        }
+        size_t bytes = instance_buffer_.Upload();
+
+        // The draws themselves, read by the GPU
+        if (indirect_buffer_) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawCommand), commands_.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+
+        return bytes + commands_.size() * sizeof(DrawCommand);
+    }
+
+
+    void InstancedFamily::setupVertexAttributes(void) {
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+
+        // Set attributes for shaders (common elements)
+        SetupVertexFormat(vertex_format_);
+        setupInstanceAttributes(0);
+
+        // The depth pass reads only what the alpha test needs
+        glBindVertexArray(depth_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+        std::vector<GLuint> depth_attributes;
+        depth_attributes.push_back(VertexLocation);
+        depth_attributes.push_back(UVLocation);
+        SetupVertexFormat(vertex_format_, depth_attributes);
+        setupInstanceAttributes(0);
+
+        glBindVertexArray(0);
+    }
+
+
+    void InstancedFamily::setupInstanceAttributes(GLuint first_instance) {
+
+        GLState::BindBuffer(GL_ARRAY_BUFFER, instance_buffer_.GetBuffer());
+        SetupInstanceAttributes(first_instance);
+    }
+
+
+    void InstancedFamily::SetupShader(GLuint program) {
+
+        // Timer
+        GLint timer_var = glGetUniformLocation(program, "timer");
+        float current_time = static_cast<float>(glfwGetTime());
+        glUniform1f(timer_var, (float)current_time);
+    }
+
+} // namespace game
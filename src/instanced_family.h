@@ -0,0 +1,94 @@
+#ifndef INSTANCED_FAMILY_H_
+#define INSTANCED_FAMILY_H_
+
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+#include "instance_buffer.h"
+#include "renderable.h"
+#include "resource.h"
+
+namespace game {
+
+    // One member of an instanced family: a mesh, the layer of its texture
+    // in the family's texture array, and the placement of its instances
+    struct InstancedFamilyMember {
+        const Resource* geometry;
+        int layer;
+        std::vector<glm::vec3> positions;
+        std::vector<float> scales; // Uniform
+        std::vector<glm::quat> orientations;
+    };
+
+    // Instanced objects that share a material and a texture array and only
+    // differ in mesh and texture layer. The meshes are merged into one
+    // buffer, so the whole family is drawn with one multi-draw call and a
+    // single texture bind. A family that mixes vertex formats is drawn in
+    // the standard one, its compact meshes widened as they are merged
+    class InstancedFamily : public Renderable {
+
+    public:
+        InstancedFamily(const std::string name, const std::vector<InstancedFamilyMember>& members, const Resource* material, const Resource* texture_array);
+        ~InstancedFamily();
+
+        // Replace the instances of all members. The members must have the
+        // same meshes as those the family was created with. Only the
+        // instances that changed are uploaded; returns the number of bytes
+        // uploaded
+        size_t SetInstances(const std::vector<InstancedFamilyMember>& members);
+
+        virtual void Update(void) override;
+
+        virtual void Draw(Camera* camera) override;
+
+        // Depth of the whole family, with the alpha test of the material
+        virtual bool DrawDepth(Camera* camera, GLuint program) override;
+
+    private:
+        // Draw of one member, laid out as glMultiDrawElementsIndirect expects
+        struct DrawCommand {
+            GLuint count;
+            GLuint instance_count;
+            GLuint first_index;
+            GLint base_vertex;
+            GLuint base_instance;
+        };
+
+        // Upload the instances of the members and their draws
+        size_t uploadInstances(const std::vector<InstancedFamilyMember>& members);
+        void setupVertexAttributes(void);
+        // Point the instance attributes of the bound vertex array at the
+        // given instance; past 0, only needed when drawing members one by one
+        void setupInstanceAttributes(GLuint first_instance);
+        // Issue the draws of the members with the bound vertex array
+        void drawMembers(void);
+
+        virtual void SetupShader(GLuint program) override;
+
+        GLuint array_buffer_ = 0; // Merged geometry of all members
+        GLuint element_array_buffer_ = 0;
+        InstanceBuffer instance_buffer_;
+        // Instances each member has room for in the instance buffer; the
+        // ranges grow by doubling, so that a member whose instance count
+        // changes does not move the instances of the following members
+        std::vector<size_t> member_capacities_;
+        GLuint indirect_buffer_ = 0;
+        GLuint VAO = 0;
+        GLuint depth_VAO = 0; // Positions and texture coordinates only
+        VertexFormat vertex_format_;
+        GLuint material_; // Reference to shader program
+        GLuint texture_; // Reference to texture array
+
+        std::vector<DrawCommand> commands_;
+
+    }; // class InstancedFamily
+
+} // namespace game
+
+#endif // INSTANCED_FAMILY_H_
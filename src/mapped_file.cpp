@@ -0,0 +1,181 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <filesystem>
+#include <fstream>
+#include <ios>
+
+#include "mapped_file.h"
+
+namespace game {
+
+MappedFile::MappedFile(void){
+
+    data_ = NULL;
+    size_ = 0;
+#ifdef _WIN32
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = NULL;
+#endif
+}
+
+
+MappedFile::~MappedFile(){
+
+    Unmap();
+}
+
+
+bool MappedFile::Map(const std::string& filename){
+
+    Unmap();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0){
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL){
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL){
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const unsigned char*>(data);
+    size_ = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0){
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED){
+        return false;
+    }
+    data_ = static_cast<const unsigned char*>(data);
+    size_ = static_cast<size_t>(info.st_size);
+#endif
+
+    return true;
+}
+
+
+void MappedFile::Unmap(void){
+
+    if (!data_){
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = NULL;
+#else
+    munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+
+    data_ = NULL;
+    size_ = 0;
+}
+
+
+bool MappedFile::IsMapped(void) const {
+
+    return data_ != NULL;
+}
+
+
+const unsigned char* MappedFile::GetData(void) const {
+
+    return data_;
+}
+
+
+size_t MappedFile::GetSize(void) const {
+
+    return size_;
+}
+
+
+uint64_t HashFiles(const std::vector<std::string>& filenames, uint32_t salt){
+
+    const uint64_t fnv_offset = 14695981039346656037ull;
+    const uint64_t fnv_prime = 1099511628211ull;
+
+    uint64_t hash = fnv_offset;
+    for (int k = 0; k < 4; k++){
+        hash = (hash ^ ((salt >> (k * 8)) & 0xff)) * fnv_prime;
+    }
+
+    for (size_t i = 0; i < filenames.size(); i++){
+        MappedFile file;
+        if (!file.Map(filenames[i])){
+            throw(std::ios_base::failure(std::string("Error opening file ") + filenames[i]));
+        }
+        const unsigned char* data = file.GetData();
+        for (size_t j = 0; j < file.GetSize(); j++){
+            hash = (hash ^ data[j]) * fnv_prime;
+        }
+        // Separate the files, so that moving bytes between them changes the hash
+        hash = (hash ^ 0xff) * fnv_prime;
+    }
+
+    return hash;
+}
+
+
+bool WriteCacheFile(const std::string& directory, const std::string& filename, const std::vector<unsigned char>& data){
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::string temp_path = filename + ".tmp";
+    std::ofstream f(temp_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!f){
+        return false;
+    }
+    f.write(reinterpret_cast<const char*>(data.data()), data.size());
+    f.close();
+    if (!f){
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, filename, error);
+    if (error){
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+} // namespace game
@@ -0,0 +1,54 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace game {
+
+    // Read-only memory mapping of a whole file. The contents are paged in
+    // by the OS on access, so data can be handed to OpenGL without first
+    // copying it into a buffer of our own
+    class MappedFile {
+
+        public:
+            MappedFile(void);
+            ~MappedFile();
+
+            // Map a file; returns false if it does not exist or is empty
+            bool Map(const std::string& filename);
+            // Release the mapping; also done by the destructor
+            void Unmap(void);
+
+            bool IsMapped(void) const;
+            const unsigned char* GetData(void) const;
+            size_t GetSize(void) const;
+
+        private:
+            // Mappings cannot be shared between owners
+            MappedFile(const MappedFile&);
+            MappedFile& operator=(const MappedFile&);
+
+            const unsigned char* data_;
+            size_t size_;
+#ifdef _WIN32
+            void* file_; // Handles of the file and of its mapping
+            void* mapping_;
+#endif
+
+    }; // class MappedFile
+
+    // Helpers shared by the resource caches
+    // Hash the contents of a list of files (FNV-1a, 64 bits), mixing in a
+    // salt such as a cache version. Throws if a file cannot be read
+    uint64_t HashFiles(const std::vector<std::string>& filenames, uint32_t salt);
+    // Write a cache entry through a temporary file, so that an interrupted
+    // write never leaves a truncated entry behind. Creates the directory
+    // if needed. Returns false on failure
+    bool WriteCacheFile(const std::string& directory, const std::string& filename, const std::vector<unsigned char>& data);
+
+} // namespace game
+
+#endif // MAPPED_FILE_H_
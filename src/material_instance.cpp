@@ -0,0 +1,135 @@
+#include <stdexcept>
+
+#include "material_instance.h"
+#include "gl_state.h"
+
+namespace game {
+
+    unsigned int MaterialInstance::next_id_ = 1;
+    std::map<std::pair<GLuint, GLuint>, MaterialInstance*> MaterialInstance::shared_;
+
+
+    MaterialInstance::MaterialInstance(const std::string name, const Resource* program, const Resource* texture, const MaterialParameters& parameters) {
+
+        if (program->GetType() != Material) {
+            throw(std::invalid_argument(std::string("Invalid type of material")));
+        }
+
+        name_ = name;
+        id_ = next_id_++;
+        program_ = program->GetResource();
+        parameters_ = parameters;
+
+        // Texture
+        texture_ = 0;
+        texture_target_ = GL_TEXTURE_2D;
+        if (texture) {
+            texture_ = texture->GetResource();
+            if (texture->GetType() == TextureArray) {
+                texture_target_ = GL_TEXTURE_2D_ARRAY;
+            }
+            else if (texture->GetType() == SkyboxTexture) {
+                texture_target_ = GL_TEXTURE_CUBE_MAP;
+            }
+            else if (texture->GetType() != Texture) {
+                throw(std::invalid_argument(std::string("Invalid type of texture")));
+            }
+        }
+
+        // Parameter block
+        glGenBuffers(1, &buffer_);
+        GLState::BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialParameters), &parameters_, GL_STATIC_DRAW);
+
+        // Point the program at the block and the texture unit; programs
+        // shared by several materials get the same settings again
+        GLuint block = glGetUniformBlockIndex(program_, "MaterialBlock");
+        if (block != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program_, block, block_binding);
+        }
+        GLint tex = glGetUniformLocation(program_, "texture_map");
+        if (tex >= 0) {
+            GLState::UseProgram(program_);
+            glUniform1i(tex, 0);
+        }
+    }
+
+
+    MaterialInstance::~MaterialInstance() {
+
+        glDeleteBuffers(1, &buffer_);
+    }
+
+
+    MaterialParameters MaterialInstance::GetDefaultParameters(void) {
+
+        MaterialParameters parameters;
+        parameters.object_color = glm::vec4(0.0f, 0.7f, 0.9f, 1.0f);
+        parameters.light_color = glm::vec4(1.0f, 1.0f, 0.4f, 1.0f);
+        parameters.ambient_light_color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+        parameters.specular_power = 41.0f;
+        parameters.padding[0] = parameters.padding[1] = parameters.padding[2] = 0.0f;
+        return parameters;
+    }
+
+
+    MaterialInstance* MaterialInstance::GetShared(const Resource* program, const Resource* texture) {
+
+        std::pair<GLuint, GLuint> key(program->GetResource(), texture ? texture->GetResource() : 0);
+        MaterialInstance*& material = shared_[key];
+        if (!material) {
+            std::string name = program->GetName() + (texture ? "/" + texture->GetName() : std::string());
+            material = new MaterialInstance(name, program, texture, GetDefaultParameters());
+        }
+        return material;
+    }
+
+
+    const std::string MaterialInstance::GetName(void) const {
+
+        return name_;
+    }
+
+
+    GLuint MaterialInstance::GetProgram(void) const {
+
+        return program_;
+    }
+
+
+    GLuint MaterialInstance::GetTexture(void) const {
+
+        return texture_;
+    }
+
+
+    unsigned int MaterialInstance::GetId(void) const {
+
+        return id_;
+    }
+
+
+    const MaterialParameters& MaterialInstance::GetParameters(void) const {
+
+        return parameters_;
+    }
+
+
+    void MaterialInstance::SetParameters(const MaterialParameters& parameters) {
+
+        parameters_ = parameters;
+        GLState::BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MaterialParameters), &parameters_);
+    }
+
+
+    void MaterialInstance::Bind(void) const {
+
+        GLState::UseProgram(program_);
+        if (texture_) {
+            GLState::BindTexture(0, texture_target_, texture_);
+        }
+        GLState::BindBufferRange(GL_UNIFORM_BUFFER, block_binding, buffer_, 0, sizeof(MaterialParameters));
+    }
+
+} // namespace game
@@ -0,0 +1,83 @@
+#ifndef MATERIAL_INSTANCE_H_
+#define MATERIAL_INSTANCE_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "resource.h"
+
+namespace game {
+
+    // Parameters of a material, as laid out in the MaterialBlock uniform
+    // block of the shaders (std140)
+    struct MaterialParameters {
+        glm::vec4 object_color;
+        glm::vec4 light_color;
+        glm::vec4 ambient_light_color;
+        float specular_power;
+        float padding[3];
+    };
+    static_assert(sizeof(MaterialParameters) == 64, "MaterialParameters must match the std140 layout");
+
+    // A shader program with its texture and the values of its parameters.
+    // The parameters live in a uniform buffer written when they change,
+    // not on every draw, so binding a material is a program, a texture and
+    // one glBindBufferRange, and all three are skipped by the state cache
+    // when the node drawn before used the same material. Nodes made from
+    // the same program and texture share one material
+    class MaterialInstance {
+
+        public:
+            // Uniform buffer binding of the parameter block; the particle
+            // emitters use binding 0
+            static const GLuint block_binding = 1;
+
+            // 'texture' may be NULL
+            MaterialInstance(const std::string name, const Resource* program, const Resource* texture, const MaterialParameters& parameters);
+            ~MaterialInstance();
+
+            // Parameters the nodes have always been drawn with
+            static MaterialParameters GetDefaultParameters(void);
+
+            // Material shared by all the nodes that use this program and
+            // texture with the default parameters. Created on first use,
+            // with the GL context current
+            static MaterialInstance* GetShared(const Resource* program, const Resource* texture);
+
+            const std::string GetName(void) const;
+            GLuint GetProgram(void) const;
+            GLuint GetTexture(void) const;
+            // Unique per material; the render queue sorts by it
+            unsigned int GetId(void) const;
+
+            const MaterialParameters& GetParameters(void) const;
+            // Upload new parameter values
+            void SetParameters(const MaterialParameters& parameters);
+
+            // Use the program and bind the texture to unit 0 and the
+            // parameters to block_binding
+            void Bind(void) const;
+
+        private:
+            std::string name_;
+            unsigned int id_;
+            GLuint program_;
+            GLuint texture_;
+            GLenum texture_target_;
+            MaterialParameters parameters_;
+            GLuint buffer_;
+
+            static unsigned int next_id_;
+            // Shared materials, by program and texture; kept for the life
+            // of the program, like the resources they are made from
+            static std::map<std::pair<GLuint, GLuint>, MaterialInstance*> shared_;
+
+    }; // class MaterialInstance
+
+} // namespace game
+
+#endif // MATERIAL_INSTANCE_H_
@@ -0,0 +1,129 @@
+#include "mesh_builder.h"
+
+namespace game {
+
+MeshBuilder::MeshBuilder(void){
+
+    format_ = StandardFormat;
+}
+
+
+void MeshBuilder::Reserve(size_t vertex_num, size_t face_num){
+
+    vertex_.reserve(vertex_num * vertex_att);
+    index_.reserve(face_num * face_att);
+}
+
+
+GLuint MeshBuilder::AddVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& color, const glm::vec2& uv){
+
+    GLuint index = static_cast<GLuint>(vertex_.size() / vertex_att);
+
+    vertex_.insert(vertex_.end(), {
+        position[0], position[1], position[2],
+        normal[0], normal[1], normal[2],
+        color[0], color[1], color[2],
+        uv[0], uv[1] });
+
+    return index;
+}
+
+
+void MeshBuilder::AddTriangle(GLuint a, GLuint b, GLuint c){
+
+    index_.push_back(a);
+    index_.push_back(b);
+    index_.push_back(c);
+}
+
+
+void MeshBuilder::Clear(void){
+
+    vertex_.clear();
+    index_.clear();
+}
+
+
+void MeshBuilder::Swap(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices){
+
+    vertex_.swap(vertices);
+    index_.swap(indices);
+}
+
+
+GLsizei MeshBuilder::GetVertexCount(void) const {
+
+    return static_cast<GLsizei>(vertex_.size() / vertex_att);
+}
+
+
+GLsizei MeshBuilder::GetIndexCount(void) const {
+
+    return static_cast<GLsizei>(index_.size());
+}
+
+
+const std::vector<GLfloat>& MeshBuilder::GetVertices(void) const {
+
+    return vertex_;
+}
+
+
+const std::vector<GLuint>& MeshBuilder::GetIndices(void) const {
+
+    return index_;
+}
+
+
+void MeshBuilder::SetVertexFormat(VertexFormat format){
+
+    format_ = format;
+}
+
+
+VertexFormat MeshBuilder::GetVertexFormat(void) const {
+
+    return format_;
+}
+
+
+std::vector<unsigned char> MeshBuilder::GetPackedVertices(void) const {
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(vertex_.data());
+    if (format_ == CompactFormat){
+        std::vector<CompactVertex> packed = PackVertices<CompactVertex>(vertex_, vertex_att);
+        data = reinterpret_cast<const unsigned char*>(packed.data());
+        return std::vector<unsigned char>(data, data + packed.size() * sizeof(CompactVertex));
+    }
+    return std::vector<unsigned char>(data, data + vertex_.size() * sizeof(GLfloat));
+}
+
+
+GLuint MeshBuilder::UploadVertices(GLenum usage) const {
+
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (format_ == StandardFormat){
+        // Staged data is already in the standard layout
+        glBufferData(GL_ARRAY_BUFFER, vertex_.size() * sizeof(GLfloat), vertex_.empty() ? NULL : vertex_.data(), usage);
+    } else {
+        std::vector<unsigned char> packed = GetPackedVertices();
+        glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.empty() ? NULL : packed.data(), usage);
+    }
+
+    return vbo;
+}
+
+
+GLuint MeshBuilder::UploadIndices(GLenum usage) const {
+
+    GLuint ebo;
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_.size() * sizeof(GLuint), index_.empty() ? NULL : index_.data(), usage);
+
+    return ebo;
+}
+
+} // namespace game
@@ -0,0 +1,65 @@
+#ifndef MESH_BUILDER_H_
+#define MESH_BUILDER_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "vertex_format.h"
+
+namespace game {
+
+    // Assembles the interleaved vertex data and the index data of a mesh in
+    // CPU memory, so that each OpenGL buffer is filled with a single upload
+    class MeshBuilder {
+
+        public:
+            // Number of attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
+            static const int vertex_att = 11;
+            // Vertex indices per triangle (3)
+            static const int face_att = 3;
+
+            MeshBuilder(void);
+
+            // Reserve staging memory for a known number of vertices and triangles
+            void Reserve(size_t vertex_num, size_t face_num);
+
+            // Append a vertex and return its index
+            GLuint AddVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& color, const glm::vec2& uv);
+            // Append a triangle made of three vertex indices
+            void AddTriangle(GLuint a, GLuint b, GLuint c);
+
+            // Remove all staged data, keeping the allocated memory
+            void Clear(void);
+            // Exchange the staged data with the given arrays, e.g., to
+            // process it in place and hand it back
+            void Swap(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+
+            GLsizei GetVertexCount(void) const;
+            GLsizei GetIndexCount(void) const;
+            const std::vector<GLfloat>& GetVertices(void) const;
+            const std::vector<GLuint>& GetIndices(void) const;
+
+            // Layout in which the vertices are uploaded
+            void SetVertexFormat(VertexFormat format);
+            VertexFormat GetVertexFormat(void) const;
+
+            // Vertices converted to the upload format, as raw bytes
+            std::vector<unsigned char> GetPackedVertices(void) const;
+
+            // Create an OpenGL buffer holding the staged vertices/indices
+            GLuint UploadVertices(GLenum usage = GL_STATIC_DRAW) const;
+            GLuint UploadIndices(GLenum usage = GL_STATIC_DRAW) const;
+
+        private:
+            std::vector<GLfloat> vertex_;
+            std::vector<GLuint> index_;
+            VertexFormat format_;
+
+    }; // class MeshBuilder
+
+} // namespace game
+
+#endif // MESH_BUILDER_H_
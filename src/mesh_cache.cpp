@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstring>
+
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "path_config.h"
+
+namespace game {
+
+namespace {
+
+    const char mesh_magic[4] = { 'W', 'M', 'S', 'H' };
+
+    uint64_t AlignOffset(uint64_t offset){
+
+        return (offset + MeshCache::blob_alignment - 1) / MeshCache::blob_alignment * MeshCache::blob_alignment;
+    }
+
+} // namespace
+
+
+uint64_t MeshCache::HashFiles(const std::vector<std::string>& filenames){
+
+    // Mix in the cache version, so that entries of older versions are missed
+    return game::HashFiles(filenames, version);
+}
+
+
+std::string MeshCache::GetCachePath(uint64_t source_hash){
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.wmesh", static_cast<unsigned long long>(source_hash));
+
+    return std::string(MESH_CACHE_DIRECTORY) + "/" + name;
+}
+
+
+bool MeshCache::Load(const std::string& cache_path, uint64_t source_hash, GLuint& array_buffer, GLuint& element_array_buffer, GLsizei& size, VertexFormat& format, MeshStats& stats){
+
+    MappedFile file;
+    if (!file.Map(cache_path) || file.GetSize() < sizeof(MeshFileHeader)){
+        return false;
+    }
+
+    // Validate the header and the blob ranges before touching the data
+    MeshFileHeader header;
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (memcmp(header.magic, mesh_magic, sizeof(mesh_magic)) != 0 ||
+        header.version != version || header.source_hash != source_hash){
+        return false;
+    }
+    if (header.vertex_format > CompactFormat ||
+        header.vertex_size != GetVertexSize(static_cast<VertexFormat>(header.vertex_format)) ||
+        header.lod_count == 0){
+        return false;
+    }
+    uint64_t vertex_bytes = static_cast<uint64_t>(header.vertex_count) * header.vertex_size;
+    uint64_t index_bytes = static_cast<uint64_t>(header.index_count) * sizeof(GLuint);
+    if (header.lod_offset + static_cast<uint64_t>(header.lod_count) * sizeof(MeshFileLod) > file.GetSize() ||
+        header.vertex_offset + vertex_bytes > file.GetSize() ||
+        header.index_offset + index_bytes > file.GetSize()){
+        return false;
+    }
+
+    // Draw the most detailed level
+    MeshFileLod lod;
+    memcpy(&lod, file.GetData() + header.lod_offset, sizeof(lod));
+    if (static_cast<uint64_t>(lod.first_index) + lod.index_count > header.index_count){
+        return false;
+    }
+
+    // Upload straight from the mapping
+    glGenBuffers(1, &array_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, array_buffer);
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes, file.GetData() + header.vertex_offset, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &element_array_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, lod.index_count * sizeof(GLuint), file.GetData() + header.index_offset + lod.first_index * sizeof(GLuint), GL_STATIC_DRAW);
+
+    size = lod.index_count;
+    format = static_cast<VertexFormat>(header.vertex_format);
+    stats = header.stats;
+
+    return true;
+}
+
+
+void MeshCache::Store(const std::string& cache_path, uint64_t source_hash, const MeshBuilder& builder, const MeshStats& stats){
+
+    const std::vector<GLfloat>& vertices = builder.GetVertices();
+    const std::vector<GLuint>& indices = builder.GetIndices();
+    std::vector<unsigned char> packed = builder.GetPackedVertices();
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, mesh_magic, sizeof(mesh_magic));
+    header.version = version;
+    header.source_hash = source_hash;
+    header.vertex_format = builder.GetVertexFormat();
+    header.vertex_size = static_cast<uint32_t>(GetVertexSize(builder.GetVertexFormat()));
+    header.vertex_count = builder.GetVertexCount();
+    header.index_count = builder.GetIndexCount();
+    header.stats = stats;
+    for (size_t i = 0; i < vertices.size(); i += MeshBuilder::vertex_att){
+        for (int k = 0; k < 3; k++){
+            if (i == 0 || vertices[i + k] < header.bounds_min[k]){
+                header.bounds_min[k] = vertices[i + k];
+            }
+            if (i == 0 || vertices[i + k] > header.bounds_max[k]){
+                header.bounds_max[k] = vertices[i + k];
+            }
+        }
+    }
+
+    // A single level for now, covering the whole index blob
+    MeshFileLod lod;
+    memset(&lod, 0, sizeof(lod));
+    lod.first_index = 0;
+    lod.index_count = header.index_count;
+    lod.max_distance = 0.0f; // Unbounded
+
+    header.lod_count = 1;
+    header.lod_offset = static_cast<uint32_t>(AlignOffset(sizeof(header)));
+    header.vertex_offset = AlignOffset(header.lod_offset + header.lod_count * sizeof(MeshFileLod));
+    header.index_offset = AlignOffset(header.vertex_offset + packed.size());
+
+    std::vector<unsigned char> blob(header.index_offset + indices.size() * sizeof(GLuint), 0);
+    memcpy(&blob[0], &header, sizeof(header));
+    memcpy(&blob[header.lod_offset], &lod, sizeof(lod));
+    if (!packed.empty()){
+        memcpy(&blob[header.vertex_offset], packed.data(), packed.size());
+    }
+    if (!indices.empty()){
+        memcpy(&blob[header.index_offset], indices.data(), indices.size() * sizeof(GLuint));
+    }
+
+    WriteCacheFile(MESH_CACHE_DIRECTORY, cache_path, blob);
+}
+
+} // namespace game
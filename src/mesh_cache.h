@@ -0,0 +1,74 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "mesh_builder.h"
+#include "mesh_optimizer.h"
+#include "vertex_format.h"
+
+namespace game {
+
+    // Layout of a baked mesh file. All blobs start on a multiple of
+    // blob_alignment, so they can be uploaded straight from a mapping:
+    //   MeshFileHeader
+    //   MeshFileLod[lod_count]
+    //   vertex blob: vertex_count * vertex_size bytes
+    //   index blob: index_count GLuints
+    struct MeshFileHeader {
+        char magic[4]; // "WMSH"
+        uint32_t version;
+        uint64_t source_hash; // Hash of the source files the mesh was baked from
+        uint32_t vertex_format; // VertexFormat of the vertex blob
+        uint32_t vertex_size;
+        uint32_t vertex_count;
+        uint32_t index_count;
+        float bounds_min[3]; // Axis aligned bounding box of the positions
+        float bounds_max[3];
+        uint32_t lod_count;
+        uint32_t lod_offset; // Byte offsets from the start of the file
+        uint64_t vertex_offset;
+        uint64_t index_offset;
+        MeshStats stats; // Of the optimizer, kept for the mesh report
+    };
+
+    // One level of detail: a range of the index blob
+    struct MeshFileLod {
+        uint32_t first_index;
+        uint32_t index_count;
+        float max_distance; // Farthest view distance the level is used at
+        uint32_t reserved;
+    };
+
+    // Cache of meshes baked to the binary format above, stored in
+    // MESH_CACHE_DIRECTORY and keyed by the hash of their source files
+    class MeshCache {
+
+        public:
+            // Bump when the format or the processing of meshes changes, so
+            // that old cache entries are rebuilt
+            static const uint32_t version = 3;
+            static const size_t blob_alignment = 16;
+
+            // Hash the contents of the source files of a mesh
+            static uint64_t HashFiles(const std::vector<std::string>& filenames);
+            // Cache file for the given source hash
+            static std::string GetCachePath(uint64_t source_hash);
+
+            // Upload a cached mesh into new OpenGL buffers. Returns false
+            // if there is no valid entry for the hash
+            static bool Load(const std::string& cache_path, uint64_t source_hash, GLuint& array_buffer, GLuint& element_array_buffer, GLsizei& size, VertexFormat& format, MeshStats& stats);
+            // Bake a staged mesh into the cache. Failing to write the cache
+            // is not an error, the mesh is simply rebuilt next time
+            static void Store(const std::string& cache_path, uint64_t source_hash, const MeshBuilder& builder, const MeshStats& stats);
+
+    }; // class MeshCache
+
+} // namespace game
+
+#endif // MESH_CACHE_H_
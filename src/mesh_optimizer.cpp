@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+
+#include "mesh_optimizer.h"
+
+namespace game {
+
+namespace {
+
+    const int vertex_att = MeshBuilder::vertex_att;
+    const GLuint invalid_index = ~0u;
+
+    // Weights of the Forsyth vertex score
+    const float cache_decay_power = 1.5f;
+    const float last_triangle_score = 0.75f;
+    const float valence_boost_scale = 2.0f;
+    const float valence_boost_power = 0.5f;
+
+    // Hash the attributes of a vertex; zeros are hashed alike so that
+    // 0.0 and -0.0 end up in the same bucket, as they compare equal
+    size_t HashVertex(const GLfloat* v){
+
+        size_t hash = 2166136261u;
+        for (int k = 0; k < vertex_att; k++){
+            float f = (v[k] == 0.0f) ? 0.0f : v[k];
+            unsigned int bits;
+            memcpy(&bits, &f, sizeof(bits));
+            hash = (hash ^ bits) * 16777619u;
+        }
+        return hash;
+    }
+
+
+    bool EqualVertex(const GLfloat* a, const GLfloat* b){
+
+        for (int k = 0; k < vertex_att; k++){
+            if (a[k] != b[k]){
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    float VertexScore(int cache_position, int remaining){
+
+        if (remaining == 0){
+            // No triangle needs this vertex anymore
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cache_position >= 0){
+            if (cache_position < 3){
+                // Used by the last triangle; fixed score so that the
+                // next triangle does not simply reuse the same edge
+                score = last_triangle_score;
+            } else {
+                float scaler = 1.0f / (MeshOptimizer::cache_size - 3);
+                score = 1.0f - (cache_position - 3) * scaler;
+                score = powf(score, cache_decay_power);
+            }
+        }
+
+        // Favor vertices with few triangles left, so that lone
+        // triangles are not left behind
+        score += valence_boost_scale * powf(static_cast<float>(remaining), -valence_boost_power);
+
+        return score;
+    }
+
+
+    glm::vec3 VertexPosition(const std::vector<GLfloat>& vertices, GLuint index){
+
+        const GLfloat* v = &vertices[index * vertex_att];
+        return glm::vec3(v[0], v[1], v[2]);
+    }
+
+} // namespace
+
+
+MeshStats MeshOptimizer::Optimize(MeshBuilder& builder){
+
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    builder.Swap(vertices, indices);
+
+    MeshStats stats;
+    stats.source_vertex_count = static_cast<uint32_t>(vertices.size() / vertex_att);
+    stats.source_acmr = ComputeACMR(indices, stats.source_vertex_count);
+
+    WeldVertices(vertices, indices);
+    OptimizeVertexCache(indices, vertices.size() / vertex_att);
+    OptimizeOverdraw(vertices, indices);
+    OptimizeVertexFetch(vertices, indices);
+
+    stats.vertex_count = static_cast<uint32_t>(vertices.size() / vertex_att);
+    stats.acmr = ComputeACMR(indices, stats.vertex_count);
+
+    builder.Swap(vertices, indices);
+    return stats;
+}
+
+
+void MeshOptimizer::WeldVertices(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices){
+
+    size_t vertex_count = vertices.size() / vertex_att;
+    if (vertex_count == 0){
+        return;
+    }
+
+    // Open addressing table of indices into the welded vertex array,
+    // at most half full
+    size_t table_size = 1;
+    while (table_size < vertex_count * 2){
+        table_size *= 2;
+    }
+    std::vector<GLuint> table(table_size, invalid_index);
+
+    std::vector<GLfloat> welded;
+    welded.reserve(vertices.size());
+    std::vector<GLuint> remap(vertex_count);
+
+    for (size_t i = 0; i < vertex_count; i++){
+        const GLfloat* v = &vertices[i * vertex_att];
+        size_t slot = HashVertex(v) & (table_size - 1);
+
+        // Linear probing until we find the same vertex or an empty slot
+        while (table[slot] != invalid_index && !EqualVertex(&welded[table[slot] * vertex_att], v)){
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if (table[slot] == invalid_index){
+            table[slot] = static_cast<GLuint>(welded.size() / vertex_att);
+            welded.insert(welded.end(), v, v + vertex_att);
+        }
+        remap[i] = table[slot];
+    }
+
+    for (size_t i = 0; i < indices.size(); i++){
+        indices[i] = remap[indices[i]];
+    }
+    vertices.swap(welded);
+}
+
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count){
+
+    size_t face_count = indices.size() / 3;
+    if (face_count == 0){
+        return;
+    }
+
+    // Triangles adjacent to each vertex; the first remaining[v] entries
+    // of a vertex are the triangles not emitted yet
+    std::vector<int> remaining(vertex_count, 0);
+    for (size_t i = 0; i < face_count * 3; i++){
+        remaining[indices[i]]++;
+    }
+    std::vector<size_t> offset(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++){
+        offset[v + 1] = offset[v] + remaining[v];
+    }
+    std::vector<GLuint> adjacency(face_count * 3);
+    std::vector<int> fill(vertex_count, 0);
+    for (size_t f = 0; f < face_count; f++){
+        for (int j = 0; j < 3; j++){
+            GLuint v = indices[f * 3 + j];
+            adjacency[offset[v] + fill[v]++] = static_cast<GLuint>(f);
+        }
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++){
+        vertex_score[v] = VertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> face_score(face_count);
+    std::vector<bool> emitted(face_count, false);
+    size_t best_face = 0;
+    for (size_t f = 0; f < face_count; f++){
+        face_score[f] = vertex_score[indices[f * 3]] + vertex_score[indices[f * 3 + 1]] + vertex_score[indices[f * 3 + 2]];
+        if (face_score[f] > face_score[best_face]){
+            best_face = f;
+        }
+    }
+
+    // LRU cache, with room for the vertices pushed out by one triangle
+    std::vector<GLuint> cache, new_cache;
+    cache.reserve(cache_size + 3);
+    new_cache.reserve(cache_size + 3);
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    size_t scan_cursor = 0;
+
+    for (size_t n = 0; n < face_count; n++){
+        // Emit the best triangle
+        emitted[best_face] = true;
+        const GLuint* face = &indices[best_face * 3];
+        result.insert(result.end(), face, face + 3);
+
+        // Remove it from the adjacency of its vertices
+        for (int j = 0; j < 3; j++){
+            GLuint v = face[j];
+            GLuint* list = &adjacency[offset[v]];
+            for (int k = 0; k < remaining[v]; k++){
+                if (list[k] == best_face){
+                    std::swap(list[k], list[remaining[v] - 1]);
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // Move its vertices to the front of the cache
+        new_cache.assign(face, face + 3);
+        for (size_t k = 0; k < cache.size(); k++){
+            GLuint v = cache[k];
+            if (v != face[0] && v != face[1] && v != face[2]){
+                new_cache.push_back(v);
+            }
+        }
+        cache.swap(new_cache);
+
+        // Update the scores of the vertices in the cache, including the
+        // ones that just fell out of it
+        for (size_t k = 0; k < cache.size(); k++){
+            GLuint v = cache[k];
+            cache_position[v] = (k < static_cast<size_t>(cache_size)) ? static_cast<int>(k) : -1;
+            vertex_score[v] = VertexScore(cache_position[v], remaining[v]);
+        }
+
+        // Update the triangles around them and select the best one
+        float best_score = -1.0f;
+        size_t next_face = face_count;
+        for (size_t k = 0; k < cache.size(); k++){
+            GLuint v = cache[k];
+            for (int t = 0; t < remaining[v]; t++){
+                GLuint f = adjacency[offset[v] + t];
+                face_score[f] = vertex_score[indices[f * 3]] + vertex_score[indices[f * 3 + 1]] + vertex_score[indices[f * 3 + 2]];
+                if (face_score[f] > best_score){
+                    best_score = face_score[f];
+                    next_face = f;
+                }
+            }
+        }
+        if (cache.size() > static_cast<size_t>(cache_size)){
+            cache.resize(cache_size);
+        }
+
+        // No triangle touches the cache: continue with the next one in
+        // the input order
+        if (next_face == face_count){
+            while (scan_cursor < face_count && emitted[scan_cursor]){
+                scan_cursor++;
+            }
+            next_face = scan_cursor;
+        }
+        best_face = next_face;
+    }
+
+    indices.swap(result);
+}
+
+
+void MeshOptimizer::OptimizeOverdraw(const std::vector<GLfloat>& vertices, std::vector<GLuint>& indices){
+
+    size_t face_count = indices.size() / 3;
+    if (face_count == 0){
+        return;
+    }
+
+    // Split the triangle list into clusters where the cache order has a
+    // hard boundary, i.e., a triangle misses the cache with all its
+    // vertices. Reordering whole clusters keeps most of the cache locality
+    std::vector<size_t> cluster_start;
+    std::vector<int> timestamp(vertices.size() / vertex_att, -report_cache_size - 1);
+    int time = 0;
+    for (size_t f = 0; f < face_count; f++){
+        int misses = 0;
+        for (int j = 0; j < 3; j++){
+            GLuint v = indices[f * 3 + j];
+            if (time - timestamp[v] > report_cache_size){
+                timestamp[v] = time++;
+                misses++;
+            }
+        }
+        if (f == 0 || misses == 3){
+            cluster_start.push_back(f);
+        }
+    }
+    size_t cluster_count = cluster_start.size();
+    cluster_start.push_back(face_count);
+
+    // Area weighted centroid and normal of each cluster
+    std::vector<glm::vec3> cluster_centroid(cluster_count, glm::vec3(0.0f));
+    std::vector<glm::vec3> cluster_normal(cluster_count, glm::vec3(0.0f));
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+    for (size_t c = 0; c < cluster_count; c++){
+        float cluster_area = 0.0f;
+        for (size_t f = cluster_start[c]; f < cluster_start[c + 1]; f++){
+            glm::vec3 p0 = VertexPosition(vertices, indices[f * 3]);
+            glm::vec3 p1 = VertexPosition(vertices, indices[f * 3 + 1]);
+            glm::vec3 p2 = VertexPosition(vertices, indices[f * 3 + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+            cluster_centroid[c] += centroid * area;
+            cluster_normal[c] += normal;
+            cluster_area += area;
+        }
+        mesh_centroid += cluster_centroid[c];
+        mesh_area += cluster_area;
+        if (cluster_area > 0.0f){
+            cluster_centroid[c] /= cluster_area;
+        }
+    }
+    if (mesh_area > 0.0f){
+        mesh_centroid /= mesh_area;
+    }
+
+    // Clusters facing away from the center of the mesh are more likely
+    // to occlude the others, so they are drawn first
+    std::vector<float> sort_key(cluster_count);
+    std::vector<size_t> order(cluster_count);
+    for (size_t c = 0; c < cluster_count; c++){
+        float length = glm::length(cluster_normal[c]);
+        glm::vec3 normal = (length > 0.0f) ? cluster_normal[c] / length : glm::vec3(0.0f);
+        sort_key[c] = glm::dot(cluster_centroid[c] - mesh_centroid, normal);
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sort_key](size_t a, size_t b){
+        return sort_key[a] > sort_key[b];
+    });
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    for (size_t k = 0; k < cluster_count; k++){
+        size_t c = order[k];
+        result.insert(result.end(), indices.begin() + cluster_start[c] * 3, indices.begin() + cluster_start[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices){
+
+    std::vector<GLuint> remap(vertices.size() / vertex_att, invalid_index);
+    std::vector<GLfloat> result;
+    result.reserve(vertices.size());
+
+    for (size_t i = 0; i < indices.size(); i++){
+        GLuint v = indices[i];
+        if (remap[v] == invalid_index){
+            remap[v] = static_cast<GLuint>(result.size() / vertex_att);
+            result.insert(result.end(), vertices.begin() + v * vertex_att, vertices.begin() + (v + 1) * vertex_att);
+        }
+        indices[i] = remap[v];
+    }
+    vertices.swap(result);
+}
+
+
+float MeshOptimizer::ComputeACMR(const std::vector<GLuint>& indices, size_t vertex_count, int fifo_size){
+
+    size_t face_count = indices.size() / 3;
+    if (face_count == 0){
+        return 0.0f;
+    }
+
+    // A vertex is in the FIFO if it was pushed less than fifo_size
+    // misses ago
+    std::vector<int> timestamp(vertex_count, -fifo_size - 1);
+    int misses = 0;
+    for (size_t i = 0; i < indices.size(); i++){
+        GLuint v = indices[i];
+        if (misses - timestamp[v] > fifo_size){
+            timestamp[v] = misses++;
+        }
+    }
+
+    return static_cast<float>(misses) / face_count;
+}
+
+} // namespace game
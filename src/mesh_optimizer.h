@@ -0,0 +1,58 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <cstdint>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "mesh_builder.h"
+
+namespace game {
+
+    // Vertex count and ACMR of a mesh as parsed and after the optimizer
+    struct MeshStats {
+        uint32_t source_vertex_count;
+        float source_acmr;
+        uint32_t vertex_count;
+        float acmr;
+    };
+
+    // Load-time processing of indexed triangle meshes stored in the
+    // interleaved layout of MeshBuilder
+    class MeshOptimizer {
+
+        public:
+            // Size of the post-transform cache targeted by the triangle order
+            static const int cache_size = 32;
+            // Size of the FIFO cache used to report the ACMR
+            static const int report_cache_size = 16;
+
+            // Run the whole pipeline on a mesh: weld, vertex cache order,
+            // overdraw order and vertex fetch order. Returns the vertex
+            // count and ACMR before and after
+            static MeshStats Optimize(MeshBuilder& builder);
+
+            // Merge vertices with identical attributes and rewrite the
+            // indices to refer to the merged vertices
+            static void WeldVertices(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+            // Reorder triangles for post-transform cache locality
+            // (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+            static void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count);
+            // Reorder clusters of the cache-optimized triangle list so that
+            // outward facing clusters are drawn first, which reduces overdraw
+            static void OptimizeOverdraw(const std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+            // Reorder vertices in the order they are first referenced, and
+            // drop unreferenced vertices
+            static void OptimizeVertexFetch(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+
+            // Average cache miss ratio: transformed vertices per triangle
+            // with a FIFO cache of the given size
+            static float ComputeACMR(const std::vector<GLuint>& indices, size_t vertex_count, int fifo_size = report_cache_size);
+
+    }; // class MeshOptimizer
+
+} // namespace game
+
+#endif // MESH_OPTIMIZER_H_
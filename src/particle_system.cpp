@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#include "particle_system.h"
+#include "gl_state.h"
+
+namespace game {
+
+namespace {
+
+    // Uniform buffer binding of the emitter blocks
+    const GLuint emitter_binding = 0;
+
+    // Longest step of a single update, so that a pause does not throw
+    // the particles across the map
+    const float max_step = 0.1f;
+
+} // namespace
+
+
+ParticleSystem::ParticleSystem(const std::string name, GLsizei capacity, const Resource* simulation, const Resource* material, const Resource* texture)
+    : Renderable(name, true) {
+
+    if (simulation->GetType() != Material || material->GetType() != Material) {
+        throw(std::invalid_argument(std::string("Invalid type of material")));
+    }
+    if (capacity <= 0) {
+        throw(std::invalid_argument(std::string("Particle system needs room for at least one particle")));
+    }
+
+    capacity_ = capacity;
+    high_water_ = 0;
+    Range all = { 0, capacity };
+    free_.push_back(all);
+    emitters_.resize(max_emitters);
+    for (int i = 0; i < max_emitters; i++) {
+        emitters_[i].used = false;
+    }
+    blocks_.resize(max_emitters);
+
+    last_time_ = glfwGetTime();
+    frame_ = 0;
+    source_ = 0;
+    simulation_ = simulation->GetResource();
+    material_ = material->GetResource();
+    texture_ = texture ? texture->GetResource() : 0;
+
+    // Every particle starts dead: its age and lifetime are both zero
+    std::vector<Particle> dead(capacity, Particle{ glm::vec4(0.0f), glm::vec4(0.0f) });
+    glGenBuffers(2, state_);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, state_[i]);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Particle), dead.data(), GL_DYNAMIC_COPY);
+    }
+
+    std::vector<GLuint> owner(capacity, 0);
+    glGenBuffers(1, &emitter_buffer_);
+    glBindBuffer(GL_ARRAY_BUFFER, emitter_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), owner.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &uniform_buffer_);
+    glBindBuffer(GL_UNIFORM_BUFFER, uniform_buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, max_emitters * sizeof(EmitterBlock), blocks_.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Both programs read the emitters from the same binding
+    GLuint programs[2] = { simulation_, material_ };
+    for (int i = 0; i < 2; i++) {
+        GLuint block = glGetUniformBlockIndex(programs[i], "Emitters");
+        if (block != GL_INVALID_INDEX) {
+            glUniformBlockBinding(programs[i], block, emitter_binding);
+        }
+    }
+
+    glGenVertexArrays(2, vao_);
+    glGenVertexArrays(2, draw_vao_);
+    for (int i = 0; i < 2; i++) {
+        setupVertexArray(vao_[i], state_[i], 0);
+        setupVertexArray(draw_vao_[i], state_[i], 1);
+    }
+}
+
+
+ParticleSystem::~ParticleSystem() {
+
+    glDeleteVertexArrays(2, vao_);
+    glDeleteVertexArrays(2, draw_vao_);
+    glDeleteBuffers(2, state_);
+    glDeleteBuffers(1, &emitter_buffer_);
+    glDeleteBuffers(1, &uniform_buffer_);
+}
+
+
+ParticleSystem::EmitterHandle ParticleSystem::AddEmitter(const ParticleEmitter& emitter, GLsizei particles) {
+
+    EmitterHandle handle = 0;
+    while (handle < max_emitters && emitters_[handle].used) {
+        handle++;
+    }
+    if (handle == max_emitters) {
+        throw(std::invalid_argument(std::string("Too many particle emitters")));
+    }
+    Range range;
+    if (particles <= 0 || !allocate(particles, range)) {
+        throw(std::invalid_argument(std::string("No room for the particles of the emitter")));
+    }
+
+    Emitter& entry = emitters_[handle];
+    entry.settings = emitter;
+    entry.range = range;
+    entry.spawned = 0.0;
+    entry.used = true;
+    updateHighWater();
+
+    // Hand the range to the emitter, all dead
+    std::vector<GLuint> owner(range.count, static_cast<GLuint>(handle));
+    glBindBuffer(GL_ARRAY_BUFFER, emitter_buffer_);
+    glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(GLuint), range.count * sizeof(GLuint), owner.data());
+    std::vector<Particle> dead(range.count, Particle{ glm::vec4(0.0f), glm::vec4(0.0f) });
+    glBindBuffer(GL_ARRAY_BUFFER, state_[source_]);
+    glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(Particle), range.count * sizeof(Particle), dead.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return handle;
+}
+
+
+void ParticleSystem::RemoveEmitter(EmitterHandle handle) {
+
+    Emitter& entry = emitters_[handle];
+    if (!entry.used) {
+        return;
+    }
+    entry.used = false;
+    release(entry.range);
+    updateHighWater();
+}
+
+
+void ParticleSystem::SetEmitterPosition(EmitterHandle handle, const glm::vec3& position) {
+
+    emitters_[handle].settings.position = position;
+}
+
+
+void ParticleSystem::SetEmitterRate(EmitterHandle handle, float rate) {
+
+    emitters_[handle].settings.rate = rate;
+}
+
+
+const ParticleEmitter& ParticleSystem::GetEmitter(EmitterHandle handle) const {
+
+    return emitters_[handle].settings;
+}
+
+
+GLsizei ParticleSystem::GetCapacity(void) const {
+
+    return capacity_;
+}
+
+
+GLsizei ParticleSystem::GetReserved(void) const {
+
+    GLsizei reserved = capacity_;
+    for (size_t i = 0; i < free_.size(); i++) {
+        reserved -= free_[i].count;
+    }
+    return reserved;
+}
+
+
+bool ParticleSystem::allocate(GLsizei count, Range& range) {
+
+    for (size_t i = 0; i < free_.size(); i++) {
+        if (free_[i].count >= count) {
+            range.first = free_[i].first;
+            range.count = count;
+            free_[i].first += count;
+            free_[i].count -= count;
+            if (free_[i].count == 0) {
+                free_.erase(free_.begin() + i);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void ParticleSystem::release(const Range& range) {
+
+    size_t i = 0;
+    while (i < free_.size() && free_[i].first < range.first) {
+        i++;
+    }
+    free_.insert(free_.begin() + i, range);
+
+    // Merge with the next range, then with the previous one
+    if (i + 1 < free_.size() && free_[i].first + free_[i].count == free_[i + 1].first) {
+        free_[i].count += free_[i + 1].count;
+        free_.erase(free_.begin() + i + 1);
+    }
+    if (i > 0 && free_[i - 1].first + free_[i - 1].count == free_[i].first) {
+        free_[i - 1].count += free_[i].count;
+        free_.erase(free_.begin() + i);
+    }
+}
+
+
+void ParticleSystem::updateHighWater(void) {
+
+    // The last free range reaches the end of the pool unless it is full
+    high_water_ = capacity_;
+    if (!free_.empty() && free_.back().first + free_.back().count == capacity_) {
+        high_water_ = free_.back().first;
+    }
+}
+
+
+void ParticleSystem::Update(void) {
+
+    double current_time = glfwGetTime();
+    float delta_time = std::min(static_cast<float>(current_time - last_time_), max_step);
+    last_time_ = current_time;
+
+    Simulate(delta_time);
+}
+
+
+void ParticleSystem::Simulate(float delta_time) {
+
+    if (high_water_ == 0) {
+        return;
+    }
+
+    // Emitters as the shaders see them; each spawns the particles due
+    // since the last update into its range, in turn
+    for (int i = 0; i < max_emitters; i++) {
+        Emitter& entry = emitters_[i];
+        EmitterBlock& block = blocks_[i];
+        if (!entry.used) {
+            block.size.y = 0.0f;
+            continue;
+        }
+        const ParticleEmitter& settings = entry.settings;
+        double before = entry.spawned;
+        entry.spawned += settings.rate * delta_time;
+        GLuint begin = static_cast<GLuint>(static_cast<unsigned long long>(before));
+        GLuint end = static_cast<GLuint>(static_cast<unsigned long long>(entry.spawned));
+        if (end - begin > static_cast<GLuint>(entry.range.count)) {
+            begin = end - entry.range.count;
+        }
+
+        block.position = glm::vec4(settings.position, settings.attraction);
+        block.velocity = glm::vec4(settings.velocity, settings.spread);
+        block.acceleration = glm::vec4(settings.acceleration, settings.lifetime);
+        block.color = settings.color;
+        block.size = glm::vec4(settings.size, 1.0f, 0.0f, 0.0f);
+        block.spawn[0] = entry.range.first;
+        block.spawn[1] = entry.range.count;
+        block.spawn[2] = begin;
+        block.spawn[3] = end;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, uniform_buffer_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, max_emitters * sizeof(EmitterBlock), blocks_.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, emitter_binding, uniform_buffer_);
+
+    glUseProgram(simulation_);
+    GLint delta_time_var = glGetUniformLocation(simulation_, "delta_time");
+    glUniform1f(delta_time_var, delta_time);
+    GLint seed_var = glGetUniformLocation(simulation_, "seed");
+    glUniform1ui(seed_var, ++frame_);
+
+    // Read one state buffer, write the other; nothing is drawn
+    int target = 1 - source_;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(vao_[source_]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, state_[target]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, high_water_);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    source_ = target;
+}
+
+
+void ParticleSystem::Draw(Camera* camera) {
+
+    if (high_water_ == 0) {
+        return;
+    }
+
+    // Drawn in the transparency pass, which sets up the blending
+    GLState::DepthMask(GL_FALSE);
+
+    // Select proper material (shader program)
+    GLState::UseProgram(material_);
+
+    // Set globals for camera
+    camera->SetupShader(material_);
+
+    // Set texture and other shader input variables
+    SetupShader(material_);
+
+    // Four vertices per particle; dead ones collapse outside of the view
+    GLState::BindBufferBase(GL_UNIFORM_BUFFER, emitter_binding, uniform_buffer_);
+    GLState::BindVertexArray(draw_vao_[source_]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, high_water_);
+}
+
+
+void ParticleSystem::setupVertexArray(GLuint vao, GLuint state, GLuint divisor) {
+
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, state);
+    glVertexAttribPointer(ParticlePositionLocation, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, position));
+    glEnableVertexAttribArray(ParticlePositionLocation);
+    glVertexAttribPointer(ParticleVelocityLocation, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, velocity));
+    glEnableVertexAttribArray(ParticleVelocityLocation);
+
+    glBindBuffer(GL_ARRAY_BUFFER, emitter_buffer_);
+    glVertexAttribIPointer(ParticleEmitterLocation, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glEnableVertexAttribArray(ParticleEmitterLocation);
+
+    glVertexAttribDivisor(ParticlePositionLocation, divisor);
+    glVertexAttribDivisor(ParticleVelocityLocation, divisor);
+    glVertexAttribDivisor(ParticleEmitterLocation, divisor);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void ParticleSystem::SetupShader(GLuint program) {
+
+    // Texture
+    GLint tex = glGetUniformLocation(program, "tex_samp");
+    glUniform1i(tex, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, texture_);
+}
+
+} // namespace game
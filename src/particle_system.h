@@ -0,0 +1,135 @@
+#ifndef PARTICLE_SYSTEM_H_
+#define PARTICLE_SYSTEM_H_
+
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "renderable.h"
+#include "resource.h"
+
+namespace game {
+
+    // How an emitter spawns and moves its particles, in world space
+    struct ParticleEmitter {
+        glm::vec3 position;
+        glm::vec3 velocity; // Initial velocity
+        float spread; // Random initial speed, in any direction
+        glm::vec3 acceleration;
+        float attraction; // Pull toward the emitter, per unit of distance
+        float rate; // Particles spawned per second
+        float lifetime; // Seconds
+        glm::vec4 color;
+        float size;
+    };
+
+    // Particles simulated on the GPU. Each particle keeps its position,
+    // velocity, age and lifetime in a vertex buffer; every frame a
+    // transform feedback pass reads one buffer and writes the other. Each
+    // emitter owns a range of the pool, taken from a free list when it is
+    // added, and spawns into the dead particles of its range in turn, so
+    // spawning allocates nothing. All emitters are drawn in one instanced
+    // call, one quad per particle
+    class ParticleSystem : public Renderable {
+
+        public:
+            typedef int EmitterHandle;
+
+            // Emitters alive at the same time
+            static const int max_emitters = 64;
+
+            // 'simulation' is the feedback program that moves the particles
+            // and 'material' the program that draws them
+            ParticleSystem(const std::string name, GLsizei capacity, const Resource* simulation, const Resource* material, const Resource* texture);
+            ~ParticleSystem();
+
+            // Add an emitter with room for 'particles' live particles
+            EmitterHandle AddEmitter(const ParticleEmitter& emitter, GLsizei particles);
+            // The particles of a removed emitter disappear at the next update
+            void RemoveEmitter(EmitterHandle handle);
+            void SetEmitterPosition(EmitterHandle handle, const glm::vec3& position);
+            void SetEmitterRate(EmitterHandle handle, float rate);
+            const ParticleEmitter& GetEmitter(EmitterHandle handle) const;
+
+            GLsizei GetCapacity(void) const;
+            // Particles reserved by the emitters
+            GLsizei GetReserved(void) const;
+
+            // Move the particles by the time since the last update
+            virtual void Update(void) override;
+            // Move the particles by 'delta_time' seconds
+            void Simulate(float delta_time);
+
+            virtual void Draw(Camera* camera) override;
+
+        private:
+            // State of a particle, as read and written by the simulation
+            struct Particle {
+                glm::vec4 position; // w: age
+                glm::vec4 velocity; // w: lifetime, dead once the age reaches it
+            };
+
+            // Emitter as laid out in the uniform block (std140)
+            struct EmitterBlock {
+                glm::vec4 position; // w: attraction
+                glm::vec4 velocity; // w: spread
+                glm::vec4 acceleration; // w: lifetime
+                glm::vec4 color;
+                glm::vec4 size; // x: size, y: 1 while the emitter exists
+                GLuint spawn[4]; // First particle, particles, and the spawn counter before and after this update
+            };
+            static_assert(sizeof(EmitterBlock) == 96, "EmitterBlock must match the std140 layout");
+
+            // Free range of the pool
+            struct Range {
+                GLsizei first;
+                GLsizei count;
+            };
+
+            struct Emitter {
+                ParticleEmitter settings;
+                Range range;
+                double spawned; // Particles spawned since the emitter was added
+                bool used;
+            };
+
+            // Take a range from the free list, first fit; false if none fits
+            bool allocate(GLsizei count, Range& range);
+            // Give a range back, merging it with its free neighbours
+            void release(const Range& range);
+            // End of the last reserved range
+            void updateHighWater(void);
+
+            // Particles are read once per vertex to simulate them, once per
+            // instance to draw them
+            void setupVertexArray(GLuint vao, GLuint state, GLuint divisor);
+            virtual void SetupShader(GLuint program) override;
+
+            GLsizei capacity_;
+            GLsizei high_water_; // Particles before it are simulated and drawn
+            std::vector<Range> free_; // Sorted by first particle
+            std::vector<Emitter> emitters_;
+            std::vector<EmitterBlock> blocks_;
+
+            double last_time_; // Of the last update
+            GLuint frame_;
+
+            GLuint state_[2]; // Ping-pong particle buffers
+            GLuint emitter_buffer_; // Emitter of each particle, fixed while it is reserved
+            GLuint uniform_buffer_; // Emitter blocks
+            GLuint vao_[2]; // Simulation, reading each state buffer
+            GLuint draw_vao_[2]; // Drawing, one quad per particle
+            int source_; // State buffer holding the current particles
+
+            GLuint simulation_;
+            GLuint material_;
+            GLuint texture_;
+
+    }; // class ParticleSystem
+
+} // namespace game
+
+#endif // PARTICLE_SYSTEM_H_
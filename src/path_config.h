@@ -1,4 +1,8 @@
 #define MATERIAL_DIRECTORY CMAKE_PROJ_DIRECTORY "/resources"
 #define SHADERS_DIRECTORY MATERIAL_DIRECTORY "/Shaders"
 #define SCREEN_SPACE_SHADERS_DIRECTORY SHADERS_DIRECTORY "/Screen-Space_Shaders"
-#define AUDIO_DIRECTORY MATERIAL_DIRECTORY "/audio"
\ No newline at end of file
+#define AUDIO_DIRECTORY MATERIAL_DIRECTORY "/audio"
+#define MESH_CACHE_DIRECTORY CMAKE_PROJ_DIRECTORY "/cache/meshes"
+#define TEXTURE_CACHE_DIRECTORY CMAKE_PROJ_DIRECTORY "/cache/textures"
+#define PROGRAM_CACHE_DIRECTORY CMAKE_PROJ_DIRECTORY "/cache/programs"
+#define WORLD_GRID_CACHE_DIRECTORY CMAKE_PROJ_DIRECTORY "/cache/world"
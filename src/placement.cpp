@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+#include "placement.h"
+
+namespace game {
+
+namespace {
+
+    // Candidates tried around an active point before it is retired
+    const int bridson_attempts = 30;
+    // Bridson's algorithm places about one point per bridson_packing * r^2
+    const float bridson_packing = 1.55f;
+
+    // SplitMix64 finalizer: a strong mix of a 64 bit value
+    uint64_t Mix(uint64_t x){
+
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+
+    bool InArea(const glm::vec2& point, const PlacementArea& area){
+
+        return point.x > area.min_x && point.x < area.max_x && point.y > area.min_z && point.y < area.max_z;
+    }
+
+
+    // Cut the excluded areas that span a whole side off the bounds, so
+    // that families living in a small part of the map only sample that
+    // part
+    PlacementArea ShrinkToAllowed(PlacementArea bounds, const std::vector<PlacementArea>& excluded){
+
+        bool changed = true;
+        while (changed){
+            changed = false;
+            for (size_t i = 0; i < excluded.size(); i++){
+                const PlacementArea& e = excluded[i];
+                bool spans_x = e.min_x <= bounds.min_x && e.max_x >= bounds.max_x;
+                bool spans_z = e.min_z <= bounds.min_z && e.max_z >= bounds.max_z;
+                if (spans_x && e.min_z <= bounds.min_z && e.max_z > bounds.min_z){
+                    bounds.min_z = e.max_z;
+                    changed = true;
+                }
+                if (spans_x && e.max_z >= bounds.max_z && e.min_z < bounds.max_z){
+                    bounds.max_z = e.min_z;
+                    changed = true;
+                }
+                if (spans_z && e.min_x <= bounds.min_x && e.max_x > bounds.min_x){
+                    bounds.min_x = e.max_x;
+                    changed = true;
+                }
+                if (spans_z && e.max_x >= bounds.max_x && e.min_x < bounds.max_x){
+                    bounds.max_x = e.min_x;
+                    changed = true;
+                }
+            }
+        }
+
+        return bounds;
+    }
+
+} // namespace
+
+
+CounterRng::CounterRng(uint64_t seed){
+
+    seed_ = Mix(seed);
+    counter_ = 0;
+}
+
+
+uint64_t CounterRng::Next(void){
+
+    return Mix(seed_ + 0x9e3779b97f4a7c15ull * ++counter_);
+}
+
+
+float CounterRng::NextFloat(float min, float max){
+
+    // 24 random bits give every float in [0, 1) the same chance
+    float unit = static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f);
+    return min + unit * (max - min);
+}
+
+
+PlacementGrid::PlacementGrid(const PlacementArea& area, float min_distance){
+
+    area_ = area;
+    min_distance_ = min_distance;
+    inv_cell_size_ = std::sqrt(2.0f) / min_distance;
+    columns_ = std::max(1, static_cast<int>(std::ceil((area.max_x - area.min_x) * inv_cell_size_)));
+    rows_ = std::max(1, static_cast<int>(std::ceil((area.max_z - area.min_z) * inv_cell_size_)));
+    cells_.assign(columns_ * rows_, -1);
+}
+
+
+bool PlacementGrid::IsFree(const glm::vec2& point) const {
+
+    int x = std::min(std::max(static_cast<int>((point.x - area_.min_x) * inv_cell_size_), 0), columns_ - 1);
+    int z = std::min(std::max(static_cast<int>((point.y - area_.min_z) * inv_cell_size_), 0), rows_ - 1);
+
+    // A point closer than min_distance lies at most two cells away
+    for (int j = std::max(z - 2, 0); j <= std::min(z + 2, rows_ - 1); j++){
+        for (int i = std::max(x - 2, 0); i <= std::min(x + 2, columns_ - 1); i++){
+            int other = cells_[j * columns_ + i];
+            if (other >= 0){
+                glm::vec2 d = points_[other] - point;
+                if (d.x * d.x + d.y * d.y <= min_distance_ * min_distance_){
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool PlacementGrid::Insert(const glm::vec2& point){
+
+    if (!IsFree(point)){
+        return false;
+    }
+    int x = std::min(std::max(static_cast<int>((point.x - area_.min_x) * inv_cell_size_), 0), columns_ - 1);
+    int z = std::min(std::max(static_cast<int>((point.y - area_.min_z) * inv_cell_size_), 0), rows_ - 1);
+    cells_[z * columns_ + x] = static_cast<int>(points_.size());
+    points_.push_back(point);
+
+    return true;
+}
+
+
+PoissonPlacer::PoissonPlacer(const PlacementArea& area, float min_distance){
+
+    area_ = area;
+    min_distance_ = min_distance;
+}
+
+
+std::vector<glm::vec2> PoissonPlacer::Sample(const PlacementFamily& family) const {
+
+    std::vector<glm::vec2> result;
+    if (family.amount <= 0){
+        return result;
+    }
+    CounterRng rng(family.seed);
+
+    // Spacing that spreads 'amount' points over the whole area
+    float area = (area_.max_x - area_.min_x) * (area_.max_z - area_.min_z);
+    float radius = std::sqrt(area / (bridson_packing * family.amount));
+
+    // Sample the whole part of the area the family may use, so that the
+    // excluded areas inside it do not cut it into parts the samples cannot
+    // reach, then drop what is excluded
+    PlacementArea bounds = ShrinkToAllowed(area_, family.excluded);
+    if (bounds.min_x >= bounds.max_x || bounds.min_z >= bounds.max_z){
+        return result;
+    }
+    PlacementGrid grid(bounds, radius);
+    std::vector<glm::vec2> samples;
+    std::vector<glm::vec2> active;
+
+    glm::vec2 first(rng.NextFloat(bounds.min_x, bounds.max_x), rng.NextFloat(bounds.min_z, bounds.max_z));
+    grid.Insert(first);
+    samples.push_back(first);
+    active.push_back(first);
+
+    while (!active.empty()){
+        size_t index = rng.Next() % active.size();
+        glm::vec2 center = active[index];
+
+        // Try candidates in the annulus between radius and 2 * radius
+        bool found = false;
+        for (int k = 0; k < bridson_attempts; k++){
+            float angle = rng.NextFloat(0.0f, 6.28318531f);
+            float distance = radius * std::sqrt(rng.NextFloat(1.0f, 4.0f));
+            glm::vec2 candidate = center + distance * glm::vec2(std::cos(angle), std::sin(angle));
+            if (candidate.x < bounds.min_x || candidate.x > bounds.max_x ||
+                candidate.y < bounds.min_z || candidate.y > bounds.max_z){
+                continue;
+            }
+            if (grid.Insert(candidate)){
+                samples.push_back(candidate);
+                active.push_back(candidate);
+                found = true;
+                break;
+            }
+        }
+        if (!found){
+            active[index] = active.back();
+            active.pop_back();
+        }
+    }
+
+    // Samples come out grown from the first point; shuffle them so that
+    // a cut at 'amount' does not leave a region empty
+    for (size_t i = samples.size(); i > 1; i--){
+        std::swap(samples[i - 1], samples[rng.Next() % i]);
+    }
+    for (size_t i = 0; i < samples.size() && result.size() < static_cast<size_t>(family.amount); i++){
+        bool excluded = false;
+        for (size_t j = 0; j < family.excluded.size() && !excluded; j++){
+            excluded = InArea(samples[i], family.excluded[j]);
+        }
+        if (!excluded){
+            result.push_back(samples[i]);
+        }
+    }
+
+    return result;
+}
+
+
+std::vector<std::vector<glm::vec2> > PoissonPlacer::Place(const std::vector<PlacementFamily>& families, bool parallel) const {
+
+    std::vector<std::future<std::vector<glm::vec2> > > jobs;
+    for (size_t i = 0; i < families.size(); i++){
+        jobs.push_back(std::async(parallel ? std::launch::async : std::launch::deferred, &PoissonPlacer::Sample, this, std::cref(families[i])));
+    }
+
+    // Earlier families win where instances would be too close
+    PlacementGrid grid(area_, min_distance_);
+    std::vector<std::vector<glm::vec2> > placed(families.size());
+    for (size_t i = 0; i < families.size(); i++){
+        std::vector<glm::vec2> samples = jobs[i].get();
+        for (size_t j = 0; j < samples.size(); j++){
+            if (grid.Insert(samples[j])){
+                placed[i].push_back(samples[j]);
+            }
+        }
+    }
+
+    return placed;
+}
+
+} // namespace game
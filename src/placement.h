@@ -0,0 +1,89 @@
+#ifndef PLACEMENT_H_
+#define PLACEMENT_H_
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace game {
+
+    // Rectangle on the ground plane
+    struct PlacementArea {
+        float min_x, max_x;
+        float min_z, max_z;
+    };
+
+    // Counter-based random numbers: the n-th number of a stream only
+    // depends on the seed and on n, never on global state or on other
+    // streams, so streams can be drawn on any thread in any order
+    class CounterRng {
+
+        public:
+            CounterRng(uint64_t seed);
+
+            uint64_t Next(void);
+            // Uniform in [min, max)
+            float NextFloat(float min = 0.0f, float max = 1.0f);
+
+        private:
+            uint64_t seed_;
+            uint64_t counter_;
+
+    }; // class CounterRng
+
+    // Background grid that accepts points at least min_distance apart.
+    // Cells are small enough to hold one point each, so a test only looks
+    // at the 5x5 cells around a point
+    class PlacementGrid {
+
+        public:
+            PlacementGrid(const PlacementArea& area, float min_distance);
+
+            // Whether a point is at least min_distance from all others
+            bool IsFree(const glm::vec2& point) const;
+            // Add a point if it is free; returns whether it was added
+            bool Insert(const glm::vec2& point);
+
+        private:
+            PlacementArea area_;
+            float min_distance_;
+            float inv_cell_size_;
+            int columns_, rows_;
+            std::vector<int> cells_; // Index of the point in each cell, or -1
+            std::vector<glm::vec2> points_;
+
+    }; // class PlacementGrid
+
+    // One family of instances to place
+    struct PlacementFamily {
+        int amount; // Instances the whole placement area would hold
+        uint64_t seed;
+        std::vector<PlacementArea> excluded; // Areas kept free of the family
+    };
+
+    // Poisson-disk placement of instance families: every family is spread
+    // evenly over the placement area with Bridson's algorithm, and
+    // instances of all families keep a minimum distance from each other
+    class PoissonPlacer {
+
+        public:
+            PoissonPlacer(const PlacementArea& area, float min_distance);
+
+            // Positions of one family, at most 'amount' of them. Only
+            // depends on the family, so families can be sampled in parallel
+            std::vector<glm::vec2> Sample(const PlacementFamily& family) const;
+
+            // Sample all families, on worker threads if 'parallel', then
+            // accept their positions in family order against the minimum
+            // distance, so the result does not depend on thread timing
+            std::vector<std::vector<glm::vec2> > Place(const std::vector<PlacementFamily>& families, bool parallel = true) const;
+
+        private:
+            PlacementArea area_;
+            float min_distance_;
+
+    }; // class PoissonPlacer
+
+} // namespace game
+
+#endif // PLACEMENT_H_
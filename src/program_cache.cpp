@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <cstring>
+
+#include "mapped_file.h"
+#include "program_cache.h"
+#include "path_config.h"
+
+namespace game {
+
+namespace {
+
+    const char program_magic[4] = { 'W', 'P', 'R', 'G' };
+
+    // Continue an FNV-1a hash over a string, terminated so that
+    // consecutive strings cannot run into each other
+    uint64_t HashString(uint64_t hash, const char* str){
+
+        const uint64_t fnv_prime = 1099511628211ull;
+
+        if (str){
+            for (const char* c = str; *c; c++){
+                hash = (hash ^ static_cast<unsigned char>(*c)) * fnv_prime;
+            }
+        }
+        return (hash ^ 0xff) * fnv_prime;
+    }
+
+} // namespace
+
+
+uint64_t ProgramCache::HashProgram(const std::vector<std::string>& filenames, const std::string& defines){
+
+    uint64_t hash = HashFiles(filenames, version);
+
+    // A driver update invalidates every binary
+    hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    hash = HashString(hash, defines.c_str());
+
+    return hash;
+}
+
+
+std::string ProgramCache::GetCachePath(uint64_t source_hash){
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.wprg", static_cast<unsigned long long>(source_hash));
+
+    return std::string(PROGRAM_CACHE_DIRECTORY) + "/" + name;
+}
+
+
+bool ProgramCache::IsSupported(void){
+
+    if (!GLEW_ARB_get_program_binary){
+        return false;
+    }
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+    return format_count > 0;
+}
+
+
+bool ProgramCache::Load(const std::string& cache_path, uint64_t source_hash, GLuint& program){
+
+    MappedFile file;
+    if (!file.Map(cache_path) || file.GetSize() < sizeof(ProgramFileHeader)){
+        return false;
+    }
+
+    ProgramFileHeader header;
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (memcmp(header.magic, program_magic, sizeof(program_magic)) != 0 ||
+        header.version != version || header.source_hash != source_hash ||
+        header.binary_size == 0 ||
+        static_cast<uint64_t>(header.binary_offset) + header.binary_size > file.GetSize()){
+        return false;
+    }
+
+    // The driver may still refuse the binary, e.g. after an update that
+    // kept its version string
+    program = glCreateProgram();
+    glProgramBinary(program, header.binary_format, file.GetData() + header.binary_offset, header.binary_size);
+
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE){
+        glDeleteProgram(program);
+        program = 0;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool ProgramCache::Store(const std::string& cache_path, uint64_t source_hash, GLuint program){
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0){
+        return false;
+    }
+
+    ProgramFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, program_magic, sizeof(program_magic));
+    header.version = version;
+    header.source_hash = source_hash;
+    header.binary_offset = sizeof(header);
+
+    std::vector<unsigned char> blob(header.binary_offset + length, 0);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, &blob[header.binary_offset]);
+    if (written <= 0){
+        return false;
+    }
+    header.binary_format = format;
+    header.binary_size = static_cast<uint32_t>(written);
+    blob.resize(header.binary_offset + written);
+    memcpy(&blob[0], &header, sizeof(header));
+
+    return WriteCacheFile(PROGRAM_CACHE_DIRECTORY, cache_path, blob);
+}
+
+} // namespace game
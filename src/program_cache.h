@@ -0,0 +1,60 @@
+#ifndef PROGRAM_CACHE_H_
+#define PROGRAM_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+namespace game {
+
+    // Layout of a cached program binary, as returned by glGetProgramBinary:
+    //   ProgramFileHeader
+    //   binary, starting at binary_offset
+    struct ProgramFileHeader {
+        char magic[4]; // "WPRG"
+        uint32_t version;
+        uint64_t source_hash; // Hash of the sources, driver and defines
+        uint32_t binary_format; // Driver specific format of the binary
+        uint32_t binary_size;
+        uint32_t binary_offset;
+        uint32_t reserved;
+    };
+
+    // Cache of linked shader programs, stored in PROGRAM_CACHE_DIRECTORY.
+    // Binaries are only valid for the driver that produced them, so the
+    // key covers the driver strings as well as the sources
+    class ProgramCache {
+
+        public:
+            // Bump when the container changes, or when code that affects
+            // linking does (such as the fixed attribute locations)
+            static const uint32_t version = 2;
+
+            // Hash the source files of a program together with the
+            // vendor, renderer and version strings of the current context
+            // and the defines injected into the sources
+            static uint64_t HashProgram(const std::vector<std::string>& filenames, const std::string& defines);
+            // Cache file for the given hash
+            static std::string GetCachePath(uint64_t source_hash);
+
+            // Whether the driver can load program binaries at all
+            static bool IsSupported(void);
+
+            // Create a program from a cached binary. Returns false if there
+            // is no valid entry or if the driver rejects the binary, in
+            // which case the program has to be built from source
+            static bool Load(const std::string& cache_path, uint64_t source_hash, GLuint& program);
+
+            // Store the binary of a linked program. The program must have
+            // been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+            // Returns false if the binary could not be retrieved or written
+            static bool Store(const std::string& cache_path, uint64_t source_hash, GLuint program);
+
+    }; // class ProgramCache
+
+} // namespace game
+
+#endif // PROGRAM_CACHE_H_
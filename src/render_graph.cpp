@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "render_graph.h"
+#include "gl_state.h"
+
+namespace game {
+
+    RenderGraph::RenderGraph(void) {
+
+        compiled_ = false;
+        for (int i = 0; i < 4; i++) {
+            viewport_[i] = 0;
+        }
+    }
+
+
+    RenderGraph::~RenderGraph() {
+
+        for (size_t i = 0; i < pool_.size(); i++) {
+            glDeleteFramebuffers(1, &pool_[i].frame_buffer);
+            glDeleteTextures(1, &pool_[i].texture);
+        }
+    }
+
+
+    void RenderGraph::Reset(void) {
+
+        passes_.clear();
+        targets_.clear();
+        compiled_ = false;
+
+        // The screen is always the first target
+        glGetIntegerv(GL_VIEWPORT, viewport_);
+        Target screen;
+        screen.name = "Screen";
+        screen.transient = false;
+        screen.width = viewport_[2];
+        screen.height = viewport_[3];
+        screen.internal_format = GL_RGBA8;
+        screen.texture = 0;
+        screen.frame_buffer = 0;
+        screen.alias = -1;
+        screen.pooled = -1;
+        targets_.push_back(screen);
+    }
+
+
+    GraphTarget RenderGraph::GetScreen(void) const {
+
+        return 0;
+    }
+
+
+    GraphTarget RenderGraph::Import(const std::string& name, GLuint texture, GLuint frame_buffer, GLsizei width, GLsizei height) {
+
+        Target target;
+        target.name = name;
+        target.transient = false;
+        target.width = width;
+        target.height = height;
+        target.internal_format = 0;
+        target.texture = texture;
+        target.frame_buffer = frame_buffer;
+        target.alias = -1;
+        target.pooled = -1;
+        targets_.push_back(target);
+        return static_cast<GraphTarget>(targets_.size() - 1);
+    }
+
+
+    GraphTarget RenderGraph::CreateTarget(const std::string& name, GLsizei width, GLsizei height, GLenum internal_format) {
+
+        Target target;
+        target.name = name;
+        target.transient = true;
+        target.width = width;
+        target.height = height;
+        target.internal_format = internal_format;
+        target.texture = 0;
+        target.frame_buffer = 0;
+        target.alias = -1;
+        target.pooled = -1;
+        targets_.push_back(target);
+        return static_cast<GraphTarget>(targets_.size() - 1);
+    }
+
+
+    void RenderGraph::AddPass(const std::string& name, const std::vector<GraphTarget>& inputs, GraphTarget output, PassFunction function, bool identity) {
+
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (inputs[i] < 0 || inputs[i] >= static_cast<GraphTarget>(targets_.size())) {
+                throw(std::invalid_argument(std::string("Unknown input of render pass ") + name));
+            }
+        }
+        if (output < 0 || output >= static_cast<GraphTarget>(targets_.size())) {
+            throw(std::invalid_argument(std::string("Unknown output of render pass ") + name));
+        }
+        if (identity && inputs.size() != 1) {
+            throw(std::invalid_argument(std::string("Identity render pass must read one target: ") + name));
+        }
+
+        Pass pass;
+        pass.name = name;
+        pass.inputs = inputs;
+        pass.output = output;
+        pass.function = function;
+        pass.identity = identity;
+        pass.state = PassRun;
+        passes_.push_back(pass);
+        compiled_ = false;
+    }
+
+
+    GraphTarget RenderGraph::resolve(GraphTarget target) const {
+
+        while (targets_[target].alias >= 0) {
+            target = targets_[target].alias;
+        }
+        return target;
+    }
+
+
+    void RenderGraph::Compile(void) {
+
+        for (size_t i = 0; i < passes_.size(); i++) {
+            passes_[i].state = PassRun;
+        }
+        for (size_t i = 0; i < targets_.size(); i++) {
+            targets_[i].alias = -1;
+            targets_[i].pooled = -1;
+        }
+
+        // An identity pass into a transient target: read its input instead
+        for (size_t i = 0; i < passes_.size(); i++) {
+            Pass& pass = passes_[i];
+            if (!pass.identity || !targets_[pass.output].transient) continue;
+            GraphTarget source = resolve(pass.inputs[0]);
+            if (source != pass.output) {
+                targets_[pass.output].alias = source;
+            }
+            pass.state = PassCulledIdentity;
+        }
+
+        // An identity pass into an imported target: have the pass that made
+        // its input draw there, if nothing else needs that input and the
+        // imported target is left alone in between; otherwise blit
+        for (size_t i = 0; i < passes_.size(); i++) {
+            Pass& pass = passes_[i];
+            if (!pass.identity || pass.state != PassRun) continue;
+            GraphTarget source = resolve(pass.inputs[0]);
+            GraphTarget destination = resolve(pass.output);
+            if (source == destination) {
+                pass.state = PassCulledIdentity;
+                continue;
+            }
+            pass.state = PassBlit;
+            if (!targets_[source].transient) continue;
+
+            int producer = -1;
+            int writes = 0, reads = 0;
+            bool destination_used = false;
+            for (size_t j = 0; j < passes_.size(); j++) {
+                const Pass& other = passes_[j];
+                if (other.state == PassCulledIdentity) continue;
+                bool reads_destination = false;
+                for (size_t k = 0; k < other.inputs.size(); k++) {
+                    GraphTarget input = resolve(other.inputs[k]);
+                    if (input == source) reads++;
+                    if (input == destination) reads_destination = true;
+                }
+                if (resolve(other.output) == source) {
+                    writes++;
+                    producer = static_cast<int>(j);
+                }
+                // Between the producer and this pass, or in the producer
+                if (producer >= 0 && j < i && (reads_destination || (j != static_cast<size_t>(producer) && resolve(other.output) == destination))) {
+                    destination_used = true;
+                }
+            }
+            if (writes == 1 && reads == 1 && producer < static_cast<int>(i) && !destination_used) {
+                targets_[source].alias = destination;
+                pass.state = PassCulledIdentity;
+            }
+        }
+
+        // Walk back from the screen; a pass is kept if what it draws is read
+        // by a kept pass or is the screen
+        std::vector<bool> needed(targets_.size(), false);
+        needed[GetScreen()] = true;
+        for (size_t i = passes_.size(); i-- > 0;) {
+            Pass& pass = passes_[i];
+            if (pass.state == PassCulledIdentity) continue;
+            if (!needed[resolve(pass.output)]) {
+                pass.state = PassCulledUnused;
+                continue;
+            }
+            for (size_t k = 0; k < pass.inputs.size(); k++) {
+                needed[resolve(pass.inputs[k])] = true;
+            }
+        }
+
+        // Last kept pass that uses each target
+        std::vector<int> last_use(targets_.size(), -1);
+        for (size_t i = 0; i < passes_.size(); i++) {
+            const Pass& pass = passes_[i];
+            if (pass.state != PassRun && pass.state != PassBlit) continue;
+            last_use[resolve(pass.output)] = static_cast<int>(i);
+            for (size_t k = 0; k < pass.inputs.size(); k++) {
+                last_use[resolve(pass.inputs[k])] = static_cast<int>(i);
+            }
+        }
+
+        // Place the transient targets in the pool in pass order. A texture
+        // is given back after the last pass that uses it, so the input and
+        // output of a pass never share one
+        for (size_t i = 0; i < pool_.size(); i++) {
+            pool_[i].busy = false;
+        }
+        for (size_t i = 0; i < passes_.size(); i++) {
+            const Pass& pass = passes_[i];
+            if (pass.state != PassRun && pass.state != PassBlit) continue;
+
+            std::vector<GraphTarget> used(pass.inputs);
+            used.push_back(pass.output);
+            for (size_t k = 0; k < used.size(); k++) {
+                Target& target = targets_[resolve(used[k])];
+                if (target.transient && target.pooled < 0) {
+                    target.pooled = acquire(target);
+                }
+            }
+            for (size_t k = 0; k < used.size(); k++) {
+                GraphTarget target = resolve(used[k]);
+                if (last_use[target] == static_cast<int>(i) && targets_[target].pooled >= 0) {
+                    pool_[targets_[target].pooled].busy = false;
+                }
+            }
+        }
+        compiled_ = true;
+    }
+
+
+    int RenderGraph::acquire(const Target& target) {
+
+        for (size_t i = 0; i < pool_.size(); i++) {
+            PooledTarget& pooled = pool_[i];
+            if (!pooled.busy && pooled.width == target.width && pooled.height == target.height &&
+                pooled.internal_format == target.internal_format) {
+                pooled.busy = true;
+                return static_cast<int>(i);
+            }
+        }
+
+        PooledTarget pooled;
+        pooled.width = target.width;
+        pooled.height = target.height;
+        pooled.internal_format = target.internal_format;
+        pooled.busy = true;
+
+        glGenTextures(1, &pooled.texture);
+        GLState::BindTexture(0, GL_TEXTURE_2D, pooled.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, target.internal_format, target.width, target.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &pooled.frame_buffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, pooled.frame_buffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pooled.texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw(std::ios_base::failure(std::string("Error setting up frame buffer of render target ") + target.name));
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        pool_.push_back(pooled);
+        return static_cast<int>(pool_.size() - 1);
+    }
+
+
+    void RenderGraph::Execute(void) {
+
+        if (!compiled_) {
+            Compile();
+        }
+
+        for (size_t i = 0; i < passes_.size(); i++) {
+            const Pass& pass = passes_[i];
+            const Target& output = targets_[resolve(pass.output)];
+            GLuint frame_buffer = output.pooled >= 0 ? pool_[output.pooled].frame_buffer : output.frame_buffer;
+
+            if (pass.state == PassRun) {
+                glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+                if (resolve(pass.output) == GetScreen()) {
+                    glViewport(viewport_[0], viewport_[1], viewport_[2], viewport_[3]);
+                }
+                else {
+                    glViewport(0, 0, output.width, output.height);
+                }
+                pass.function(*this);
+            }
+            else if (pass.state == PassBlit) {
+                const Target& input = targets_[resolve(pass.inputs[0])];
+                GLuint read_buffer = input.pooled >= 0 ? pool_[input.pooled].frame_buffer : input.frame_buffer;
+                GLint x = 0, y = 0;
+                if (resolve(pass.output) == GetScreen()) {
+                    x = viewport_[0];
+                    y = viewport_[1];
+                }
+                bool scaled = input.width != output.width || input.height != output.height;
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, read_buffer);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame_buffer);
+                glBlitFramebuffer(0, 0, input.width, input.height, x, y, x + output.width, y + output.height,
+                    GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+            }
+        }
+
+        // Leave the screen bound, as the passes found it
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport_[0], viewport_[1], viewport_[2], viewport_[3]);
+    }
+
+
+    GLuint RenderGraph::GetTexture(GraphTarget target) const {
+
+        if (target < 0 || target >= static_cast<GraphTarget>(targets_.size())) {
+            throw(std::invalid_argument(std::string("Unknown render target")));
+        }
+        const Target& resolved = targets_[resolve(target)];
+        return resolved.pooled >= 0 ? pool_[resolved.pooled].texture : resolved.texture;
+    }
+
+
+    void RenderGraph::Dump(std::ostream& out) const {
+
+        static const char* state_names[] = { "run", "blit", "culled (identity)", "culled (unused)" };
+
+        out << "Render graph: " << passes_.size() << " passes, " << pool_.size() << " pooled targets"
+            << (compiled_ ? "" : " (not compiled)") << std::endl;
+        for (size_t i = 0; i < passes_.size(); i++) {
+            const Pass& pass = passes_[i];
+            out << "  " << pass.name << ": " << state_names[pass.state] << ", ";
+            for (size_t k = 0; k < pass.inputs.size(); k++) {
+                out << (k ? " " : "") << targets_[pass.inputs[k]].name;
+            }
+            out << (pass.inputs.empty() ? "" : " ") << "-> " << targets_[pass.output].name << std::endl;
+        }
+        for (size_t i = 0; i < targets_.size(); i++) {
+            const Target& target = targets_[i];
+            out << "  " << target.name << " " << target.width << "x" << target.height << ": ";
+            GraphTarget resolved = resolve(static_cast<GraphTarget>(i));
+            if (resolved != static_cast<GraphTarget>(i)) {
+                out << "aliased to " << targets_[resolved].name;
+            }
+            else if (target.pooled >= 0) {
+                out << "pooled texture " << target.pooled;
+            }
+            else if (target.transient) {
+                out << "unused";
+            }
+            else if (i == static_cast<size_t>(GetScreen())) {
+                out << "default frame buffer";
+            }
+            else {
+                out << "imported";
+            }
+            out << std::endl;
+        }
+    }
+
+
+    size_t RenderGraph::GetPoolSize(void) const {
+
+        return pool_.size();
+    }
+
+} // namespace game
@@ -0,0 +1,117 @@
+#ifndef RENDER_GRAPH_H_
+#define RENDER_GRAPH_H_
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    // Handle of a target declared to the render graph
+    typedef int GraphTarget;
+
+    // The passes of a frame, declared with the targets they read and the
+    // target they draw into, then compiled and run in declaration order.
+    // Compiling culls the passes that cannot change the frame:
+    //   - an identity pass (one that copies its input unchanged) goes
+    //     away and its readers read its input instead; when it writes an
+    //     imported target, the pass that made its input draws there
+    //     directly, or failing that a blit is left in its place
+    //   - a pass whose target nothing reads on the way to the screen
+    // Transient targets then get textures from a pool kept across frames;
+    // targets whose lifetimes do not overlap share the same texture.
+    // The graph is declared again every frame, which costs a few small
+    // vectors
+    class RenderGraph {
+
+        public:
+            // Draws the pass into the bound frame buffer and viewport
+            typedef std::function<void(const RenderGraph& graph)> PassFunction;
+
+            RenderGraph(void);
+            ~RenderGraph();
+
+            // Forget the passes and targets of the last frame; the pooled
+            // textures stay. The screen is the current viewport
+            void Reset(void);
+
+            // The default frame buffer
+            GraphTarget GetScreen(void) const;
+            // A texture drawn outside of the pool, with its frame buffer
+            GraphTarget Import(const std::string& name, GLuint texture, GLuint frame_buffer, GLsizei width, GLsizei height);
+            // A texture that only lives during the frame
+            GraphTarget CreateTarget(const std::string& name, GLsizei width, GLsizei height, GLenum internal_format = GL_RGB8);
+
+            // Declare a pass. An identity pass must read exactly one target
+            void AddPass(const std::string& name, const std::vector<GraphTarget>& inputs, GraphTarget output, PassFunction function, bool identity = false);
+
+            // Cull the passes and place the transient targets
+            void Compile(void);
+            // Run the passes that were kept
+            void Execute(void);
+
+            // Texture of a target, for the passes to read; valid once
+            // compiled
+            GLuint GetTexture(GraphTarget target) const;
+
+            // Print the compiled passes and where each target lives
+            void Dump(std::ostream& out) const;
+
+            // Textures held by the pool
+            size_t GetPoolSize(void) const;
+
+        private:
+            enum PassState {
+                PassRun,
+                PassBlit, // Identity pass into an imported target
+                PassCulledIdentity,
+                PassCulledUnused
+            };
+
+            struct Pass {
+                std::string name;
+                std::vector<GraphTarget> inputs;
+                GraphTarget output;
+                PassFunction function;
+                bool identity;
+                PassState state;
+            };
+
+            struct Target {
+                std::string name;
+                bool transient;
+                GLsizei width, height;
+                GLenum internal_format;
+                GLuint texture;
+                GLuint frame_buffer;
+                GraphTarget alias; // Target used in its place, -1 for none
+                int pooled; // Index in the pool, -1 for none
+            };
+
+            struct PooledTarget {
+                GLsizei width, height;
+                GLenum internal_format;
+                GLuint texture;
+                GLuint frame_buffer;
+                bool busy;
+            };
+
+            // Follow the aliases to the target really drawn
+            GraphTarget resolve(GraphTarget target) const;
+            // Take a free texture of the pool that fits 'target', or add one
+            int acquire(const Target& target);
+
+            std::vector<Pass> passes_;
+            std::vector<Target> targets_;
+            std::vector<PooledTarget> pool_;
+            GLint viewport_[4];
+            bool compiled_;
+
+    }; // class RenderGraph
+
+} // namespace game
+
+#endif // RENDER_GRAPH_H_
@@ -1,4 +1,5 @@
 #include "renderable.h"
+#include "gl_state.h"
 
 namespace game {
 	Renderable::Renderable(std::string name, bool blending) {
@@ -11,6 +12,42 @@ namespace game {
 		return name_;
 	}
 
+	bool Renderable::IsBlended(void) const {
+		return blending_;
+	}
+
+	RenderLayer Renderable::GetLayer(void) const {
+		return layer_;
+	}
+
+	void Renderable::SetLayer(RenderLayer layer) {
+		layer_ = layer;
+	}
+
+	MaterialInstance* Renderable::GetMaterialInstance(void) const {
+		return material_instance_;
+	}
+
+	void Renderable::SetMaterialInstance(MaterialInstance* material) {
+		material_instance_ = material;
+	}
+
+	void Renderable::SetDepthPrepassed(bool prepassed) {
+		depth_prepassed_ = prepassed;
+	}
+
+	void Renderable::setupOpaqueDepth(void) const {
+		if (depth_prepassed_) {
+			// The depth is already there; shade only the visible fragments
+			GLState::DepthMask(GL_FALSE);
+			GLState::DepthFunc(GL_EQUAL);
+		}
+		else {
+			GLState::DepthMask(GL_TRUE);
+			GLState::DepthFunc(GL_LESS);
+		}
+	}
+
 	void Renderable::setEntity(Entity* e) {
 		colisionBox_ = e;
 	}
@@ -6,9 +6,22 @@
 #include "entities.h"
 
 namespace game {
+	class MaterialInstance;
+
+	// Groups of nodes the scene graph can treat differently, such as
+	// giving them a depth pre-pass
+	enum RenderLayer {
+		TerrainLayer,
+		FamilyLayer, // Instanced families: trees, rocks and other props
+		ObjectLayer,
+		RenderLayerCount
+	};
+
 	class Renderable {
 	public:
 		Renderable(std::string name, bool blending = false);
+		// Nodes are deleted through this class
+		virtual ~Renderable() {}
 
 		virtual void Draw(Camera* camera) = 0;
 
@@ -17,6 +30,25 @@ namespace game {
 		// Get name of node
 		const std::string GetName(void) const;
 
+		// Blended nodes are drawn in the transparency pass of the scene
+		bool IsBlended(void) const;
+
+		RenderLayer GetLayer(void) const;
+		void SetLayer(RenderLayer layer);
+
+		// Program, textures and parameters the node is drawn with; NULL
+		// for nodes that set up their own, such as particles
+		MaterialInstance* GetMaterialInstance(void) const;
+		void SetMaterialInstance(MaterialInstance* material);
+
+		// Draw only the depth of the node with the given program, for the
+		// depth pre-pass. Nodes without such a pass return false and keep
+		// the usual depth test in the main pass
+		virtual bool DrawDepth(Camera*, GLuint) { return false; }
+		// Whether the depth of the node was drawn by the pre-pass; the
+		// main pass then only shades the fragments that match it
+		void SetDepthPrepassed(bool prepassed);
+
 		void setEntity(Entity* e);
 		Entity* getEntity() const;
 
@@ -24,6 +56,12 @@ namespace game {
 		Entity* colisionBox_ = nullptr;
 		std::string name_; // Name
 		bool blending_ = false;
+		RenderLayer layer_ = ObjectLayer;
+		MaterialInstance* material_instance_ = nullptr;
+		bool depth_prepassed_ = false;
+
+		// Depth test and writes of an opaque draw
+		void setupOpaqueDepth(void) const;
 
 		// Set matrices that transform the node in a shader program
 		virtual void SetupShader(GLuint program) = 0;
@@ -9,15 +9,17 @@ Resource::Resource(ResourceType type, std::string name, GLuint resource, GLsizei
     name_ = name;
     resource_ = resource;
     size_ = size;
+    format_ = StandardFormat;
 }
 
 
-Resource::Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
+Resource::Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, VertexFormat format){
     type_ = type;
     name_ = name;
     array_buffer_ = array_buffer;
     element_array_buffer_ = element_array_buffer;
     size_ = size;
+    format_ = format;
 }
 
 
@@ -61,4 +63,10 @@ GLsizei Resource::GetSize(void) const {
     return size_;
 }
 
+
+VertexFormat Resource::GetVertexFormat(void) const {
+
+    return format_;
+}
+
 } // namespace game
@@ -6,10 +6,12 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "vertex_format.h"
+
 namespace game {
 
     // Possible resource types
-    typedef enum Type { Material, SS_Material, PointSet, Mesh, Texture, SkyboxTexture } ResourceType;
+    typedef enum Type { Material, SS_Material, PointSet, Mesh, Texture, SkyboxTexture, TextureArray } ResourceType;
 
     // Class that holds one resource
     class Resource {
@@ -27,10 +29,11 @@ namespace game {
                 };
             };
             GLsizei size_; // Number of primitives in geometry
+            VertexFormat format_; // Layout of the vertices in the array buffer
 
         public:
             Resource(ResourceType type, std::string name, GLuint resource, GLsizei size);
-            Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
+            Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, VertexFormat format = StandardFormat);
             ~Resource();
             ResourceType GetType(void) const;
             const std::string GetName(void) const;
@@ -38,6 +41,7 @@ namespace game {
             GLuint GetArrayBuffer(void) const;
             GLuint GetElementArrayBuffer(void) const;
             GLsizei GetSize(void) const;
+            VertexFormat GetVertexFormat(void) const;
 
     }; // class Resource
 
@@ -5,9 +5,15 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
 #include <SOIL/SOIL.h>
 
 #include "model_loader.h"
+#include "mesh_builder.h"
+#include "mesh_cache.h"
+#include "texture_cache.h"
+#include "program_cache.h"
+#include "mesh_optimizer.h"
 #include "resource_manager.h"
 #include "path_config.h"
 
@@ -65,6 +71,16 @@ namespace game {
     GLuint ResourceManager::skyboxVAO_ = 0;
 
 ResourceManager::ResourceManager(void){
+
+    texture_count_ = 0;
+    texture_cache_hits_ = 0;
+    texture_load_time_ = 0.0;
+    texture_bytes_ = 0;
+    texture_uncompressed_bytes_ = 0;
+
+    shader_count_ = 0;
+    shader_cache_hits_ = 0;
+    shader_load_time_ = 0.0;
 }
 
 
@@ -135,16 +151,26 @@ void ResourceManager::AddResource(ResourceType type, const std::string name, GLu
 }
 
 
-void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
+void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, VertexFormat format){
 
     Resource *res;
 
-    res = new Resource(type, name, array_buffer, element_array_buffer, size);
+    res = new Resource(type, name, array_buffer, element_array_buffer, size, format);
 
     resource_.push_back(res);
 }
 
 
+void ResourceManager::AddMesh(const std::string name, const MeshBuilder& builder){
+
+    // One upload per buffer for the whole mesh
+    GLuint vbo = builder.UploadVertices();
+    GLuint ebo = builder.UploadIndices();
+
+    AddResource(Mesh, name, vbo, ebo, builder.GetIndexCount(), builder.GetVertexFormat());
+}
+
+
 void ResourceManager::LoadResource(ResourceType type, const std::string name, const char *filename){
 
     // Call appropriate method depending on type of resource
@@ -165,264 +191,118 @@ void ResourceManager::LoadResource(ResourceType type, const std::string name, co
     }
 }
 
-void ResourceManager::LoadCustomResource(ResourceType type, const std::string name, const char* verticesFilepath, const char* facesFilepath) {
-    std::string vertexText = LoadTextFile(verticesFilepath);
-    std::string faceText = LoadTextFile(facesFilepath);
+void ResourceManager::LoadFeedbackProgram(const std::string name, const char* prefix, const std::vector<std::string>& varyings) {
 
-    GLuint vbo = ParseVertices(vertexText);
-    GLsizei faceSize;
-    GLuint ebo = ParseFaces(faceText, faceSize);
-
-    // Create resource
-    AddResource(Mesh, name, vbo, ebo, faceSize);
+    if (varyings.empty()) {
+        throw(std::invalid_argument(std::string("Feedback program needs at least one varying")));
+    }
+    LoadMaterial(name, prefix, Material, varyings);
 }
 
-std::vector<std::vector<bool>> ResourceManager::GetImpassableCells(const char* impassableFilePath, std::vector<std::vector<float>> terrain) {
-    constexpr float sizeOfQuad = 0.1f;
-    const int coord_offset = 250; // This is to avoid negative indices, seems to be the right value
-
-    std::vector<std::vector<bool>> impassable_cells;
-
-    // Get the impassable data from the impassable file. 1 means that cell is impassable
-    std::string fileContent = LoadTextFile(impassableFilePath);
-    std::vector<std::string> lines = StringSplit(fileContent, '\n');
-
-    const int width = StringSplit(lines[0], ',').size();
-    const int height = lines.size();
-
-    for (const std::string& line : lines) {
-        std::vector<std::string> cells = StringSplit(line, ',');
-        std::vector<bool> row;
+void ResourceManager::LoadCustomResource(ResourceType type, const std::string name, const char* verticesFilepath, const char* facesFilepath) {
+    // Use the baked mesh if the source files did not change
+    std::vector<std::string> sources;
+    sources.push_back(verticesFilepath);
+    sources.push_back(facesFilepath);
+    uint64_t source_hash = MeshCache::HashFiles(sources);
+    std::string cache_path = MeshCache::GetCachePath(source_hash);
+    if (LoadCachedMesh(name, cache_path, source_hash)) {
+        return;
+    }
 
-        for (const std::string& cell : cells) {
-            row.push_back(cell == "1");
-        }
+    std::string vertexText = LoadTextFile(verticesFilepath);
+    std::string faceText = LoadTextFile(facesFilepath);
 
-        impassable_cells.push_back(row);
-    }
+    MeshBuilder builder;
+    ParseVertices(vertexText, builder);
+    ParseFaces(faceText, builder);
 
-    return impassable_cells;
+    ProcessMesh(name, builder, cache_path, source_hash);
 }
 
-void ResourceManager::CreateInsectParticles(std::string object_name, int num_particles) {
-    // Data buffer
-    GLfloat* particle = NULL;
 
-    // Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-    const int particle_att = 11;
+bool ResourceManager::LoadCachedMesh(const std::string name, const std::string& cache_path, uint64_t source_hash) {
 
-    // Allocate memory for buffer
-    try {
-        particle = new GLfloat[num_particles * particle_att];
-    }
-    catch (std::exception& e) {
-        throw e;
+    GLuint vbo, ebo;
+    GLsizei size;
+    VertexFormat format;
+    MeshStats stats;
+    if (!MeshCache::Load(cache_path, source_hash, vbo, ebo, size, format, stats)) {
+        return false;
     }
 
-    float u, v, w; // Work variables
-
-    for (int i = 0; i < num_particles; i++) {
-        // Get three random numbers
-        u = ((double)rand() / (RAND_MAX)) - 0.5f;
-        v = ((double)rand() / (RAND_MAX)) - 0.5f;
-        w = ((double)rand() / (RAND_MAX)) - 0.5f;
+    AddResource(Mesh, name, vbo, ebo, size, format);
+    mesh_stats_.push_back(std::make_pair(name, stats));
+    return true;
+}
 
-        glm::vec3 normal(u, v, w); // each normal value slightly offsets the time for movement in that direction (x, y, or z) for that particles
-        glm::vec3 position(u, v, w); // randomizes start position of the particles
-        glm::vec3 color(i / (float)num_particles, 0.0, 1.0 - (i / (float)num_particles));
+void ResourceManager::LoadWorldGrid(WorldGridFile& grid, const char* heightfieldFilePath, const char* impassableFilePath) {
+    constexpr float sizeOfQuad = 0.1f;
 
-        // Add vectors to the data buffer
-        for (int k = 0; k < 3; k++) {
-            particle[i * particle_att + k] = position[k];
-            particle[i * particle_att + k + 3] = normal[k];
-            particle[i * particle_att + k + 6] = color[k];
+    double start_time = glfwGetTime();
+
+    // Convert the text files once, then map the binary grid on later runs
+    std::vector<std::string> filenames;
+    filenames.push_back(heightfieldFilePath);
+    filenames.push_back(impassableFilePath);
+    uint64_t source_stamp = WorldGridFile::StampFiles(filenames);
+    std::string cache_path = WorldGridFile::GetCachePath(source_stamp);
+
+    const char* note = "";
+    if (!grid.Open(cache_path, source_stamp)) {
+        // Throws if the text files are malformed
+        std::vector<unsigned char> blob;
+        WorldGridFile::Convert(heightfieldFilePath, impassableFilePath, source_stamp, sizeOfQuad, blob);
+        note = " (converted from text)";
+
+        // Like the other caches, carry on without it if it cannot be
+        // written, such as in a read-only checkout
+        if (!WorldGridFile::Store(cache_path, blob) || !grid.Open(cache_path, source_stamp)) {
+            grid.Open(blob, source_stamp);
+            note = " (converted from text, not cached)";
         }
     }
 
-    // Create OpenGL buffer and copy data
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete[] particle;
-
-    // Create resource
-    AddResource(PointSet, object_name, vbo, 0, num_particles);
+    std::cout << "World grid: " << grid.GetWidth() << "x" << grid.GetHeight() << " loaded in " <<
+        (glfwGetTime() - start_time) * 1000.0 << " ms" << note << std::endl;
 }
 
-std::vector<std::vector<float>> ResourceManager::LoadTerrainResource(ResourceType type, const std::string name, const char* terrainFilePath) {
-    constexpr float sizeOfQuad = 0.1f;
-    
-    std::vector<std::vector<float>> terrain_grid;
-
-    // first create the vertices from heightfield data
-    std::string fileContent = LoadTextFile(terrainFilePath);
-    std::vector<std::string> lines = StringSplit(fileContent, '\n');
-    const int width = StringSplit(lines[0], ' ').size();
-
-    const int vertex_att = 11; // 11 attributes per vertex: 3D position (3), normal vector (3), tangent vector (3), 2D texture coordinates (2)
-    const int height = lines.size();
-    const int vertexNum = width * height;
-
-    GLfloat* vertices = new GLfloat[vertex_att * (width * height)];
+void ResourceManager::LoadTerrainHeights(const WorldGridFile& grid, WorldGrid& world) {
+    const int width = grid.GetWidth();
+    const int height = grid.GetHeight();
 
-    assert(width % 2 == 0);
-    assert(height % 2 == 0);
+    std::vector<float> terrain_heights(width * height);
 
-    int rowCtr = 0;
-    for (const std::string& line : lines) {
-        std::vector<std::string> verticesStrings = StringSplit(line, ' ');
-        std::vector<float> row;
+    const float* heights = grid.GetHeights();
+    for (int rowCtr = 0; rowCtr < height; ++rowCtr) {
+        for (int columnCtr = 0; columnCtr < width; ++columnCtr) {
+            int cell = rowCtr * width + columnCtr;
 
-        terrain_grid.push_back(row);
-
-        int columnCtr = 0;
-        for (const std::string& vertex : verticesStrings) {
-            std::vector<std::string> inputNums = StringSplit(vertex, ',');
-
-            float zpos = -((height >> 2) - rowCtr) * sizeOfQuad;
-            float xpos = -((width >> 2) - columnCtr) * sizeOfQuad;
-            double ypos = atof(inputNums[0].c_str());
-            double textCordu = atof(inputNums[1].c_str());
-            double textCordv = atof(inputNums[2].c_str());
-
-            vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 0] = static_cast<float>(xpos);
             if (rowCtr > 5 && rowCtr < 10) { // Create flat terrain for road
-                vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 1] = 0.5f;
+                terrain_heights[cell] = 0.5f;
             }
             else if (rowCtr > 20 && rowCtr < 27) { // Create flat terrain for river
-                vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 1] = 0.1f;
-            }
-            else {
-                vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 1] = static_cast<float>(ypos);
-            }
-            vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 2] = static_cast<float>(zpos);
-
-            vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 9] = static_cast<float>(textCordu);
-            vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 10] = static_cast<float>(textCordv);
-
-            terrain_grid[rowCtr].push_back(vertices[width * rowCtr * vertex_att + columnCtr * vertex_att + 1]);
-
-            columnCtr++;
-        }
-
-        rowCtr++;
-    }
-
-    // now fill in the normal and tangent vectors
-
-    /*
-        I'm not sure this is correct but basically what I am doing is having all normal vectors point directly up and
-        having all tangent vectors be tangential to the next vertex to the right, or down based on what's possible.
-        This might give poor estimations for the surface normals when doing normal mapping but i'm not currently sure how to do
-        better without duplicating vertices that aren't in the corners.
-
-        For this assignment we aren't doing normal mapping yet so it might not matter
-
-        NV
-    */
-
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            vertices[width * i * vertex_att + j * vertex_att + 3] = 0.0;
-            vertices[width * i * vertex_att + j * vertex_att + 4] = 1.0;
-            vertices[width * i * vertex_att + j * vertex_att + 5] = 0.0;
-
-            glm::vec3 vertexPos = glm::vec3(vertices[width * i * vertex_att + j * vertex_att + 0],
-                vertices[width * i * vertex_att + j * vertex_att + 1], vertices[width * i * vertex_att + j * vertex_att + 2]);
-
-            glm::vec3 comparisonVertex;
-            if (j != width - 1) {
-                comparisonVertex = glm::vec3(vertices[width * i * vertex_att + (j + 1) * vertex_att + 0],
-                    vertices[width * i * vertex_att + (j + 1) * vertex_att + 1], vertices[width * i * vertex_att + (j + 1) * vertex_att + 2]);
-            }
-            else if (i != height - 1) {
-                comparisonVertex = glm::vec3(vertices[width * (i + 1) * vertex_att + j * vertex_att + 0],
-                    vertices[width * (i + 1) * vertex_att + j * vertex_att + 1], vertices[width * (i + 1) * vertex_att + j * vertex_att + 2]);
+                terrain_heights[cell] = 0.1f;
             }
-            // we're in the bottom right corner
             else {
-                comparisonVertex = glm::vec3(vertices[width * (i - 1) * vertex_att + j * vertex_att + 0],
-                    vertices[width * (i - 1) * vertex_att + j * vertex_att + 1], vertices[width * (i - 1) * vertex_att + j * vertex_att + 2]);
+                terrain_heights[cell] = heights[cell];
             }
-
-            glm::vec3 differenceVector = vertexPos - comparisonVertex;
-
-            vertices[width * i * vertex_att + j * vertex_att + 6] = differenceVector.x;
-            vertices[width * i * vertex_att + j * vertex_att + 7] = differenceVector.y;
-            vertices[width * i * vertex_att + j * vertex_att + 8] = differenceVector.z;
         }
     }
 
-
-    // Create OpenGL buffer for vertices
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertexNum * vertex_att * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
-
-
-    // now let's do faces
-    const int numQuads = (width - 1) * height;
-    const int numFaces = numQuads * 2;
-
-    const int face_att = 3; // Vertex indices (3)
-    GLuint* indexes = new GLuint[numFaces * face_att];
-
-    int quadCtr = 0;
-    for (int i = 0; i < numFaces * face_att; i += 6) {
-        if ((quadCtr - 99) % 100 == 0 && quadCtr != 0) {
-        quadCtr++;
-        continue;
-    }
-
-        GLuint vertex1 = quadCtr;
-        GLuint vertex2 = quadCtr + 1;
-
-        GLuint vertex3 = quadCtr + width;
-        GLuint vertex4 = quadCtr + width + 1;
-
-        // triangle 1
-        indexes[i] = vertex1;
-        indexes[i + 1] = vertex2;
-        indexes[i + 2] = vertex4;
-
-        // triangle 2
-        indexes[i + 3] = vertex1;
-        indexes[i + 4] = vertex3;
-        indexes[i + 5] = vertex4;
-
-        quadCtr++;
-    }
-
-    // Create OpenGL buffer for faces
-    GLuint ebo;
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, numFaces * face_att * sizeof(GLuint), indexes, GL_STATIC_DRAW);
-
-
-    // Free data buffers
-    delete[] vertices;
-    delete[] indexes;
-
-    AddResource(ResourceType::Mesh, name, vbo, ebo, numFaces * face_att);
-
-    return terrain_grid;
+    // The terrain mesh is built from these heights chunk by chunk, see
+    // WorldStreamer, so queries on the terrain see the same heights as the mesh
+    world.SetHeights(width, height, grid.GetOriginX(), grid.GetOriginZ(), grid.GetCellSize(), terrain_heights);
 }
 
-GLuint ResourceManager::ParseVertices(const std::string& verticesText) {
+void ResourceManager::ParseVertices(const std::string& verticesText, MeshBuilder& builder) {
     std::vector<std::string> vertexLinesWithBlanks = StringSplit(verticesText, '\n');
     std::vector<std::string> vertexLines;
     std::copy_if(vertexLinesWithBlanks.begin(), vertexLinesWithBlanks.end(), std::back_inserter(vertexLines), [](std::string& str) {return !str.empty() && !IsComment(str);});
 
     const int vertex_att = 11;  // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-    const int vertex_num = vertexLines.size();
-    GLfloat* vertices = new GLfloat[vertex_num * vertex_att];
+    builder.Reserve(vertexLines.size(), 0);
 
-    int vertexIndex = 0;
     for (const std::string& vertex : vertexLines) {
         std::vector<std::string> atribs = StringSplit(vertex, ' ');
 
@@ -430,39 +310,24 @@ GLuint ResourceManager::ParseVertices(const std::string& verticesText) {
             throw(std::invalid_argument(std::string("Invalid resource data")));
         }
 
+        GLfloat values[vertex_att];
         for (int i = 0; i < vertex_att; ++i) {
-            GLfloat value = static_cast<float>(atof(atribs[i].c_str()));
-
-            vertices[(vertexIndex * vertex_att) + i] = value;
+            values[i] = static_cast<float>(atof(atribs[i].c_str()));
         }
 
-        vertexIndex++;
+        builder.AddVertex(glm::vec3(values[0], values[1], values[2]), glm::vec3(values[3], values[4], values[5]),
+            glm::vec3(values[6], values[7], values[8]), glm::vec2(values[9], values[10]));
     }
-
-    // Create OpenGL buffer for vertices
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
-
-
-    // Free data buffers
-    delete[] vertices;
-
-
-    return vbo;
 }
 
-GLuint ResourceManager::ParseFaces(const std::string& facesText, GLsizei& faceSize) {
+void ResourceManager::ParseFaces(const std::string& facesText, MeshBuilder& builder) {
     std::vector<std::string> faceLinesWithBlanks = StringSplit(facesText, '\n');
     std::vector<std::string> faceLines;
     std::copy_if(faceLinesWithBlanks.begin(), faceLinesWithBlanks.end(), std::back_inserter(faceLines), [](std::string& str) {return !str.empty() && !IsComment(str);});
 
     const int face_att = 3; // Vertex indices (3)
-    const int face_num = faceLines.size();
-    GLuint* indexes = new GLuint[face_num * face_att];
+    const long vertex_count = builder.GetVertexCount();
 
-    int faceIndex = 0;
     for (const std::string& face : faceLines) {
         std::vector<std::string> vertexIndexes = StringSplit(face, ' ');
 
@@ -470,26 +335,21 @@ GLuint ResourceManager::ParseFaces(const std::string& facesText, GLsizei& faceSi
             throw(std::invalid_argument(std::string("Invalid resource data")));
         }
 
+        // The optimizer indexes the vertices with these, so reject
+        // anything that is not one of the parsed vertices
+        GLuint values[face_att];
         for (int i = 0; i < face_att; ++i) {
-            GLuint value = atoi(vertexIndexes[i].c_str());
-
-            indexes[(faceIndex * face_att) + i] = value;
+            const char* text = vertexIndexes[i].c_str();
+            char* end;
+            long index = strtol(text, &end, 10);
+            if (end == text || index < 0 || index >= vertex_count) {
+                throw(std::invalid_argument(std::string("Invalid resource data")));
+            }
+            values[i] = static_cast<GLuint>(index);
         }
 
-        faceIndex++;
+        builder.AddTriangle(values[0], values[1], values[2]);
     }
-
-    // Create OpenGL buffer for faces
-    GLuint ebo;
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), indexes, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete[] indexes;
-
-    faceSize = face_num * face_att;
-    return ebo;
 }
 
 
@@ -505,25 +365,72 @@ Resource *ResourceManager::GetResource(const std::string name) const {
 }
 
 
-void ResourceManager::LoadMaterial(const std::string name, const char* prefix, ResourceType type) {
+GeometryArena* ResourceManager::GetGeometryArena(void) {
 
-    // Load vertex program source code
-    std::string filename;
+    return &geometry_arena_;
+}
+
+
+void ResourceManager::LoadMaterial(const std::string name, const char* prefix, ResourceType type, const std::vector<std::string>& varyings) {
+
+    double start_time = glfwGetTime();
+
+    // Find the source files of the program
+    std::string vp_filename;
     if (type == Material) {
-        filename = std::string(prefix) + std::string(VERTEX_PROGRAM_EXTENSION);
+        vp_filename = std::string(prefix) + std::string(VERTEX_PROGRAM_EXTENSION);
     }
     else if (type == SS_Material) {
-        filename = SCREEN_SPACE_SHADERS_DIRECTORY "/ScreenSpace_vp.glsl";
+        vp_filename = SCREEN_SPACE_SHADERS_DIRECTORY "/ScreenSpace_vp.glsl";
     }
     else {
         throw(std::ios_base::failure(std::string("Error Non Existant Material Type")));
     }
+    std::string fp_filename = std::string(prefix) + std::string(FRAGMENT_PROGRAM_EXTENSION);
+
+    // Feedback programs only have a vertex shader
+    bool feedback_program = !varyings.empty();
 
-    std::string vp = LoadTextFile(filename.c_str());
+    // A geometry shader is used when its source sits next to the others
+    std::string gp_filename = std::string(prefix) + std::string(GEOMETRY_PROGRAM_EXTENSION);
+    bool geometry_program = !feedback_program && std::ifstream(gp_filename.c_str()).good();
 
-    // Load fragment program source code
-    filename = std::string(prefix) + std::string(FRAGMENT_PROGRAM_EXTENSION);
-    std::string fp = LoadTextFile(filename.c_str());
+    std::vector<std::string> filenames;
+    filenames.push_back(vp_filename);
+    if (!feedback_program) {
+        filenames.push_back(fp_filename);
+    }
+    if (geometry_program) {
+        filenames.push_back(gp_filename);
+    }
+
+    // The captured outputs are part of the linked program
+    std::string captured;
+    for (size_t i = 0; i < varyings.size(); i++) {
+        captured += varyings[i] + ";";
+    }
+
+    // Use the binary linked on a previous run if the driver accepts it
+    // (no defines are injected into the sources at the moment)
+    bool use_cache = ProgramCache::IsSupported();
+    uint64_t source_hash = 0;
+    std::string cache_path;
+    if (use_cache) {
+        source_hash = ProgramCache::HashProgram(filenames, captured);
+        cache_path = ProgramCache::GetCachePath(source_hash);
+
+        GLuint sp;
+        if (ProgramCache::Load(cache_path, source_hash, sp)) {
+            AddResource(Material, name, sp, 0);
+            shader_count_++;
+            shader_cache_hits_++;
+            shader_load_time_ += glfwGetTime() - start_time;
+            return;
+        }
+    }
+
+    // Load vertex program source code
+    std::string vp = LoadTextFile(vp_filename.c_str());
 
     // Create a shader from the vertex program source code
     GLuint vs = glCreateShader(GL_VERTEX_SHADER);
@@ -541,31 +448,29 @@ void ResourceManager::LoadMaterial(const std::string name, const char* prefix, R
     }
 
     // Create a shader from the fragment program source code
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    const char* source_fp = fp.c_str();
-    glShaderSource(fs, 1, &source_fp, NULL);
-    glCompileShader(fs);
+    GLuint fs = 0;
+    if (!feedback_program) {
+        std::string fp = LoadTextFile(fp_filename.c_str());
+        fs = glCreateShader(GL_FRAGMENT_SHADER);
+        const char* source_fp = fp.c_str();
+        glShaderSource(fs, 1, &source_fp, NULL);
+        glCompileShader(fs);
 
-    // Check if shader compiled successfully
-    glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE) {
-        char buffer[512];
-        glGetShaderInfoLog(fs, 512, NULL, buffer);
-        throw(std::ios_base::failure(std::string("Error compiling fragment shader: ") + std::string(buffer)));
+        // Check if shader compiled successfully
+        glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
+        if (status != GL_TRUE) {
+            char buffer[512];
+            glGetShaderInfoLog(fs, 512, NULL, buffer);
+            throw(std::ios_base::failure(std::string("Error compiling fragment shader: ") + std::string(buffer)));
+        }
     }
 
     // Try to also load a geometry shader
-    filename = std::string(prefix) + std::string(GEOMETRY_PROGRAM_EXTENSION);
-    bool geometry_program = false;
-    std::string strPrefix(prefix);
     std::string gp = "";
     GLuint gs;
-    if (strPrefix.find("particle") != std::string::npos) {
-        geometry_program = true;
-        gp = LoadTextFile(filename.c_str());
-    }
-
     if (geometry_program) {
+        gp = LoadTextFile(gp_filename.c_str());
+
         // Create a shader from the geometry program source code
         gs = glCreateShader(GL_GEOMETRY_SHADER);
         const char* source_gp = gp.c_str();
@@ -586,10 +491,23 @@ void ResourceManager::LoadMaterial(const std::string name, const char* prefix, R
     // together
     GLuint sp = glCreateProgram();
     glAttachShader(sp, vs);
-    glAttachShader(sp, fs);
+    if (!feedback_program) {
+        glAttachShader(sp, fs);
+    }
     if (geometry_program) {
         glAttachShader(sp, gs);
     }
+    BindVertexAttributeLocations(sp);
+    if (feedback_program) {
+        std::vector<const char*> names;
+        for (size_t i = 0; i < varyings.size(); i++) {
+            names.push_back(varyings[i].c_str());
+        }
+        glTransformFeedbackVaryings(sp, static_cast<GLsizei>(names.size()), names.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+    if (use_cache) {
+        glProgramParameteri(sp, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(sp);
 
     // Check if shaders were linked successfully
@@ -603,13 +521,48 @@ void ResourceManager::LoadMaterial(const std::string name, const char* prefix, R
     // Delete memory used by shaders, since they were already compiled
     // and linked
     glDeleteShader(vs);
-    glDeleteShader(fs);
+    if (!feedback_program) {
+        glDeleteShader(fs);
+    }
     if (geometry_program) {
         glDeleteShader(gs);
     }
 
+    // Refresh the cache for the next runs
+    if (use_cache) {
+        ProgramCache::Store(cache_path, source_hash, sp);
+    }
+
     // Add a resource for the shader program
     AddResource(Material, name, sp, 0);
+    shader_count_++;
+    shader_load_time_ += glfwGetTime() - start_time;
+}
+
+
+void ResourceManager::PrintShaderStats(void) const {
+
+    std::cout << "Shaders: " << shader_count_ << " programs loaded (" << shader_cache_hits_ << " from cache) in " <<
+        shader_load_time_ * 1000.0 << " ms" << std::endl;
+}
+
+
+void ResourceManager::PrintTextureStats(void) const {
+
+    std::cout << "Textures: " << texture_count_ << " loaded (" << texture_cache_hits_ << " from cache) in " <<
+        texture_load_time_ * 1000.0 << " ms, " << texture_bytes_ / (1024.0 * 1024.0) << " MB resident (" <<
+        texture_uncompressed_bytes_ / (1024.0 * 1024.0) << " MB as RGBA8)" << std::endl;
+}
+
+
+void ResourceManager::PrintMeshStats(void) const {
+
+    for (size_t i = 0; i < mesh_stats_.size(); i++) {
+        const MeshStats& stats = mesh_stats_[i].second;
+        std::cout << "Mesh " << mesh_stats_[i].first << ": " <<
+            stats.source_vertex_count << " -> " << stats.vertex_count << " vertices, ACMR " <<
+            stats.source_acmr << " -> " << stats.acmr << std::endl;
+    }
 }
 
 
@@ -640,35 +593,14 @@ std::string ResourceManager::LoadTextFile(const char *filename){
 void ResourceManager::CreateCylinder(std::string object_name, float height, float circle_radius, int num_height_samples, int num_circle_samples) {
 
     // Create a cylinder
-
-    // Number of vertices and faces to be created
-    const GLuint vertex_num = num_height_samples * num_circle_samples + 2; // plus two for top and bottom
-    const GLuint face_num = num_height_samples * (num_circle_samples - 1) * 2 + 2 * num_circle_samples; // two extra rings worth for top and bottom
-
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;  // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-    const int face_att = 3; // Vertex indices (3)
-
-    // Data buffers for the shape
-    GLfloat* vertex = NULL;
-    GLuint* face = NULL;
-
-    GLuint vbo, ebo;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att];
-        face = new GLuint[face_num * face_att];
-    }
-    catch (std::exception& e) {
-        throw e;
-    }
+    MeshBuilder builder;
+    builder.Reserve(num_height_samples * num_circle_samples + 2, // plus two for top and bottom
+                    (num_height_samples - 1) * num_circle_samples * 2 + 2 * num_circle_samples); // two extra rings worth for top and bottom
 
     // Create vertices 
     double theta; // Angle for circle
     double h; // height
     float s, t; // parameters zero to one
-    glm::vec3 loop_center;
     glm::vec3 vertex_position;
     glm::vec3 vertex_normal;
     glm::vec3 vertex_color;
@@ -690,46 +622,22 @@ void ResourceManager::CreateCylinder(std::string object_name, float height, floa
                 s);
             vertex_coord = glm::vec2(s, t);
 
-            // Add vectors to the data buffer
-            for (int k = 0; k < 3; k++) {
-                vertex[(i * num_circle_samples + j) * vertex_att + k] = vertex_position[k];
-                vertex[(i * num_circle_samples + j) * vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i * num_circle_samples + j) * vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i * num_circle_samples + j) * vertex_att + 9] = vertex_coord[0];
-            vertex[(i * num_circle_samples + j) * vertex_att + 10] = vertex_coord[1];
+            builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
         }
     }
 
-    int topvertex = num_circle_samples * num_height_samples;
-    int bottomvertex = num_circle_samples * num_height_samples + 1; // indices for top and bottom vertex
-
     vertex_position = glm::vec3(0, height * (num_height_samples - 1) / (float)num_height_samples - height * 0.5, 0); // location of top middle of cylinder
     vertex_normal = glm::vec3(0, 1, 0);
     vertex_color = glm::vec3(1, 0.6, 0.4);
     vertex_coord = glm::vec2(0, 0); // no good way to texture top and bottom
-
-    for (int k = 0; k < 3; k++) {
-        vertex[topvertex * vertex_att + k] = vertex_position[k];
-        vertex[topvertex * vertex_att + k + 3] = vertex_normal[k];
-        vertex[topvertex * vertex_att + k + 6] = vertex_color[k];
-    }
-    vertex[(topvertex)*vertex_att + 9] = vertex_coord[0];
-    vertex[(topvertex)*vertex_att + 10] = vertex_coord[1];
+    GLuint topvertex = builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
 
     //================== bottom vertex
 
     vertex_position = glm::vec3(0, -0.5 * height, 0); // location of top middle of cylinder
     vertex_normal = glm::vec3(0, -1, 0);
     // leave the color and uv alone
-
-    for (int k = 0; k < 3; k++) {
-        vertex[bottomvertex * vertex_att + k] = vertex_position[k];
-        vertex[bottomvertex * vertex_att + k + 3] = vertex_normal[k];
-        vertex[bottomvertex * vertex_att + k + 6] = vertex_color[k];
-    }
-    vertex[(bottomvertex)*vertex_att + 9] = vertex_coord[0];
-    vertex[(bottomvertex)*vertex_att + 10] = vertex_coord[1];
+    GLuint bottomvertex = builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
 
     //===================== end of vertices
 
@@ -737,62 +645,32 @@ void ResourceManager::CreateCylinder(std::string object_name, float height, floa
     for (int i = 0; i < num_height_samples - 1; i++) {
         for (int j = 0; j < num_circle_samples; j++) {
             // Two triangles per quad
-            glm::vec3 t1(((i + 1) % num_height_samples) * num_circle_samples + j,
+            builder.AddTriangle(((i + 1) % num_height_samples) * num_circle_samples + j,
                 i * num_circle_samples + ((j + 1) % num_circle_samples),
                 i * num_circle_samples + j);
-            glm::vec3 t2(((i + 1) % num_height_samples) * num_circle_samples + j,
+            builder.AddTriangle(((i + 1) % num_height_samples) * num_circle_samples + j,
                 ((i + 1) % num_height_samples) * num_circle_samples + ((j + 1) % num_circle_samples),
                 i * num_circle_samples + ((j + 1) % num_circle_samples));
-            // Add two triangles to the data buffer
-            for (int k = 0; k < 3; k++) {
-                face[(i * num_circle_samples + j) * face_att * 2 + k] = (GLuint)t1[k];
-                face[(i * num_circle_samples + j) * face_att * 2 + k + face_att] = (GLuint)t2[k];
-            }
         }
     }
-    int cylbodysize = num_circle_samples * (num_height_samples - 1) * 2; // amount of array filled so far, start adding from here
+
     // triangles for top disc (fan shape)
     int i = num_height_samples - 1;
     for (int j = 0; j < num_circle_samples; j++) {
         // Bunch of wedges pointing to the centre
-        glm::vec3 topwedge(
-            i * num_circle_samples + j,
+        builder.AddTriangle(i * num_circle_samples + j,
             topvertex,
-            i * num_circle_samples + (j + 1) % num_circle_samples
-        );
-
+            i * num_circle_samples + (j + 1) % num_circle_samples);
+    }
+    for (int j = 0; j < num_circle_samples; j++) {
         // note order reversed so that all triangles point outward
-        glm::vec3 botwedge(
-            0 + (j + 1) % num_circle_samples,
+        builder.AddTriangle(0 + (j + 1) % num_circle_samples,
             bottomvertex,
-            0 + j
-        );
-
-        // Add the triangles to the data buffer
-        for (int k = 0; k < 3; k++) {
-            face[(cylbodysize + j) * face_att + k] = (GLuint)topwedge[k];
-            face[(cylbodysize + j + num_circle_samples) * face_att + k] = (GLuint)botwedge[k];
-        }
+            0 + j);
     }
 
-    // Create OpenGL buffer for vertices
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    // Create OpenGL buffer for faces
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete[] vertex;
-    delete[] face;
-
-
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
-
+    AddMesh(object_name, builder);
 }
 
 
@@ -800,36 +678,15 @@ void ResourceManager::CreateCylinder(std::string object_name, float height, floa
 void ResourceManager::CreateCone(std::string object_name, float height, float circle_radius, int num_height_samples, int num_circle_samples) {
 
     // Create a cone (adapted from cylinder code)
-
-    // Number of vertices and faces to be created
-    const GLuint vertex_num = num_height_samples * num_circle_samples + 2; // plus two for top and bottom
-    const GLuint face_num = num_height_samples * (num_circle_samples - 1) * 2 + 2 * num_circle_samples; // two extra rings worth for top and bottom
-
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;  // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-    const int face_att = 3; // Vertex indices (3)
-
-    // Data buffers for the shape
-    GLfloat* vertex = NULL;
-    GLuint* face = NULL;
-
-    GLuint vbo, ebo;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att];
-        face = new GLuint[face_num * face_att];
-    }
-    catch (std::exception& e) {
-        throw e;
-    }
+    MeshBuilder builder;
+    builder.Reserve(num_height_samples * num_circle_samples + 2, // plus two for top and bottom
+                    (num_height_samples - 1) * num_circle_samples * 2 + 2 * num_circle_samples); // two extra rings worth for top and bottom
 
     // Create vertices 
     double theta; // Angle for circle
     float local_radius; // radius of this spot on the cone
     double h; // height
     float s, t; // parameters zero to one
-    glm::vec3 loop_center;
     glm::vec3 vertex_position;
     glm::vec3 vertex_normal;
     glm::vec3 vertex_color;
@@ -852,46 +709,22 @@ void ResourceManager::CreateCone(std::string object_name, float height, float ci
                 s);
             vertex_coord = glm::vec2(s, t);
 
-            // Add vectors to the data buffer
-            for (int k = 0; k < 3; k++) {
-                vertex[(i * num_circle_samples + j) * vertex_att + k] = vertex_position[k];
-                vertex[(i * num_circle_samples + j) * vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i * num_circle_samples + j) * vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i * num_circle_samples + j) * vertex_att + 9] = vertex_coord[0];
-            vertex[(i * num_circle_samples + j) * vertex_att + 10] = vertex_coord[1];
+            builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
         }
     }
 
-    int topvertex = num_circle_samples * num_height_samples;
-    int bottomvertex = num_circle_samples * num_height_samples + 1; // indices for top and bottom vertex
-
     vertex_position = glm::vec3(0, height * (num_height_samples) / (float)num_height_samples - height * 0.5, 0); // location of tip
     vertex_normal = glm::vec3(0, 1, 0);
     vertex_color = glm::vec3(1, 0.6, 0.4);
     vertex_coord = glm::vec2(0, 0); // no good way to texture top and bottom
-
-    for (int k = 0; k < 3; k++) {
-        vertex[topvertex * vertex_att + k] = vertex_position[k];
-        vertex[topvertex * vertex_att + k + 3] = vertex_normal[k];
-        vertex[topvertex * vertex_att + k + 6] = vertex_color[k];
-    }
-    vertex[(topvertex)*vertex_att + 9] = vertex_coord[0];
-    vertex[(topvertex)*vertex_att + 10] = vertex_coord[1];
+    GLuint topvertex = builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
 
     //================== bottom vertex
 
     vertex_position = glm::vec3(0, -0.5 * height, 0); // location of middle of base of cone
     vertex_normal = glm::vec3(0, -1, 0);
     // leave the color and uv alone
-
-    for (int k = 0; k < 3; k++) {
-        vertex[bottomvertex * vertex_att + k] = vertex_position[k];
-        vertex[bottomvertex * vertex_att + k + 3] = vertex_normal[k];
-        vertex[bottomvertex * vertex_att + k + 6] = vertex_color[k];
-    }
-    vertex[(bottomvertex)*vertex_att + 9] = vertex_coord[0];
-    vertex[(bottomvertex)*vertex_att + 10] = vertex_coord[1];
+    GLuint bottomvertex = builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
 
     //===================== end of vertices
 
@@ -899,91 +732,40 @@ void ResourceManager::CreateCone(std::string object_name, float height, float ci
     for (int i = 0; i < num_height_samples - 1; i++) {
         for (int j = 0; j < num_circle_samples; j++) {
             // Two triangles per quad
-            glm::vec3 t1(((i + 1) % num_height_samples) * num_circle_samples + j,
+            builder.AddTriangle(((i + 1) % num_height_samples) * num_circle_samples + j,
                 i * num_circle_samples + ((j + 1) % num_circle_samples),
                 i * num_circle_samples + j);
-            glm::vec3 t2(((i + 1) % num_height_samples) * num_circle_samples + j,
+            builder.AddTriangle(((i + 1) % num_height_samples) * num_circle_samples + j,
                 ((i + 1) % num_height_samples) * num_circle_samples + ((j + 1) % num_circle_samples),
                 i * num_circle_samples + ((j + 1) % num_circle_samples));
-            // Add two triangles to the data buffer
-            for (int k = 0; k < 3; k++) {
-                face[(i * num_circle_samples + j) * face_att * 2 + k] = (GLuint)t1[k];
-                face[(i * num_circle_samples + j) * face_att * 2 + k + face_att] = (GLuint)t2[k];
-            }
         }
     }
-    int cylbodysize = num_circle_samples * (num_height_samples - 1) * 2; // amount of array filled so far, start adding from here
+
     // triangles for top disc (fan shape)
     int i = num_height_samples - 1;
     for (int j = 0; j < num_circle_samples; j++) {
         // Bunch of wedges pointing to the centre
-        glm::vec3 topwedge(
-            i * num_circle_samples + j,
+        builder.AddTriangle(i * num_circle_samples + j,
             topvertex,
-            i * num_circle_samples + (j + 1) % num_circle_samples
-        );
-
+            i * num_circle_samples + (j + 1) % num_circle_samples);
+    }
+    for (int j = 0; j < num_circle_samples; j++) {
         // note order reversed so that all triangles point outward
-        glm::vec3 botwedge(
-            0 + (j + 1) % num_circle_samples,
+        builder.AddTriangle(0 + (j + 1) % num_circle_samples,
             bottomvertex,
-            0 + j
-        );
-
-        // Add the triangles to the data buffer
-        for (int k = 0; k < 3; k++) {
-            face[(cylbodysize + j) * face_att + k] = (GLuint)topwedge[k];
-            face[(cylbodysize + j + num_circle_samples) * face_att + k] = (GLuint)botwedge[k];
-        }
+            0 + j);
     }
 
-    // Create OpenGL buffer for vertices
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    // Create OpenGL buffer for faces
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete[] vertex;
-    delete[] face;
-
-
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
-
+    AddMesh(object_name, builder);
 }
 
 void ResourceManager::CreateTorus(std::string object_name, float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples){
 
     // Create a torus
     // The torus is built from a large loop with small circles around the loop
-
-    // Number of vertices and faces to be created
-    // Check the construction algorithm below to understand the numbers
-    // specified below
-    const GLuint vertex_num = num_loop_samples*num_circle_samples;
-    const GLuint face_num = num_loop_samples*num_circle_samples*2;
-
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Data buffers for the torus
-    GLfloat *vertex = NULL;
-    GLuint *face = NULL;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch  (std::exception &e){
-        throw e;
-    }
+    MeshBuilder builder;
+    builder.Reserve(num_loop_samples*num_circle_samples, num_loop_samples*num_circle_samples*2);
 
     // Create vertices 
     double theta, phi; // Angles for circles
@@ -1011,14 +793,7 @@ void ResourceManager::CreateTorus(std::string object_name, float loop_radius, fl
             vertex_coord = glm::vec2(theta / (2.0*glm::pi<GLfloat>()),
                                      phi / (2.0*glm::pi<GLfloat>()));
 
-            // Add vectors to the data buffer
-            for (int k = 0; k < 3; k++){
-                vertex[(i*num_circle_samples+j)*vertex_att + k] = vertex_position[k];
-                vertex[(i*num_circle_samples+j)*vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i*num_circle_samples+j)*vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i*num_circle_samples+j)*vertex_att + 9] = vertex_coord[0];
-            vertex[(i*num_circle_samples+j)*vertex_att + 10] = vertex_coord[1];
+            builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
         }
     }
 
@@ -1026,67 +801,25 @@ void ResourceManager::CreateTorus(std::string object_name, float loop_radius, fl
     for (int i = 0; i < num_loop_samples; i++){
         for (int j = 0; j < num_circle_samples; j++){
             // Two triangles per quad
-            glm::vec3 t1(((i + 1) % num_loop_samples)*num_circle_samples + j, 
-                         i*num_circle_samples + ((j + 1) % num_circle_samples),
-                         i*num_circle_samples + j);    
-            glm::vec3 t2(((i + 1) % num_loop_samples)*num_circle_samples + j,
-                         ((i + 1) % num_loop_samples)*num_circle_samples + ((j + 1) % num_circle_samples),
-                         i*num_circle_samples + ((j + 1) % num_circle_samples));
-            // Add two triangles to the data buffer
-            for (int k = 0; k < 3; k++){
-                face[(i*num_circle_samples+j)*face_att*2 + k] = (GLuint) t1[k];
-                face[(i*num_circle_samples+j)*face_att*2 + k + face_att] = (GLuint) t2[k];
-            }
+            builder.AddTriangle(((i + 1) % num_loop_samples)*num_circle_samples + j, 
+                                i*num_circle_samples + ((j + 1) % num_circle_samples),
+                                i*num_circle_samples + j);    
+            builder.AddTriangle(((i + 1) % num_loop_samples)*num_circle_samples + j,
+                                ((i + 1) % num_loop_samples)*num_circle_samples + ((j + 1) % num_circle_samples),
+                                i*num_circle_samples + ((j + 1) % num_circle_samples));
         }
     }
 
-    // Create OpenGL buffers and copy data
-    //GLuint vao;
-    //glGenVertexArrays(1, &vao);
-    //glBindVertexArray(vao);
-
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete [] vertex;
-    delete [] face;
-
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    AddMesh(object_name, builder);
 }
 
 
 void ResourceManager::CreateSphere(std::string object_name, float radius, int num_samples_theta, int num_samples_phi){
 
     // Create a sphere using a well-known parameterization
-
-    // Number of vertices and faces to be created
-    const GLuint vertex_num = num_samples_theta*num_samples_phi;
-    const GLuint face_num = num_samples_theta*(num_samples_phi-1)*2;
-
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Data buffers 
-    GLfloat *vertex = NULL;
-    GLuint *face = NULL;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch  (std::exception &e){
-        throw e;
-    }
+    MeshBuilder builder;
+    builder.Reserve(num_samples_theta*num_samples_phi, num_samples_theta*(num_samples_phi-1)*2);
 
     // Create vertices 
     double theta, phi; // Angles for parametric equation
@@ -1113,14 +846,7 @@ void ResourceManager::CreateSphere(std::string object_name, float radius, int nu
             vertex_color = glm::vec3(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi), ((float)j)/((float)num_samples_phi));
             vertex_coord = glm::vec2(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi));
 
-            // Add vectors to the data buffer
-            for (int k = 0; k < 3; k++){
-                vertex[(i*num_samples_phi+j)*vertex_att + k] = vertex_position[k];
-                vertex[(i*num_samples_phi+j)*vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i*num_samples_phi+j)*vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i*num_samples_phi+j)*vertex_att + 9] = vertex_coord[0];
-            vertex[(i*num_samples_phi+j)*vertex_att + 10] = vertex_coord[1];
+            builder.AddVertex(vertex_position, vertex_normal, vertex_color, vertex_coord);
         }
     }
 
@@ -1128,226 +854,98 @@ void ResourceManager::CreateSphere(std::string object_name, float radius, int nu
     for (int i = 0; i < num_samples_theta; i++){
         for (int j = 0; j < (num_samples_phi-1); j++){
             // Two triangles per quad
-            glm::vec3 t1(((i + 1) % num_samples_theta)*num_samples_phi + j, 
-                         i*num_samples_phi + (j + 1),
-                         i*num_samples_phi + j);
-            glm::vec3 t2(((i + 1) % num_samples_theta)*num_samples_phi + j, 
-                         ((i + 1) % num_samples_theta)*num_samples_phi + (j + 1), 
-                         i*num_samples_phi + (j + 1));
-            // Add two triangles to the data buffer
-            for (int k = 0; k < 3; k++){
-                face[(i*(num_samples_phi-1)+j)*face_att*2 + k] = (GLuint) t1[k];
-                face[(i*(num_samples_phi-1)+j)*face_att*2 + k + face_att] = (GLuint) t2[k];
-            }
+            builder.AddTriangle(((i + 1) % num_samples_theta)*num_samples_phi + j, 
+                                i*num_samples_phi + (j + 1),
+                                i*num_samples_phi + j);
+            builder.AddTriangle(((i + 1) % num_samples_theta)*num_samples_phi + j, 
+                                ((i + 1) % num_samples_theta)*num_samples_phi + (j + 1), 
+                                i*num_samples_phi + (j + 1));
         }
     }
 
-    // Create OpenGL buffers and copy data
-    //GLuint vao;
-    //glGenVertexArrays(1, &vao);
-    //glBindVertexArray(vao);
-
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete [] vertex;
-    delete [] face;
-
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    AddMesh(object_name, builder);
 }
 
 
 void ResourceManager::CreateVertex(std::string object_name) {
     // Create a singular, invisible vertex
-
-    // Number of vertices and faces to be created
-    const GLuint vertex_num = 1;
-    const GLuint face_num = 0;
-
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Data buffers 
-    GLfloat* vertex = NULL;
-    GLuint* face = NULL;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch (std::exception& e) {
-        throw e;
-    }
-
-    // Create vertex
-    glm::vec3 pos = glm::vec3(0, 0, 0);
-    glm::vec3 norm = glm::vec3(0, 1, 0);
-    glm::vec3 color = glm::vec3(1, 1, 1);
-
-    for (int i = 0; i < 3; ++i) {
-        vertex[i] = pos[i];
-        vertex[i + 3] = norm[i];
-        vertex[i + 6] = color[i];
-    }
-    vertex[9] = 0;
-    vertex[10] = 0;
-
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete[] vertex;
-    delete[] face;
+    MeshBuilder builder;
+    builder.AddVertex(glm::vec3(0, 0, 0), glm::vec3(0, 1, 0), glm::vec3(1, 1, 1), glm::vec2(0, 0));
 
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    AddMesh(object_name, builder);
 }
 
 
 void ResourceManager::CreateWall(std::string object_name, glm::vec3 color) {
 
-    GLfloat vertex[] = {
-        // Position, normal, color, texture coordinates
-        // Here, color stores the tangent of the vertex
-        -1.0, -1.0, 0.0,  0.0, -1.0,  0.0,  color[0], color[1], color[2],  0.0, 0.0,
-        -1.0,  1.0, 0.0,  0.0, -1.0,  0.0,  color[0], color[1], color[2],  0.0, 1.0,
-         1.0,  1.0, 0.0,  0.0, -1.0,  0.0,  color[0], color[1], color[2],  1.0, 1.0,
-         1.0, -1.0, 0.0,  0.0, -1.0,  0.0,  color[0], color[1], color[2],  1.0, 0.0 };
-    GLuint face[] = { 0, 2, 1,
-                     0, 3, 2 };
-
-    // Create OpenGL buffers and copy data
-    GLuint vbo, ebo;
-
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, 4 * 11 * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 2 * 3 * sizeof(GLuint), face, GL_STATIC_DRAW);
+    // Here, color stores the tangent of the vertex
+    MeshBuilder builder;
+    builder.Reserve(4, 2);
+    builder.AddVertex(glm::vec3(-1.0, -1.0, 0.0), glm::vec3(0.0, -1.0, 0.0), color, glm::vec2(0.0, 0.0));
+    builder.AddVertex(glm::vec3(-1.0,  1.0, 0.0), glm::vec3(0.0, -1.0, 0.0), color, glm::vec2(0.0, 1.0));
+    builder.AddVertex(glm::vec3( 1.0,  1.0, 0.0), glm::vec3(0.0, -1.0, 0.0), color, glm::vec2(1.0, 1.0));
+    builder.AddVertex(glm::vec3( 1.0, -1.0, 0.0), glm::vec3(0.0, -1.0, 0.0), color, glm::vec2(1.0, 0.0));
+    builder.AddTriangle(0, 2, 1);
+    builder.AddTriangle(0, 3, 2);
 
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, 2 * 3);
+    AddMesh(object_name, builder);
 }
 
 
 void ResourceManager::CreatePlane(std::string object_name, int repeatsX) {
-    const GLuint vertex_num = 4;
-    const GLuint face_num = 2;
-
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Data buffers 
-    GLfloat* vertex = NULL;
-    GLuint* face = NULL;
+    const glm::vec3 corners[4] = {
+        glm::vec3(-1, 0, -1),
+        glm::vec3(-1, 0, 1),
+        glm::vec3(1, 0, 1),
+        glm::vec3(1, 0, -1)
+    };
 
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch (std::exception& e) {
-        throw e;
-    }
+    MeshBuilder builder;
+    builder.Reserve(4, 2);
 
     // Create vertices
     for (int i = 0; i < 4; ++i) {
-        glm::vec3 pos;
-
-        switch (i)
-        {
-        case 0:
-            pos = glm::vec3(-1, 0, -1);
-            break;
-        case 1:
-            pos = glm::vec3(-1, 0, 1);
-            break;
-        case 2:
-            pos = glm::vec3(1, 0, 1);
-			break;
-		case 3:
-			pos = glm::vec3(1, 0, -1);
-			break;
-        default:
-            break;
-        }
-
+        glm::vec3 pos = corners[i];
         glm::vec3 norm = glm::vec3(0, -1, 0);
         glm::vec3 color = glm::vec3(1, 1, 1);
+        glm::vec2 uv = glm::vec2(pos.x / 2 * repeatsX + 0.5f, pos.z / 2 + 0.5f);
 
-        for (int j = 0; j < 3; ++j) {
-            vertex[i * vertex_att + j] = pos[j];
-            vertex[i * vertex_att + j + 3] = norm[j];
-            vertex[i * vertex_att + j + 6] = color[j];
-        }
-        // uv
-        vertex[i * vertex_att + 9] = pos.x / 2 * repeatsX + 0.5f;
-        vertex[i * vertex_att + 10] = pos.z / 2 + 0.5f;
+        builder.AddVertex(pos, norm, color, uv);
     }
 
     // Create triangles
-    glm::vec3 t1(0, 1, 2);
-    glm::vec3 t2(0, 2, 3);
-
-    for (int k = 0; k < 3; k++) {
-		face[k] = (GLuint)t1[k];
-		face[k + face_att] = (GLuint)t2[k];
-	}
-
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete[] vertex;
-    delete[] face;
+    builder.AddTriangle(0, 1, 2);
+    builder.AddTriangle(0, 2, 3);
 
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    AddMesh(object_name, builder);
 }
 
 
 void ResourceManager::LoadTexture(const std::string name, const char* filename) {
 
-    // Load texture from file
-    GLuint texture = SOIL_load_OGL_texture(filename, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID, 0);
-    if (!texture) {
-        throw(std::ios_base::failure(std::string("Error loading texture ") + std::string(filename) + std::string(": ") + std::string(SOIL_last_result())));
-    }
+    double start_time = glfwGetTime();
 
-    glBindTexture(GL_TEXTURE_2D, texture); // First texture we bind
-    // Define texture interpolation
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Use the converted texture if the source image did not change,
+    // otherwise decode and convert the image
+    uint64_t source_hash = TextureCache::HashFile(filename);
+    std::string cache_path = TextureCache::GetCachePath(source_hash);
+    GLuint texture;
+    size_t bytes, uncompressed_bytes;
+    if (TextureCache::Load(cache_path, source_hash, texture, bytes, uncompressed_bytes)) {
+        texture_cache_hits_++;
+    }
+    else {
+        texture = TextureCache::Bake(filename, cache_path, source_hash, bytes, uncompressed_bytes);
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    texture_count_++;
+    texture_load_time_ += glfwGetTime() - start_time;
+    texture_bytes_ += bytes;
+    texture_uncompressed_bytes_ += uncompressed_bytes;
 
     // Create resource
     AddResource(Texture, name, texture, 0);
@@ -1399,7 +997,14 @@ void ResourceManager::LoadSkyboxTexture(const std::string name, const char* file
 
 void ResourceManager::LoadMesh(const std::string name, const char* filename) {
 
-    // First load model into memory. If that goes well, we transfer the
+    // Use the baked mesh if the source file did not change
+    uint64_t source_hash = MeshCache::HashFiles(std::vector<std::string>(1, filename));
+    std::string cache_path = MeshCache::GetCachePath(source_hash);
+    if (LoadCachedMesh(name, cache_path, source_hash)) {
+        return;
+    }
+
+    // Otherwise, load model into memory. If that goes well, we transfer the
     // mesh to an OpenGL buffer
     TriMesh mesh;
 
@@ -1587,70 +1192,63 @@ void ResourceManager::LoadMesh(const std::string name, const char* filename) {
 
     // If we got to this point, the file was parsed successfully and the
     // mesh is in memory
-    // Now, transfer the mesh to OpenGL buffers
+    // Now, stage the mesh in CPU memory and transfer it to OpenGL buffers
+    // in one upload per buffer
     // Create three new vertices for each face, in case vertex
     // normals/texture coordinates are not consistent over the mesh
+    MeshBuilder builder;
+    builder.Reserve(mesh.face.size() * 3, mesh.face.size());
 
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Create OpenGL buffers and copy data
-    GLuint vbo, ebo;
-
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh.face.size() * 3 * vertex_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.face.size() * face_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
-
-    unsigned int vertex_index = 0;
     for (unsigned int i = 0; i < mesh.face.size(); i++) {
         // Add three vertices and their attributes
-        GLfloat att[3 * vertex_att] = { 0 };
+        GLuint findex[3];
         for (int j = 0; j < 3; j++) {
             // Position
-            att[j * vertex_att + 0] = mesh.position[mesh.face[i].i[j]][0];
-            att[j * vertex_att + 1] = mesh.position[mesh.face[i].i[j]][1];
-            att[j * vertex_att + 2] = mesh.position[mesh.face[i].i[j]][2];
+            glm::vec3 position = mesh.position[mesh.face[i].i[j]];
             // Normal
+            glm::vec3 normal(0.0f);
             if (!added_normal) {
-                att[j * vertex_att + 3] = mesh.normal[mesh.face[i].i[j]][0];
-                att[j * vertex_att + 4] = mesh.normal[mesh.face[i].i[j]][1];
-                att[j * vertex_att + 5] = mesh.normal[mesh.face[i].i[j]][2];
+                normal = mesh.normal[mesh.face[i].i[j]];
             }
-            else {
-                if (mesh.face[i].n[j] >= 0) {
-                    att[j * vertex_att + 3] = mesh.normal[mesh.face[i].n[j]][0];
-                    att[j * vertex_att + 4] = mesh.normal[mesh.face[i].n[j]][1];
-                    att[j * vertex_att + 5] = mesh.normal[mesh.face[i].n[j]][2];
-                }
+            else if (mesh.face[i].n[j] >= 0) {
+                normal = mesh.normal[mesh.face[i].n[j]];
             }
-            // No color in (6, 7, 8)
+            // No color
             // Texture coordinates
+            glm::vec2 uv(0.0f);
             if (mesh.face[i].t[j] >= 0) {
-                att[j * vertex_att + 9] = mesh.tex_coord[mesh.face[i].t[j]][0];
-                att[j * vertex_att + 10] = mesh.tex_coord[mesh.face[i].t[j]][1];
+                uv = mesh.tex_coord[mesh.face[i].t[j]];
             }
-        }
 
-        // Copy attributes to buffer
-        glBufferSubData(GL_ARRAY_BUFFER, i * 3 * vertex_att * sizeof(GLfloat), 3 * vertex_att * sizeof(GLfloat), att);
+            findex[j] = builder.AddVertex(position, normal, glm::vec3(0.0f), uv);
+        }
 
         // Add triangle
-        GLuint findex[face_att] = { 0 };
-        findex[0] = vertex_index;
-        findex[1] = vertex_index + 1;
-        findex[2] = vertex_index + 2;
-        vertex_index += 3;
+        builder.AddTriangle(findex[0], findex[1], findex[2]);
+    }
+
+    ProcessMesh(name, builder, cache_path, source_hash);
+}
+
+
+void ResourceManager::ProcessMesh(const std::string name, MeshBuilder& builder, const std::string& cache_path, uint64_t source_hash) {
+
+    // Weld the duplicated vertices back together and reorder the mesh
+    // for the vertex cache, overdraw and vertex fetch
+    MeshStats stats = MeshOptimizer::Optimize(builder);
+    mesh_stats_.push_back(std::make_pair(name, stats));
 
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, i * face_att * sizeof(GLuint), face_att * sizeof(GLuint), findex);
+    // Store loaded models in the compact vertex format, unless their
+    // coordinates are too large for half precision or they have colors
+    if (CompactVertex::Fits(builder.GetVertices())) {
+        builder.SetVertexFormat(CompactFormat);
     }
 
+    // Bake the processed mesh for the next runs
+    MeshCache::Store(cache_path, source_hash, builder, stats);
+
     // Create resource
-    AddResource(Mesh, name, vbo, ebo, mesh.face.size() * face_att);
+    AddMesh(name, builder);
 }
 
 
@@ -1659,19 +1257,9 @@ void ResourceManager::CreateSphereParticles(std::string object_name, int num_par
     // Create a set of points which will be the particles
     // This is similar to drawing a sphere: we will sample points on a sphere, but will allow them to also deviate a bit from the sphere along the normal (change of radius)
 
-    // Data buffer
-    GLfloat* particle = NULL;
-
-    // Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-    const int particle_att = 11;
-
-    // Allocate memory for buffer
-    try {
-        particle = new GLfloat[num_particles * particle_att];
-    }
-    catch (std::exception& e) {
-        throw e;
-    }
+    // Staging buffer: one vertex per particle
+    MeshBuilder builder;
+    builder.Reserve(num_particles, 0);
 
     float trad = 0.2f; // Defines the starting point of the particles along the normal
     float maxspray = 1.0f; // This is how much we allow the points to deviate from the sphere
@@ -1698,27 +1286,108 @@ void ResourceManager::CreateSphereParticles(std::string object_name, int num_par
         glm::vec3 color(i / (float)num_particles, 0.0, 1.0 - (i / (float)num_particles)); // We can use the color for debug, if needed
 
         // Add vectors to the data buffer
-        for (int k = 0; k < 3; k++) {
-            particle[i * particle_att + k] = position[k];
-            particle[i * particle_att + k + 3] = normal[k];
-            particle[i * particle_att + k + 6] = color[k];
-        }
+        builder.AddVertex(position, normal, color, glm::vec2(0.0f));
     }
 
     // Create OpenGL buffer and copy data
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete[] particle;
+    GLuint vbo = builder.UploadVertices();
 
     // Create resource
     AddResource(PointSet, object_name, vbo, 0, num_particles);
 }
 
 
+void ResourceManager::CreateTextureArray(std::string object_name, const std::vector<std::string>& texture_names, GLsizei size) {
+
+    Resource* copy_material = GetResource("TextureLayerMaterial");
+    if (!copy_material) {
+        throw(std::invalid_argument(std::string("TextureLayerMaterial must be loaded before creating texture arrays")));
+    }
+    GLsizei layers = static_cast<GLsizei>(texture_names.size());
+
+    // Allocate every level of the array
+    int level_count = 1;
+    while ((size >> level_count) > 0) {
+        level_count++;
+    }
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    for (int level = 0; level < level_count; level++) {
+        GLsizei level_size = std::max(size >> level, 1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, level_size, level_size, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    // Render each texture into its layer; sampling on the GPU resamples
+    // textures of any size and decodes compressed formats
+    GLint previous_framebuffer;
+    GLint viewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    GLuint framebuffer, vao;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    GLuint program = copy_material->GetResource();
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "texture_map"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glViewport(0, 0, size, size);
+
+    for (GLsizei layer = 0; layer < layers; layer++) {
+        Resource* source = GetResource(texture_names[layer]);
+        if (!source || source->GetType() != Texture) {
+            throw(std::invalid_argument(std::string("Invalid texture for array: ") + texture_names[layer]));
+        }
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, 0, layer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw(std::runtime_error(std::string("Error creating texture array ") + object_name));
+        }
+        glBindTexture(GL_TEXTURE_2D, source->GetResource());
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    // Restore the previous state
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &vao);
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depth_test) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Build the other levels from the first one
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Count the array in the texture statistics, with its mip chain
+    size_t bytes = static_cast<size_t>(size) * size * 4 * layers * 4 / 3;
+    texture_count_++;
+    texture_bytes_ += bytes;
+    texture_uncompressed_bytes_ += bytes;
+
+    // Create resource; the size is the number of layers
+    AddResource(TextureArray, object_name, texture, layers);
+}
+
+
 void string_trim(std::string str, std::string to_trim) {
 
     // Trim any character in to_trim from the beginning of the string str
@@ -1,14 +1,20 @@
 #ifndef RESOURCE_MANAGER_H_
 #define RESOURCE_MANAGER_H_
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "geometry_arena.h"
+#include "mesh_optimizer.h"
 #include "resource.h"
+#include "world_grid.h"
+#include "world_grid_file.h"
 
 // Default extensions for different shader source files
 #define VERTEX_PROGRAM_EXTENSION "_vp.glsl"
@@ -17,6 +23,8 @@
 
 namespace game {
 
+    class MeshBuilder;
+
     // Class that manages all resources
     class ResourceManager {
 
@@ -26,18 +34,36 @@ namespace game {
             ~ResourceManager();
             // Add a resource that was already loaded and allocated to memory
             void AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size);
-            void AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
+            void AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, VertexFormat format = StandardFormat);
+            // Upload a mesh staged in a builder and add it as a resource
+            void AddMesh(const std::string name, const MeshBuilder& builder);
             // Load a resource from a file, according to the specified type
             void LoadResource(ResourceType type, const std::string name, const char *filename);
             void LoadCustomResource(ResourceType type, const std::string name, const char* verticesFilepath, const char* facesFilepath);
-            std::vector<std::vector<float>> LoadTerrainResource(ResourceType type, const std::string name, const char* terrainFilePath);
-            std::vector<std::vector<bool>> ResourceManager::GetImpassableCells(const char* impassableFilePath, std::vector<std::vector<float>> terrain);
-
-            GLuint ParseVertices(const std::string& verticesText);
-            GLuint ParseFaces(const std::string& facesText, GLsizei& faceSize);
+            // Load a vertex program whose outputs 'varyings' are captured
+            // with transform feedback, in that order and interleaved; it has
+            // no fragment program
+            void LoadFeedbackProgram(const std::string name, const char* prefix, const std::vector<std::string>& varyings);
+            // Map the binary world grid of a text heightfield and passability
+            // csv, converting them first if they changed
+            void LoadWorldGrid(WorldGridFile& grid, const char* heightfieldFilePath, const char* impassableFilePath);
+            // Pass the terrain heights of a world grid on to 'world', with
+            // the road and the river flattened
+            void LoadTerrainHeights(const WorldGridFile& grid, WorldGrid& world);
+
+            void ParseVertices(const std::string& verticesText, MeshBuilder& builder);
+            void ParseFaces(const std::string& facesText, MeshBuilder& builder);
             // Get the resource with the specified name
             Resource *GetResource(const std::string name) const;
 
+            // Print the time spent loading textures and their memory use
+            void PrintTextureStats(void) const;
+            // Print the time spent loading shader programs
+            void PrintShaderStats(void) const;
+            // Print the vertex count and ACMR of each loaded model before
+            // and after the mesh optimizer
+            void PrintMeshStats(void) const;
+
             // Methods to create specific resources
             // Create the geometry for a torus and add it to the list of resources
             void CreateTorus(std::string object_name, float loop_radius = 0.6, float circle_radius = 0.2, int num_loop_samples = 90, int num_circle_samples = 30);
@@ -55,15 +81,21 @@ namespace game {
             // Taken from assignment 7, wall is used for river and road geometry
             void CreateWall(std::string object_name, glm::vec3 color);
 
-            // Creates particles for some insects
-            void CreateInsectParticles(std::string object_name, int num_particles);
-
             // Create a plane, used for UI
             void CreatePlane(std::string object_name, int repeatsX = 1);
 
             // Create particles distributed over a sphere
             void CreateSphereParticles(std::string object_name, int num_particles = 20000);
 
+            // Create a 2D texture array with one layer per texture, all
+            // resampled to size x size. Requires the "TextureLayerMaterial"
+            // material to be loaded
+            void CreateTextureArray(std::string object_name, const std::vector<std::string>& texture_names, GLsizei size = 1024);
+
+            // Shared buffers that meshes are copied into to be drawn
+            // together, such as by static batches
+            GeometryArena* GetGeometryArena(void);
+
             static const float *GetSkyboxVertices();
             static void GenerateSkybox();
             static GLuint GetSkyboxVBO();
@@ -79,10 +111,27 @@ namespace game {
 
             // List storing all resources
             std::vector<Resource*> resource_; 
+
+            GeometryArena geometry_arena_;
+
+            // Texture loading statistics
+            int texture_count_;
+            int texture_cache_hits_;
+            double texture_load_time_; // Seconds
+            size_t texture_bytes_;
+            size_t texture_uncompressed_bytes_;
+
+            // Shader program loading statistics
+            int shader_count_;
+            int shader_cache_hits_;
+            double shader_load_time_; // Seconds
+
+            // Optimizer statistics of the loaded models, by name
+            std::vector<std::pair<std::string, MeshStats> > mesh_stats_;
  
             // Methods to load specific types of resources
             // Load shaders programs
-            void LoadMaterial(const std::string name, const char *prefix, ResourceType type);
+            void LoadMaterial(const std::string name, const char *prefix, ResourceType type, const std::vector<std::string>& varyings = std::vector<std::string>());
             // Load a text file into memory (could be source code)
             std::string LoadTextFile(const char *filename);
             // Load a texture from an image file: png, jpg, etc.
@@ -90,6 +139,11 @@ namespace game {
             void LoadSkyboxTexture(const std::string name, const char* filename);
             // Loads a mesh in obj format
             void LoadMesh(const std::string name, const char* filename);
+            // Add a mesh from the baked mesh cache; false if there is no valid entry
+            bool LoadCachedMesh(const std::string name, const std::string& cache_path, uint64_t source_hash);
+            // Optimize a mesh parsed from its source files, choose its vertex
+            // format, bake it to the cache and add it
+            void ProcessMesh(const std::string name, MeshBuilder& builder, const std::string& cache_path, uint64_t source_hash);
 
     }; // class ResourceManager
 
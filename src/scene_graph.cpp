@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
@@ -7,7 +8,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "scene_graph.h"
-#include "ghost.h"
+#include "gl_state.h"
+#include "material_instance.h"
 
 namespace game {
 
@@ -23,6 +25,21 @@ namespace game {
     SceneGraph::SceneGraph(void) {
 
         background_color_ = glm::vec3(0.0, 0.0, 0.0);
+        transparency_frame_buffer_ = 0;
+        composite_program_ = 0;
+        for (int i = 0; i < RenderLayerCount; i++) {
+            depth_program_[i] = 0;
+        }
+        for (int i = 0; i < timer_frames; i++) {
+            for (int j = 0; j < RenderPassCount; j++) {
+                timer_queries_[i][j] = 0;
+                timer_issued_[i][j] = false;
+            }
+        }
+        timer_frame_ = 0;
+        for (int i = 0; i < RenderPassCount; i++) {
+            pass_time_[i] = 0.0f;
+        }
     }
 
 
@@ -74,6 +91,12 @@ namespace game {
     }
 
 
+    void SceneGraph::AddNodeFirst(Renderable* node) {
+
+        node_.insert(node_.begin(), node);
+    }
+
+
     SceneNode* SceneGraph::GetNode(const std::string& node_name) const {
 
         // Find node with the specified name
@@ -134,50 +157,57 @@ namespace game {
 
         if (gamePhase == title) {
             GetNode("MainMenu")->Draw(camera);
+            GLState::BindVertexArray(0);
             return;
         }
         else if (gamePhase == gameLost) {
             GetNode("LoseScreen")->Draw(camera);
+            GLState::BindVertexArray(0);
             return;
         }
         else if (gamePhase == gameWon) {
             GetNode("WinScreen")->Draw(camera);
+            GLState::BindVertexArray(0);
             return;
         }
 
-        // Draw all scene nodes
-        for (size_t i = 0; i < node_.size(); i++) {
-            if (node_[i]->GetName() == "skybox") continue;
-            if (node_[i]->GetName() == "MainMenu") continue;
-            if (node_[i]->GetName() == "LoseScreen") continue;
-            if (node_[i]->GetName() == "WinScreen") continue;
-            node_[i]->Draw(camera);
-        }
+        // The transparency pass tests against the depth of the frame
+        // buffer, so draw there and copy the result to the screen
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        DrawToTexture(camera, gamePhase);
 
-        GetNode("skybox")->Draw(camera);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_buffer_);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT,
+            viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+            GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
 
-    void SceneGraph::Update(Camera* camera, double deltaTime, GamePhase gamePhase) {
+    void SceneGraph::Update(GamePhase gamePhase) {
         if (gamePhase == title || gamePhase == gameLost || gamePhase == gameWon) {
 			return; // Don't update anything if in UI
 		}
 
         for (size_t i = 0; i < node_.size(); i++) {
-            // Check if the current node is a Ghost
-            Ghost* ghostNode = dynamic_cast<Ghost*>(node_[i]);
+            node_[i]->Update();
+        }
+    }
 
-            if (ghostNode) {
-                // If it's a Ghost, pass the camera to its Update function
-                ghostNode->Update(camera, static_cast<float>(deltaTime));
-            }
-            else {
-                node_[i]->Update();
-            }
+    GLuint SceneGraph::GetTexture(void) const {
 
-        }
+        return texture_;
+    }
+
+
+    GLuint SceneGraph::GetFrameBuffer(void) const {
+
+        return frame_buffer_;
     }
 
+
     void SceneGraph::SetupDrawToTexture(void) {
 
         // Set up frame buffer
@@ -212,6 +242,9 @@ namespace game {
         // Reset frame buffer
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+        // Timers of the passes drawn into the texture
+        glGenQueries(timer_frames * RenderPassCount, &timer_queries_[0][0]);
+
         // Set up quad for drawing to the screen
         static const GLfloat quad_vertex_data[] = {
             -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
@@ -229,6 +262,231 @@ namespace game {
     }
 
 
+    void SceneGraph::SetupTransparency(GLuint composite_program) {
+
+        composite_program_ = composite_program;
+
+        glGenFramebuffers(1, &transparency_frame_buffer_);
+        glBindFramebuffer(GL_FRAMEBUFFER, transparency_frame_buffer_);
+
+        // Sum of the weighted colors (rgb) and of the weights (a); half
+        // floats so that many overlapping particles do not saturate
+        glGenTextures(1, &accumulation_texture_);
+        glBindTexture(GL_TEXTURE_2D, accumulation_texture_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT, 0, GL_RGBA, GL_HALF_FLOAT, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        // Product of (1 - alpha) of the fragments: how much of the scene
+        // behind them still shows
+        glGenTextures(1, &revealage_texture_);
+        glBindTexture(GL_TEXTURE_2D, revealage_texture_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        // The depth of the opaque nodes hides the fragments behind them
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation_texture_, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealage_texture_, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer_);
+        GLenum DrawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, DrawBuffers);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw(std::ios_base::failure(std::string("Error setting up transparency frame buffer")));
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+
+    void SceneGraph::queueOpaque(void) {
+
+        opaque_queue_.clear();
+        for (size_t i = 0; i < node_.size(); i++) {
+            if (node_[i]->GetName() == "skybox") continue;
+            if (node_[i]->GetName() == "MainMenu") continue;
+            if (node_[i]->GetName() == "LoseScreen") continue;
+            if (node_[i]->GetName() == "WinScreen") continue;
+            if (node_[i]->IsBlended()) continue;
+            opaque_queue_.push_back(node_[i]);
+        }
+
+        // Stable, so nodes of the same material keep the order they were
+        // added in, and the terrain layer still goes first
+        std::stable_sort(opaque_queue_.begin(), opaque_queue_.end(), [](const Renderable* a, const Renderable* b) {
+            if (a->GetLayer() != b->GetLayer()) {
+                return a->GetLayer() < b->GetLayer();
+            }
+            const MaterialInstance* ma = a->GetMaterialInstance();
+            const MaterialInstance* mb = b->GetMaterialInstance();
+            GLuint pa = ma ? ma->GetProgram() : 0;
+            GLuint pb = mb ? mb->GetProgram() : 0;
+            if (pa != pb) {
+                return pa < pb;
+            }
+            return (ma ? ma->GetId() : 0) < (mb ? mb->GetId() : 0);
+        });
+    }
+
+
+    void SceneGraph::drawTransparent(Camera* camera) {
+
+        bool blended = false;
+        for (size_t i = 0; i < node_.size() && !blended; i++) {
+            blended = node_[i]->IsBlended();
+        }
+        if (!blended || !transparency_frame_buffer_) {
+            pass_time_[TransparentPass] = 0.0f;
+            return;
+        }
+
+        beginPass(TransparentPass);
+        glBindFramebuffer(GL_FRAMEBUFFER, transparency_frame_buffer_);
+        static const GLfloat no_accumulation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        static const GLfloat full_revealage[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, no_accumulation);
+        glClearBufferfv(GL_COLOR, 1, full_revealage);
+
+        // Sums and products do not depend on the order of the fragments,
+        // so the nodes are drawn as they come, without sorting
+        GLState::Enable(GL_DEPTH_TEST);
+        GLState::DepthFunc(GL_LESS);
+        GLState::DepthMask(GL_FALSE);
+        GLState::Enable(GL_BLEND);
+        GLState::BlendEquation(GL_FUNC_ADD);
+        GLState::BlendFunci(0, GL_ONE, GL_ONE);
+        GLState::BlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+        for (size_t i = 0; i < node_.size(); i++) {
+            if (node_[i]->IsBlended()) {
+                node_[i]->Draw(camera);
+            }
+        }
+
+        // Composite: average color * (1 - revealage) + scene * revealage
+        glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_);
+        GLState::Disable(GL_DEPTH_TEST);
+        GLState::BlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+        // The quad is set up on the default vertex array
+        GLState::BindVertexArray(0);
+        GLState::BindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
+        GLState::UseProgram(composite_program_);
+
+        GLint pos_att = glGetAttribLocation(composite_program_, "position");
+        glEnableVertexAttribArray(pos_att);
+        glVertexAttribPointer(pos_att, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
+
+        GLint tex_att = glGetAttribLocation(composite_program_, "uv");
+        glEnableVertexAttribArray(tex_att);
+        glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+        glUniform1i(glGetUniformLocation(composite_program_, "accumulation_map"), 0);
+        glUniform1i(glGetUniformLocation(composite_program_, "revealage_map"), 1);
+        GLState::BindTexture(0, GL_TEXTURE_2D, accumulation_texture_);
+        GLState::BindTexture(1, GL_TEXTURE_2D, revealage_texture_);
+
+        glDrawArrays(GL_TRIANGLES, 0, 6); // Quad: 6 coordinates
+
+        GLState::Enable(GL_DEPTH_TEST);
+        GLState::Disable(GL_BLEND);
+        GLState::DepthMask(GL_TRUE);
+        endPass();
+    }
+
+
+    void SceneGraph::SetDepthPrepass(RenderLayer layer, GLuint depth_program) {
+
+        depth_program_[layer] = depth_program;
+    }
+
+
+    bool SceneGraph::HasDepthPrepass(RenderLayer layer) const {
+
+        return depth_program_[layer] != 0;
+    }
+
+
+    void SceneGraph::drawDepth(Camera* camera) {
+
+        bool drawing = false;
+        for (size_t i = 0; i < opaque_queue_.size(); i++) {
+            Renderable* node = opaque_queue_[i];
+            GLuint program = depth_program_[node->GetLayer()];
+            bool prepassed = false;
+            if (program) {
+                if (!drawing) {
+                    // Depth only: the fragment shaders are empty and no
+                    // color is written
+                    beginPass(DepthPass);
+                    GLState::DepthMask(GL_TRUE);
+                    GLState::DepthFunc(GL_LESS);
+                    GLState::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                    drawing = true;
+                }
+                prepassed = node->DrawDepth(camera, program);
+            }
+            node->SetDepthPrepassed(prepassed);
+        }
+
+        if (drawing) {
+            GLState::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            endPass();
+        }
+        else {
+            pass_time_[DepthPass] = 0.0f;
+        }
+    }
+
+
+    void SceneGraph::beginPass(RenderPass pass) {
+
+        GLuint query = timer_queries_[timer_frame_][pass];
+        if (!query) {
+            return;
+        }
+
+        // Take the time of the frame that last used this query, if the
+        // GPU is done with it; otherwise keep the previous time
+        if (timer_issued_[timer_frame_][pass]) {
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 elapsed;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                pass_time_[pass] = elapsed / 1.0e6f;
+            }
+        }
+
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        timer_issued_[timer_frame_][pass] = true;
+    }
+
+
+    void SceneGraph::endPass(void) {
+
+        if (timer_queries_[timer_frame_][0]) {
+            glEndQuery(GL_TIME_ELAPSED);
+        }
+    }
+
+
+    float SceneGraph::GetPassTime(RenderPass pass) const {
+
+        return pass_time_[pass];
+    }
+
+
+    void SceneGraph::PrintPassTimes(void) const {
+
+        std::cout << "GPU time: depth pre-pass " << pass_time_[DepthPass] << " ms, opaque "
+            << pass_time_[OpaquePass] << " ms, transparent " << pass_time_[TransparentPass] << " ms" << std::endl;
+        std::cout << "GL state calls: " << GLState::GetIssuedCalls() << " issued, "
+            << GLState::GetFilteredCalls() << " filtered" << std::endl;
+    }
+
+
     void SceneGraph::DrawToTexture(Camera* camera, GamePhase gamePhase) {
 
         // Save current viewport
@@ -240,9 +498,9 @@ namespace game {
         glViewport(0, 0, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
 
         // Enable writing to depth buffer
-        glDepthMask(GL_TRUE);
-        glDisable(GL_BLEND);
-        glDepthFunc(GL_LESS);
+        GLState::DepthMask(GL_TRUE);
+        GLState::Disable(GL_BLEND);
+        GLState::DepthFunc(GL_LESS);
 
         // Clear background
         glClearColor(background_color_[0],
@@ -252,32 +510,46 @@ namespace game {
 
         if (gamePhase == title) {
             GetNode("MainMenu")->Draw(camera);
+            GLState::BindVertexArray(0);
             return;
         }
         else if (gamePhase == gameLost) {
             GetNode("LoseScreen")->Draw(camera);
+            GLState::BindVertexArray(0);
             return;
         }
         else if (gamePhase == gameWon) {
             GetNode("WinScreen")->Draw(camera);
+            GLState::BindVertexArray(0);
             return;
         }
 
-        // Draw all scene nodes
-        for (size_t i = 0; i < node_.size(); i++) {
-            if (node_[i]->GetName() == "skybox") continue;
-            if (node_[i]->GetName() == "MainMenu") continue;
-            if (node_[i]->GetName() == "LoseScreen") continue;
-            if (node_[i]->GetName() == "WinScreen") continue;
-            node_[i]->Draw(camera);
+        queueOpaque();
+
+        // Depth first for the layers that have a pre-pass
+        drawDepth(camera);
+
+        // Draw all opaque scene nodes
+        beginPass(OpaquePass);
+        for (size_t i = 0; i < opaque_queue_.size(); i++) {
+            opaque_queue_[i]->Draw(camera);
         }
 
         GetNode("skybox")->Draw(camera);
+        endPass();
+
+        // Blended nodes go last, over the sky as well
+        drawTransparent(camera);
+        timer_frame_ = (timer_frame_ + 1) % timer_frames;
 
         // Enable writing to depth buffer
-        glDepthMask(GL_TRUE);
-        glDisable(GL_BLEND);
-        glDepthFunc(GL_LESS);
+        GLState::DepthMask(GL_TRUE);
+        GLState::Disable(GL_BLEND);
+        GLState::DepthFunc(GL_LESS);
+
+        // The nodes leave their vertex arrays bound; unbind the last one
+        // so that buffers bound between frames do not change it
+        GLState::BindVertexArray(0);
 
         // Reset frame buffer
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -286,79 +558,17 @@ namespace game {
         glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
     }
 
-    void SceneGraph::ApplySSE(GLuint program) {
-        // Save current viewport
-        GLint viewport[4];
-        glGetIntegerv(GL_VIEWPORT, viewport);
-
-        // Enable frame buffer
-        glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_);
-        glViewport(0, 0, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
+    void SceneGraph::DisplayTexture(GLuint program, GLuint texture) {
 
-        // Configure output to the screen
-       //glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST);
+        // Draw into the bound frame buffer
+        GLState::Disable(GL_DEPTH_TEST);
 
         // Set up quad geometry
-        glBindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
+        GLState::BindVertexArray(0);
+        GLState::BindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
 
         // Select proper material (shader program)
-        glUseProgram(program);
-
-        // Setup attributes of screen-space shader
-        GLint pos_att = glGetAttribLocation(program, "position");
-        glEnableVertexAttribArray(pos_att);
-        glVertexAttribPointer(pos_att, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
-
-        GLint tex_att = glGetAttribLocation(program, "uv");
-        glEnableVertexAttribArray(tex_att);
-        glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-
-        GLint ratio_var = glGetUniformLocation(program, "aspect_ratio");
-        float aspect_ratio = static_cast<float>(viewport[2]) / viewport[3];
-        glUniform1f(ratio_var, aspect_ratio);
-
-        GLint blur_samples = glGetUniformLocation(program, "num_samples");
-        glUniform1i(blur_samples, blurrSamples);
-
-        GLint blood_factor = glGetUniformLocation(program, "blood_factor");
-        // 1 is fully bloody. 0 is no blood
-        glUniform1f(blood_factor, bloodFactor);
-
-        GLint pixel_spacing = glGetUniformLocation(program, "pixelSpacing");
-        glUniform1f(pixel_spacing, pixelSpacing);
-
-        // Timer
-        GLint timer_var = glGetUniformLocation(program, "timer");
-        float current_time = static_cast<float>(glfwGetTime());
-        glUniform1f(timer_var, current_time);
-
-        // Bind texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture_);
-
-        // Draw geometry
-        glDrawArrays(GL_TRIANGLES, 0, 6); // Quad: 6 coordinates
-
-        // Reset current geometry
-        glEnable(GL_DEPTH_TEST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-    }
-
-
-    void SceneGraph::DisplayTexture(GLuint program) {
-
-        // Configure output to the screen
-        //glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST);
-
-        // Set up quad geometry
-        glBindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
-
-        // Select proper material (shader program)
-        glUseProgram(program);
+        GLState::UseProgram(program);
 
         // Setup attributes of screen-space shader
         GLint pos_att = glGetAttribLocation(program, "position");
@@ -391,14 +601,13 @@ namespace game {
         glUniform1f(timer_var, current_time);
 
         // Bind texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture_);
+        GLState::BindTexture(0, GL_TEXTURE_2D, texture);
 
         // Draw geometry
         glDrawArrays(GL_TRIANGLES, 0, 6); // Quad: 6 coordinates
 
         // Reset current geometry
-        glEnable(GL_DEPTH_TEST);
+        GLState::Enable(GL_DEPTH_TEST);
     }
 
 
@@ -28,6 +28,14 @@ namespace game {
         gameWon,
     };
 
+    // Passes of a frame timed on the GPU
+    enum RenderPass {
+        DepthPass, // Depth pre-pass
+        OpaquePass, // Opaque nodes and the skybox
+        TransparentPass, // Blended nodes and their composite
+        RenderPassCount
+    };
+
     // Class that manages all the objects in a scene
     class SceneGraph {
 
@@ -46,7 +54,37 @@ namespace game {
         GLuint texture_;
         GLuint depth_buffer_;
 
-        
+        // Weighted blended order-independent transparency: blended nodes
+        // add their weighted colors and coverage into these targets, in
+        // any order, then one pass composites them over the scene
+        GLuint transparency_frame_buffer_;
+        GLuint accumulation_texture_;
+        GLuint revealage_texture_;
+        GLuint composite_program_;
+
+        // Opaque nodes of the frame, in drawing order
+        std::vector<Renderable*> opaque_queue_;
+        // List the opaque nodes by layer, then by program and material, so
+        // that consecutive nodes share as much GL state as they can
+        void queueOpaque(void);
+
+        // Draw the blended nodes and composite them into the frame buffer
+        void drawTransparent(Camera* camera);
+
+        // Depth program of each layer given a pre-pass, 0 for none
+        GLuint depth_program_[RenderLayerCount];
+        // Lay down the depth of the opaque nodes of the pre-passed layers
+        void drawDepth(Camera* camera);
+
+        // Timer queries of the passes, for a few frames in flight so that
+        // reading them never waits on the GPU
+        static const int timer_frames = 3;
+        GLuint timer_queries_[timer_frames][RenderPassCount];
+        bool timer_issued_[timer_frames][RenderPassCount];
+        int timer_frame_;
+        float pass_time_[RenderPassCount]; // Milliseconds
+        void beginPass(RenderPass pass);
+        void endPass(void);
 
         // Interactable nodes
         std::vector<InteractableNode*> interactable_nodes_;
@@ -69,6 +107,9 @@ namespace game {
         InteractableNode* CreateInteractableNode(std::string node_name, Resource* geometry, Resource* material, Resource* texture = NULL);
         // Add an already-created node
         void AddNode(Renderable* node);
+        // Add an already-created node that is drawn before all others, so
+        // that opaque ground added late is still drawn before blended nodes
+        void AddNodeFirst(Renderable* node);
         // Find a scene node with a specific name
         Renderable* getRenderable(const std::string& node_name);
         SceneNode* GetNode(const std::string& node_name) const;
@@ -85,17 +126,30 @@ namespace game {
 
         // Update entire scene
         //void Update(void);
-        void Update(Camera* camera, double deltaTime, GamePhase gamePhase);
+        void Update(GamePhase gamePhase);
 
         // Drawing from/to a texture
         // Setup the texture
         void SetupDrawToTexture(void);
+        // Setup the transparency targets, after the texture since they
+        // share its depth buffer
+        void SetupTransparency(GLuint composite_program);
+        // Give the opaque nodes of a layer a depth-only pre-pass drawn with
+        // 'depth_program'; the main pass then shades only the visible
+        // fragments. 0 draws the layer with the usual depth test
+        void SetDepthPrepass(RenderLayer layer, GLuint depth_program);
+        bool HasDepthPrepass(RenderLayer layer) const;
+        // GPU time of a pass, in milliseconds, from a few frames ago
+        float GetPassTime(RenderPass pass) const;
+        void PrintPassTimes(void) const;
         // Draw the scene into a texture
         void DrawToTexture(Camera* camera, GamePhase gamePhase);
-        // Process and draw the texture on the screen
-        void DisplayTexture(GLuint program);
-        // apply an sse to the frame buffer without drawing to screen
-        void ApplySSE(GLuint program);
+        // Texture drawn into and its frame buffer
+        GLuint GetTexture(void) const;
+        GLuint GetFrameBuffer(void) const;
+        // Process 'texture' with a screen-space program into the bound
+        // frame buffer, over the whole viewport
+        void DisplayTexture(GLuint program, GLuint texture);
         // Save texture to a file in ppm format
         void SaveTexture(char* filename);
     }; // class SceneGraph
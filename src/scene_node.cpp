@@ -6,9 +6,8 @@
 #include <time.h>
 
 #include "scene_node.h"
-
-#define RGB(A, B, C, D) 255 / A, 255 / B, 255 / C, 255 / D
-
+#include "gl_state.h"
+#include "material_instance.h"
 
 
 namespace game {
@@ -29,6 +28,7 @@ namespace game {
         array_buffer_ = geometry->GetArrayBuffer();
         element_array_buffer_ = geometry->GetElementArrayBuffer();
         size_ = geometry->GetSize();
+        vertex_format_ = geometry->GetVertexFormat();
 
         // Set material (shader program)
         if (material->GetType() != Material) {
@@ -45,17 +45,25 @@ namespace game {
             texture_ = 0;
         }
 
+        // Nodes made from the same resources share their parameters
+        material_instance_ = MaterialInstance::GetShared(material, texture);
+
         // Other attributes
         scale_ = glm::vec3(1.0, 1.0, 1.0);
         blending_ = false;
         name_ = name;
 
         glGenVertexArrays(1, &VAO);
-        setupVertexAttributes(material_);
+        setupVertexAttributes();
     }
 
 
     SceneNode::~SceneNode() {
+
+        glDeleteVertexArrays(1, &VAO);
+        if (depth_VAO) {
+            glDeleteVertexArrays(1, &depth_VAO);
+        }
     }
 
 
@@ -191,72 +199,76 @@ namespace game {
         return transf;
     }
 
-    void SceneNode::UpdateYPos(std::vector<std::vector<float>> terrain_grid_, float object_offset) {
-        constexpr float sizeOfQuad = 0.1f;
-        const int coord_offset = 300; // This is to avoid negative indices, seems to be the right value
-        const float height_scalar = 25.0f;
-
-        // Get indices in the grid for all 4 points
-        int x1 = static_cast<int>(glm::floor((position_.x + coord_offset) * sizeOfQuad));
-        int x2 = static_cast<int>(glm::ceil((position_.x + coord_offset) * sizeOfQuad));
-        int z1 = static_cast<int>(glm::floor((position_.z + coord_offset) * sizeOfQuad));
-        int z2 = static_cast<int>(glm::ceil((position_.z + coord_offset) * sizeOfQuad));
-
-        glm::vec3 p1 = glm::vec3(x1, terrain_grid_[z1 / 2][x1 / 2], z1);
-        glm::vec3 p2 = glm::vec3(x1, terrain_grid_[z1 / 2][x2 / 2], z2);
-        glm::vec3 p3 = glm::vec3(x2, terrain_grid_[z2 / 2][x1 / 2], z1);
-        glm::vec3 p4 = glm::vec3(x2, terrain_grid_[z2 / 2][x2 / 2], z2);
-
-        float s = (position_.x + coord_offset) * sizeOfQuad - x1;
-        float t = (position_.z + coord_offset) * sizeOfQuad - z1;
-
-        position_.y = ((1 - t) * ((1 - s) * p1 + s * p2) + t * ((1 - s) * p3 + s * p4)).y * height_scalar + object_offset;
+    void SceneNode::UpdateYPos(const WorldGrid& grid, float object_offset) {
+        position_.y = grid.GetHeight(position_.x, position_.z) + object_offset;
     }
 
     void SceneNode::Draw(Camera* camera) {
         // Select particle blending or not
         if (blending_) {
-            // Disable depth write
-            glDepthMask(GL_FALSE);
-
-            // Enable blending
-            glEnable(GL_BLEND);
-            //glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Simpler form
-            glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glBlendEquationSeparate(GL_FUNC_ADD, GL_MAX);
+            // Disable depth write; the transparency pass of the scene
+            // graph sets up the blending
+            GLState::DepthMask(GL_FALSE);
         }
         else {
-            // Enable z-buffer
-            glDepthMask(GL_TRUE);
-            glDisable(GL_BLEND);
-            glDepthFunc(GL_LESS);
+            // Enable z-buffer, or match the depth of the pre-pass
+            setupOpaqueDepth();
+            GLState::Disable(GL_BLEND);
         }
 
-        // Select proper material (shader program)
-        glUseProgram(material_);
-
-        // Set geometry to draw
-        glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+        // Select proper material: program, texture and parameters
+        material_instance_->Bind();
+        GLuint program = material_instance_->GetProgram();
 
         // Set globals for camera
-        camera->SetupShader(material_);
+        camera->SetupShader(program);
 
         // Set world matrix and other shader input variables
-        SetupShader(material_);
+        SetupShader(program);
 
-        glBindVertexArray(VAO);
+        // The vertex array holds the geometry buffers; it stays bound for
+        // the next node, which often shares it
+        GLState::BindVertexArray(VAO);
 
         // Draw geometry
         if (mode_ == GL_POINTS) {
-            glDrawArrays(mode_, 0, size_);
+            // One quad of four vertices per point
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, size_);
         }
         else {
             // glDrawElementsInstanced(mode_, size_, GL_UNSIGNED_INT, 0, 200);
             glDrawElements(mode_, size_, GL_UNSIGNED_INT, 0);
         }
+    }
 
-        glBindVertexArray(0);
+    bool SceneNode::DrawDepth(Camera* camera, GLuint program) {
+        // The wind moves the node between the two passes, so its depths
+        // would not match
+        if (mode_ != GL_TRIANGLES || blending_) {
+            return false;
+        }
+        for (const SceneNode* node = this; node; node = node->parent_) {
+            if (node->wind_affected) {
+                return false;
+            }
+        }
+
+        if (!depth_VAO) {
+            glGenVertexArrays(1, &depth_VAO);
+            GLState::BindVertexArray(depth_VAO);
+            GLState::BindBuffer(GL_ARRAY_BUFFER, array_buffer_);
+            GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+            SetupVertexFormat(vertex_format_, std::vector<GLuint>(1, VertexLocation));
+        }
+
+        GLState::UseProgram(program);
+        camera->SetupShader(program);
+        GLint world_mat = glGetUniformLocation(program, "world_mat");
+        glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(CalculateTransform(static_cast<float>(glfwGetTime()), true)));
+
+        GLState::BindVertexArray(depth_VAO);
+        glDrawElements(mode_, size_, GL_UNSIGNED_INT, 0);
+        return true;
     }
 
     void SceneNode::SetBlending(bool blending) {
@@ -269,40 +281,27 @@ namespace game {
             colisionBox_->setPos(position_);
     }
 
-    void SceneNode::setupVertexAttributes(GLuint program) {
+    void SceneNode::setupVertexAttributes(void) {
         glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
-        // Set attributes for shaders
-        GLint vertex_att = glGetAttribLocation(program, "vertex");
-        glVertexAttribPointer(vertex_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), 0);
-        glEnableVertexAttribArray(vertex_att);
-
-        GLint normal_att = glGetAttribLocation(program, "normal");
-        glVertexAttribPointer(normal_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(normal_att);
-
-        GLint color_att = glGetAttribLocation(program, "color");
-        glVertexAttribPointer(color_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(color_att);
+        // Set attributes for shaders; locations are fixed for all materials
+        SetupVertexFormat(vertex_format_);
 
-        GLint tex_att = glGetAttribLocation(program, "uv");
-        glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(9 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(tex_att);
+        // Points are drawn as instanced quads: each point is read once per
+        // instance, the vertex shader places the corners
+        if (mode_ == GL_POINTS) {
+            glVertexAttribDivisor(VertexLocation, 1);
+            glVertexAttribDivisor(NormalLocation, 1);
+            glVertexAttribDivisor(ColorLocation, 1);
+            glVertexAttribDivisor(UVLocation, 1);
+        }
 
         glBindVertexArray(0);
     }
 
 
     void SceneNode::SetupShader(GLuint program) {
-        // Texture
-        if (texture_) {
-            GLint tex = glGetUniformLocation(program, "texture_map");
-            glUniform1i(tex, 0); // Assign the first texture to the map
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texture_); // First texture we bind
-        }
-
         // Timer
         GLint timer_var = glGetUniformLocation(program, "timer");
         float current_time = static_cast<float>(glfwGetTime());
@@ -312,22 +311,6 @@ namespace game {
         glm::mat4 scaling = glm::scale(glm::mat4(1.0), scale_);
         GLint world_mat = glGetUniformLocation(program, "world_mat");
         glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(CalculateTransform(current_time, true)));
-
-        // Specular Power
-        GLint specular_power = glGetUniformLocation(program, "specular_power");
-        glUniform1f(specular_power, 41);
-
-        // Light Color
-        GLint light_color = glGetUniformLocation(program, "light_color");
-        glUniform4f(light_color, 1, 1, 0.4f, 1);
-
-        // Ambient Light Color
-        GLint amb_light_color = glGetUniformLocation(program, "ambient_light_color");
-        glUniform4f(amb_light_color, RGB(176, 224, 230, 255));
-
-        // Object Color
-        GLint object_color = glGetUniformLocation(program, "object_color");
-        glUniform3f(object_color, 0.0f, 0.7f, 0.9f);
     }
 
 } // namespace game;
@@ -47,6 +47,10 @@ namespace game {
         // variable
         virtual void Draw(Camera* camera) override;
 
+        // Depth of a triangle mesh, read through a position-only vertex
+        // array; not for blended nodes or nodes moving with the wind
+        virtual bool DrawDepth(Camera* camera, GLuint program) override;
+
         // Set blending mode
         void SetBlending(bool blending);
 
@@ -54,7 +58,7 @@ namespace game {
         virtual void Update(void) override;
 
         // Updates y position
-        void UpdateYPos(std::vector<std::vector<float>> terrain_grid_, float object_offset);
+        void UpdateYPos(const WorldGrid& grid, float object_offset);
 
         // OpenGL variables
         GLenum GetMode(void) const;
@@ -73,12 +77,14 @@ namespace game {
         virtual glm::mat4 CalculateTransform(float, bool = false) const;
 
     protected:
-        void setupVertexAttributes(GLuint program);
+        void setupVertexAttributes(void);
 
         std::string name_; // Name of the scene node
         GLuint array_buffer_; // References to geometry: vertex and array buffers
         GLuint element_array_buffer_;
         GLuint VAO;
+        GLuint depth_VAO = 0; // Position only, made on the first depth pass
+        VertexFormat vertex_format_; // Layout of the vertices in the array buffer
         GLenum mode_; // Type of geometry
         GLsizei size_; // Number of primitives in geometry
         GLuint material_; // Reference to shader program
@@ -86,10 +92,9 @@ namespace game {
         glm::vec3 position_; // Position of node
         glm::quat orientation_; // Orientation of node
         glm::vec3 scale_; // Scale of node
-        bool blending_;
 
         SceneNode* parent_ = NULL;
-        bool wind_affected; // Whether to make it move with the wind
+        bool wind_affected = false; // Whether to make it move with the wind
         glm::vec3 orbit_translation = glm::vec3(0, 0, 0);
         glm::quat orbit_rotation = glm::quat(0, 0, 0, 0);
         float wind_strength = 0.05f; // The amount the wind moves the tree
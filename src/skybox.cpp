@@ -1,5 +1,6 @@
 #include "skybox.h"
 #include "resource_manager.h"
+#include "gl_state.h"
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -15,14 +16,12 @@ namespace game {
 	{
 
         // Enable z-buffer
-        glDepthMask(GL_TRUE);
-        glDisable(GL_BLEND);
-        glDepthFunc(GL_LESS);
-        glEnable(GL_DEPTH_TEST);
-        
+        GLState::DepthMask(GL_TRUE);
+        GLState::Disable(GL_BLEND);
+        GLState::Enable(GL_DEPTH_TEST);
 
         // Select proper material (shader program)
-        glUseProgram(material_);
+        GLState::UseProgram(material_);
 
         // draw skybox
         GLuint skyboxVAO, skyboxVBO;
@@ -30,16 +29,15 @@ namespace game {
         skyboxVAO = ResourceManager::GetSkyboxVAO();
         skyboxVBO = ResourceManager::GetSkyboxVBO();
 
-        glDepthFunc(GL_LEQUAL);  
-        glBindVertexArray(skyboxVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+        // The sky is drawn at the far plane, behind everything else
+        GLState::DepthFunc(GL_LEQUAL);
+        GLState::BindVertexArray(skyboxVAO);
+        GLState::BindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
         // Set globals for camera
         camera->SetupShaderSkybox(material_);
         // Set world matrix and other shader input variables
         SetupShader(material_);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
 	}
 
     void Skybox::SetupShader(GLuint program) {
@@ -47,8 +45,7 @@ namespace game {
         if (texture_) {
             GLint tex = glGetUniformLocation(program, "texture_map");
             glUniform1i(tex, 0);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, texture_);
+            GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, texture_);
         }
 
         glEnableVertexAttribArray(0);
@@ -0,0 +1,178 @@
+#include <stdexcept>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/type_ptr.hpp>
+
+#include "static_batch.h"
+#include "gl_state.h"
+#include "material_instance.h"
+
+namespace game {
+
+    StaticBatch::StaticBatch(const std::string name, GeometryArena* arena, const Resource* material, const Resource* texture)
+        : Renderable(name) {
+
+        if (material->GetType() != Material) {
+            throw(std::invalid_argument(std::string("Invalid type of material")));
+        }
+        material_instance_ = MaterialInstance::GetShared(material, texture);
+        blending_ = false;
+        arena_ = arena;
+        vertex_format_ = StandardFormat;
+
+        glGenBuffers(1, &draw_buffer_);
+        glGenTextures(1, &draw_texture_);
+        if (GLEW_ARB_multi_draw_indirect) {
+            glGenBuffers(1, &indirect_buffer_);
+        }
+    }
+
+
+    StaticBatch::~StaticBatch() {
+
+        glDeleteTextures(1, &draw_texture_);
+        glDeleteBuffers(1, &draw_buffer_);
+        if (indirect_buffer_) {
+            glDeleteBuffers(1, &indirect_buffer_);
+        }
+    }
+
+
+    void StaticBatch::Add(const Resource* geometry, const glm::mat4& world) {
+
+        // The first mesh picks the format; a standard mesh in a compact
+        // batch moves the draws already added to the standard arena
+        if (commands_.empty()) {
+            vertex_format_ = geometry->GetVertexFormat();
+        }
+        else if (geometry->GetVertexFormat() != vertex_format_ && vertex_format_ == CompactFormat) {
+            vertex_format_ = StandardFormat;
+            for (size_t i = 0; i < geometries_.size(); i++) {
+                const GeometryRange& moved = arena_->Add(geometries_[i], vertex_format_);
+                commands_[i].first_index = moved.first_index;
+                commands_[i].base_vertex = moved.base_vertex;
+            }
+        }
+        const GeometryRange& range = arena_->Add(geometry, vertex_format_);
+
+        DrawElementsIndirectCommand command;
+        command.count = range.count;
+        command.instance_count = 1;
+        command.first_index = range.first_index;
+        command.base_vertex = range.base_vertex;
+        command.base_instance = 0;
+        commands_.push_back(command);
+        geometries_.push_back(geometry);
+
+        // The normal matrix is worked out here rather than per vertex
+        glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(world)));
+        for (int i = 0; i < 4; i++) {
+            draw_data_.push_back(world[i]);
+        }
+        for (int i = 0; i < 3; i++) {
+            draw_data_.push_back(glm::vec4(normal[i], 0.0f));
+        }
+        draw_data_.push_back(glm::vec4(0.0f));
+        dirty_ = true;
+    }
+
+
+    size_t StaticBatch::GetDrawCount(void) const {
+
+        return commands_.size();
+    }
+
+
+    void StaticBatch::Update(void) {
+
+        if (dirty_) {
+            upload();
+        }
+    }
+
+
+    void StaticBatch::upload(void) {
+
+        GLState::BindBuffer(GL_TEXTURE_BUFFER, draw_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, draw_data_.size() * sizeof(glm::vec4), draw_data_.data(), GL_STATIC_DRAW);
+        GLState::BindTexture(draw_data_unit, GL_TEXTURE_BUFFER, draw_texture_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, draw_buffer_);
+
+        if (indirect_buffer_) {
+            GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawElementsIndirectCommand), commands_.data(), GL_STATIC_DRAW);
+        }
+        dirty_ = false;
+    }
+
+
+    void StaticBatch::Draw(Camera* camera) {
+
+        if (commands_.empty()) {
+            return;
+        }
+        if (dirty_) {
+            upload();
+        }
+
+        // Enable z-buffer, or match the depth of the pre-pass
+        setupOpaqueDepth();
+        GLState::Disable(GL_BLEND);
+
+        // Select proper material: program, texture and parameters
+        material_instance_->Bind();
+        GLuint program = material_instance_->GetProgram();
+
+        // Set globals for camera
+        camera->SetupShader(program);
+
+        // Set the per-draw data and other shader input variables
+        SetupShader(program);
+
+        // One vertex array for everything in the arena
+        GLState::BindVertexArray(arena_->GetVertexArray(vertex_format_));
+
+        GLint draw_index = glGetUniformLocation(program, "draw_index");
+        if (draw_index >= 0) {
+            // The shader cannot see the draw number; tell it one draw at a time
+            for (size_t i = 0; i < commands_.size(); i++) {
+                const DrawElementsIndirectCommand& command = commands_[i];
+                glUniform1i(draw_index, static_cast<GLint>(i));
+                glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                    (void*)(command.first_index * sizeof(GLuint)), command.base_vertex);
+            }
+        }
+        else if (indirect_buffer_) {
+            // Whole batch in one call
+            GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(commands_.size()), 0);
+        }
+        else {
+            // Still one call, with the draws passed from client memory
+            std::vector<GLsizei> counts(commands_.size());
+            std::vector<const void*> offsets(commands_.size());
+            std::vector<GLint> base_vertices(commands_.size());
+            for (size_t i = 0; i < commands_.size(); i++) {
+                counts[i] = commands_[i].count;
+                offsets[i] = (const void*)(commands_[i].first_index * sizeof(GLuint));
+                base_vertices[i] = commands_[i].base_vertex;
+            }
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT,
+                offsets.data(), static_cast<GLsizei>(commands_.size()), base_vertices.data());
+        }
+    }
+
+
+    void StaticBatch::SetupShader(GLuint program) {
+
+        // Timer
+        GLint timer_var = glGetUniformLocation(program, "timer");
+        float current_time = static_cast<float>(glfwGetTime());
+        glUniform1f(timer_var, (float)current_time);
+
+        // Transforms of the draws
+        GLint draw_data = glGetUniformLocation(program, "draw_data");
+        glUniform1i(draw_data, draw_data_unit);
+        GLState::BindTexture(draw_data_unit, GL_TEXTURE_BUFFER, draw_texture_);
+    }
+
+} // namespace game
@@ -0,0 +1,67 @@
+#ifndef STATIC_BATCH_H_
+#define STATIC_BATCH_H_
+
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "geometry_arena.h"
+#include "renderable.h"
+#include "resource.h"
+
+namespace game {
+
+    // Props that never move and share a material: their meshes are drawn
+    // from the geometry arena with one glMultiDrawElementsIndirect. The
+    // transform of each draw sits in a texture buffer that the vertex
+    // shader reads at gl_DrawIDARB, so the draws need no uniforms or
+    // vertex arrays of their own. Shaders without ARB_shader_draw_parameters
+    // get the index of the draw in the 'draw_index' uniform instead, one
+    // draw at a time
+    class StaticBatch : public Renderable {
+
+    public:
+        // Texture unit of the per-draw data; the lights use 4 to 6
+        static const int draw_data_unit = 7;
+
+        StaticBatch(const std::string name, GeometryArena* arena, const Resource* material, const Resource* texture = NULL);
+        ~StaticBatch();
+
+        // Add a draw of a triangle mesh placed by 'world'. The batch is
+        // drawn in the compact format only while all its meshes are
+        // compact; otherwise they are all drawn in the standard one
+        void Add(const Resource* geometry, const glm::mat4& world);
+        size_t GetDrawCount(void) const;
+
+        // Upload the draws added since the last update
+        virtual void Update(void) override;
+
+        virtual void Draw(Camera* camera) override;
+
+    private:
+        void upload(void);
+
+        virtual void SetupShader(GLuint program) override;
+
+        GeometryArena* arena_;
+        VertexFormat vertex_format_;
+        std::vector<const Resource*> geometries_; // Mesh of each draw
+        std::vector<DrawElementsIndirectCommand> commands_;
+        // World matrix then normal matrix of each draw, draw_data_texels
+        // texels per draw
+        std::vector<glm::vec4> draw_data_;
+        static const int draw_data_texels = 8;
+        bool dirty_ = false;
+
+        GLuint indirect_buffer_ = 0;
+        GLuint draw_buffer_ = 0;
+        GLuint draw_texture_ = 0;
+
+    }; // class StaticBatch
+
+} // namespace game
+
+#endif // STATIC_BATCH_H_
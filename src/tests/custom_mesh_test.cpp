@@ -0,0 +1,74 @@
+// Custom meshes whose faces point outside the vertex list are rejected
+// with std::invalid_argument while parsing, before any GL work, so no
+// context is needed
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "resource_manager.h"
+
+using namespace game;
+
+// Three vertices: position, normal, color and texture coordinates
+static const char* vertices =
+    "0 0 0 0 1 0 1 1 1 0 0\n"
+    "1 0 0 0 1 0 1 1 1 1 0\n"
+    "0 0 1 0 1 0 1 1 1 0 1\n";
+
+
+static void WriteFile(const std::string& filename, const std::string& text) {
+
+    std::ofstream f(filename.c_str(), std::ios::binary);
+    f << text;
+}
+
+
+// Whether loading the three vertices with the given faces throws
+// std::invalid_argument
+static bool Rejects(const std::string& name, const std::string& faces) {
+
+    WriteFile(name + ".customv", vertices);
+    WriteFile(name + ".customf", faces);
+    std::string vertices_path = name + ".customv";
+    std::string faces_path = name + ".customf";
+
+    ResourceManager resman;
+    try {
+        resman.LoadCustomResource(Mesh, name, vertices_path.c_str(), faces_path.c_str());
+    }
+    catch (std::invalid_argument&) {
+        return true;
+    }
+    catch (std::exception& e) {
+        printf("%s: unexpected exception: %s\n", name.c_str(), e.what());
+        return false;
+    }
+    return false;
+}
+
+
+int main(void) {
+
+    struct Case {
+        const char* name;
+        const char* faces;
+    };
+    const Case cases[] = {
+        { "index_past_end", "0 1 3\n" },
+        { "index_far_past_end", "0 1 2\n2 1 100000\n" },
+        { "negative_index", "0 -1 2\n" },
+        { "not_an_index", "0 one 2\n" },
+    };
+
+    int failures = 0;
+    for (const Case& c : cases) {
+        if (!Rejects(c.name, c.faces)) {
+            printf("%s: loaded a face outside the vertices\n", c.name);
+            failures++;
+        }
+    }
+
+    printf("%d of %d cases rejected\n", (int)(sizeof(cases) / sizeof(cases[0])) - failures, (int)(sizeof(cases) / sizeof(cases[0])));
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ios>
+#include <vector>
+#include <SOIL/SOIL.h>
+
+#include "mapped_file.h"
+#include "texture_cache.h"
+#include "path_config.h"
+
+namespace game {
+
+namespace {
+
+    const char texture_magic[4] = { 'W', 'T', 'E', 'X' };
+
+    size_t AlignOffset(size_t offset){
+
+        return (offset + TextureCache::blob_alignment - 1) / TextureCache::blob_alignment * TextureCache::blob_alignment;
+    }
+
+
+    // Halve an RGBA8 image with a box filter; odd rows/columns are
+    // folded into the last texel
+    std::vector<unsigned char> Downsample(const std::vector<unsigned char>& src, int width, int height, int& new_width, int& new_height){
+
+        new_width = (width > 1) ? width / 2 : 1;
+        new_height = (height > 1) ? height / 2 : 1;
+
+        std::vector<unsigned char> dst(new_width * new_height * 4);
+        for (int y = 0; y < new_height; y++){
+            int y0 = std::min(y * 2, height - 1);
+            int y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < new_width; x++){
+                int x0 = std::min(x * 2, width - 1);
+                int x1 = std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < 4; c++){
+                    int sum = src[(y0 * width + x0) * 4 + c] + src[(y0 * width + x1) * 4 + c] +
+                        src[(y1 * width + x0) * 4 + c] + src[(y1 * width + x1) * 4 + c];
+                    dst[(y * new_width + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        return dst;
+    }
+
+
+    // Same sampling as the textures SOIL used to create
+    void SetTextureParameters(int level_count){
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level_count - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+
+} // namespace
+
+
+uint64_t TextureCache::HashFile(const char* filename){
+
+    return HashFiles(std::vector<std::string>(1, filename), version);
+}
+
+
+std::string TextureCache::GetCachePath(uint64_t source_hash){
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.wtex", static_cast<unsigned long long>(source_hash));
+
+    return std::string(TEXTURE_CACHE_DIRECTORY) + "/" + name;
+}
+
+
+bool TextureCache::Load(const std::string& cache_path, uint64_t source_hash, GLuint& texture, size_t& bytes, size_t& uncompressed_bytes){
+
+    MappedFile file;
+    if (!file.Map(cache_path) || file.GetSize() < sizeof(TextureFileHeader)){
+        return false;
+    }
+
+    // Validate the header and the level table before touching the data
+    TextureFileHeader header;
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (memcmp(header.magic, texture_magic, sizeof(texture_magic)) != 0 ||
+        header.version != version || header.source_hash != source_hash ||
+        header.level_count == 0 || header.level_count > 32){
+        return false;
+    }
+    if (header.compressed && !GLEW_EXT_texture_compression_s3tc){
+        return false;
+    }
+    if (header.level_offset + static_cast<uint64_t>(header.level_count) * sizeof(TextureFileLevel) > file.GetSize()){
+        return false;
+    }
+
+    std::vector<TextureFileLevel> level(header.level_count);
+    memcpy(level.data(), file.GetData() + header.level_offset, level.size() * sizeof(TextureFileLevel));
+    for (size_t i = 0; i < level.size(); i++){
+        if (level[i].offset + level[i].size > file.GetSize()){
+            return false;
+        }
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    bytes = 0;
+    uncompressed_bytes = 0;
+    for (size_t i = 0; i < level.size(); i++){
+        const unsigned char* data = file.GetData() + level[i].offset;
+        if (header.compressed){
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, header.internal_format, level[i].width, level[i].height, 0, level[i].size, data);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, i, header.internal_format, level[i].width, level[i].height, 0, header.format, header.type, data);
+        }
+        bytes += level[i].size;
+        uncompressed_bytes += level[i].width * level[i].height * 4;
+    }
+
+    SetTextureParameters(header.level_count);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return true;
+}
+
+
+GLuint TextureCache::Bake(const char* filename, const std::string& cache_path, uint64_t source_hash, size_t& bytes, size_t& uncompressed_bytes){
+
+    // Decode the image
+    int width, height, channels;
+    unsigned char* image = SOIL_load_image(filename, &width, &height, &channels, SOIL_LOAD_RGBA);
+    if (!image) {
+        throw(std::ios_base::failure(std::string("Error loading texture ") + std::string(filename) + std::string(": ") + std::string(SOIL_last_result())));
+    }
+
+    // Build the mip chain down to 1x1
+    std::vector<std::vector<unsigned char> > mip(1, std::vector<unsigned char>(image, image + width * height * 4));
+    std::vector<int> mip_width(1, width);
+    std::vector<int> mip_height(1, height);
+    SOIL_free_image_data(image);
+    while (mip_width.back() > 1 || mip_height.back() > 1){
+        int w, h;
+        mip.push_back(Downsample(mip.back(), mip_width.back(), mip_height.back(), w, h));
+        mip_width.push_back(w);
+        mip_height.push_back(h);
+    }
+
+    // Images without transparency only need the 4 bpp format
+    bool opaque = true;
+    for (size_t i = 3; i < mip[0].size() && opaque; i += 4){
+        opaque = mip[0][i] == 255;
+    }
+
+    TextureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, texture_magic, sizeof(texture_magic));
+    header.version = version;
+    header.source_hash = source_hash;
+    header.compressed = GLEW_EXT_texture_compression_s3tc ? 1 : 0;
+    if (header.compressed){
+        header.internal_format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    } else {
+        header.internal_format = GL_RGBA8;
+    }
+    header.format = GL_RGBA;
+    header.type = GL_UNSIGNED_BYTE;
+    header.width = width;
+    header.height = height;
+    header.level_count = static_cast<uint32_t>(mip.size());
+    header.level_offset = static_cast<uint32_t>(AlignOffset(sizeof(header)));
+
+    // Create the texture; the driver compresses the levels if asked to
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (size_t i = 0; i < mip.size(); i++){
+        glTexImage2D(GL_TEXTURE_2D, i, header.internal_format, mip_width[i], mip_height[i], 0, GL_RGBA, GL_UNSIGNED_BYTE, mip[i].data());
+    }
+    SetTextureParameters(header.level_count);
+
+    // Gather the levels as stored by OpenGL
+    std::vector<TextureFileLevel> level(mip.size());
+    size_t offset = AlignOffset(header.level_offset + level.size() * sizeof(TextureFileLevel));
+    bytes = 0;
+    uncompressed_bytes = 0;
+    for (size_t i = 0; i < mip.size(); i++){
+        if (header.compressed){
+            GLint size;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            mip[i].resize(size);
+            glGetCompressedTexImage(GL_TEXTURE_2D, i, mip[i].data());
+        }
+        level[i].offset = offset;
+        level[i].size = static_cast<uint32_t>(mip[i].size());
+        level[i].width = mip_width[i];
+        level[i].height = mip_height[i];
+        level[i].reserved = 0;
+        offset = AlignOffset(offset + mip[i].size());
+
+        bytes += mip[i].size();
+        uncompressed_bytes += mip_width[i] * mip_height[i] * 4;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Bake the container for the next runs
+    std::vector<unsigned char> blob(offset, 0);
+    memcpy(&blob[0], &header, sizeof(header));
+    memcpy(&blob[header.level_offset], level.data(), level.size() * sizeof(TextureFileLevel));
+    for (size_t i = 0; i < mip.size(); i++){
+        memcpy(&blob[level[i].offset], mip[i].data(), mip[i].size());
+    }
+    WriteCacheFile(TEXTURE_CACHE_DIRECTORY, cache_path, blob);
+
+    return texture;
+}
+
+} // namespace game
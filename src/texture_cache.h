@@ -0,0 +1,71 @@
+#ifndef TEXTURE_CACHE_H_
+#define TEXTURE_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+namespace game {
+
+    // Layout of a baked texture container, in the spirit of KTX. Every mip
+    // level is stored ready for glTexImage2D/glCompressedTexImage2D and
+    // starts on a multiple of blob_alignment:
+    //   TextureFileHeader
+    //   TextureFileLevel[level_count]
+    //   level data, largest level first
+    struct TextureFileHeader {
+        char magic[4]; // "WTEX"
+        uint32_t version;
+        uint64_t source_hash; // Hash of the source image
+        uint32_t internal_format; // OpenGL internal format of the levels
+        uint32_t format; // Pixel format and type, for uncompressed levels
+        uint32_t type;
+        uint32_t compressed; // Non-zero if the levels are compressed blocks
+        uint32_t width; // Size of level 0
+        uint32_t height;
+        uint32_t level_count;
+        uint32_t level_offset; // Byte offset of the level table
+    };
+
+    struct TextureFileLevel {
+        uint64_t offset; // Byte offset of the level data
+        uint32_t size; // Size of the level data in bytes
+        uint32_t width;
+        uint32_t height;
+        uint32_t reserved;
+    };
+
+    // Cache of textures converted to the container above, stored in
+    // TEXTURE_CACHE_DIRECTORY and keyed by the hash of the source image
+    class TextureCache {
+
+        public:
+            // Bump when the container or the conversion changes
+            static const uint32_t version = 1;
+            static const size_t blob_alignment = 16;
+
+            // Hash the contents of a source image
+            static uint64_t HashFile(const char* filename);
+            // Cache file for the given source hash
+            static std::string GetCachePath(uint64_t source_hash);
+
+            // Create a 2D texture from a cached container, uploading every
+            // level straight from a file mapping. Returns false if there is
+            // no valid entry, or if the driver cannot sample its format.
+            // 'bytes' receives the size of all levels in video memory, and
+            // 'uncompressed_bytes' what they would take as RGBA8
+            static bool Load(const std::string& cache_path, uint64_t source_hash, GLuint& texture, size_t& bytes, size_t& uncompressed_bytes);
+
+            // Decode an image, build its mip chain on the CPU and create a
+            // 2D texture from it. The levels are compressed by the driver
+            // when S3TC is available, then read back and baked into the
+            // cache. Throws if the image cannot be decoded
+            static GLuint Bake(const char* filename, const std::string& cache_path, uint64_t source_hash, size_t& bytes, size_t& uncompressed_bytes);
+
+    }; // class TextureCache
+
+} // namespace game
+
+#endif // TEXTURE_CACHE_H_
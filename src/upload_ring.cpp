@@ -0,0 +1,118 @@
+#include <cstring>
+
+#include "upload_ring.h"
+
+namespace game {
+
+    UploadRing::UploadRing(GLsizeiptr region_size) {
+
+        region_size_ = region_size;
+        buffer_ = 0;
+        mapping_ = NULL;
+        for (int i = 0; i < region_count; i++) {
+            fences_[i] = 0;
+        }
+        region_ = region_count - 1;
+        used_ = 0;
+        stalls_ = 0;
+
+        if (!GLEW_ARB_buffer_storage || region_size <= 0) {
+            return;
+        }
+
+        // Coherent, so that the writes are seen by the copies issued after
+        // them without flushing
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &buffer_);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer_);
+        glBufferStorage(GL_COPY_READ_BUFFER, region_count * region_size_, NULL, flags);
+        mapping_ = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, region_count * region_size_, flags));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        if (!mapping_) {
+            glDeleteBuffers(1, &buffer_);
+            buffer_ = 0;
+        }
+    }
+
+
+    UploadRing::~UploadRing() {
+
+        for (int i = 0; i < region_count; i++) {
+            if (fences_[i]) {
+                glDeleteSync(fences_[i]);
+            }
+        }
+        // Deleting the buffer unmaps it
+        if (buffer_) {
+            glDeleteBuffers(1, &buffer_);
+        }
+    }
+
+
+    GLsizeiptr UploadRing::GetRegionSize(void) const {
+
+        return region_size_;
+    }
+
+
+    bool UploadRing::IsMapped(void) const {
+
+        return mapping_ != NULL;
+    }
+
+
+    void UploadRing::Begin(void) {
+
+        region_ = (region_ + 1) % region_count;
+        used_ = 0;
+
+        GLsync& fence = fences_[region_];
+        if (!fence) {
+            return;
+        }
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            stalls_++;
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+
+    bool UploadRing::Write(GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size) {
+
+        if (used_ + size > region_size_) {
+            return false;
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if (mapping_) {
+            GLintptr staged = region_ * region_size_ + used_;
+            memcpy(mapping_ + staged, data, size);
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer_);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, staged, offset, size);
+        }
+        else {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+        }
+        used_ += size;
+        return true;
+    }
+
+
+    void UploadRing::End(void) {
+
+        if (mapping_ && used_ > 0) {
+            fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+
+    size_t UploadRing::GetStalls(void) const {
+
+        return stalls_;
+    }
+
+} // namespace game
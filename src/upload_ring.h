@@ -0,0 +1,55 @@
+#ifndef UPLOAD_RING_H_
+#define UPLOAD_RING_H_
+
+#include <cstddef>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    // Staging memory for buffer updates that change every frame. A buffer
+    // made with glBufferStorage is mapped once, for good, and split in
+    // region_count regions; each batch of updates is written into the
+    // next region and copied on the GPU to the buffers that are drawn.
+    // A fence after the copies tells when the region can be written
+    // again, which with three regions is almost never waited for.
+    // Without ARB_buffer_storage the updates go through glBufferSubData
+    class UploadRing {
+
+        public:
+            static const int region_count = 3;
+
+            // 'region_size' bytes can be written in each batch
+            UploadRing(GLsizeiptr region_size);
+            ~UploadRing();
+
+            GLsizeiptr GetRegionSize(void) const;
+            // Whether the updates go through a persistently mapped buffer
+            bool IsMapped(void) const;
+
+            // Start a batch in the next region, waiting for the GPU to be
+            // done with it if it still has to be
+            void Begin(void);
+            // Copy 'size' bytes of 'data' to 'offset' in 'buffer'. Returns
+            // false, copying nothing, if the region has no room left
+            bool Write(GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size);
+            // Fence the copies of the batch
+            void End(void);
+
+            // Times Begin had to wait for a region, since the ring was made
+            size_t GetStalls(void) const;
+
+        private:
+            GLsizeiptr region_size_;
+            GLuint buffer_;
+            unsigned char* mapping_; // Whole buffer; NULL when not mapped
+            GLsync fences_[region_count];
+            int region_;
+            GLsizeiptr used_; // Bytes written in the current batch
+            size_t stalls_;
+
+    }; // class UploadRing
+
+} // namespace game
+
+#endif // UPLOAD_RING_H_
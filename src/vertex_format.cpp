@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cmath>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "vertex_format.h"
+
+namespace game {
+
+// Storage for the layout tables
+constexpr VertexAttribute VertexLayout<StandardVertex>::attributes[];
+constexpr VertexAttribute VertexLayout<CompactVertex>::attributes[];
+constexpr VertexAttribute VertexLayout<InstanceRecord>::attributes[];
+
+
+StandardVertex StandardVertex::Pack(const GLfloat* staged){
+
+    StandardVertex v;
+    for (int k = 0; k < 3; k++){
+        v.position[k] = staged[k];
+        v.normal[k] = staged[k + 3];
+        v.color[k] = staged[k + 6];
+    }
+    v.uv[0] = staged[9];
+    v.uv[1] = staged[10];
+
+    return v;
+}
+
+
+CompactVertex CompactVertex::Pack(const GLfloat* staged){
+
+    CompactVertex v;
+    for (int k = 0; k < 3; k++){
+        v.position[k] = glm::packHalf1x16(staged[k]);
+    }
+    v.position[3] = glm::packHalf1x16(1.0f);
+
+    glm::vec3 normal(staged[3], staged[4], staged[5]);
+    float length = glm::length(normal);
+    if (length > 0.0f){
+        normal /= length;
+    }
+    v.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+
+    v.uv[0] = glm::packHalf1x16(staged[9]);
+    v.uv[1] = glm::packHalf1x16(staged[10]);
+
+    return v;
+}
+
+
+void CompactVertex::Unpack(GLfloat* staged) const{
+
+    for (int k = 0; k < 3; k++){
+        staged[k] = glm::unpackHalf1x16(position[k]);
+    }
+
+    glm::vec4 n = glm::unpackSnorm3x10_1x2(normal);
+    staged[3] = n.x;
+    staged[4] = n.y;
+    staged[5] = n.z;
+
+    staged[6] = staged[7] = staged[8] = 0.0f;
+    staged[9] = glm::unpackHalf1x16(uv[0]);
+    staged[10] = glm::unpackHalf1x16(uv[1]);
+}
+
+
+bool CompactVertex::Fits(const std::vector<GLfloat>& staged){
+
+    const int staged_att = 11;
+    // Largest finite half float
+    const float half_max = 65504.0f;
+
+    if (staged.empty()){
+        return false;
+    }
+
+    glm::vec3 min_corner(staged[0], staged[1], staged[2]);
+    glm::vec3 max_corner = min_corner;
+    for (size_t i = 0; i < staged.size(); i += staged_att){
+        glm::vec3 p(staged[i], staged[i + 1], staged[i + 2]);
+        min_corner = glm::min(min_corner, p);
+        max_corner = glm::max(max_corner, p);
+        if (fabs(staged[i + 9]) > half_max || fabs(staged[i + 10]) > half_max){
+            return false;
+        }
+        if (staged[i + 6] != 0.0f || staged[i + 7] != 0.0f || staged[i + 8] != 0.0f){
+            return false;
+        }
+    }
+    float tolerance = glm::length(max_corner - min_corner) * 0.001f;
+
+    for (size_t i = 0; i < staged.size(); i += staged_att){
+        for (int k = 0; k < 3; k++){
+            float value = staged[i + k];
+            if (fabs(value) > half_max || fabs(glm::unpackHalf1x16(glm::packHalf1x16(value)) - value) > tolerance){
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+InstanceRecord InstanceRecord::Pack(const glm::vec3& position, float scale, const glm::quat& rotation, int layer, const glm::vec4& tint){
+
+    InstanceRecord r;
+    r.position[0] = position.x;
+    r.position[1] = position.y;
+    r.position[2] = position.z;
+    r.scale = scale;
+
+    glm::quat q = glm::normalize(rotation);
+    const float components[4] = { q.x, q.y, q.z, q.w };
+    for (int k = 0; k < 4; k++){
+        r.rotation[k] = static_cast<GLshort>(std::round(glm::clamp(components[k], -1.0f, 1.0f) * 32767.0f));
+    }
+
+    r.layer = static_cast<GLushort>(layer);
+    r.reserved = 0;
+    for (int k = 0; k < 4; k++){
+        r.tint[k] = static_cast<GLubyte>(std::round(glm::clamp(tint[k], 0.0f, 1.0f) * 255.0f));
+    }
+
+    return r;
+}
+
+
+void SetupVertexFormat(VertexFormat format){
+
+    if (format == CompactFormat){
+        SetupVertexAttributes<CompactVertex>();
+    } else {
+        SetupVertexAttributes<StandardVertex>();
+    }
+}
+
+
+void SetupVertexFormat(VertexFormat format, const std::vector<GLuint>& locations){
+
+    if (format == CompactFormat){
+        SetupVertexAttributes<CompactVertex>(locations);
+    } else {
+        SetupVertexAttributes<StandardVertex>(locations);
+    }
+}
+
+
+size_t GetVertexSize(VertexFormat format){
+
+    if (format == CompactFormat){
+        return sizeof(CompactVertex);
+    }
+    return sizeof(StandardVertex);
+}
+
+
+std::vector<GLubyte> ReadVertices(GLuint array_buffer, VertexFormat from, VertexFormat to){
+
+    const int staged_att = 11;
+
+    GLint buffer_size;
+    glBindBuffer(GL_COPY_READ_BUFFER, array_buffer);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &buffer_size);
+    size_t vertex_count = buffer_size / GetVertexSize(from);
+
+    // Back to the staged layout, which is also that of StandardVertex
+    std::vector<GLfloat> staged(vertex_count * staged_att);
+    if (from == CompactFormat){
+        std::vector<CompactVertex> compact(vertex_count);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertex_count * sizeof(CompactVertex), compact.data());
+        for (size_t i = 0; i < vertex_count; i++){
+            compact[i].Unpack(&staged[i * staged_att]);
+        }
+    } else {
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, staged.size() * sizeof(GLfloat), staged.data());
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    std::vector<GLubyte> bytes(vertex_count * GetVertexSize(to));
+    if (to == CompactFormat){
+        std::vector<CompactVertex> packed = PackVertices<CompactVertex>(staged, staged_att);
+        std::copy((const GLubyte*)packed.data(), (const GLubyte*)packed.data() + bytes.size(), bytes.begin());
+    } else {
+        std::copy((const GLubyte*)staged.data(), (const GLubyte*)staged.data() + bytes.size(), bytes.begin());
+    }
+    return bytes;
+}
+
+
+void SetupInstanceAttributes(GLuint first_instance){
+
+    size_t base = first_instance * sizeof(InstanceRecord);
+    for (int i = 0; i < VertexLayout<InstanceRecord>::attribute_count; i++){
+        const VertexAttribute& att = VertexLayout<InstanceRecord>::attributes[i];
+        glVertexAttribPointer(att.location, att.size, att.type, att.normalized, sizeof(InstanceRecord), (void*)(base + att.offset));
+        glEnableVertexAttribArray(att.location);
+        glVertexAttribDivisor(att.location, 1);
+    }
+}
+
+
+void BindVertexAttributeLocations(GLuint program){
+
+    // Names that are not used by the program are ignored by OpenGL
+    glBindAttribLocation(program, VertexLocation, "vertex");
+    glBindAttribLocation(program, NormalLocation, "normal");
+    glBindAttribLocation(program, ColorLocation, "color");
+    glBindAttribLocation(program, UVLocation, "uv");
+    glBindAttribLocation(program, InstancePositionLocation, "instancePosition");
+    glBindAttribLocation(program, InstanceRotationLocation, "instanceRotation");
+    glBindAttribLocation(program, InstanceLayerLocation, "instanceLayer");
+    glBindAttribLocation(program, InstanceTintLocation, "instanceTint");
+    glBindAttribLocation(program, ParticlePositionLocation, "particlePosition");
+    glBindAttribLocation(program, ParticleVelocityLocation, "particleVelocity");
+    glBindAttribLocation(program, ParticleEmitterLocation, "particleEmitter");
+}
+
+} // namespace game
@@ -0,0 +1,176 @@
+#ifndef VERTEX_FORMAT_H_
+#define VERTEX_FORMAT_H_
+
+#include <cstddef>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+namespace game {
+
+    // Attribute locations shared by all materials. They are bound by name
+    // before linking, so a vertex array set up once works with any program
+    enum VertexAttributeLocation {
+        VertexLocation = 0,
+        NormalLocation = 1,
+        ColorLocation = 2,
+        UVLocation = 3,
+        InstancePositionLocation = 4, // Position of an instance, w: uniform scale
+        InstanceRotationLocation = 5, // Rotation quaternion
+        InstanceLayerLocation = 6, // Texture array layer of an instance
+        InstanceTintLocation = 7, // Color multiplying the texture of an instance
+        ParticlePositionLocation = 9, // Position and age of a simulated particle
+        ParticleVelocityLocation = 10, // Velocity and lifetime
+        ParticleEmitterLocation = 11 // Emitter the particle belongs to
+    };
+
+    // Possible layouts of geometry in a vertex buffer
+    typedef enum Format { StandardFormat, CompactFormat } VertexFormat;
+
+    // Description of one attribute inside a vertex
+    struct VertexAttribute {
+        GLuint location;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        size_t offset;
+    };
+
+    // Full precision vertex, 44 bytes: position, normal, color, texture coordinates
+    struct StandardVertex {
+        GLfloat position[3];
+        GLfloat normal[3];
+        GLfloat color[3];
+        GLfloat uv[2];
+
+        // Build from the 11 floats staged by MeshBuilder
+        static StandardVertex Pack(const GLfloat* staged);
+    };
+
+    // Compact vertex, 16 bytes: half float position (w = 1 pads to four
+    // bytes), signed 10_10_10_2 normal and half float texture coordinates.
+    // There is no color, shaders read the default (0, 0, 0, 1)
+    struct CompactVertex {
+        GLushort position[4];
+        GLuint normal;
+        GLushort uv[2];
+
+        static CompactVertex Pack(const GLfloat* staged);
+        // Back to 11 staged floats, with no color
+        void Unpack(GLfloat* staged) const;
+        // Whether the staged vertices keep their shape in half precision:
+        // the position error must stay below 1/1000 of the mesh extent.
+        // Vertices with a color never fit, since the color is dropped
+        static bool Fits(const std::vector<GLfloat>& staged);
+    };
+
+    // Instance of an instanced mesh, 32 bytes: position and uniform scale,
+    // a rotation quaternion in normalized shorts and the variation of the
+    // instance. Vertex shaders rebuild the transform from it; the normals
+    // only need the rotation
+    struct InstanceRecord {
+        GLfloat position[3];
+        GLfloat scale;
+        GLshort rotation[4]; // x, y, z, w
+        GLushort layer; // Texture array layer
+        GLushort reserved; // Keeps the tint four byte aligned
+        GLubyte tint[4];
+
+        static InstanceRecord Pack(const glm::vec3& position, float scale, const glm::quat& rotation, int layer = 0, const glm::vec4& tint = glm::vec4(1.0f));
+    };
+
+    // Attribute layout of each vertex type
+    template <typename V> struct VertexLayout;
+
+    template <> struct VertexLayout<StandardVertex> {
+        static constexpr int attribute_count = 4;
+        static constexpr VertexAttribute attributes[attribute_count] = {
+            { VertexLocation, 3, GL_FLOAT, GL_FALSE, offsetof(StandardVertex, position) },
+            { NormalLocation, 3, GL_FLOAT, GL_FALSE, offsetof(StandardVertex, normal) },
+            { ColorLocation, 3, GL_FLOAT, GL_FALSE, offsetof(StandardVertex, color) },
+            { UVLocation, 2, GL_FLOAT, GL_FALSE, offsetof(StandardVertex, uv) }
+        };
+    };
+
+    template <> struct VertexLayout<CompactVertex> {
+        static constexpr int attribute_count = 3;
+        static constexpr VertexAttribute attributes[attribute_count] = {
+            { VertexLocation, 3, GL_HALF_FLOAT, GL_FALSE, offsetof(CompactVertex, position) },
+            { NormalLocation, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(CompactVertex, normal) },
+            { UVLocation, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(CompactVertex, uv) }
+        };
+    };
+
+    // Enable the attributes of a vertex type in the bound vertex array,
+    // reading from the bound array buffer
+    template <typename V> void SetupVertexAttributes(void) {
+        for (int i = 0; i < VertexLayout<V>::attribute_count; i++) {
+            const VertexAttribute& att = VertexLayout<V>::attributes[i];
+            glVertexAttribPointer(att.location, att.size, att.type, att.normalized, sizeof(V), (void*)att.offset);
+            glEnableVertexAttribArray(att.location);
+        }
+    }
+
+    // Enable only the attributes of a vertex type at some locations, such
+    // as the position alone for a depth pass
+    template <typename V> void SetupVertexAttributes(const std::vector<GLuint>& locations) {
+        for (int i = 0; i < VertexLayout<V>::attribute_count; i++) {
+            const VertexAttribute& att = VertexLayout<V>::attributes[i];
+            for (size_t j = 0; j < locations.size(); j++) {
+                if (locations[j] == att.location) {
+                    glVertexAttribPointer(att.location, att.size, att.type, att.normalized, sizeof(V), (void*)att.offset);
+                    glEnableVertexAttribArray(att.location);
+                }
+            }
+        }
+    }
+
+    // Convert vertices staged as 11 floats each into a vertex type
+    template <typename V> std::vector<V> PackVertices(const std::vector<GLfloat>& staged, int staged_att) {
+        std::vector<V> packed(staged.size() / staged_att);
+        for (size_t i = 0; i < packed.size(); i++) {
+            packed[i] = V::Pack(&staged[i * staged_att]);
+        }
+        return packed;
+    }
+
+    template <> struct VertexLayout<InstanceRecord> {
+        static constexpr int attribute_count = 4;
+        static constexpr VertexAttribute attributes[attribute_count] = {
+            { InstancePositionLocation, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceRecord, position) },
+            { InstanceRotationLocation, 4, GL_SHORT, GL_TRUE, offsetof(InstanceRecord, rotation) },
+            { InstanceLayerLocation, 1, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(InstanceRecord, layer) },
+            { InstanceTintLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(InstanceRecord, tint) }
+        };
+    };
+
+    // Enable the instance attributes in the bound vertex array, reading
+    // one record per instance from the bound array buffer, starting
+    // 'first_instance' records in
+    void SetupInstanceAttributes(GLuint first_instance = 0);
+
+    // Enable the attributes of a vertex format selected at run time
+    void SetupVertexFormat(VertexFormat format);
+    void SetupVertexFormat(VertexFormat format, const std::vector<GLuint>& locations);
+    // Size in bytes of one vertex of the given format
+    size_t GetVertexSize(VertexFormat format);
+    // Read back the vertices of an array buffer stored in format 'from'
+    // and convert them to format 'to', so that meshes of both formats can
+    // share one vertex array. Widened compact vertices have no color
+    std::vector<GLubyte> ReadVertices(GLuint array_buffer, VertexFormat from, VertexFormat to);
+
+    // Bind the attribute names used by the shaders to their fixed
+    // locations; must be called before linking the program
+    void BindVertexAttributeLocations(GLuint program);
+
+    static_assert(sizeof(StandardVertex) == 44, "StandardVertex must be tightly packed");
+    static_assert(sizeof(CompactVertex) == 16, "CompactVertex must be tightly packed");
+    static_assert(sizeof(InstanceRecord) == 32, "InstanceRecord must be tightly packed");
+
+} // namespace game
+
+#endif // VERTEX_FORMAT_H_
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cmath>
+
+#include "world_grid.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WORLD_GRID_SSE2
+#endif
+
+namespace game {
+
+WorldGrid::WorldGrid(void){
+
+    width_ = 0;
+    height_ = 0;
+    passability_rows_ = 0;
+    passability_columns_ = 0;
+    passability_revision_ = 0;
+    mesh_origin_x_ = 0.0f;
+    mesh_origin_z_ = 0.0f;
+    mesh_cell_size_ = 1.0f;
+    position_ = glm::vec3(0.0f);
+    scale_ = glm::vec3(1.0f);
+    updatePlacement();
+}
+
+
+void WorldGrid::SetHeights(int width, int height, float origin_x, float origin_z, float cell_size, const std::vector<float>& heights){
+
+    width_ = width;
+    height_ = height;
+    heights_ = heights;
+    mesh_origin_x_ = origin_x;
+    mesh_origin_z_ = origin_z;
+    mesh_cell_size_ = cell_size;
+    updatePlacement();
+}
+
+
+void WorldGrid::SetPassability(const WorldGridFile& file){
+
+    passability_rows_ = file.GetPassabilityHeight();
+    passability_columns_ = file.GetPassabilityWidth();
+    impassable_.assign((static_cast<size_t>(passability_rows_) * passability_columns_ + 63) / 64, 0);
+    for (int i = 0; i < passability_rows_; i++){
+        for (int j = 0; j < passability_columns_; j++){
+            SetCellImpassable(i, j, file.IsImpassable(i, j));
+        }
+    }
+}
+
+
+void WorldGrid::SetTransform(const glm::vec3& position, const glm::vec3& scale){
+
+    position_ = position;
+    scale_ = scale;
+    updatePlacement();
+}
+
+
+void WorldGrid::updatePlacement(void){
+
+    origin_x_ = position_.x + scale_.x * mesh_origin_x_;
+    origin_z_ = position_.z + scale_.z * mesh_origin_z_;
+    inv_cell_size_x_ = 1.0f / (scale_.x * mesh_cell_size_);
+    inv_cell_size_z_ = 1.0f / (scale_.z * mesh_cell_size_);
+}
+
+
+float WorldGrid::heightAt(float x, float z) const {
+
+    if (width_ < 2 || height_ < 2){
+        return 0.0f;
+    }
+
+    // Position in cells, clamped to the grid
+    float gx = std::min(std::max((x - origin_x_) * inv_cell_size_x_, 0.0f), static_cast<float>(width_ - 1));
+    float gz = std::min(std::max((z - origin_z_) * inv_cell_size_z_, 0.0f), static_cast<float>(height_ - 1));
+    int i = std::min(static_cast<int>(gx), width_ - 2);
+    int j = std::min(static_cast<int>(gz), height_ - 2);
+    float fx = gx - i;
+    float fz = gz - j;
+
+    const float* h = &heights_[j * width_ + i];
+    float top = h[0] + fx * (h[1] - h[0]);
+    float bottom = h[width_] + fx * (h[width_ + 1] - h[width_]);
+
+    return (top + fz * (bottom - top)) * scale_.y;
+}
+
+
+float WorldGrid::GetHeight(float x, float z) const {
+
+    return heightAt(x, z);
+}
+
+
+void WorldGrid::GetHeights(const float* x, const float* z, float* heights, size_t count) const {
+
+    size_t i = 0;
+#ifdef WORLD_GRID_SSE2
+    if (width_ >= 2 && height_ >= 2){
+        const __m128 origin_x = _mm_set1_ps(origin_x_);
+        const __m128 origin_z = _mm_set1_ps(origin_z_);
+        const __m128 inv_x = _mm_set1_ps(inv_cell_size_x_);
+        const __m128 inv_z = _mm_set1_ps(inv_cell_size_z_);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 max_x = _mm_set1_ps(static_cast<float>(width_ - 1));
+        const __m128 max_z = _mm_set1_ps(static_cast<float>(height_ - 1));
+        const __m128 last_x = _mm_set1_ps(static_cast<float>(width_ - 2));
+        const __m128 last_z = _mm_set1_ps(static_cast<float>(height_ - 2));
+        const __m128 width = _mm_set1_ps(static_cast<float>(width_));
+        const __m128 scale = _mm_set1_ps(scale_.y);
+        const float* h = heights_.data();
+
+        for (; i + 4 <= count; i += 4){
+            // Position in cells, clamped to the grid
+            __m128 gx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), origin_x), inv_x);
+            __m128 gz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(z + i), origin_z), inv_z);
+            gx = _mm_min_ps(_mm_max_ps(gx, zero), max_x);
+            gz = _mm_min_ps(_mm_max_ps(gz, zero), max_z);
+
+            // Cell corner and fraction; truncation is a floor here, as
+            // the positions are not negative
+            __m128 cx = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(gx)), last_x);
+            __m128 cz = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(gz)), last_z);
+            __m128 fx = _mm_sub_ps(gx, cx);
+            __m128 fz = _mm_sub_ps(gz, cz);
+
+            // Index of the corner; exact in floats for grids of up to 4096x4096
+            alignas(16) int base[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(base), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(cz, width), cx)));
+
+            // Gather the four corners of each cell
+            __m128 h00 = _mm_set_ps(h[base[3]], h[base[2]], h[base[1]], h[base[0]]);
+            __m128 h01 = _mm_set_ps(h[base[3] + 1], h[base[2] + 1], h[base[1] + 1], h[base[0] + 1]);
+            __m128 h10 = _mm_set_ps(h[base[3] + width_], h[base[2] + width_], h[base[1] + width_], h[base[0] + width_]);
+            __m128 h11 = _mm_set_ps(h[base[3] + width_ + 1], h[base[2] + width_ + 1], h[base[1] + width_ + 1], h[base[0] + width_ + 1]);
+
+            __m128 top = _mm_add_ps(h00, _mm_mul_ps(fx, _mm_sub_ps(h01, h00)));
+            __m128 bottom = _mm_add_ps(h10, _mm_mul_ps(fx, _mm_sub_ps(h11, h10)));
+            __m128 result = _mm_add_ps(top, _mm_mul_ps(fz, _mm_sub_ps(bottom, top)));
+            _mm_storeu_ps(heights + i, _mm_mul_ps(result, scale));
+        }
+    }
+#endif
+    for (; i < count; i++){
+        heights[i] = heightAt(x[i], z[i]);
+    }
+}
+
+
+bool WorldGrid::passableAt(float x, float z) const {
+
+    float gx = (x - origin_x_) * inv_cell_size_x_;
+    float gz = (z - origin_z_) * inv_cell_size_z_;
+    if (!(gx >= 0.0f && gx < passability_rows_ && gz >= 0.0f && gz < passability_columns_)){
+        return false;
+    }
+
+    return !IsCellImpassable(static_cast<int>(gx), static_cast<int>(gz));
+}
+
+
+bool WorldGrid::IsPassable(float x, float z) const {
+
+    return passableAt(x, z);
+}
+
+
+void WorldGrid::GetPassable(const float* x, const float* z, bool* passable, size_t count) const {
+
+    size_t i = 0;
+#ifdef WORLD_GRID_SSE2
+    const __m128 origin_x = _mm_set1_ps(origin_x_);
+    const __m128 origin_z = _mm_set1_ps(origin_z_);
+    const __m128 inv_x = _mm_set1_ps(inv_cell_size_x_);
+    const __m128 inv_z = _mm_set1_ps(inv_cell_size_z_);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 rows = _mm_set1_ps(static_cast<float>(passability_rows_));
+    const __m128 columns = _mm_set1_ps(static_cast<float>(passability_columns_));
+
+    for (; i + 4 <= count; i += 4){
+        __m128 gx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), origin_x), inv_x);
+        __m128 gz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(z + i), origin_z), inv_z);
+
+        // Positions outside the grid may not be walked on
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(gx, zero), _mm_cmplt_ps(gx, rows)),
+            _mm_and_ps(_mm_cmpge_ps(gz, zero), _mm_cmplt_ps(gz, columns)));
+        int mask = _mm_movemask_ps(inside);
+
+        // Bit of the cell; exact in floats for grids of up to 4096x4096
+        __m128 cell = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(gx)), columns), _mm_cvtepi32_ps(_mm_cvttps_epi32(gz)));
+        alignas(16) int bit[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(bit), _mm_cvttps_epi32(cell));
+
+        for (int k = 0; k < 4; k++){
+            passable[i + k] = ((mask >> k) & 1) && !((impassable_[bit[k] >> 6] >> (bit[k] & 63)) & 1);
+        }
+    }
+#endif
+    for (; i < count; i++){
+        passable[i] = passableAt(x[i], z[i]);
+    }
+}
+
+
+int WorldGrid::GetColumn(float x) const {
+
+    return static_cast<int>(std::floor((x - origin_x_) * inv_cell_size_x_));
+}
+
+
+int WorldGrid::GetRow(float z) const {
+
+    return static_cast<int>(std::floor((z - origin_z_) * inv_cell_size_z_));
+}
+
+
+int WorldGrid::GetVertexColumns(void) const {
+
+    return width_;
+}
+
+
+int WorldGrid::GetVertexRows(void) const {
+
+    return height_;
+}
+
+
+float WorldGrid::GetMeshX(int column) const {
+
+    return mesh_origin_x_ + column * mesh_cell_size_;
+}
+
+
+float WorldGrid::GetMeshZ(int row) const {
+
+    return mesh_origin_z_ + row * mesh_cell_size_;
+}
+
+
+float WorldGrid::GetWorldX(int column) const {
+
+    return position_.x + scale_.x * GetMeshX(column);
+}
+
+
+float WorldGrid::GetWorldZ(int row) const {
+
+    return position_.z + scale_.z * GetMeshZ(row);
+}
+
+
+const glm::vec3& WorldGrid::GetPosition(void) const {
+
+    return position_;
+}
+
+
+const glm::vec3& WorldGrid::GetScale(void) const {
+
+    return scale_;
+}
+
+
+float WorldGrid::GetCellHeight(int row, int column) const {
+
+    return heights_[row * width_ + column];
+}
+
+
+void WorldGrid::SetCellHeight(int row, int column, float height){
+
+    heights_[row * width_ + column] = height;
+}
+
+
+bool WorldGrid::IsCellImpassable(int x, int z) const {
+
+    size_t bit = static_cast<size_t>(x) * passability_columns_ + z;
+    return (impassable_[bit >> 6] >> (bit & 63)) & 1;
+}
+
+
+void WorldGrid::SetCellImpassable(int x, int z, bool impassable){
+
+    passability_revision_++;
+    size_t bit = static_cast<size_t>(x) * passability_columns_ + z;
+    if (impassable){
+        impassable_[bit >> 6] |= uint64_t(1) << (bit & 63);
+    } else {
+        impassable_[bit >> 6] &= ~(uint64_t(1) << (bit & 63));
+    }
+}
+
+
+int WorldGrid::GetPassabilityRows(void) const {
+
+    return passability_rows_;
+}
+
+
+int WorldGrid::GetPassabilityColumns(void) const {
+
+    return passability_columns_;
+}
+
+
+const std::vector<uint64_t>& WorldGrid::GetImpassableBits(void) const {
+
+    return impassable_;
+}
+
+
+uint32_t WorldGrid::GetPassabilityRevision(void) const {
+
+    return passability_revision_;
+}
+
+} // namespace game
@@ -0,0 +1,111 @@
+#ifndef WORLD_GRID_H_
+#define WORLD_GRID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "world_grid_file.h"
+
+namespace game {
+
+    // Heights and passability of the world, shared by everything that
+    // needs to stand on the terrain or test where it may walk. Heights are
+    // kept row by row (rows along z) in one array, passability as a bitset.
+    // Queries take world positions and use the transform of the terrain
+    // node, so that they match the rendered mesh
+    class WorldGrid {
+
+        public:
+            WorldGrid(void);
+
+            // Set the heights of the terrain mesh: width x height vertices,
+            // row by row, in the mesh space given by origin and cell size
+            void SetHeights(int width, int height, float origin_x, float origin_z, float cell_size, const std::vector<float>& heights);
+            // Copy the passability bitset of a baked world grid
+            void SetPassability(const WorldGridFile& file);
+            // Place the grid like the terrain node that draws it
+            void SetTransform(const glm::vec3& position, const glm::vec3& scale);
+
+            // Height of the terrain at a world position, interpolated
+            // bilinearly. Positions outside the grid get the height of
+            // the nearest edge
+            float GetHeight(float x, float z) const;
+            // Heights at 'count' positions given as separate x and z arrays
+            void GetHeights(const float* x, const float* z, float* heights, size_t count) const;
+
+            // Whether a world position may be walked on; positions outside
+            // the passability grid may not
+            bool IsPassable(float x, float z) const;
+            // Passability of 'count' positions given as separate x and z arrays
+            void GetPassable(const float* x, const float* z, bool* passable, size_t count) const;
+
+            // Cell of a world position, along x and along z
+            int GetColumn(float x) const;
+            int GetRow(float z) const;
+
+            // Vertices of the heightfield, along x and along z
+            int GetVertexColumns(void) const;
+            int GetVertexRows(void) const;
+            // Position of a vertex column or row, in the mesh space of the
+            // terrain and in the world
+            float GetMeshX(int column) const;
+            float GetMeshZ(int row) const;
+            float GetWorldX(int column) const;
+            float GetWorldZ(int row) const;
+            // Transform of the terrain node
+            const glm::vec3& GetPosition(void) const;
+            const glm::vec3& GetScale(void) const;
+
+            // Direct access to single cells. Height rows run along z, while
+            // passability rows run along x, as in impassable.csv
+            float GetCellHeight(int row, int column) const;
+            void SetCellHeight(int row, int column, float height);
+            bool IsCellImpassable(int x, int z) const;
+            void SetCellImpassable(int x, int z, bool impassable);
+            // Cells of the passability grid, along x and along z
+            int GetPassabilityRows(void) const;
+            int GetPassabilityColumns(void) const;
+            // Passability bitset, one bit per cell row by row, set where impassable
+            const std::vector<uint64_t>& GetImpassableBits(void) const;
+            // Changes every time a cell is made passable or impassable
+            uint32_t GetPassabilityRevision(void) const;
+
+        private:
+            // Derive the world space placement
+            void updatePlacement(void);
+            // Scalar versions of the queries, also used for the ends of
+            // the batches
+            float heightAt(float x, float z) const;
+            bool passableAt(float x, float z) const;
+
+            int width_; // Vertices of the heightfield
+            int height_;
+            std::vector<float> heights_;
+
+            int passability_rows_; // Cells along x
+            int passability_columns_; // Cells along z
+            std::vector<uint64_t> impassable_;
+            uint32_t passability_revision_;
+
+            // Mesh space placement of the vertices
+            float mesh_origin_x_;
+            float mesh_origin_z_;
+            float mesh_cell_size_;
+
+            // Transform of the terrain node
+            glm::vec3 position_;
+            glm::vec3 scale_;
+
+            // World space placement, derived from the above
+            float origin_x_;
+            float origin_z_;
+            float inv_cell_size_x_;
+            float inv_cell_size_z_;
+
+    }; // class WorldGrid
+
+} // namespace game
+
+#endif // WORLD_GRID_H_
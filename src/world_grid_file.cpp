@@ -0,0 +1,342 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <sstream>
+
+#include "world_grid_file.h"
+#include "path_config.h"
+
+namespace game {
+
+namespace {
+
+    const char world_grid_magic[4] = { 'W', 'G', 'R', 'D' };
+
+    uint64_t AlignOffset(uint64_t offset){
+
+        return (offset + WorldGridFile::blob_alignment - 1) / WorldGridFile::blob_alignment * WorldGridFile::blob_alignment;
+    }
+
+
+    uint64_t HashBytes(uint64_t hash, const void* data, size_t size){
+
+        const uint64_t fnv_prime = 1099511628211ull;
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++){
+            hash = (hash ^ bytes[i]) * fnv_prime;
+        }
+        return hash;
+    }
+
+
+    std::string ReadFile(const char* filename){
+
+        std::ifstream f(filename, std::ios::binary);
+        if (!f){
+            throw(std::ios_base::failure(std::string("Error opening file ") + std::string(filename)));
+        }
+        std::ostringstream content;
+        content << f.rdbuf();
+        return content.str();
+    }
+
+
+    bool IsBlank(char c){
+
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+} // namespace
+
+
+WorldGridFile::WorldGridFile(void){
+
+    memset(&header_, 0, sizeof(header_));
+}
+
+
+uint64_t WorldGridFile::StampFiles(const std::vector<std::string>& filenames){
+
+    uint64_t stamp = 14695981039346656037ull;
+    uint32_t salt = version;
+    stamp = HashBytes(stamp, &salt, sizeof(salt));
+
+    for (size_t i = 0; i < filenames.size(); i++){
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(filenames[i], error);
+        if (error){
+            throw(std::ios_base::failure(std::string("Error opening file ") + filenames[i]));
+        }
+        int64_t time = std::filesystem::last_write_time(filenames[i], error).time_since_epoch().count();
+
+        stamp = HashBytes(stamp, filenames[i].c_str(), filenames[i].size() + 1);
+        stamp = HashBytes(stamp, &size, sizeof(size));
+        stamp = HashBytes(stamp, &time, sizeof(time));
+    }
+
+    return stamp;
+}
+
+
+std::string WorldGridFile::GetCachePath(uint64_t source_stamp){
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.wgrid", static_cast<unsigned long long>(source_stamp));
+
+    return std::string(WORLD_GRID_CACHE_DIRECTORY) + "/" + name;
+}
+
+
+void WorldGridFile::Convert(const char* heightfield_filename, const char* passability_filename, uint64_t source_stamp, float cell_size, std::vector<unsigned char>& blob){
+
+    // Heightfield: rows of space separated "height,u,v" triples
+    std::string text = ReadFile(heightfield_filename);
+    std::vector<float> heights;
+    std::vector<float> uvs;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    const char* c = text.c_str();
+    const char* end = c + text.size();
+    while (c < end){
+        uint32_t columns = 0;
+        while (c < end && *c != '\n'){
+            if (IsBlank(*c)){
+                c++;
+                continue;
+            }
+            char* next;
+            float value[3];
+            for (int k = 0; k < 3; k++){
+                value[k] = strtof(c, &next);
+                if (next == c){
+                    throw(std::ios_base::failure(std::string("Malformed heightfield ") + std::string(heightfield_filename)));
+                }
+                c = (k < 2 && *next == ',') ? next + 1 : next;
+            }
+            heights.push_back(value[0]);
+            uvs.push_back(value[1]);
+            uvs.push_back(value[2]);
+            columns++;
+        }
+        c++;
+
+        // Blank lines, such as a trailing one, are not rows
+        if (columns == 0){
+            continue;
+        }
+        if (height == 0){
+            width = columns;
+        } else if (columns != width){
+            throw(std::ios_base::failure(std::string("Rows of different length in heightfield ") + std::string(heightfield_filename)));
+        }
+        height++;
+    }
+
+    // Passability: rows of comma separated 0/1 cells
+    text = ReadFile(passability_filename);
+    std::vector<unsigned char> cells;
+    uint32_t passability_width = 0;
+    uint32_t passability_height = 0;
+
+    c = text.c_str();
+    end = c + text.size();
+    while (c < end){
+        uint32_t columns = 0;
+        while (c < end && *c != '\n'){
+            if (IsBlank(*c) || *c == ','){
+                c++;
+                continue;
+            }
+            cells.push_back(*c == '1' ? 1 : 0);
+            columns++;
+            c++;
+        }
+        c++;
+
+        if (columns == 0){
+            continue;
+        }
+        if (passability_height == 0){
+            passability_width = columns;
+        } else if (columns != passability_width){
+            throw(std::ios_base::failure(std::string("Rows of different length in ") + std::string(passability_filename)));
+        }
+        passability_height++;
+    }
+
+    WorldGridFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, world_grid_magic, sizeof(world_grid_magic));
+    header.version = version;
+    header.source_stamp = source_stamp;
+    header.width = width;
+    header.height = height;
+    header.passability_width = passability_width;
+    header.passability_height = passability_height;
+    header.cell_size = cell_size;
+    // The placement the terrain mesh has always used
+    header.origin_x = -static_cast<float>(width >> 2) * cell_size;
+    header.origin_z = -static_cast<float>(height >> 2) * cell_size;
+    header.heights_offset = AlignOffset(sizeof(header));
+    header.uvs_offset = AlignOffset(header.heights_offset + heights.size() * sizeof(float));
+    header.passability_offset = AlignOffset(header.uvs_offset + uvs.size() * sizeof(float));
+
+    blob.assign(header.passability_offset + (cells.size() + 7) / 8, 0);
+    memcpy(&blob[0], &header, sizeof(header));
+    if (!heights.empty()){
+        memcpy(&blob[header.heights_offset], heights.data(), heights.size() * sizeof(float));
+        memcpy(&blob[header.uvs_offset], uvs.data(), uvs.size() * sizeof(float));
+    }
+    for (size_t i = 0; i < cells.size(); i++){
+        if (cells[i]){
+            blob[header.passability_offset + i / 8] |= 1 << (i % 8);
+        }
+    }
+
+}
+
+
+bool WorldGridFile::Store(const std::string& cache_path, const std::vector<unsigned char>& blob){
+
+    return WriteCacheFile(WORLD_GRID_CACHE_DIRECTORY, cache_path, blob);
+}
+
+
+bool WorldGridFile::Bake(const char* heightfield_filename, const char* passability_filename, const std::string& cache_path, uint64_t source_stamp, float cell_size){
+
+    std::vector<unsigned char> blob;
+    Convert(heightfield_filename, passability_filename, source_stamp, cell_size, blob);
+    return Store(cache_path, blob);
+}
+
+
+bool WorldGridFile::Open(const std::string& cache_path, uint64_t source_stamp){
+
+    memory_.clear();
+    if (!file_.Map(cache_path) || !validate(file_.GetData(), file_.GetSize(), source_stamp)){
+        file_.Unmap();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool WorldGridFile::Open(std::vector<unsigned char>& blob, uint64_t source_stamp){
+
+    file_.Unmap();
+    memory_.clear();
+    if (!validate(blob.data(), blob.size(), source_stamp)){
+        return false;
+    }
+
+    // The vector's storage comes from operator new, so the blobs stay
+    // aligned as in a mapping
+    memory_.swap(blob);
+    return true;
+}
+
+
+bool WorldGridFile::validate(const unsigned char* data, size_t size, uint64_t source_stamp){
+
+    if (size < sizeof(WorldGridFileHeader)){
+        memset(&header_, 0, sizeof(header_));
+        return false;
+    }
+
+    // Validate the header and the blob ranges before handing out pointers
+    memcpy(&header_, data, sizeof(header_));
+    uint64_t vertices = static_cast<uint64_t>(header_.width) * header_.height;
+    uint64_t cells = static_cast<uint64_t>(header_.passability_width) * header_.passability_height;
+    if (memcmp(header_.magic, world_grid_magic, sizeof(world_grid_magic)) != 0 ||
+        header_.version != version || header_.source_stamp != source_stamp ||
+        header_.heights_offset % sizeof(float) != 0 || header_.uvs_offset % sizeof(float) != 0 ||
+        header_.heights_offset + vertices * sizeof(float) > size ||
+        header_.uvs_offset + vertices * 2 * sizeof(float) > size ||
+        header_.passability_offset + (cells + 7) / 8 > size){
+        memset(&header_, 0, sizeof(header_));
+        return false;
+    }
+
+    return true;
+}
+
+
+const unsigned char* WorldGridFile::getData(void) const {
+
+    return file_.IsMapped() ? file_.GetData() : memory_.data();
+}
+
+
+uint32_t WorldGridFile::GetWidth(void) const {
+
+    return header_.width;
+}
+
+
+uint32_t WorldGridFile::GetHeight(void) const {
+
+    return header_.height;
+}
+
+
+float WorldGridFile::GetCellSize(void) const {
+
+    return header_.cell_size;
+}
+
+
+float WorldGridFile::GetOriginX(void) const {
+
+    return header_.origin_x;
+}
+
+
+float WorldGridFile::GetOriginZ(void) const {
+
+    return header_.origin_z;
+}
+
+
+uint32_t WorldGridFile::GetPassabilityWidth(void) const {
+
+    return header_.passability_width;
+}
+
+
+uint32_t WorldGridFile::GetPassabilityHeight(void) const {
+
+    return header_.passability_height;
+}
+
+
+float WorldGridFile::GetHeight(uint32_t row, uint32_t column) const {
+
+    return GetHeights()[row * header_.width + column];
+}
+
+
+const float* WorldGridFile::GetHeights(void) const {
+
+    return reinterpret_cast<const float*>(getData() + header_.heights_offset);
+}
+
+
+const float* WorldGridFile::GetUVs(void) const {
+
+    return reinterpret_cast<const float*>(getData() + header_.uvs_offset);
+}
+
+
+bool WorldGridFile::IsImpassable(uint32_t row, uint32_t column) const {
+
+    size_t bit = static_cast<size_t>(row) * header_.passability_width + column;
+    return (getData()[header_.passability_offset + bit / 8] >> (bit % 8)) & 1;
+}
+
+} // namespace game
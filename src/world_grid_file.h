@@ -0,0 +1,104 @@
+#ifndef WORLD_GRID_FILE_H_
+#define WORLD_GRID_FILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace game {
+
+    // Layout of a baked world grid. All blobs start on a multiple of
+    // blob_alignment and are used straight from a mapping:
+    //   WorldGridFileHeader
+    //   heights: width * height floats, row by row
+    //   uvs: width * height pairs of floats
+    //   passability: one bit per cell of the passability grid, row by
+    //   row, set for impassable cells
+    struct WorldGridFileHeader {
+        char magic[4]; // "WGRD"
+        uint32_t version;
+        uint64_t source_stamp; // Stamp of the source files, see WorldGridFile::StampFiles
+        uint32_t width; // Vertices of the heightfield
+        uint32_t height;
+        uint32_t passability_width; // Cells of the passability grid
+        uint32_t passability_height;
+        float cell_size; // Distance between neighbouring vertices
+        float origin_x; // Position of the first vertex
+        float origin_z;
+        uint32_t reserved;
+        uint64_t heights_offset; // Byte offsets from the start of the file
+        uint64_t uvs_offset;
+        uint64_t passability_offset;
+    };
+
+    // Heightfield and passability of the world, baked from the text
+    // heightfield and csv files into the format above and kept in
+    // WORLD_GRID_CACHE_DIRECTORY. Opening a baked grid only maps the file.
+    // If the cache cannot be written, a converted grid is served from memory
+    class WorldGridFile {
+
+        public:
+            // Bump when the format or the conversion changes
+            static const uint32_t version = 1;
+            static const size_t blob_alignment = 16;
+
+            WorldGridFile(void);
+
+            // Stamp the source files by path, size and modification time.
+            // Unlike meshes, world files are too large to hash on every
+            // launch. Throws if a file does not exist
+            static uint64_t StampFiles(const std::vector<std::string>& filenames);
+            // Cache file for the given source stamp
+            static std::string GetCachePath(uint64_t source_stamp);
+
+            // Convert a text heightfield ("height,u,v" per vertex, one row
+            // per line) and a passability csv (1 for impassable cells)
+            // into the format above. Throws if a file cannot be read or
+            // is malformed
+            static void Convert(const char* heightfield_filename, const char* passability_filename, uint64_t source_stamp, float cell_size, std::vector<unsigned char>& blob);
+            // Write a converted grid to the cache. Returns false on failure
+            static bool Store(const std::string& cache_path, const std::vector<unsigned char>& blob);
+            // Convert and store in one go. Throws as Convert; returns false
+            // if the cache cannot be written
+            static bool Bake(const char* heightfield_filename, const char* passability_filename, const std::string& cache_path, uint64_t source_stamp, float cell_size);
+
+            // Map a baked grid. Returns false if there is no valid entry
+            bool Open(const std::string& cache_path, uint64_t source_stamp);
+            // Use a converted grid held in memory, taking its contents.
+            // Returns false if it is not valid
+            bool Open(std::vector<unsigned char>& blob, uint64_t source_stamp);
+
+            uint32_t GetWidth(void) const;
+            uint32_t GetHeight(void) const;
+            float GetCellSize(void) const;
+            float GetOriginX(void) const;
+            float GetOriginZ(void) const;
+            uint32_t GetPassabilityWidth(void) const;
+            uint32_t GetPassabilityHeight(void) const;
+
+            // Height of the vertex at the given row and column
+            float GetHeight(uint32_t row, uint32_t column) const;
+            // All heights, row by row
+            const float* GetHeights(void) const;
+            // All texture coordinates, two per vertex
+            const float* GetUVs(void) const;
+            // Whether a cell of the passability grid is impassable
+            bool IsImpassable(uint32_t row, uint32_t column) const;
+
+        private:
+            // Check the header of a grid and the ranges of its blobs
+            bool validate(const unsigned char* data, size_t size, uint64_t source_stamp);
+            // Start of the grid, mapped or in memory
+            const unsigned char* getData(void) const;
+
+            MappedFile file_;
+            std::vector<unsigned char> memory_; // Grid that could not be cached
+            WorldGridFileHeader header_;
+
+    }; // class WorldGridFile
+
+} // namespace game
+
+#endif // WORLD_GRID_FILE_H_
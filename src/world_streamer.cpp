@@ -0,0 +1,563 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+#include "entities.h"
+#include "scene_node.h"
+#include "world_streamer.h"
+
+namespace game {
+
+namespace {
+
+    const int vertex_att = 11; // Position (3), normal (3), tangent (3), texture coordinates (2)
+
+    int FloorDiv(int a, int b){
+
+        return (a >= 0) ? a / b : -((-a + b - 1) / b);
+    }
+
+
+    float AreaOf(const PlacementArea& area){
+
+        return std::max(area.max_x - area.min_x, 0.0f) * std::max(area.max_z - area.min_z, 0.0f);
+    }
+
+} // namespace
+
+
+WorldStreamer::WorldStreamer(SceneGraph& scene, CollisionWorld& collision_world)
+    : scene_(scene), collision_world_(collision_world){
+
+    file_ = NULL;
+    chunk_columns_ = 0;
+    chunk_rows_ = 0;
+    stop_ = false;
+    center_x_ = 0;
+    center_z_ = 0;
+    has_center_ = false;
+    instances_dirty_ = false;
+    flush_time_ = 0.0;
+}
+
+
+WorldStreamer::~WorldStreamer(){
+
+    // Only stop the worker; the GL objects go with the context
+    if (worker_.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_condition_.notify_all();
+        worker_.join();
+    }
+    for (size_t i = 0; i < finished_.size(); i++){
+        delete finished_[i];
+    }
+    for (size_t i = 0; i < ready_.size(); i++){
+        delete ready_[i];
+    }
+    for (std::unordered_map<ChunkKey, Chunk*>::iterator it = resident_.begin(); it != resident_.end(); ++it){
+        delete it->second->data;
+        delete it->second;
+    }
+}
+
+
+WorldStreamer::ChunkKey WorldStreamer::MakeKey(int x, int z){
+
+    return (static_cast<ChunkKey>(x) << 32) | static_cast<uint32_t>(z);
+}
+
+
+int WorldStreamer::KeyX(ChunkKey key){
+
+    return static_cast<int>(key >> 32);
+}
+
+
+int WorldStreamer::KeyZ(ChunkKey key){
+
+    return static_cast<int>(static_cast<uint32_t>(key));
+}
+
+
+int WorldStreamer::distanceToCenter(ChunkKey key) const {
+
+    int dx = KeyX(key) - center_x_;
+    int dz = KeyZ(key) - center_z_;
+    return dx * dx + dz * dz;
+}
+
+
+void WorldStreamer::Start(const WorldGrid& ground, const WorldGridFile& file, const WorldStreamerSettings& settings){
+
+    Stop();
+
+    ground_ = ground;
+    file_ = &file;
+    settings_ = settings;
+    int cells = settings_.chunk_cells;
+    chunk_columns_ = (ground_.GetVertexColumns() - 1 + cells - 1) / cells;
+    chunk_rows_ = (ground_.GetVertexRows() - 1 + cells - 1) / cells;
+
+    // One family per group for all resident chunks, empty until the
+    // first chunks arrive
+    for (size_t i = 0; i < settings_.groups.size(); i++){
+        const StreamedGroup& group = settings_.groups[i];
+        std::vector<InstancedFamilyMember> members(group.members.size());
+        for (size_t j = 0; j < members.size(); j++){
+            members[j].geometry = group.members[j].geometry;
+            members[j].layer = group.members[j].layer;
+        }
+        InstancedFamily* family = new InstancedFamily(group.name, members, group.material, group.texture_array);
+        scene_.AddNode(family);
+        families_.push_back(family);
+    }
+
+    stop_ = false;
+    worker_ = std::thread(&WorldStreamer::workerLoop, this);
+}
+
+
+void WorldStreamer::Stop(void){
+
+    if (worker_.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_condition_.notify_all();
+        worker_.join();
+    }
+
+    pending_.clear();
+    for (size_t i = 0; i < finished_.size(); i++){
+        delete finished_[i];
+    }
+    finished_.clear();
+    for (size_t i = 0; i < ready_.size(); i++){
+        delete ready_[i];
+    }
+    ready_.clear();
+    requested_.clear();
+
+    for (std::unordered_map<ChunkKey, Chunk*>::iterator it = resident_.begin(); it != resident_.end(); ++it){
+        unloadChunk(it->second);
+    }
+    resident_.clear();
+    for (size_t i = 0; i < families_.size(); i++){
+        scene_.DeleteNode(settings_.groups[i].name);
+    }
+    families_.clear();
+
+    has_center_ = false;
+    instances_dirty_ = false;
+}
+
+
+void WorldStreamer::Update(const glm::vec3& position){
+
+    update(position, settings_.upload_budget);
+}
+
+
+void WorldStreamer::Flush(const glm::vec3& position){
+
+    double start_time = glfwGetTime();
+
+    update(position, SIZE_MAX);
+    while (!requested_.empty()){
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_condition_.wait(lock, [this]{ return !finished_.empty(); });
+        }
+        update(position, SIZE_MAX);
+    }
+
+    flush_time_ = (glfwGetTime() - start_time) * 1000.0;
+}
+
+
+size_t WorldStreamer::GetResidentCount(void) const {
+
+    return resident_.size();
+}
+
+
+void WorldStreamer::PrintStats(void) const {
+
+    std::cout << "World streaming: " << resident_.size() << " chunks resident, last flush took " <<
+        flush_time_ << " ms" << std::endl;
+}
+
+
+void WorldStreamer::update(const glm::vec3& position, size_t budget){
+
+    if (families_.size() != settings_.groups.size() || !worker_.joinable()){
+        return;
+    }
+
+    int cells = settings_.chunk_cells;
+    int x = FloorDiv(ground_.GetColumn(position.x), cells);
+    int z = FloorDiv(ground_.GetRow(position.z), cells);
+    if (!has_center_ || x != center_x_ || z != center_z_){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            center_x_ = x;
+            center_z_ = z;
+        }
+        has_center_ = true;
+        refreshRing();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.insert(ready_.end(), finished_.begin(), finished_.end());
+        finished_.clear();
+    }
+
+    // Nearest chunks first, until the budget is spent
+    std::sort(ready_.begin(), ready_.end(), [this](const ChunkData* a, const ChunkData* b){
+        return distanceToCenter(a->key) < distanceToCenter(b->key);
+    });
+    size_t spent = 0;
+    size_t used = 0;
+    for (; used < ready_.size() && spent < budget; used++){
+        ChunkData* data = ready_[used];
+        if (requested_.count(data->key) == 0 || resident_.count(data->key) != 0){
+            // Left behind, or built twice
+            delete data;
+            continue;
+        }
+        requested_.erase(data->key);
+        spent += uploadChunk(data);
+    }
+    ready_.erase(ready_.begin(), ready_.begin() + used);
+
+    if (instances_dirty_){
+        uploadInstances();
+        instances_dirty_ = false;
+    }
+}
+
+
+void WorldStreamer::refreshRing(void){
+
+    int load = settings_.load_radius * settings_.load_radius;
+    int unload = settings_.unload_radius * settings_.unload_radius;
+
+    // Unload the chunks left behind
+    for (std::unordered_map<ChunkKey, Chunk*>::iterator it = resident_.begin(); it != resident_.end();){
+        if (distanceToCenter(it->first) > unload){
+            unloadChunk(it->second);
+            it = resident_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Forget the requests left behind; those still on their way are
+    // dropped when they arrive
+    for (std::unordered_set<ChunkKey>::iterator it = requested_.begin(); it != requested_.end();){
+        if (distanceToCenter(*it) > unload){
+            it = requested_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Request the chunks in the ring that are missing
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.erase(std::remove_if(pending_.begin(), pending_.end(), [this](ChunkKey key){
+            return requested_.count(key) == 0;
+        }), pending_.end());
+
+        int radius = settings_.load_radius;
+        for (int dz = -radius; dz <= radius; dz++){
+            for (int dx = -radius; dx <= radius; dx++){
+                int x = center_x_ + dx;
+                int z = center_z_ + dz;
+                if (dx * dx + dz * dz > load || x < 0 || z < 0 || x >= chunk_columns_ || z >= chunk_rows_){
+                    continue;
+                }
+                ChunkKey key = MakeKey(x, z);
+                if (resident_.count(key) == 0 && requested_.count(key) == 0){
+                    requested_.insert(key);
+                    pending_.push_back(key);
+                }
+            }
+        }
+    }
+    work_condition_.notify_one();
+}
+
+
+void WorldStreamer::workerLoop(void){
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true){
+        work_condition_.wait(lock, [this]{ return stop_ || !pending_.empty(); });
+        if (stop_){
+            return;
+        }
+
+        // Build the chunk nearest to the player first
+        size_t nearest = 0;
+        for (size_t i = 1; i < pending_.size(); i++){
+            if (distanceToCenter(pending_[i]) < distanceToCenter(pending_[nearest])){
+                nearest = i;
+            }
+        }
+        ChunkKey key = pending_[nearest];
+        pending_[nearest] = pending_.back();
+        pending_.pop_back();
+
+        lock.unlock();
+        ChunkData* data = buildChunk(key);
+        lock.lock();
+
+        finished_.push_back(data);
+        done_condition_.notify_all();
+    }
+}
+
+
+WorldStreamer::ChunkData* WorldStreamer::buildChunk(ChunkKey key) const {
+
+    ChunkData* data = new ChunkData;
+    data->key = key;
+
+    // Vertices of the chunk, sharing its border rows with the neighbours
+    int columns = ground_.GetVertexColumns();
+    int rows = ground_.GetVertexRows();
+    int c0 = KeyX(key) * settings_.chunk_cells;
+    int r0 = KeyZ(key) * settings_.chunk_cells;
+    int c1 = std::min(c0 + settings_.chunk_cells, columns - 1);
+    int r1 = std::min(r0 + settings_.chunk_cells, rows - 1);
+    int width = c1 - c0 + 1;
+    int height = r1 - r0 + 1;
+
+    // Terrain patch, laid out as the whole terrain mesh used to be: normals
+    // point up and tangents point to the next vertex of the full grid
+    const float* uvs = file_->GetUVs();
+    data->vertices.resize(width * height * vertex_att);
+    GLfloat* vertex = data->vertices.data();
+    for (int r = r0; r <= r1; r++){
+        for (int c = c0; c <= c1; c++){
+            glm::vec3 position(ground_.GetMeshX(c), ground_.GetCellHeight(r, c), ground_.GetMeshZ(r));
+
+            int nr = r, nc = c;
+            if (c != columns - 1){
+                nc = c + 1;
+            } else if (r != rows - 1){
+                nr = r + 1;
+            } else {
+                nr = r - 1;
+            }
+            glm::vec3 tangent = position - glm::vec3(ground_.GetMeshX(nc), ground_.GetCellHeight(nr, nc), ground_.GetMeshZ(nr));
+
+            vertex[0] = position.x;
+            vertex[1] = position.y;
+            vertex[2] = position.z;
+            vertex[3] = 0.0f;
+            vertex[4] = 1.0f;
+            vertex[5] = 0.0f;
+            vertex[6] = tangent.x;
+            vertex[7] = tangent.y;
+            vertex[8] = tangent.z;
+            vertex[9] = uvs[(r * columns + c) * 2];
+            vertex[10] = uvs[(r * columns + c) * 2 + 1];
+            vertex += vertex_att;
+        }
+    }
+
+    data->indices.reserve((width - 1) * (height - 1) * 6);
+    for (int r = 0; r < height - 1; r++){
+        for (int c = 0; c < width - 1; c++){
+            GLuint quad = r * width + c;
+
+            // triangle 1
+            data->indices.push_back(quad);
+            data->indices.push_back(quad + 1);
+            data->indices.push_back(quad + width + 1);
+
+            // triangle 2
+            data->indices.push_back(quad);
+            data->indices.push_back(quad + width);
+            data->indices.push_back(quad + width + 1);
+        }
+    }
+
+    // Instances: the part of the placement area in the chunk holds its
+    // share of every family. Samples keep half the minimum distance from
+    // the chunk border, so instances of neighbouring chunks keep it too
+    const PlacementArea& whole = settings_.placement_area;
+    PlacementArea area;
+    area.min_x = std::max(ground_.GetWorldX(c0), whole.min_x);
+    area.max_x = std::min(ground_.GetWorldX(c1), whole.max_x);
+    area.min_z = std::max(ground_.GetWorldZ(r0), whole.min_z);
+    area.max_z = std::min(ground_.GetWorldZ(r1), whole.max_z);
+    float share = AreaOf(area) / AreaOf(whole);
+
+    float margin = settings_.min_distance * 0.5f;
+    area.min_x += margin;
+    area.max_x -= margin;
+    area.min_z += margin;
+    area.max_z -= margin;
+
+    std::vector<PlacementFamily> families;
+    for (size_t i = 0; i < settings_.groups.size(); i++){
+        for (size_t j = 0; j < settings_.groups[i].members.size(); j++){
+            PlacementFamily family = settings_.groups[i].members[j].placement;
+            family.amount = static_cast<int>(std::lround(family.amount * share));
+            family.seed ^= static_cast<uint64_t>(key) * 0x9e3779b97f4a7c15ull;
+            families.push_back(family);
+        }
+    }
+    std::vector<std::vector<glm::vec2> > placed(families.size());
+    if (AreaOf(area) > 0.0f){
+        // Already on a worker, so the families are sampled in turn
+        placed = PoissonPlacer(area, settings_.min_distance).Place(families, false);
+    }
+
+    // Put all the instances on the ground at once
+    std::vector<float> xs, zs;
+    for (size_t i = 0; i < placed.size(); i++){
+        for (size_t j = 0; j < placed[i].size(); j++){
+            xs.push_back(placed[i][j].x);
+            zs.push_back(placed[i][j].y);
+        }
+    }
+    std::vector<float> heights(xs.size());
+    ground_.GetHeights(xs.data(), zs.data(), heights.data(), xs.size());
+
+    size_t next = 0;
+    size_t family = 0;
+    data->positions.resize(settings_.groups.size());
+    for (size_t i = 0; i < settings_.groups.size(); i++){
+        const StreamedGroup& group = settings_.groups[i];
+        data->positions[i].resize(group.members.size());
+        for (size_t j = 0; j < group.members.size(); j++, family++){
+            const glm::vec3& box = group.members[j].bounding_box;
+            for (size_t k = 0; k < placed[family].size(); k++, next++){
+                glm::vec3 position(xs[next], heights[next] - 3, zs[next]);
+                data->positions[i][j].push_back(position);
+
+                Entity entity(box.x, box.y, box.z, position);
+                entity.setOrientation(glm::angleAxis(glm::radians(0.0f), glm::vec3(0, 1, 0)));
+                data->boxes.push_back(entity.getBBox());
+            }
+        }
+    }
+
+    return data;
+}
+
+
+size_t WorldStreamer::uploadChunk(ChunkData* data){
+
+    Chunk* chunk = new Chunk;
+    chunk->data = data;
+
+    std::ostringstream name;
+    name << "TerrainChunk_" << KeyX(data->key) << "_" << KeyZ(data->key);
+    chunk->name = name.str();
+
+    size_t bytes = data->vertices.size() * sizeof(GLfloat) + data->indices.size() * sizeof(GLuint);
+
+    glGenBuffers(1, &chunk->array_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk->array_buffer);
+    glBufferData(GL_ARRAY_BUFFER, data->vertices.size() * sizeof(GLfloat), data->vertices.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &chunk->element_array_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk->element_array_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, data->indices.size() * sizeof(GLuint), data->indices.data(), GL_STATIC_DRAW);
+
+    chunk->geometry = new Resource(Mesh, chunk->name, chunk->array_buffer, chunk->element_array_buffer, static_cast<GLsizei>(data->indices.size()));
+
+    // Placed like the whole terrain; ground goes before the blended nodes
+    SceneNode* node = new SceneNode(chunk->name, chunk->geometry, settings_.terrain_material, settings_.terrain_texture);
+    node->SetPosition(ground_.GetPosition());
+    node->SetScale(ground_.GetScale());
+    node->SetLayer(TerrainLayer);
+    scene_.AddNodeFirst(node);
+
+    for (size_t i = 0; i < data->boxes.size(); i++){
+        chunk->handles.push_back(collision_world_.Add(data->boxes[i]));
+    }
+
+    // Only the instance positions are needed from now on
+    std::vector<GLfloat>().swap(data->vertices);
+    std::vector<GLuint>().swap(data->indices);
+    std::vector<BoundingBox>().swap(data->boxes);
+
+    resident_[data->key] = chunk;
+    instances_dirty_ = true;
+
+    return bytes;
+}
+
+
+void WorldStreamer::unloadChunk(Chunk* chunk){
+
+    scene_.DeleteNode(chunk->name);
+    delete chunk->geometry;
+    glDeleteBuffers(1, &chunk->array_buffer);
+    glDeleteBuffers(1, &chunk->element_array_buffer);
+
+    for (size_t i = 0; i < chunk->handles.size(); i++){
+        collision_world_.Remove(chunk->handles[i]);
+    }
+
+    delete chunk->data;
+    delete chunk;
+    instances_dirty_ = true;
+}
+
+
+size_t WorldStreamer::uploadInstances(void){
+
+    // Gather the chunks in key order rather than in the order of the
+    // hash map, which changes as chunks come and go; the families then
+    // only upload the instances after the chunks that changed
+    std::vector<ChunkKey> keys;
+    keys.reserve(resident_.size());
+    for (std::unordered_map<ChunkKey, Chunk*>::const_iterator it = resident_.begin(); it != resident_.end(); ++it){
+        keys.push_back(it->first);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < families_.size(); i++){
+        const StreamedGroup& group = settings_.groups[i];
+        std::vector<InstancedFamilyMember> members(group.members.size());
+        for (size_t j = 0; j < members.size(); j++){
+            members[j].geometry = group.members[j].geometry;
+            members[j].layer = group.members[j].layer;
+        }
+
+        for (size_t k = 0; k < keys.size(); k++){
+            const std::vector<std::vector<glm::vec3> >& positions = resident_.at(keys[k])->data->positions[i];
+            for (size_t j = 0; j < members.size(); j++){
+                members[j].positions.insert(members[j].positions.end(), positions[j].begin(), positions[j].end());
+            }
+        }
+
+        for (size_t j = 0; j < members.size(); j++){
+            members[j].scales.assign(members[j].positions.size(), group.members[j].scale);
+            members[j].orientations.assign(members[j].positions.size(), glm::angleAxis(glm::radians(0.0f), glm::vec3(0, 1, 0)));
+        }
+        bytes += families_[i]->SetInstances(members);
+    }
+
+    return bytes;
+}
+
+} // namespace game
@@ -0,0 +1,163 @@
+#ifndef WORLD_STREAMER_H_
+#define WORLD_STREAMER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "collision_world.h"
+#include "instanced_family.h"
+#include "placement.h"
+#include "resource.h"
+#include "scene_graph.h"
+#include "world_grid.h"
+#include "world_grid_file.h"
+
+namespace game {
+
+    // A mesh whose instances are spread over the streamed chunks
+    struct StreamedMember {
+        const Resource* geometry;
+        int layer; // Texture layer in the group's texture array
+        float scale; // Uniform
+        glm::vec3 bounding_box; // Collision box of each instance
+        PlacementFamily placement; // Amount over the whole placement area
+    };
+
+    // Members drawn together as one instanced family
+    struct StreamedGroup {
+        std::string name;
+        const Resource* material;
+        const Resource* texture_array;
+        std::vector<StreamedMember> members;
+    };
+
+    struct WorldStreamerSettings {
+        int chunk_cells; // Cells of the world grid along each side of a chunk
+        int load_radius; // Chunks around the player that are loaded
+        int unload_radius; // Chunks further away than this are unloaded
+        size_t upload_budget; // Bytes sent to the GPU per frame
+        const Resource* terrain_material;
+        const Resource* terrain_texture;
+        PlacementArea placement_area; // Where instances may be placed
+        float min_distance; // Between any two instances
+        std::vector<StreamedGroup> groups;
+    };
+
+    // Streams the world in square chunks of the world grid around the
+    // player. A chunk holds a patch of the terrain mesh, the instances
+    // placed on it and their collision boxes. A worker thread builds the
+    // chunks nearest to the player first; the main thread uploads them
+    // within a byte budget per frame and unloads the chunks left behind, so
+    // memory use follows the load radius and not the size of the map
+    class WorldStreamer {
+
+        public:
+            WorldStreamer(SceneGraph& scene, CollisionWorld& collision_world);
+            ~WorldStreamer();
+
+            // Start streaming a world. 'ground' is copied, so the worker
+            // never sees the changes made to it while playing; 'file' must
+            // stay open while streaming
+            void Start(const WorldGrid& ground, const WorldGridFile& file, const WorldStreamerSettings& settings);
+            // Stop the worker and unload every chunk
+            void Stop(void);
+
+            // Follow the player: request the chunks around it, upload the
+            // built ones within the budget and unload those left behind.
+            // Call once per frame
+            void Update(const glm::vec3& position);
+            // Load every chunk around a position before returning,
+            // regardless of the budget
+            void Flush(const glm::vec3& position);
+
+            size_t GetResidentCount(void) const;
+            // Resident chunks and how long the last flush took
+            void PrintStats(void) const;
+
+        private:
+            typedef int64_t ChunkKey;
+
+            // Chunk as built by the worker, before anything is on the GPU
+            struct ChunkData {
+                ChunkKey key;
+                std::vector<GLfloat> vertices;
+                std::vector<GLuint> indices;
+                std::vector<std::vector<std::vector<glm::vec3> > > positions; // Per group and member
+                std::vector<BoundingBox> boxes;
+            };
+
+            // Chunk in the scene
+            struct Chunk {
+                ChunkData* data;
+                std::string name; // Name of the terrain node
+                GLuint array_buffer;
+                GLuint element_array_buffer;
+                Resource* geometry;
+                std::vector<CollisionWorld::Handle> handles;
+            };
+
+            static ChunkKey MakeKey(int x, int z);
+            static int KeyX(ChunkKey key);
+            static int KeyZ(ChunkKey key);
+            // Squared distance in chunks from the chunk of the player
+            int distanceToCenter(ChunkKey key) const;
+
+            void update(const glm::vec3& position, size_t budget);
+            // Unload and forget the chunks left behind, request the new ones
+            void refreshRing(void);
+
+            void workerLoop(void);
+            // Build the terrain patch and the instances of a chunk; only
+            // reads state that does not change while streaming
+            ChunkData* buildChunk(ChunkKey key) const;
+
+            // Returns the number of bytes uploaded
+            size_t uploadChunk(ChunkData* data);
+            void unloadChunk(Chunk* chunk);
+            // Gather the instances of the resident chunks into the families
+            size_t uploadInstances(void);
+
+            SceneGraph& scene_;
+            CollisionWorld& collision_world_;
+
+            // Fixed while streaming
+            WorldGrid ground_;
+            const WorldGridFile* file_;
+            WorldStreamerSettings settings_;
+            int chunk_columns_, chunk_rows_;
+            std::vector<InstancedFamily*> families_; // One per group
+
+            // Shared with the worker
+            std::thread worker_;
+            std::mutex mutex_;
+            std::condition_variable work_condition_;
+            std::condition_variable done_condition_;
+            bool stop_;
+            std::vector<ChunkKey> pending_; // Chunks to build
+            std::vector<ChunkData*> finished_; // Chunks built
+            int center_x_, center_z_; // Chunk of the player
+
+            // Main thread only
+            bool has_center_;
+            std::unordered_map<ChunkKey, Chunk*> resident_;
+            std::unordered_set<ChunkKey> requested_; // Wanted but not resident yet
+            std::vector<ChunkData*> ready_; // Built, waiting for upload
+            bool instances_dirty_;
+            double flush_time_; // Milliseconds the last flush took
+
+    }; // class WorldStreamer
+
+} // namespace game
+
+#endif // WORLD_STREAMER_H_